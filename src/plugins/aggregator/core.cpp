@@ -39,6 +39,7 @@
 #include <QTextCodec>
 #include <QXmlStreamWriter>
 #include <QNetworkReply>
+#include <QtConcurrentRun>
 #include <interfaces/iwebbrowser.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/itagsmanager.h>
@@ -54,6 +55,7 @@
 #include <util/sll/qtutil.h>
 #include <util/sll/visitor.h>
 #include <util/sll/either.h>
+#include <util/threads/futures.h>
 #include "core.h"
 #include "xmlsettingsmanager.h"
 #include "parserfactory.h"
@@ -75,11 +77,62 @@
 #include "dbupdatethreadworker.h"
 #include "dumbstorage.h"
 #include "storagebackendmanager.h"
+#include "streamparser.h"
+#include "feedfetch.h"
 
 namespace LeechCraft
 {
 namespace Aggregator
 {
+	namespace
+	{
+		using ParseResult_t = Util::Either<QString, channels_container_t>;
+
+		/* Runs in a worker thread: the feed ID is filled in by the caller
+		 * once the channels are back in the GUI thread.
+		 */
+		ParseResult_t ParseFeedFile (const QString& filename, const QString& url)
+		{
+			QFile file { filename };
+			if (!file.open (QIODevice::ReadOnly))
+				return ParseResult_t::Left (Core::tr ("Could not open file %1 from %2.")
+						.arg (filename)
+						.arg (url));
+
+			StreamParser streamParser { &file, IDNotFound };
+			if (streamParser.Parse () == StreamParser::Result::Parsed)
+				return ParseResult_t::Right (streamParser.GetChannels ());
+
+			// Feeds the streaming parser can't handle go through the DOM parsers.
+			file.seek (0);
+
+			QDomDocument doc;
+			QString errorMsg;
+			int errorLine, errorColumn;
+			if (!doc.setContent (&file, true, &errorMsg, &errorLine, &errorColumn))
+			{
+				file.copy (QDir::tempPath () + "/failedFile.xml");
+				return ParseResult_t::Left (Core::tr ("XML file parse error: %1, line %2, column %3, filename %4, from %5")
+						.arg (errorMsg)
+						.arg (errorLine)
+						.arg (errorColumn)
+						.arg (filename)
+						.arg (url));
+			}
+
+			const auto parser = ParserFactory::Instance ().Return (doc);
+			if (!parser)
+			{
+				file.copy (QDir::tempPath () + "/failedFile.xml");
+				return ParseResult_t::Left (Core::tr ("Could not find parser to parse file %1 from %2")
+						.arg (filename)
+						.arg (url));
+			}
+
+			return ParseResult_t::Right (parser->ParseFeed (doc, IDNotFound));
+		}
+	}
+
 	Core::Core ()
 	{
 		qRegisterMetaType<IDType_t> ("IDType_t");
@@ -129,7 +182,7 @@ namespace Aggregator
 
 	Util::IDPool<IDType_t>& Core::GetPool (PoolType type)
 	{
-		return Pools_ [type];
+		return Pools_.at (type);
 	}
 
 	bool Core::CouldHandle (const Entity& e)
@@ -359,13 +412,8 @@ namespace Aggregator
 		if (!result)
 			return false;
 
-		Pools_.clear ();
 		for (int type = 0; type < PTMAX; ++type)
-		{
-			Util::IDPool<IDType_t> pool;
-			pool.SetID (StorageBackend_->GetHighestID (static_cast<PoolType> (type)) + 1);
-			Pools_ [static_cast<PoolType> (type)] = pool;
-		}
+			Pools_ [type].SetID (StorageBackend_->GetHighestID (static_cast<PoolType> (type)) + 1);
 
 		return true;
 	}
@@ -488,8 +536,7 @@ namespace Aggregator
 
 		StorageBackend_->GetFeed (channel.FeedID_) * [&] (auto&& feed) { ci.URL_ = feed.URL_; };
 
-		// TODO introduce a method in SB for this
-		ci.NumItems_ = StorageBackend_->GetItems (channel.ChannelID_).size ();
+		ci.NumItems_ = StorageBackend_->GetTotalItems (channel.ChannelID_);
 
 		return ci;
 	}
@@ -769,13 +816,13 @@ namespace Aggregator
 		PendingJobs_.remove (id);
 		ID2Downloader_.remove (id);
 
-		Util::FileRemoveGuard file (pj.Filename_);
-		if (!file.open (QIODevice::ReadOnly))
+		const auto file = std::make_shared<Util::FileRemoveGuard> (pj.Filename_);
+		if (!file->open (QIODevice::ReadOnly))
 		{
 			qWarning () << Q_FUNC_INFO << "could not open file for pj " << pj.Filename_;
 			return;
 		}
-		if (!file.size ())
+		if (!file->size ())
 		{
 			if (pj.Role_ != PendingJob::RFeedExternalData)
 				ErrorNotification (tr ("Feed error"),
@@ -783,64 +830,14 @@ namespace Aggregator
 			return;
 		}
 
-		channels_container_t channels;
-		if (pj.Role_ != PendingJob::RFeedExternalData)
+		if (pj.Role_ == PendingJob::RFeedExternalData)
 		{
-			QByteArray data = file.readAll ();
-			QDomDocument doc;
-			QString errorMsg;
-			int errorLine, errorColumn;
-			if (!doc.setContent (data, true, &errorMsg, &errorLine, &errorColumn))
-			{
-				file.copy (QDir::tempPath () + "/failedFile.xml");
-				ErrorNotification (tr ("Feed error"),
-						tr ("XML file parse error: %1, line %2, column %3, filename %4, from %5")
-						.arg (errorMsg)
-						.arg (errorLine)
-						.arg (errorColumn)
-						.arg (pj.Filename_)
-						.arg (pj.URL_));
-				return;
-			}
-
-			Parser *parser = ParserFactory::Instance ().Return (doc);
-			if (!parser)
-			{
-				file.copy (QDir::tempPath () + "/failedFile.xml");
-				ErrorNotification (tr ("Feed error"),
-						tr ("Could not find parser to parse file %1 from %2")
-						.arg (pj.Filename_)
-						.arg (pj.URL_));
-				return;
-			}
-
-			IDType_t feedId = IDNotFound;
-			if (pj.Role_ == PendingJob::RFeedAdded)
-			{
-				Feed feed;
-				feed.URL_ = pj.URL_;
-				StorageBackend_->AddFeed (feed);
-				feedId = feed.FeedID_;
-			}
-			else
-				feedId = StorageBackend_->FindFeed (pj.URL_);
-
-			if (feedId == IDNotFound)
-			{
-				ErrorNotification (tr ("Feed error"),
-						tr ("Feed with url %1 not found.").arg (pj.URL_));
-				return;
-			}
-
-			channels = parser->ParseFeed (doc, feedId);
+			HandleExternalData (pj.URL_, *file);
+			return;
 		}
 
-		if (pj.Role_ == PendingJob::RFeedAdded)
-			HandleFeedAdded (channels, pj);
-		else if (pj.Role_ == PendingJob::RFeedUpdated)
-			HandleFeedUpdated (channels, pj);
-		else if (pj.Role_ == PendingJob::RFeedExternalData)
-			HandleExternalData (pj.URL_, file);
+		file->close ();
+		ParseDownloadedFeed (pj, file);
 	}
 
 	void Core::handleJobRemoved (int id)
@@ -1002,63 +999,75 @@ namespace Aggregator
 		}
 
 		const auto& url = maybeFeed->URL_;
-		for (const auto& pair : Util::Stlize (PendingJobs_))
-			if (pair.second.URL_ == url)
-			{
-				const auto id = pair.first;
-				QObject *provider = ID2Downloader_ [id];
-				IDownload *downloader = qobject_cast<IDownload*> (provider);
-				if (downloader)
+
+		if (const auto stalled = FeedFetches_.take (id))
+		{
+			qWarning () << Q_FUNC_INFO
+				<< "stalled update detected for"
+				<< url
+				<< "aborting...";
+			stalled->Abort ();
+		}
+
+		// The reply is aborted if no data arrives for this long.
+		const int stallTimeout = 60 * 1000;
+
+		const auto& fetchState = StorageBackend_->GetFeedFetchState (id);
+		const auto fetch = new FeedFetch { Proxy_->GetNetworkAccessManager (),
+				url, id, fetchState, stallTimeout, this };
+		FeedFetches_ [id] = fetch;
+		Util::Sequence (this, fetch->GetFuture ()) >>
+				[this, fetch, id, url, fetchState] (const FeedFetchResult& result)
 				{
-					qWarning () << Q_FUNC_INFO
-						<< "stalled task detected from"
-						<< downloader
-						<< "trying to kill...";
-
-					downloader->KillTask (id);
-					ID2Downloader_.remove (id);
-					qWarning () << Q_FUNC_INFO
-						<< "killed!";
-				}
-				else
-					qWarning () << Q_FUNC_INFO
-						<< "provider is not a downloader:"
-						<< provider
-						<< "; cannot kill the task";
-			}
-		PendingJobs_.clear ();
+					if (FeedFetches_.value (id) == fetch)
+						FeedFetches_.remove (id);
+					HandleFeedFetched (result, url, fetchState);
+				};
 
-		QString filename = Util::GetTemporaryName ();
+		Updates_ [id] = QDateTime::currentDateTime ();
+	}
 
-		Entity e = Util::MakeEntity (QUrl (url),
-				filename,
-				Internal |
-					DoNotNotifyUser |
-					DoNotSaveInHistory |
-					NotPersistent |
-					DoNotAnnounceEntity);
+	void Core::HandleFeedFetched (const FeedFetchResult& result,
+			const QString& url, const boost::optional<Feed::FetchState>& oldState)
+	{
+		switch (result.Outcome_)
+		{
+		// The server has confirmed our validators, nothing to do.
+		case FeedFetchResult::Outcome::NotModified:
+		case FeedFetchResult::Outcome::Aborted:
+			return;
+		case FeedFetchResult::Outcome::Error:
+			if (!XmlSettingsManager::Instance ()->property ("BeSilent").toBool ())
+				ErrorNotification (tr ("Download error"),
+						tr ("Unable to download feed %1: %2")
+							.arg (url)
+							.arg (result.Error_));
+			return;
+		case FeedFetchResult::Outcome::Empty:
+			ErrorNotification (tr ("Feed error"),
+					tr ("Downloaded file from url %1 has null size.").arg (url));
+			return;
+		// The server ignores the validators, but the document is the same.
+		case FeedFetchResult::Outcome::Unchanged:
+			if (oldState->ETag_ != result.State_.ETag_ ||
+					oldState->LastModified_ != result.State_.LastModified_)
+				StorageBackend_->SetFeedFetchState (result.State_);
+			return;
+		case FeedFetchResult::Outcome::Updated:
+			break;
+		}
 
-		PendingJob pj =
+		const auto file = std::make_shared<Util::FileRemoveGuard> (result.FileName_);
+		const PendingJob pj
 		{
 			PendingJob::RFeedUpdated,
 			url,
-			filename,
+			result.FileName_,
 			{},
-			{}
+			{},
+			result.State_
 		};
-
-		const auto& delegateResult = Proxy_->GetEntityManager ()->DelegateEntity (e);
-		if (!delegateResult)
-		{
-			ErrorNotification ("Aggregator",
-					tr ("Could not find plugin for feed with URL %1")
-						.arg (url));
-			return;
-		}
-
-		HandleProvider (delegateResult.Handler_, delegateResult.ID_);
-		PendingJobs_ [delegateResult.ID_] = pj;
-		Updates_ [id] = QDateTime::currentDateTime ();
+		ParseDownloadedFeed (pj, file);
 	}
 
 	void Core::FetchPixmap (const Channel& channel)
@@ -1130,6 +1139,62 @@ namespace Aggregator
 		StorageBackend_->UpdateChannel (channel);
 	}
 
+	void Core::ParseDownloadedFeed (const PendingJob& pj, const std::shared_ptr<QFile>& file)
+	{
+		// Either isn't default-constructible, so report the result manually
+		// instead of relying on QtConcurrent to store it.
+		QFutureInterface<ParseResult_t> iface;
+		iface.reportStarted ();
+		QtConcurrent::run ([iface, filename = pj.Filename_, url = pj.URL_] () mutable
+				{
+					Util::ReportFutureResult (iface, &ParseFeedFile, filename, url);
+				});
+
+		Util::Sequence (this, iface.future ()) >>
+				[this, pj, file] (const ParseResult_t& result)
+				{
+					if (result.IsLeft ())
+					{
+						ErrorNotification (tr ("Feed error"), result.GetLeft ());
+						return;
+					}
+
+					IDType_t feedId = IDNotFound;
+					if (pj.Role_ == PendingJob::RFeedAdded)
+					{
+						Feed feed;
+						feed.URL_ = pj.URL_;
+						StorageBackend_->AddFeed (feed);
+						feedId = feed.FeedID_;
+					}
+					else
+						feedId = StorageBackend_->FindFeed (pj.URL_);
+
+					if (feedId == IDNotFound)
+					{
+						ErrorNotification (tr ("Feed error"),
+								tr ("Feed with url %1 not found.").arg (pj.URL_));
+						return;
+					}
+
+					auto channels = result.GetRight ();
+					for (const auto& channel : channels)
+						channel->FeedID_ = feedId;
+
+					if (pj.Role_ == PendingJob::RFeedAdded)
+						HandleFeedAdded (channels, pj);
+					else
+						HandleFeedUpdated (channels, pj);
+
+					if (pj.FetchState_)
+					{
+						auto state = *pj.FetchState_;
+						state.FeedID_ = feedId;
+						StorageBackend_->SetFeedFetchState (state);
+					}
+				};
+	}
+
 	void Core::HandleFeedAdded (const channels_container_t& channels,
 			const Core::PendingJob& pj)
 	{
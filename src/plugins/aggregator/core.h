@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <QAbstractItemModel>
 #include <QString>
@@ -66,6 +67,8 @@ namespace Aggregator
 	class JobHolderRepresentation;
 	class ChannelsFilterModel;
 	class PluginManager;
+	class FeedFetch;
+	struct FeedFetchResult;
 
 	class Core : public QObject
 	{
@@ -95,6 +98,7 @@ namespace Aggregator
 			QString Filename_;
 			QStringList Tags_;
 			boost::optional<Feed::FeedSettings> FeedSettings_;
+			boost::optional<Feed::FetchState> FetchState_;
 		};
 		struct ExternalData
 		{
@@ -120,6 +124,7 @@ namespace Aggregator
 		bool Initialized_ = false;
 
 		QList<IDType_t> UpdatesQueue_;
+		QHash<IDType_t, FeedFetch*> FeedFetches_;
 
 		PluginManager *PluginManager_ = nullptr;
 
@@ -129,7 +134,11 @@ namespace Aggregator
 
 		Core ();
 	private:
-		QHash<PoolType, Util::IDPool<IDType_t>> Pools_;
+		/** Indexed by PoolType. All pools exist from the start, so
+		 * GetPool() never modifies the container and is safe to call
+		 * from the worker threads.
+		 */
+		std::array<Util::IDPool<IDType_t>, PTMAX> Pools_;
 	public:
 		struct ChannelInfo
 		{
@@ -226,6 +235,9 @@ namespace Aggregator
 		void FetchPixmap (const Channel&);
 		void FetchFavicon (const Channel&);
 		void HandleExternalData (const QString&, const QFile&);
+		void HandleFeedFetched (const FeedFetchResult&,
+				const QString&, const boost::optional<Feed::FetchState>&);
+		void ParseDownloadedFeed (const PendingJob&, const std::shared_ptr<QFile>&);
 		void HandleFeedAdded (const channels_container_t&,
 				const PendingJob&);
 		void HandleFeedUpdated (const channels_container_t&,
@@ -30,11 +30,12 @@
 #include "dbupdatethreadworker.h"
 #include <stdexcept>
 #include <boost/optional.hpp>
+#include <QHash>
+#include <QSet>
 #include <QUrl>
 #include <QtDebug>
 #include <util/xpc/util.h>
 #include <util/xpc/defaulthookproxy.h>
-#include <util/sll/lazy.h>
 #include <interfaces/core/ientitymanager.h>
 #include "xmlsettingsmanager.h"
 #include "storagebackend.h"
@@ -107,7 +108,7 @@ namespace Aggregator
 		Proxy_->GetEntityManager ()->HandleEntity (Util::MakeNotification ("Aggregator", str, Priority::Info));
 	}
 
-	bool DBUpdateThreadWorker::AddItem (Item& item, const Channel& channel, const Feed::FeedSettings& settings)
+	bool DBUpdateThreadWorker::PrepareNewItem (Item& item, const Channel& channel, const Feed::FeedSettings& settings)
 	{
 		if (item.PubDate_.isValid ())
 		{
@@ -118,29 +119,29 @@ namespace Aggregator
 			item.FixDate ();
 
 		item.ChannelID_ = channel.ChannelID_;
-		SB_->AddItem (item);
-
-		emit hookGotNewItems (std::make_shared<Util::DefaultHookProxy> (), { item });
+		return true;
+	}
 
+	void DBUpdateThreadWorker::DownloadEnclosures (const QList<Item>& items, const Channel& channel)
+	{
 		const auto iem = Proxy_->GetEntityManager ();
-		if (settings.AutoDownloadEnclosures_)
+		const auto& path = XmlSettingsManager::Instance ()->property ("EnclosuresDownloadPath").toString ();
+		for (const auto& item : items)
 			for (const auto& e : item.Enclosures_)
 			{
 				auto de = Util::MakeEntity (QUrl (e.URL_),
-						XmlSettingsManager::Instance ()->property ("EnclosuresDownloadPath").toString (),
+						path,
 						0,
 						e.Type_);
 				de.Additional_ [" Tags"] = channel.Tags_;
 				iem->HandleEntity (de);
 			}
-
-		return true;
 	}
 
-	bool DBUpdateThreadWorker::UpdateItem (const Item& item, Item ourItem)
+	boost::optional<Item> DBUpdateThreadWorker::MergeItem (const Item& item, Item ourItem) const
 	{
 		if (!IsModified (ourItem, item))
-			return false;
+			return {};
 
 		ourItem.Description_ = item.Description_;
 		ourItem.Categories_ = item.Categories_;
@@ -164,12 +165,147 @@ namespace Aggregator
 				ourItem.MRSSEntries_ << entry;
 			}
 
-		SB_->UpdateItem (ourItem);
+		return ourItem;
+	}
+
+	namespace
+	{
+		/* Mirrors the StorageBackend::FindItem(), FindItemByLink() and
+		 * FindItemByTitle() lookup chain over the items already known
+		 * for a channel, so that a whole channel can be matched after
+		 * a single query.
+		 *
+		 * Just like FindItemByLink(), an empty link never matches by
+		 * link alone, and the title-only fallback is only taken for
+		 * items without a link, so the matching rules are the same as
+		 * with the per-item queries.
+		 */
+		class ItemsIndex
+		{
+			QHash<QPair<QString, QString>, IDType_t> ByTitleLink_;
+			QHash<QString, IDType_t> ByLink_;
+			QHash<QString, IDType_t> ByTitle_;
+		public:
+			void Add (const QString& title, const QString& link, IDType_t id)
+			{
+				if (!ByTitleLink_.contains ({ title, link }))
+					ByTitleLink_ [{ title, link }] = id;
+				if (!link.isEmpty () && !ByLink_.contains (link))
+					ByLink_ [link] = id;
+				if (!ByTitle_.contains (title))
+					ByTitle_ [title] = id;
+			}
 
-		return true;
+			boost::optional<IDType_t> Find (const QString& title, const QString& link) const
+			{
+				const auto pos = ByTitleLink_.constFind ({ title, link });
+				if (pos != ByTitleLink_.constEnd ())
+					return *pos;
+
+				if (!link.isEmpty ())
+				{
+					const auto linkPos = ByLink_.constFind (link);
+					if (linkPos != ByLink_.constEnd ())
+						return *linkPos;
+					return {};
+				}
+
+				const auto titlePos = ByTitle_.constFind (title);
+				if (titlePos != ByTitle_.constEnd ())
+					return *titlePos;
+				return {};
+			}
+		};
+	}
+
+	void DBUpdateThreadWorker::MergeChannel (const Channel& channel,
+			const Channel& ourChannel, const Feed::FeedSettings& settings)
+	{
+		ItemsIndex index;
+		for (const auto& item : SB_->GetItems (ourChannel.ChannelID_))
+			index.Add (item.Title_, item.URL_, item.ItemID_);
+
+		QList<Item> added;
+		QList<Item> updated;
+
+		// Items occurring more than once in the same feed are merged into
+		// the first occurrence, just like they'd be if written one by one.
+		QHash<IDType_t, int> addedPositions;
+		QHash<IDType_t, int> updatedPositions;
+
+		// Full items are only needed to merge into, so just the stored
+		// items matched by the incoming ones are loaded, all at once.
+		// Matching against the stored items alone finds all the ones the
+		// loop below may find, since the items it adds to the index never
+		// replace the existing entries.
+		QSet<IDType_t> matchedIds;
+		for (const auto& item : channel.Items_)
+			if (const auto& ourItemID = index.Find (item->Title_, item->Link_))
+				matchedIds << *ourItemID;
+
+		QHash<IDType_t, Item_ptr> ourItems;
+		if (!matchedIds.isEmpty ())
+			for (const auto& ourItem : SB_->GetFullItems (matchedIds.toList ()))
+				ourItems [ourItem->ItemID_] = ourItem;
+
+		for (const auto& itemPtr : channel.Items_)
+		{
+			auto item = *itemPtr;
+
+			const auto& ourItemID = index.Find (item.Title_, item.Link_);
+			if (!ourItemID)
+			{
+				if (!PrepareNewItem (item, ourChannel, settings))
+					continue;
+
+				index.Add (item.Title_, item.Link_, item.ItemID_);
+				addedPositions [item.ItemID_] = added.size ();
+				added << item;
+				continue;
+			}
+
+			if (addedPositions.contains (*ourItemID))
+			{
+				auto& ourItem = added [addedPositions [*ourItemID]];
+				if (const auto& merged = MergeItem (item, ourItem))
+					ourItem = *merged;
+			}
+			else if (updatedPositions.contains (*ourItemID))
+			{
+				auto& ourItem = updated [updatedPositions [*ourItemID]];
+				if (const auto& merged = MergeItem (item, ourItem))
+					ourItem = *merged;
+			}
+			else
+			{
+				const auto& ourItem = ourItems.value (*ourItemID);
+				if (!ourItem)
+					continue;
+
+				if (const auto& merged = MergeItem (item, *ourItem))
+				{
+					updatedPositions [*ourItemID] = updated.size ();
+					updated << *merged;
+				}
+			}
+		}
+
+		SB_->MergeItems (added, updated);
+
+		if (!added.isEmpty ())
+		{
+			emit hookGotNewItems (std::make_shared<Util::DefaultHookProxy> (), added);
+
+			if (settings.AutoDownloadEnclosures_)
+				DownloadEnclosures (added, ourChannel);
+		}
+
+		SB_->TrimChannel (ourChannel.ChannelID_, settings.ItemAge_, settings.NumItems_);
+
+		NotifyUpdates (added.size (), updated.size (), channel);
 	}
 
-	void DBUpdateThreadWorker::NotifyUpdates (int newItems, int updatedItems, const Channel_ptr& channel)
+	void DBUpdateThreadWorker::NotifyUpdates (int newItems, int updatedItems, const Channel& channel)
 	{
 		const auto& method = XmlSettingsManager::Instance ()->
 				property ("NotificationsFeedUpdateBehavior").toString ();
@@ -190,7 +326,7 @@ namespace Aggregator
 		if (updatedItems)
 			substrs << tr ("%n updated item(s)", "Channel update", updatedItems);
 		const auto& str = tr ("Updated channel \"%1\" (%2).")
-				.arg (channel->Title_)
+				.arg (channel.Title_)
 				.arg (substrs.join (", "));
 		Proxy_->GetEntityManager ()->HandleEntity (Util::MakeNotification ("Aggregator", str, Priority::Info));
 	}
@@ -213,8 +349,6 @@ namespace Aggregator
 		}
 
 		const auto& feedSettings = GetFeedSettings (feedId);
-		const auto ipc = feedSettings.NumItems_;
-		const auto days = feedSettings.ItemAge_;
 
 		for (const auto& channel : channels)
 		{
@@ -226,40 +360,7 @@ namespace Aggregator
 				continue;
 			}
 
-			const auto& ourChannel = *maybeOurChannel;
-
-			int newItems = 0;
-			int updatedItems = 0;
-
-			for (const auto& itemPtr : channel->Items_)
-			{
-				auto& item = *itemPtr;
-
-				auto mkLazy = [] (auto&& f) { return Util::MakeLazyF<boost::optional<IDType_t>> (f); };
-				const auto& ourItemID = Util::Msum ({
-							mkLazy ([&] { return SB_->FindItem (item.Title_, item.Link_, ourChannel.ChannelID_); }),
-							mkLazy ([&] { return SB_->FindItemByLink (item.Link_, ourChannel.ChannelID_); }),
-							mkLazy ([&]
-									{
-										if (!item.Link_.isEmpty ())
-											return boost::optional<IDType_t> {};
-
-										return SB_->FindItemByTitle (item.Title_, ourChannel.ChannelID_);
-									})
-						}) ();
-				if (ourItemID)
-				{
-					if (const auto& ourItem = SB_->GetItem (*ourItemID);
-						ourItem && UpdateItem (item, *ourItem))
-						++updatedItems;
-				}
-				else if (AddItem (item, ourChannel, feedSettings))
-					++newItems;
-			}
-
-			SB_->TrimChannel (ourChannel.ChannelID_, days, ipc);
-
-			NotifyUpdates (newItems, updatedItems, channel);
+			MergeChannel (*channel, *maybeOurChannel, feedSettings);
 		}
 	}
 }
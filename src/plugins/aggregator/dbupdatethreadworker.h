@@ -33,6 +33,7 @@
 #include <functional>
 #include <QObject>
 #include <QVariantList>
+#include <boost/optional.hpp>
 #include <interfaces/core/ihookproxy.h>
 #include <interfaces/core/icoreproxyfwd.h>
 #include "common.h"
@@ -58,9 +59,11 @@ namespace Aggregator
 	private:
 		Feed::FeedSettings GetFeedSettings (IDType_t);
 		void AddChannel (const Channel& channel);
-		bool AddItem (Item& item, const Channel& channel, const Feed::FeedSettings& settings);
-		bool UpdateItem (const Item& item, Item ourItem);
-		void NotifyUpdates (int newItems, int updatedItems, const Channel_ptr& channel);
+		bool PrepareNewItem (Item& item, const Channel& channel, const Feed::FeedSettings& settings);
+		void DownloadEnclosures (const QList<Item>& items, const Channel& channel);
+		boost::optional<Item> MergeItem (const Item& item, Item ourItem) const;
+		void MergeChannel (const Channel& channel, const Channel& ourChannel, const Feed::FeedSettings& settings);
+		void NotifyUpdates (int newItems, int updatedItems, const Channel& channel);
 	public slots:
 		void toggleChannelUnread (IDType_t channel, bool state);
 		void updateFeed (channels_container_t channels, QString url);
@@ -61,6 +61,15 @@ namespace Aggregator
 	{
 	}
 
+	boost::optional<Feed::FetchState> DumbStorage::GetFeedFetchState (const IDType_t&) const
+	{
+		return {};
+	}
+
+	void DumbStorage::SetFeedFetchState (const Feed::FetchState&)
+	{
+	}
+
 	channels_shorts_t DumbStorage::GetChannels (const IDType_t&) const
 	{
 		return {};
@@ -90,6 +99,11 @@ namespace Aggregator
 		return {};
 	}
 
+	int DumbStorage::GetTotalItems (const IDType_t&) const
+	{
+		return {};
+	}
+
 	boost::optional<Item> DumbStorage::GetItem (const IDType_t&) const
 	{
 		return {};
@@ -115,6 +129,11 @@ namespace Aggregator
 		return {};
 	}
 
+	items_container_t DumbStorage::GetFullItems (const QList<IDType_t>&) const
+	{
+		return {};
+	}
+
 	void DumbStorage::AddFeed (const Feed&)
 	{
 	}
@@ -143,6 +162,10 @@ namespace Aggregator
 	{
 	}
 
+	void DumbStorage::MergeItems (const QList<Item>&, const QList<Item>&)
+	{
+	}
+
 	void DumbStorage::RemoveItems (const QSet<IDType_t>&)
 	{
 	}
@@ -44,17 +44,21 @@ namespace Aggregator
 		IDType_t FindFeed (const QString&) const override;
 		boost::optional<Feed::FeedSettings> GetFeedSettings (const IDType_t&) const override;
 		void SetFeedSettings (const Feed::FeedSettings&) override;
+		boost::optional<Feed::FetchState> GetFeedFetchState (const IDType_t&) const override;
+		void SetFeedFetchState (const Feed::FetchState&) override;
 		channels_shorts_t GetChannels (const IDType_t&) const override;
 		boost::optional<Channel> GetChannel (const IDType_t&) const override;
 		IDType_t FindChannel (const QString&, const QString&, const IDType_t&) const override;
 		void TrimChannel (const IDType_t&, int, int) override;
 		items_shorts_t GetItems (const IDType_t&) const override;
 		int GetUnreadItems (const IDType_t&) const override;
+		int GetTotalItems (const IDType_t&) const override;
 		boost::optional<Item> GetItem (const IDType_t&) const override;
 		boost::optional<IDType_t> FindItem (const QString&, const QString&, const IDType_t&) const override;
 		boost::optional<IDType_t> FindItemByTitle (const QString&, const IDType_t&) const override;
 		boost::optional<IDType_t> FindItemByLink (const QString&, const IDType_t&) const override;
 		items_container_t GetFullItems (const IDType_t&) const override;
+		items_container_t GetFullItems (const QList<IDType_t>&) const override;
 		void AddFeed (const Feed&) override;
 		void AddChannel (const Channel&) override;
 		void AddItem (const Item&) override;
@@ -62,6 +66,7 @@ namespace Aggregator
 		void UpdateChannel (const ChannelShort&) override;
 		void UpdateItem (const Item&) override;
 		void UpdateItem (const ItemShort&) override;
+		void MergeItems (const QList<Item>&, const QList<Item>&) override;
 		void RemoveItems (const QSet<IDType_t>&) override;
 		void RemoveChannel (const IDType_t&) override;
 		void RemoveFeed (const IDType_t&) override;
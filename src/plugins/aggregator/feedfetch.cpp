@@ -0,0 +1,207 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "feedfetch.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QtConcurrentRun>
+#include <util/sys/paths.h>
+#include <util/threads/futures.h>
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	FeedFetch::FeedFetch (QNetworkAccessManager *nam, const QString& url, IDType_t feedId,
+			const boost::optional<Feed::FetchState>& oldState, int timeoutMs, QObject *parent)
+	: QObject { parent }
+	, Reply_ { [nam, &url, &oldState]
+			{
+				QNetworkRequest req { QUrl { url } };
+				req.setAttribute (QNetworkRequest::FollowRedirectsAttribute, true);
+				req.setAttribute (QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+				req.setAttribute (QNetworkRequest::CacheSaveControlAttribute, false);
+				if (oldState)
+				{
+					if (!oldState->ETag_.isEmpty ())
+						req.setRawHeader ("If-None-Match", oldState->ETag_);
+					if (!oldState->LastModified_.isEmpty ())
+						req.setRawHeader ("If-Modified-Since", oldState->LastModified_);
+				}
+				return nam->get (req);
+			} () }
+	, StallTimer_ { new QTimer { this } }
+	, FeedID_ { feedId }
+	, OldState_ { oldState }
+	{
+		Promise_.reportStarted ();
+
+		Reply_->setParent (this);
+
+		StallTimer_->setSingleShot (true);
+		StallTimer_->setInterval (timeoutMs);
+		StallTimer_->start ();
+		connect (StallTimer_,
+				&QTimer::timeout,
+				this,
+				[this]
+				{
+					TimedOut_ = true;
+					Reply_->abort ();
+				});
+
+		connect (Reply_,
+				&QNetworkReply::downloadProgress,
+				StallTimer_,
+				[this] { StallTimer_->start (); });
+		connect (Reply_,
+				&QNetworkReply::finished,
+				this,
+				&FeedFetch::HandleFinished);
+	}
+
+	FeedFetch::~FeedFetch ()
+	{
+		if (!Promise_.isFinished ())
+		{
+			const FeedFetchResult result { FeedFetchResult::Outcome::Aborted, {}, {}, {} };
+			Promise_.reportFinished (&result);
+		}
+	}
+
+	QFuture<FeedFetchResult> FeedFetch::GetFuture ()
+	{
+		return Promise_.future ();
+	}
+
+	void FeedFetch::Abort ()
+	{
+		Reply_->abort ();
+	}
+
+	namespace
+	{
+		struct SaveResult
+		{
+			QByteArray Hash_;
+			bool Unchanged_ = false;
+			QString Error_;
+		};
+
+		SaveResult HashAndSave (const QByteArray& data, const QByteArray& oldHash, const QString& fileName)
+		{
+			SaveResult result;
+			result.Hash_ = QCryptographicHash::hash (data, QCryptographicHash::Sha1);
+
+			// The server ignores the validators, but the document is the same.
+			if (result.Hash_ == oldHash)
+			{
+				result.Unchanged_ = true;
+				return result;
+			}
+
+			QFile file { fileName };
+			if (!file.open (QIODevice::WriteOnly) ||
+					file.write (data) != data.size ())
+			{
+				result.Error_ = file.errorString ();
+				file.close ();
+				file.remove ();
+			}
+			return result;
+		}
+	}
+
+	void FeedFetch::HandleFinished ()
+	{
+		StallTimer_->stop ();
+
+		switch (Reply_->error ())
+		{
+		case QNetworkReply::NoError:
+			break;
+		case QNetworkReply::OperationCanceledError:
+			if (TimedOut_)
+				Report ({ FeedFetchResult::Outcome::Error, {}, {}, tr ("the server stopped sending data") });
+			else
+				Report ({ FeedFetchResult::Outcome::Aborted, {}, {}, {} });
+			return;
+		default:
+			Report ({ FeedFetchResult::Outcome::Error, {}, {}, Reply_->errorString () });
+			return;
+		}
+
+		if (Reply_->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt () == 304)
+		{
+			Report ({ FeedFetchResult::Outcome::NotModified, {}, {}, {} });
+			return;
+		}
+
+		const auto& data = Reply_->readAll ();
+		if (data.isEmpty ())
+		{
+			Report ({ FeedFetchResult::Outcome::Empty, {}, {}, {} });
+			return;
+		}
+
+		const Feed::FetchState state
+		{
+			FeedID_,
+			Reply_->rawHeader ("ETag"),
+			Reply_->rawHeader ("Last-Modified"),
+			{}
+		};
+
+		const auto& oldHash = OldState_ ? OldState_->BodyHash_ : QByteArray {};
+		const auto& fileName = Util::GetTemporaryName ();
+		Util::Sequence (this, QtConcurrent::run (HashAndSave, data, oldHash, fileName)) >>
+				[this, state, fileName] (const SaveResult& saved)
+				{
+					auto fullState = state;
+					fullState.BodyHash_ = saved.Hash_;
+
+					if (saved.Unchanged_)
+						Report ({ FeedFetchResult::Outcome::Unchanged, fullState, {}, {} });
+					else if (!saved.Error_.isEmpty ())
+						Report ({ FeedFetchResult::Outcome::Error, {}, {}, saved.Error_ });
+					else
+						Report ({ FeedFetchResult::Outcome::Updated, fullState, fileName, {} });
+				};
+	}
+
+	void FeedFetch::Report (const FeedFetchResult& result)
+	{
+		Promise_.reportFinished (&result);
+		deleteLater ();
+	}
+}
+}
@@ -0,0 +1,126 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QObject>
+#include <QFutureInterface>
+#include "interfaces/aggregator/feed.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	struct FeedFetchResult
+	{
+		enum class Outcome
+		{
+			/** The server confirmed the validators with a 304 reply.
+			 */
+			NotModified,
+
+			/** The document is the same as the last parsed one.
+			 */
+			Unchanged,
+
+			/** The document has changed and is saved to FileName_.
+			 */
+			Updated,
+
+			/** The server returned an empty document.
+			 */
+			Empty,
+
+			Error,
+
+			/** The fetch has been aborted via FeedFetch::Abort().
+			 */
+			Aborted
+		};
+
+		Outcome Outcome_;
+
+		/** The validators and the hash of the fetched document, valid
+		 * for the Unchanged and Updated outcomes.
+		 */
+		Feed::FetchState State_;
+
+		/** The file with the document for the Updated outcome. The
+		 * receiver is responsible for removing it.
+		 */
+		QString FileName_;
+
+		QString Error_;
+	};
+
+	/** @brief Fetches a feed document with a conditional GET request.
+	 *
+	 * The validators from the passed fetch state are sent as
+	 * If-None-Match and If-Modified-Since, and the hash of the fetched
+	 * document is compared to the stored one. Hashing and saving the
+	 * document are done in a worker thread.
+	 *
+	 * The fetch is aborted and reported as an Error if no data arrives
+	 * for the given timeout.
+	 *
+	 * The object deletes itself once the result is reported. If it is
+	 * deleted earlier, the Aborted outcome is reported.
+	 */
+	class FeedFetch : public QObject
+	{
+		Q_OBJECT
+
+		QNetworkReply * const Reply_;
+		QTimer * const StallTimer_;
+
+		const IDType_t FeedID_;
+		const boost::optional<Feed::FetchState> OldState_;
+
+		QFutureInterface<FeedFetchResult> Promise_;
+
+		bool TimedOut_ = false;
+	public:
+		FeedFetch (QNetworkAccessManager*, const QString& url, IDType_t feedId,
+				const boost::optional<Feed::FetchState>& oldState, int timeoutMs, QObject* = nullptr);
+		~FeedFetch ();
+
+		QFuture<FeedFetchResult> GetFuture ();
+
+		void Abort ();
+	private:
+		void HandleFinished ();
+		void Report (const FeedFetchResult&);
+	};
+}
+}
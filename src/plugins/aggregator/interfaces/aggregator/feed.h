@@ -32,6 +32,7 @@
 #include <memory>
 #include <vector>
 #include <QString>
+#include <QByteArray>
 #include <QDateTime>
 #include <QList>
 #include <QMetaType>
@@ -88,6 +89,36 @@ namespace Aggregator
 			bool AutoDownloadEnclosures_ = false;
 		};
 
+		/** @brief Contains the state of the last successful fetch.
+		 *
+		 * This structure is used to skip updates of the feeds that
+		 * haven't changed since they were fetched the last time, either
+		 * via a conditional GET request or by comparing the hash of the
+		 * downloaded document.
+		 */
+		struct FetchState
+		{
+			/** @brief ID of the corresponding feed.
+			 */
+			IDType_t FeedID_ = IDNotFound;
+
+			/** @brief The value of the ETag header of the last reply.
+			 *
+			 * Sent as If-None-Match with the next request.
+			 */
+			QByteArray ETag_;
+
+			/** @brief The value of the Last-Modified header of the last reply.
+			 *
+			 * Sent as If-Modified-Since with the next request.
+			 */
+			QByteArray LastModified_;
+
+			/** @brief The hash of the last parsed document.
+			 */
+			QByteArray BodyHash_;
+		};
+
 		IDType_t FeedID_;
 		QString URL_;
 		QDateTime LastUpdate_;
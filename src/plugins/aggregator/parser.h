@@ -41,6 +41,7 @@ namespace Aggregator
 	class Parser
 	{
 		friend class MRSSParser;
+		friend class StreamParser;
 	public:
 		virtual ~Parser () = default;
 		/** @brief Indicates whether parser could parse the document.
@@ -42,6 +42,7 @@ namespace Aggregator
 {
 	class RSSParser : public Parser
 	{
+		friend class StreamParser;
 	protected:
 		QMap<QString, int> TimezoneOffsets_;
 
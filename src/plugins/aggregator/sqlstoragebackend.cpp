@@ -36,6 +36,7 @@
 #include <QThread>
 #include <QVariant>
 #include <QSqlRecord>
+#include <QMutex>
 #include <util/util.h>
 #include <util/db/dblock.h>
 #include <util/db/util.h>
@@ -50,6 +51,208 @@ namespace LeechCraft
 {
 namespace Aggregator
 {
+	namespace
+	{
+		/* The counters are shared by all the storage instances (there is
+		 * one per thread), so a write done via any of them invalidates
+		 * the counters seen by the others.
+		 *
+		 * Each invalidation bumps the generation, and the counters read
+		 * from the DB are only stored if no invalidation has happened
+		 * since the reading started, so a value read before a concurrent
+		 * transaction commits never gets cached. For that to hold, the
+		 * writers invalidate only after their transaction is committed,
+		 * that is, after their DBLock is destroyed.
+		 *
+		 * Priming covers the channels without items as well, so that
+		 * they don't miss the cache on every query.
+		 */
+		template<typename Counters>
+		class ItemsCountersCache
+		{
+			mutable QMutex Mutex_;
+			QHash<IDType_t, Counters> Counters_;
+			quint64 Generation_ = 0;
+			bool Primed_ = false;
+		public:
+			static ItemsCountersCache& Instance ()
+			{
+				static ItemsCountersCache cache;
+				return cache;
+			}
+
+			quint64 GetGeneration () const
+			{
+				QMutexLocker locker { &Mutex_ };
+				return Generation_;
+			}
+
+			bool IsPrimed () const
+			{
+				QMutexLocker locker { &Mutex_ };
+				return Primed_;
+			}
+
+			boost::optional<Counters> Get (const IDType_t& channelId) const
+			{
+				QMutexLocker locker { &Mutex_ };
+				const auto pos = Counters_.constFind (channelId);
+				if (pos == Counters_.constEnd ())
+					return {};
+				return *pos;
+			}
+
+			void Set (const IDType_t& channelId, const Counters& counters, quint64 generation)
+			{
+				QMutexLocker locker { &Mutex_ };
+				if (generation == Generation_)
+					Counters_ [channelId] = counters;
+			}
+
+			void SetAll (const QHash<IDType_t, Counters>& counters, quint64 generation)
+			{
+				QMutexLocker locker { &Mutex_ };
+				if (generation != Generation_)
+					return;
+
+				Counters_ = counters;
+				Primed_ = true;
+			}
+
+			void Invalidate (const IDType_t& channelId)
+			{
+				QMutexLocker locker { &Mutex_ };
+				Counters_.remove (channelId);
+				++Generation_;
+			}
+
+			void InvalidateAll ()
+			{
+				QMutexLocker locker { &Mutex_ };
+				Counters_.clear ();
+				Primed_ = false;
+				++Generation_;
+			}
+		};
+
+		/* Runs the query in chunks of IDs, substituting the "(id, id, ...)"
+		 * list for %1 in the query template, and passes each resulting row
+		 * to the handler. The IDs are formatted as numbers, so there is
+		 * nothing to escape.
+		 */
+		template<typename F>
+		void SelectByIDs (const QSqlDatabase& db, const QString& queryTemplate,
+				const QList<IDType_t>& ids, F&& handler)
+		{
+			const int chunkSize = 500;
+			for (int pos = 0; pos < ids.size (); pos += chunkSize)
+			{
+				QStringList idsList;
+				for (const auto& id : ids.mid (pos, chunkSize))
+					idsList << QString::number (id);
+
+				QSqlQuery query { db };
+				if (!query.exec (queryTemplate.arg ("(" + idsList.join (", ") + ")")))
+				{
+					Util::DBLock::DumpError (query);
+					continue;
+				}
+
+				while (query.next ())
+					handler (query);
+			}
+		}
+
+		Enclosure ReadEnclosure (const QSqlQuery& query, const IDType_t& itemId)
+		{
+			Enclosure e (itemId, query.value (0).value<IDType_t> ());
+			e.URL_ = query.value (1).toString ();
+			e.Type_ = query.value (2).toString ();
+			e.Length_ = query.value (3).toLongLong ();
+			e.Lang_ = query.value (4).toString ();
+			return e;
+		}
+
+		MRSSEntry ReadMRSSEntry (const QSqlQuery& query, const IDType_t& itemId)
+		{
+			MRSSEntry e (itemId, query.value (0).value<IDType_t> ());
+			e.URL_ = query.value (1).toString ();
+			e.Size_ = query.value (2).toLongLong ();
+			e.Type_ = query.value (3).toString ();
+			e.Medium_ = query.value (4).toString ();
+			e.IsDefault_ = query.value (5).toBool ();
+			e.Expression_ = query.value (6).toString ();
+			e.Bitrate_ = query.value (7).toInt ();
+			e.Framerate_ = query.value (8).toDouble ();
+			e.SamplingRate_ = query.value (9).toDouble ();
+			e.Channels_ = query.value (10).toInt ();
+			e.Duration_ = query.value (11).toInt ();
+			e.Width_ = query.value (12).toInt ();
+			e.Height_ = query.value (13).toInt ();
+			e.Lang_ = query.value (14).toString ();
+			e.Group_ = query.value (15).toInt ();
+			e.Rating_ = query.value (16).toString ();
+			e.RatingScheme_ = query.value (17).toString ();
+			e.Title_ = query.value (18).toString ();
+			e.Description_ = query.value (19).toString ();
+			e.Keywords_ = query.value (20).toString ();
+			e.CopyrightURL_ = query.value (21).toString ();
+			e.CopyrightText_ = query.value (22).toString ();
+			e.RatingAverage_ = query.value (23).toInt ();
+			e.RatingCount_ = query.value (24).toInt ();
+			e.RatingMin_ = query.value (25).toInt ();
+			e.RatingMax_ = query.value (26).toInt ();
+			e.Views_ = query.value (27).toInt ();
+			e.Favs_ = query.value (28).toInt ();
+			e.Tags_ = query.value (29).toString ();
+			return e;
+		}
+
+		MRSSThumbnail ReadMRSSThumbnail (const QSqlQuery& query, const IDType_t& mrssId)
+		{
+			MRSSThumbnail th (mrssId, query.value (0).value<IDType_t> ());
+			th.URL_ = query.value (1).toString ();
+			th.Width_ = query.value (2).toInt ();
+			th.Height_ = query.value (3).toInt ();
+			th.Time_ = query.value (4).toString ();
+			return th;
+		}
+
+		MRSSCredit ReadMRSSCredit (const QSqlQuery& query, const IDType_t& mrssId)
+		{
+			MRSSCredit cr (mrssId, query.value (0).value<IDType_t> ());
+			cr.Role_ = query.value (1).toString ();
+			cr.Who_ = query.value (2).toString ();
+			return cr;
+		}
+
+		MRSSComment ReadMRSSComment (const QSqlQuery& query, const IDType_t& mrssId)
+		{
+			MRSSComment cm (mrssId, query.value (0).value<IDType_t> ());
+			cm.Type_ = query.value (1).toString ();
+			cm.Comment_ = query.value (2).toString ();
+			return cm;
+		}
+
+		MRSSPeerLink ReadMRSSPeerLink (const QSqlQuery& query, const IDType_t& mrssId)
+		{
+			MRSSPeerLink pl (mrssId, query.value (0).value<IDType_t> ());
+			pl.Type_ = query.value (1).toString ();
+			pl.Link_ = query.value (2).toString ();
+			return pl;
+		}
+
+		MRSSScene ReadMRSSScene (const QSqlQuery& query, const IDType_t& mrssId)
+		{
+			MRSSScene sc (mrssId, query.value (0).value<IDType_t> ());
+			sc.Title_ = query.value (1).toString ();
+			sc.Description_ = query.value (2).toString ();
+			sc.StartTime_ = query.value (3).toString ();
+			sc.EndTime_ = query.value (4).toString ();
+			return sc;
+		}
+	}
+
 	SQLStorageBackend::SQLStorageBackend (StorageBackend::Type t, const QString& id)
 	: Type_ (t)
 	{
@@ -152,6 +355,27 @@ namespace Aggregator
 				":auto_download_enclosures"
 				")").arg (orReplace));
 
+		FeedFetchStateGetter_ = QSqlQuery (DB_);
+		FeedFetchStateGetter_.prepare ("SELECT "
+				"etag, "
+				"last_modified, "
+				"body_hash "
+				"FROM feeds_fetch_state "
+				"WHERE feed_id = :feed_id");
+
+		FeedFetchStateSetter_ = QSqlQuery (DB_);
+		FeedFetchStateSetter_.prepare (QString ("INSERT %1 INTO feeds_fetch_state ("
+				"feed_id, "
+				"etag, "
+				"last_modified, "
+				"body_hash"
+				") VALUES ("
+				":feed_id, "
+				":etag, "
+				":last_modified, "
+				":body_hash"
+				")").arg (orReplace));
+
 		ChannelsShortSelector_ = QSqlQuery (DB_);
 		ChannelsShortSelector_.prepare ("SELECT "
 				"channel_id, "
@@ -184,11 +408,17 @@ namespace Aggregator
 				"WHERE channel_id = :channel_id "
 				"ORDER BY title");
 
-		UnreadItemsCounter_ = QSqlQuery (DB_);
-		UnreadItemsCounter_.prepare ("SELECT COUNT (1) "
+		ItemsCounter_ = QSqlQuery (DB_);
+		ItemsCounter_.prepare ("SELECT COUNT (1), "
+				"COALESCE (SUM (CASE WHEN unread THEN 1 ELSE 0 END), 0) "
 				"FROM items "
-				"WHERE channel_id = :channel_id "
-				"AND unread");
+				"WHERE channel_id = :channel_id");
+
+		AllItemsCounter_ = QSqlQuery (DB_);
+		AllItemsCounter_.prepare ("SELECT channels.channel_id, COUNT (items.item_id), "
+				"COALESCE (SUM (CASE WHEN items.unread THEN 1 ELSE 0 END), 0) "
+				"FROM channels LEFT OUTER JOIN items ON items.channel_id = channels.channel_id "
+				"GROUP BY channels.channel_id");
 
 		ItemsShortSelector_ = QSqlQuery (DB_);
 		ItemsShortSelector_.prepare ("SELECT "
@@ -977,6 +1207,38 @@ namespace Aggregator
 			LeechCraft::Util::DBLock::DumpError (FeedSettingsSetter_);
 	}
 
+	boost::optional<Feed::FetchState> SQLStorageBackend::GetFeedFetchState (const IDType_t& feedId) const
+	{
+		FeedFetchStateGetter_.bindValue (":feed_id", feedId);
+		if (!FeedFetchStateGetter_.exec ())
+			Util::DBLock::DumpError (FeedFetchStateGetter_);
+
+		if (!FeedFetchStateGetter_.next ())
+			return {};
+
+		Feed::FetchState result
+		{
+			feedId,
+			FeedFetchStateGetter_.value (0).toByteArray (),
+			FeedFetchStateGetter_.value (1).toByteArray (),
+			FeedFetchStateGetter_.value (2).toByteArray ()
+		};
+		FeedFetchStateGetter_.finish ();
+
+		return result;
+	}
+
+	void SQLStorageBackend::SetFeedFetchState (const Feed::FetchState& state)
+	{
+		FeedFetchStateSetter_.bindValue (":feed_id", state.FeedID_);
+		FeedFetchStateSetter_.bindValue (":etag", QString::fromLatin1 (state.ETag_));
+		FeedFetchStateSetter_.bindValue (":last_modified", QString::fromLatin1 (state.LastModified_));
+		FeedFetchStateSetter_.bindValue (":body_hash", state.BodyHash_);
+
+		if (!FeedFetchStateSetter_.exec ())
+			Util::DBLock::DumpError (FeedFetchStateSetter_);
+	}
+
 	channels_shorts_t SQLStorageBackend::GetChannels (const IDType_t& feedId) const
 	{
 		channels_shorts_t shorts;
@@ -988,20 +1250,12 @@ namespace Aggregator
 			return shorts;
 		}
 
+		PrimeItemsCounters ();
+
 		while (ChannelsShortSelector_.next ())
 		{
-			int unread = 0;
-
 			IDType_t id = ChannelsShortSelector_.value (0).value<IDType_t> ();
-
-			UnreadItemsCounter_.bindValue (":channel_id", id);
-			if (!UnreadItemsCounter_.exec () ||
-					!UnreadItemsCounter_.next ())
-				Util::DBLock::DumpError (UnreadItemsCounter_);
-			else
-				unread = UnreadItemsCounter_.value (0).toInt ();
-
-			UnreadItemsCounter_.finish ();
+			const auto unread = GetItemsCounters (id).Unread_;
 
 			QStringList tags = Core::Instance ().GetProxy ()->
 				GetTagsManager ()->Split (ChannelsShortSelector_.value (4).toString ());
@@ -1159,6 +1413,8 @@ namespace Aggregator
 		if (!ChannelNumberTrimmer_.exec ())
 			LeechCraft::Util::DBLock::DumpError (ChannelNumberTrimmer_);
 
+		ItemsCountersCache<ItemsCounters>::Instance ().Invalidate (channelId);
+
 		if (const auto channel = GetChannel (channelId))
 			emit channelDataUpdated (*channel);
 	}
@@ -1198,16 +1454,65 @@ namespace Aggregator
 
 	int SQLStorageBackend::GetUnreadItems (const IDType_t& channelId) const
 	{
-		int unread = 0;
-		UnreadItemsCounter_.bindValue (":channel_id", channelId);
-		if (!UnreadItemsCounter_.exec () ||
-				!UnreadItemsCounter_.next ())
-			Util::DBLock::DumpError (UnreadItemsCounter_);
-		else
-			unread = UnreadItemsCounter_.value (0).toInt ();
+		return GetItemsCounters (channelId).Unread_;
+	}
 
-		UnreadItemsCounter_.finish ();
-		return unread;
+	int SQLStorageBackend::GetTotalItems (const IDType_t& channelId) const
+	{
+		return GetItemsCounters (channelId).Total_;
+	}
+
+	auto SQLStorageBackend::GetItemsCounters (const IDType_t& channelId) const -> ItemsCounters
+	{
+		auto& cache = ItemsCountersCache<ItemsCounters>::Instance ();
+		if (const auto& cached = cache.Get (channelId))
+			return *cached;
+
+		const auto generation = cache.GetGeneration ();
+
+		ItemsCounter_.bindValue (":channel_id", channelId);
+		if (!ItemsCounter_.exec () ||
+				!ItemsCounter_.next ())
+		{
+			Util::DBLock::DumpError (ItemsCounter_);
+			return {};
+		}
+
+		const ItemsCounters counters
+		{
+			ItemsCounter_.value (0).toInt (),
+			ItemsCounter_.value (1).toInt ()
+		};
+		ItemsCounter_.finish ();
+
+		cache.Set (channelId, counters, generation);
+		return counters;
+	}
+
+	void SQLStorageBackend::PrimeItemsCounters () const
+	{
+		auto& cache = ItemsCountersCache<ItemsCounters>::Instance ();
+		if (cache.IsPrimed ())
+			return;
+
+		const auto generation = cache.GetGeneration ();
+
+		if (!AllItemsCounter_.exec ())
+		{
+			Util::DBLock::DumpError (AllItemsCounter_);
+			return;
+		}
+
+		QHash<IDType_t, ItemsCounters> counters;
+		while (AllItemsCounter_.next ())
+			counters [AllItemsCounter_.value (0).value<IDType_t> ()] =
+			{
+				AllItemsCounter_.value (1).toInt (),
+				AllItemsCounter_.value (2).toInt ()
+			};
+		AllItemsCounter_.finish ();
+
+		cache.SetAll (counters, generation);
 	}
 
 	boost::optional<Item> SQLStorageBackend::GetItem (const IDType_t& itemId) const
@@ -1259,6 +1564,189 @@ namespace Aggregator
 		return items;
 	}
 
+	items_container_t SQLStorageBackend::GetFullItems (const QList<IDType_t>& itemIds) const
+	{
+		QHash<IDType_t, Item_ptr> id2item;
+		items_container_t items;
+		SelectByIDs (DB_,
+				"SELECT "
+				"title, "
+				"url, "
+				"description, "
+				"author, "
+				"category, "
+				"guid, "
+				"pub_date, "
+				"unread, "
+				"num_comments, "
+				"comments_url, "
+				"comments_page_url, "
+				"latitude, "
+				"longitude, "
+				"channel_id, "
+				"item_id "
+				"FROM items "
+				"WHERE item_id IN %1",
+				itemIds,
+				[&] (const QSqlQuery& query)
+				{
+					const auto itemId = query.value (14).value<IDType_t> ();
+					auto item = std::make_shared<Item> (query.value (13).value<IDType_t> (), itemId);
+					FillItem (query, *item);
+					id2item [itemId] = item;
+					items.push_back (item);
+				});
+		if (items.empty ())
+			return items;
+
+		const auto& foundIds = id2item.keys ();
+
+		SelectByIDs (DB_,
+				"SELECT "
+				"enclosure_id, "
+				"url, "
+				"type, "
+				"length, "
+				"lang, "
+				"item_id "
+				"FROM enclosures "
+				"WHERE item_id IN %1 "
+				"ORDER BY url",
+				foundIds,
+				[&] (const QSqlQuery& query)
+				{
+					const auto itemId = query.value (5).value<IDType_t> ();
+					id2item [itemId]->Enclosures_ << ReadEnclosure (query, itemId);
+				});
+
+		/* The MRSS entries are completed with their children first and
+		 * distributed among the items afterwards, since the items store
+		 * them by value.
+		 */
+		QList<MRSSEntry> entries;
+		QHash<IDType_t, int> mrss2pos;
+		SelectByIDs (DB_,
+				"SELECT "
+				"mrss_id, "
+				"url, "
+				"size, "
+				"type, "
+				"medium, "
+				"is_default, "
+				"expression, "
+				"bitrate, "
+				"framerate, "
+				"samplingrate, "
+				"channels, "
+				"duration, "
+				"width, "
+				"height, "
+				"lang, "
+				"mediagroup, "
+				"rating, "
+				"rating_scheme, "
+				"title, "
+				"description, "
+				"keywords, "
+				"copyright_url, "
+				"copyright_text, "
+				"star_rating_average, "
+				"star_rating_count, "
+				"star_rating_min, "
+				"star_rating_max, "
+				"stat_views, "
+				"stat_favs, "
+				"tags, "
+				"item_id "
+				"FROM mrss "
+				"WHERE item_id IN %1 "
+				"ORDER BY title",
+				foundIds,
+				[&] (const QSqlQuery& query)
+				{
+					const auto& entry = ReadMRSSEntry (query, query.value (30).value<IDType_t> ());
+					mrss2pos [entry.MRSSEntryID_] = entries.size ();
+					entries << entry;
+				});
+		if (entries.isEmpty ())
+			return items;
+
+		const auto& mrssIds = mrss2pos.keys ();
+		const auto forEntry = [&] (int mrssIdColumn, auto reader, auto member)
+		{
+			return [&entries, &mrss2pos, mrssIdColumn, reader, member] (const QSqlQuery& query)
+			{
+				const auto mrssId = query.value (mrssIdColumn).value<IDType_t> ();
+				(entries [mrss2pos.value (mrssId)].*member) << reader (query, mrssId);
+			};
+		};
+
+		SelectByIDs (DB_,
+				"SELECT "
+				"mrss_thumb_id, "
+				"url, "
+				"width, "
+				"height, "
+				"time, "
+				"mrss_id "
+				"FROM mrss_thumbnails "
+				"WHERE mrss_id IN %1 "
+				"ORDER BY time",
+				mrssIds,
+				forEntry (5, &ReadMRSSThumbnail, &MRSSEntry::Thumbnails_));
+		SelectByIDs (DB_,
+				"SELECT "
+				"mrss_credits_id, "
+				"role, "
+				"who, "
+				"mrss_id "
+				"FROM mrss_credits "
+				"WHERE mrss_id IN %1 "
+				"ORDER BY role",
+				mrssIds,
+				forEntry (3, &ReadMRSSCredit, &MRSSEntry::Credits_));
+		SelectByIDs (DB_,
+				"SELECT "
+				"mrss_comment_id, "
+				"type, "
+				"comment, "
+				"mrss_id "
+				"FROM mrss_comments "
+				"WHERE mrss_id IN %1 "
+				"ORDER BY comment",
+				mrssIds,
+				forEntry (3, &ReadMRSSComment, &MRSSEntry::Comments_));
+		SelectByIDs (DB_,
+				"SELECT "
+				"mrss_peerlink_id, "
+				"type, "
+				"link, "
+				"mrss_id "
+				"FROM mrss_peerlinks "
+				"WHERE mrss_id IN %1 "
+				"ORDER BY link",
+				mrssIds,
+				forEntry (3, &ReadMRSSPeerLink, &MRSSEntry::PeerLinks_));
+		SelectByIDs (DB_,
+				"SELECT "
+				"mrss_scene_id, "
+				"title, "
+				"description, "
+				"start_time, "
+				"end_time, "
+				"mrss_id "
+				"FROM mrss_scenes "
+				"WHERE mrss_id IN %1 "
+				"ORDER BY start_time",
+				mrssIds,
+				forEntry (5, &ReadMRSSScene, &MRSSEntry::Scenes_));
+
+		for (const auto& entry : entries)
+			id2item [entry.ItemID_]->MRSSEntries_ << entry;
+
+		return items;
+	}
+
 	void SQLStorageBackend::AddFeed (const Feed& feed)
 	{
 		InsertFeed_.bindValue (":feed_id", feed.FeedID_);
@@ -1388,6 +1876,12 @@ namespace Aggregator
 	}
 
 	void SQLStorageBackend::UpdateItem (const Item& item)
+	{
+		UpdateItemRow (item);
+		EmitItemsUpdated ({ item });
+	}
+
+	void SQLStorageBackend::UpdateItemRow (const Item& item)
 	{
 		UpdateItem_.bindValue (":item_id", item.ItemID_);
 		UpdateItem_.bindValue (":description", item.Description_);
@@ -1420,12 +1914,6 @@ namespace Aggregator
 
 		WriteEnclosures (item.Enclosures_);
 		WriteMRSSEntries (item.MRSSEntries_);
-
-		if (const auto& channel = GetChannel (item.ChannelID_))
-		{
-			emit itemDataUpdated (item, *channel);
-			emit channelDataUpdated (*channel);
-		}
 	}
 
 	void SQLStorageBackend::UpdateItem (const ItemShort& item)
@@ -1450,6 +1938,8 @@ namespace Aggregator
 
 		UpdateShortItem_.finish ();
 
+		ItemsCountersCache<ItemsCounters>::Instance ().Invalidate (item.ChannelID_);
+
 		if (const auto& channel = GetChannel (item.ChannelID_);
 			const auto& fullItem = GetItem (item.ItemID_))
 		{
@@ -1460,42 +1950,97 @@ namespace Aggregator
 
 	void SQLStorageBackend::AddChannel (const Channel& channel)
 	{
-		InsertChannel_.bindValue (":channel_id", channel.ChannelID_);
-		InsertChannel_.bindValue (":feed_id", channel.FeedID_);
-		InsertChannel_.bindValue (":url", channel.Link_);
-		InsertChannel_.bindValue (":title", channel.Title_);
-		InsertChannel_.bindValue (":display_title", channel.DisplayTitle_);
-		InsertChannel_.bindValue (":description", channel.Description_);
-		InsertChannel_.bindValue (":last_build", channel.LastBuild_);
-		InsertChannel_.bindValue (":tags",
-				Core::Instance ().GetProxy ()->GetTagsManager ()->Join (channel.Tags_));
-		InsertChannel_.bindValue (":language", channel.Language_);
-		InsertChannel_.bindValue (":author", channel.Author_);
-		InsertChannel_.bindValue (":pixmap_url", channel.PixmapURL_);
-		InsertChannel_.bindValue (":pixmap", SerializePixmap (channel.Pixmap_));
-		InsertChannel_.bindValue (":favicon", SerializePixmap (channel.Favicon_));
-
-		if (!InsertChannel_.exec ())
+		QList<Item> items;
 		{
-			qWarning () << Q_FUNC_INFO;
-			Util::DBLock::DumpError (InsertChannel_);
-			throw std::runtime_error (qPrintable (QString (
-							"Failed to save channel {id: %1, title: %2, url: %3, parent: %4}")
-						.arg (channel.ChannelID_)
-						.arg (channel.Title_)
-						.arg (channel.Link_)
-						.arg (channel.FeedID_)));
-		}
+			Util::DBLock lock (DB_);
+			try
+			{
+				lock.Init ();
+			}
+			catch (const std::runtime_error& e)
+			{
+				qWarning () << Q_FUNC_INFO << e.what ();
+				return;
+			}
+
+			InsertChannel_.bindValue (":channel_id", channel.ChannelID_);
+			InsertChannel_.bindValue (":feed_id", channel.FeedID_);
+			InsertChannel_.bindValue (":url", channel.Link_);
+			InsertChannel_.bindValue (":title", channel.Title_);
+			InsertChannel_.bindValue (":display_title", channel.DisplayTitle_);
+			InsertChannel_.bindValue (":description", channel.Description_);
+			InsertChannel_.bindValue (":last_build", channel.LastBuild_);
+			InsertChannel_.bindValue (":tags",
+					Core::Instance ().GetProxy ()->GetTagsManager ()->Join (channel.Tags_));
+			InsertChannel_.bindValue (":language", channel.Language_);
+			InsertChannel_.bindValue (":author", channel.Author_);
+			InsertChannel_.bindValue (":pixmap_url", channel.PixmapURL_);
+			InsertChannel_.bindValue (":pixmap", SerializePixmap (channel.Pixmap_));
+			InsertChannel_.bindValue (":favicon", SerializePixmap (channel.Favicon_));
+
+			if (!InsertChannel_.exec ())
+			{
+				qWarning () << Q_FUNC_INFO;
+				Util::DBLock::DumpError (InsertChannel_);
+				throw std::runtime_error (qPrintable (QString (
+								"Failed to save channel {id: %1, title: %2, url: %3, parent: %4}")
+							.arg (channel.ChannelID_)
+							.arg (channel.Title_)
+							.arg (channel.Link_)
+							.arg (channel.FeedID_)));
+			}
+
+			InsertChannel_.finish ();
+
+			for (const auto& item : channel.Items_)
+			{
+				InsertItemRow (*item);
+				items << *item;
+			}
 
-		InsertChannel_.finish ();
+			lock.Good ();
+		}
 
-		for (const auto& item : channel.Items_)
-			AddItem (*item);
+		EmitItemsUpdated (items);
 
 		emit channelAdded (channel);
 	}
 
 	void SQLStorageBackend::AddItem (const Item& item)
+	{
+		InsertItemRow (item);
+		EmitItemsUpdated ({ item });
+	}
+
+	void SQLStorageBackend::MergeItems (const QList<Item>& added, const QList<Item>& updated)
+	{
+		if (added.isEmpty () && updated.isEmpty ())
+			return;
+
+		{
+			Util::DBLock lock (DB_);
+			try
+			{
+				lock.Init ();
+			}
+			catch (const std::runtime_error& e)
+			{
+				qWarning () << Q_FUNC_INFO << e.what ();
+				return;
+			}
+
+			for (const auto& item : added)
+				InsertItemRow (item);
+			for (const auto& item : updated)
+				UpdateItemRow (item);
+
+			lock.Good ();
+		}
+
+		EmitItemsUpdated (added + updated);
+	}
+
+	void SQLStorageBackend::InsertItemRow (const Item& item)
 	{
 		InsertItem_.bindValue (":item_id", item.ItemID_);
 		InsertItem_.bindValue (":channel_id", item.ChannelID_);
@@ -1529,12 +2074,28 @@ namespace Aggregator
 
 		WriteEnclosures (item.Enclosures_);
 		WriteMRSSEntries (item.MRSSEntries_);
+	}
+
+	void SQLStorageBackend::EmitItemsUpdated (const QList<Item>& items)
+	{
+		auto& cache = ItemsCountersCache<ItemsCounters>::Instance ();
 
-		if (const auto& channel = GetChannel (item.ChannelID_))
+		QHash<IDType_t, boost::optional<Channel>> channels;
+		for (const auto& item : items)
 		{
-			emit itemDataUpdated (item, *channel);
-			emit channelDataUpdated (*channel);
+			if (!channels.contains (item.ChannelID_))
+			{
+				cache.Invalidate (item.ChannelID_);
+				channels [item.ChannelID_] = GetChannel (item.ChannelID_);
+			}
+
+			if (const auto& channel = channels [item.ChannelID_])
+				emit itemDataUpdated (item, *channel);
 		}
+
+		for (const auto& channel : channels)
+			if (channel)
+				emit channelDataUpdated (*channel);
 	}
 
 	namespace
@@ -1557,54 +2118,59 @@ namespace Aggregator
 
 	void SQLStorageBackend::RemoveItems (const QSet<IDType_t>& items)
 	{
-		Util::DBLock lock (DB_);
-		try
-		{
-			lock.Init ();
-		}
-		catch (const std::runtime_error& e)
-		{
-			qWarning () << Q_FUNC_INFO << e.what ();
-			return;
-		}
-
-		using Util::operator*;
-
 		QList<IDType_t> modifiedChannels;
-		for (const auto itemId : items)
 		{
-			const auto& cid = GetItem (itemId) * &Item::ChannelID_;
-			if (!cid)
-				continue;
-
-			if (!modifiedChannels.contains (*cid))
-				modifiedChannels << *cid;
-
-			if (!PerformRemove (RemoveEnclosures_, itemId) ||
-					!PerformRemove (RemoveMediaRSS_, itemId) ||
-					!PerformRemove (RemoveMediaRSSThumbnails_, itemId) ||
-					!PerformRemove (RemoveMediaRSSCredits_, itemId) ||
-					!PerformRemove (RemoveMediaRSSComments_, itemId) ||
-					!PerformRemove (RemoveMediaRSSPeerLinks_, itemId) ||
-					!PerformRemove (RemoveMediaRSSScenes_, itemId))
+			Util::DBLock lock (DB_);
+			try
 			{
-				qWarning () << Q_FUNC_INFO
-					<< "a Remove* query failed";
+				lock.Init ();
+			}
+			catch (const std::runtime_error& e)
+			{
+				qWarning () << Q_FUNC_INFO << e.what ();
 				return;
 			}
 
-			RemoveItem_.bindValue (":item_id", itemId);
+			using Util::operator*;
 
-			if (!RemoveItem_.exec ())
+			for (const auto itemId : items)
 			{
-				Util::DBLock::DumpError (RemoveItem_);
-				return;
+				const auto& cid = GetItem (itemId) * &Item::ChannelID_;
+				if (!cid)
+					continue;
+
+				if (!modifiedChannels.contains (*cid))
+					modifiedChannels << *cid;
+
+				if (!PerformRemove (RemoveEnclosures_, itemId) ||
+						!PerformRemove (RemoveMediaRSS_, itemId) ||
+						!PerformRemove (RemoveMediaRSSThumbnails_, itemId) ||
+						!PerformRemove (RemoveMediaRSSCredits_, itemId) ||
+						!PerformRemove (RemoveMediaRSSComments_, itemId) ||
+						!PerformRemove (RemoveMediaRSSPeerLinks_, itemId) ||
+						!PerformRemove (RemoveMediaRSSScenes_, itemId))
+				{
+					qWarning () << Q_FUNC_INFO
+						<< "a Remove* query failed";
+					return;
+				}
+
+				RemoveItem_.bindValue (":item_id", itemId);
+
+				if (!RemoveItem_.exec ())
+				{
+					Util::DBLock::DumpError (RemoveItem_);
+					return;
+				}
+
+				RemoveItem_.finish ();
 			}
 
-			RemoveItem_.finish ();
+			lock.Good ();
 		}
 
-		lock.Good ();
+		for (const auto& cid : modifiedChannels)
+			ItemsCountersCache<ItemsCounters>::Instance ().Invalidate (cid);
 
 		emit itemsRemoved ({ items });
 
@@ -1615,56 +2181,64 @@ namespace Aggregator
 
 	void SQLStorageBackend::RemoveChannel (const IDType_t& channelId)
 	{
-		Util::DBLock lock (DB_);
-		try
-		{
-			lock.Init ();
-		}
-		catch (const std::runtime_error& e)
 		{
-			qWarning () << Q_FUNC_INFO
-					<< e.what ();
-			return;
-		}
+			Util::DBLock lock (DB_);
+			try
+			{
+				lock.Init ();
+			}
+			catch (const std::runtime_error& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< e.what ();
+				return;
+			}
 
-		RemoveChannel_.bindValue (":channel_id", channelId);
-		if (!RemoveChannel_.exec ())
-		{
-			Util::DBLock::DumpError (RemoveChannel_);
-			return;
-		}
+			RemoveChannel_.bindValue (":channel_id", channelId);
+			if (!RemoveChannel_.exec ())
+			{
+				Util::DBLock::DumpError (RemoveChannel_);
+				return;
+			}
 
-		RemoveChannel_.finish ();
+			RemoveChannel_.finish ();
 
-		lock.Good ();
+			lock.Good ();
+		}
+
+		ItemsCountersCache<ItemsCounters>::Instance ().Invalidate (channelId);
 
 		emit channelRemoved (channelId);
 	}
 
 	void SQLStorageBackend::RemoveFeed (const IDType_t& feedId)
 	{
-		Util::DBLock lock (DB_);
-		try
 		{
-			lock.Init ();
-		}
-		catch (const std::runtime_error& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< e.what ();
-			return;
-		}
+			Util::DBLock lock (DB_);
+			try
+			{
+				lock.Init ();
+			}
+			catch (const std::runtime_error& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< e.what ();
+				return;
+			}
 
-		RemoveFeed_.bindValue (":feed_id", feedId);
-		if (!RemoveFeed_.exec ())
-		{
-			Util::DBLock::DumpError (RemoveFeed_);
-			return;
-		}
+			RemoveFeed_.bindValue (":feed_id", feedId);
+			if (!RemoveFeed_.exec ())
+			{
+				Util::DBLock::DumpError (RemoveFeed_);
+				return;
+			}
 
-		RemoveFeed_.finish ();
+			RemoveFeed_.finish ();
 
-		lock.Good ();
+			lock.Good ();
+		}
+
+		ItemsCountersCache<ItemsCounters>::Instance ().InvalidateAll ();
 
 		emit feedRemoved (feedId);
 	}
@@ -1690,6 +2264,8 @@ namespace Aggregator
 
 		ToggleChannelUnread_.finish ();
 
+		ItemsCountersCache<ItemsCounters>::Instance ().Invalidate (channelId);
+
 		if (const auto& channel = GetChannel (channelId))
 		{
 			emit channelDataUpdated (*channel);
@@ -1788,6 +2364,39 @@ namespace Aggregator
 			}
 		}
 
+		if (!tables.contains ("feeds_fetch_state"))
+		{
+			if (!query.exec (QString ("CREATE TABLE feeds_fetch_state ("
+							"feed_id BIGINT UNIQUE REFERENCES feeds ON DELETE CASCADE, "
+							"etag TEXT, "
+							"last_modified TEXT, "
+							"body_hash %1"
+							");").arg (GetBlobType ())))
+			{
+				Util::DBLock::DumpError (query);
+				return false;
+			}
+
+			if (Type_ == SBPostgres)
+			{
+				if (!query.exec ("CREATE RULE \"replace_feeds_fetch_state\" AS "
+									"ON INSERT TO \"feeds_fetch_state\" "
+									"WHERE "
+										"EXISTS (SELECT 1 FROM feeds_fetch_state "
+											"WHERE feed_id = NEW.feed_id) "
+									"DO INSTEAD "
+										"(UPDATE feeds_fetch_state SET "
+											"etag = NEW.etag, "
+											"last_modified = NEW.last_modified, "
+											"body_hash = NEW.body_hash "
+											"WHERE feed_id = NEW.feed_id)"))
+				{
+					Util::DBLock::DumpError (query);
+					return false;
+				}
+			}
+		}
+
 		if (!tables.contains ("channels"))
 		{
 			if (!query.exec (QString ("CREATE TABLE channels ("
@@ -2217,15 +2826,7 @@ namespace Aggregator
 		}
 
 		while (GetEnclosures_.next ())
-		{
-			Enclosure e (itemId, GetEnclosures_.value (0).value<IDType_t> ());
-			e.URL_ = GetEnclosures_.value (1).toString ();
-			e.Type_ = GetEnclosures_.value (2).toString ();
-			e.Length_ = GetEnclosures_.value (3).toLongLong ();
-			e.Lang_ = GetEnclosures_.value (4).toString ();
-
-			enclosures << e;
-		}
+			enclosures << ReadEnclosure (GetEnclosures_, itemId);
 
 		GetEnclosures_.finish ();
 	}
@@ -2357,37 +2958,8 @@ namespace Aggregator
 
 		while (GetMediaRSSs_.next ())
 		{
-			IDType_t mrssId = GetMediaRSSs_.value (0).value<IDType_t> ();
-			MRSSEntry e (itemId, mrssId);
-			e.URL_ = GetMediaRSSs_.value (1).toString ();
-			e.Size_ = GetMediaRSSs_.value (2).toLongLong ();
-			e.Type_ = GetMediaRSSs_.value (3).toString ();
-			e.Medium_ = GetMediaRSSs_.value (4).toString ();
-			e.IsDefault_ = GetMediaRSSs_.value (5).toBool ();
-			e.Expression_ = GetMediaRSSs_.value (6).toString ();
-			e.Bitrate_ = GetMediaRSSs_.value (7).toInt ();
-			e.Framerate_ = GetMediaRSSs_.value (8).toDouble ();
-			e.SamplingRate_ = GetMediaRSSs_.value (9).toDouble ();
-			e.Channels_ = GetMediaRSSs_.value (10).toInt ();
-			e.Duration_ = GetMediaRSSs_.value (11).toInt ();
-			e.Width_ = GetMediaRSSs_.value (12).toInt ();
-			e.Height_ = GetMediaRSSs_.value (13).toInt ();
-			e.Lang_ = GetMediaRSSs_.value (14).toString ();
-			e.Group_ = GetMediaRSSs_.value (15).toInt ();
-			e.Rating_ = GetMediaRSSs_.value (16).toString ();
-			e.RatingScheme_ = GetMediaRSSs_.value (17).toString ();
-			e.Title_ = GetMediaRSSs_.value (18).toString ();
-			e.Description_ = GetMediaRSSs_.value (19).toString ();
-			e.Keywords_ = GetMediaRSSs_.value (20).toString ();
-			e.CopyrightURL_ = GetMediaRSSs_.value (21).toString ();
-			e.CopyrightText_ = GetMediaRSSs_.value (22).toString ();
-			e.RatingAverage_ = GetMediaRSSs_.value (23).toInt ();
-			e.RatingCount_ = GetMediaRSSs_.value (24).toInt ();
-			e.RatingMin_ = GetMediaRSSs_.value (25).toInt ();
-			e.RatingMax_ = GetMediaRSSs_.value (26).toInt ();
-			e.Views_ = GetMediaRSSs_.value (27).toInt ();
-			e.Favs_ = GetMediaRSSs_.value (28).toInt ();
-			e.Tags_ = GetMediaRSSs_.value (29).toString ();
+			auto e = ReadMRSSEntry (GetMediaRSSs_, itemId);
+			const auto mrssId = e.MRSSEntryID_;
 
 			GetMediaRSSThumbnails_.bindValue (":mrss_id", mrssId);
 			if (!GetMediaRSSThumbnails_.exec ())
@@ -2395,15 +2967,7 @@ namespace Aggregator
 			else
 			{
 				while (GetMediaRSSThumbnails_.next ())
-				{
-					MRSSThumbnail th (mrssId,
-							GetMediaRSSThumbnails_.value (0).value<IDType_t> ());
-					th.URL_ = GetMediaRSSThumbnails_.value (1).toString ();
-					th.Width_ = GetMediaRSSThumbnails_.value (2).toInt ();
-					th.Height_ = GetMediaRSSThumbnails_.value (3).toInt ();
-					th.Time_ = GetMediaRSSThumbnails_.value (4).toString ();
-					e.Thumbnails_ << th;
-				}
+					e.Thumbnails_ << ReadMRSSThumbnail (GetMediaRSSThumbnails_, mrssId);
 				GetMediaRSSThumbnails_.finish ();
 			}
 
@@ -2413,13 +2977,7 @@ namespace Aggregator
 			else
 			{
 				while (GetMediaRSSCredits_.next ())
-				{
-					MRSSCredit cr (mrssId,
-							GetMediaRSSCredits_.value (0).value<IDType_t> ());
-					cr.Role_ = GetMediaRSSCredits_.value (1).toString ();
-					cr.Who_ = GetMediaRSSCredits_.value (2).toString ();
-					e.Credits_ << cr;
-				}
+					e.Credits_ << ReadMRSSCredit (GetMediaRSSCredits_, mrssId);
 				GetMediaRSSCredits_.finish ();
 			}
 
@@ -2429,13 +2987,7 @@ namespace Aggregator
 			else
 			{
 				while (GetMediaRSSComments_.next ())
-				{
-					MRSSComment cm (mrssId,
-							GetMediaRSSComments_.value (0).value<IDType_t> ());
-					cm.Type_ = GetMediaRSSComments_.value (1).toString ();
-					cm.Comment_ = GetMediaRSSComments_.value (2).toString ();
-					e.Comments_ << cm;
-				}
+					e.Comments_ << ReadMRSSComment (GetMediaRSSComments_, mrssId);
 				GetMediaRSSComments_.finish ();
 			}
 
@@ -2445,13 +2997,7 @@ namespace Aggregator
 			else
 			{
 				while (GetMediaRSSPeerLinks_.next ())
-				{
-					MRSSPeerLink pl (mrssId,
-							GetMediaRSSPeerLinks_.value (0).value<IDType_t> ());
-					pl.Type_ = GetMediaRSSPeerLinks_.value (1).toString ();
-					pl.Link_ = GetMediaRSSPeerLinks_.value (2).toString ();
-					e.PeerLinks_ << pl;
-				}
+					e.PeerLinks_ << ReadMRSSPeerLink (GetMediaRSSPeerLinks_, mrssId);
 				GetMediaRSSPeerLinks_.finish ();
 			}
 
@@ -2461,15 +3007,7 @@ namespace Aggregator
 			else
 			{
 				while (GetMediaRSSScenes_.next ())
-				{
-					MRSSScene th (mrssId,
-							GetMediaRSSScenes_.value (0).value<IDType_t> ());
-					th.Title_ = GetMediaRSSScenes_.value (1).toString ();
-					th.Description_ = GetMediaRSSScenes_.value (2).toString ();
-					th.StartTime_ = GetMediaRSSScenes_.value (3).toString ();
-					th.EndTime_ = GetMediaRSSScenes_.value (4).toString ();
-					e.Scenes_ << th;
-				}
+					e.Scenes_ << ReadMRSSScene (GetMediaRSSScenes_, mrssId);
 				GetMediaRSSScenes_.finish ();
 			}
 
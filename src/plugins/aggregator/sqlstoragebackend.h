@@ -77,6 +77,22 @@ namespace Aggregator
 							 * - item_age
 							 */
 							FeedSettingsSetter_,
+							/** Returns:
+							 * - etag
+							 * - last_modified
+							 * - body_hash
+							 *
+							 * Binds:
+							 * - feed_id
+							 */
+							FeedFetchStateGetter_,
+							/** Binds:
+							 * - feed_id
+							 * - etag
+							 * - last_modified
+							 * - body_hash
+							 */
+							FeedFetchStateSetter_,
 							/** Returns:
 							 * - channel_id
 							 * - title
@@ -107,12 +123,19 @@ namespace Aggregator
 							 */
 							ChannelsFullSelector_,
 							/** Returns:
+							 * - number of items
 							 * - number of unread items
 							 *
 							 * Binds:
 							 * - channel_id
 							 */
-							UnreadItemsCounter_,
+							ItemsCounter_,
+							/** Returns:
+							 * - channel_id
+							 * - number of items
+							 * - number of unread items
+							 */
+							AllItemsCounter_,
 							/** Returns:
 							 * - item_id
 							 * - title
@@ -582,23 +605,28 @@ namespace Aggregator
 		IDType_t FindFeed (const QString&) const override;
 		boost::optional<Feed::FeedSettings> GetFeedSettings (const IDType_t&) const override;
 		void SetFeedSettings (const Feed::FeedSettings&) override;
+		boost::optional<Feed::FetchState> GetFeedFetchState (const IDType_t&) const override;
+		void SetFeedFetchState (const Feed::FetchState&) override;
 		channels_shorts_t GetChannels (const IDType_t&) const override;
 		boost::optional<Channel> GetChannel (const IDType_t&) const override;
 		IDType_t FindChannel (const QString& , const QString&, const IDType_t&) const override;
 		void TrimChannel (const IDType_t&, int, int) override;
 		items_shorts_t GetItems (const IDType_t&) const override;
 		int GetUnreadItems (const IDType_t&) const override;
+		int GetTotalItems (const IDType_t&) const override;
 		boost::optional<Item> GetItem (const IDType_t&) const override;
 		boost::optional<IDType_t> FindItem (const QString&, const QString&, const IDType_t&) const override;
 		boost::optional<IDType_t> FindItemByLink (const QString&, const IDType_t&) const override;
 		boost::optional<IDType_t> FindItemByTitle (const QString&, const IDType_t&) const override;
 		items_container_t GetFullItems (const IDType_t&) const override;
+		items_container_t GetFullItems (const QList<IDType_t>&) const override;
 
 		void AddFeed (const Feed&) override;
 		void UpdateChannel (const Channel&) override;
 		void UpdateChannel (const ChannelShort&) override;
 		void UpdateItem (const Item&) override;
 		void UpdateItem (const ItemShort&) override;
+		void MergeItems (const QList<Item>&, const QList<Item>&) override;
 		void AddChannel (const Channel&) override;
 		void AddItem (const Item&) override;
 		void RemoveItems (const QSet<IDType_t>&) override;
@@ -621,6 +649,17 @@ namespace Aggregator
 		QImage UnserializePixmap (const QByteArray&) const;
 
 		void FillItem (const QSqlQuery&, Item&) const;
+
+		struct ItemsCounters
+		{
+			int Total_ = 0;
+			int Unread_ = 0;
+		};
+		ItemsCounters GetItemsCounters (const IDType_t&) const;
+		void PrimeItemsCounters () const;
+		void InsertItemRow (const Item&);
+		void UpdateItemRow (const Item&);
+		void EmitItemsUpdated (const QList<Item>&);
 		void WriteEnclosures (const QList<Enclosure>&);
 		void GetEnclosures (const IDType_t&, QList<Enclosure>&) const;
 		void WriteMRSSEntries (const QList<MRSSEntry>&);
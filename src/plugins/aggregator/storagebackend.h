@@ -117,6 +117,22 @@ namespace Aggregator
 		 */
 		virtual void SetFeedSettings (const Feed::FeedSettings& settings) = 0;
 
+		/** @brief Returns the state of the last fetch of the feed.
+		 *
+		 * @param[in] feed Feed's ID.
+		 * @return FetchState for the feed, or an empty optional if the
+		 * feed hasn't been fetched yet.
+		 */
+		virtual boost::optional<Feed::FetchState> GetFeedFetchState (const IDType_t& feed) const = 0;
+
+		/** @brief Sets the state of the last fetch of the feed.
+		 *
+		 * Replaces the old state if it exists.
+		 *
+		 * @param[in] state New fetch state of the feed.
+		 */
+		virtual void SetFeedFetchState (const Feed::FetchState& state) = 0;
+
 		/** @brief Get all the channels of a feed in the container.
 		 *
 		 * Returns short information about channels in the storage which
@@ -183,6 +199,16 @@ namespace Aggregator
 		 */
 		virtual int GetUnreadItems (const IDType_t& id) const = 0;
 
+		/** @brief Counts all items in a given channel.
+		 *
+		 * A possibly optimized version of getting items via
+		 * GetItems() and taking their count.
+		 *
+		 * @param[in] id Channel's ID.
+		 * @return Total items count.
+		 */
+		virtual int GetTotalItems (const IDType_t& id) const = 0;
+
 		/** @brief Returns full information about an item.
 		 *
 		 * Returns full information about the item identified by
@@ -261,6 +287,19 @@ namespace Aggregator
 		 */
 		virtual items_container_t GetFullItems (const IDType_t& id) const = 0;
 
+		/** @brief Returns the items with the given IDs.
+		 *
+		 * Returns full information about the items identified by
+		 * itemIds, in no particular order. The IDs that don't
+		 * correspond to any stored item are skipped.
+		 *
+		 * This is meant to be used when only a few items of a channel
+		 * are needed at once, to avoid loading the whole channel.
+		 *
+		 * @param[in] itemIds The IDs of the items to load.
+		 */
+		virtual items_container_t GetFullItems (const QList<IDType_t>& itemIds) const = 0;
+
 		/** @brief Puts a feed and all its child channels and items into the
 		 * storage.
 		 *
@@ -340,6 +379,22 @@ namespace Aggregator
 		 */
 		virtual void UpdateItem (const ItemShort& item) = 0;
 
+		/** @brief Adds new items and updates already existing ones.
+		 *
+		 * This function is equivalent to calling AddItem() for each of
+		 * the \em added items and UpdateItem() for each of the
+		 * \em updated ones, but the backend may write them along with
+		 * their enclosures and MediaRSS entries in a single transaction.
+		 *
+		 * This function emits itemDataUpdated() for each item and
+		 * channelDataUpdated() once for each affected channel.
+		 *
+		 * @param[in] added The items that should be added.
+		 * @param[in] updated The new versions of the items that should
+		 * be updated.
+		 */
+		virtual void MergeItems (const QList<Item>& added, const QList<Item>& updated) = 0;
+
 		/** @brief Removes an already existing item.
 		 *
 		 * This function emits channelDataUpdated() and itemsRemoved()
@@ -0,0 +1,847 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "streamparser.h"
+#include <algorithm>
+#include <QIODevice>
+#include <QObject>
+#include <QStringList>
+#include <QtDebug>
+#include <util/sll/prelude.h>
+#include "rss20parser.h"
+#include "atom10parser.h"
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	struct StreamParser::AuthorData
+	{
+		boost::optional<QString> ITunes_;
+		boost::optional<QString> DC_;
+		boost::optional<QString> Plain_;
+
+		QString Get () const
+		{
+			if (ITunes_)
+				return *ITunes_;
+			if (DC_)
+				return *DC_;
+			return Plain_.get_value_or (QString {});
+		}
+	};
+
+	struct StreamParser::EscapeAwareText
+	{
+		QString Text_;
+		boost::optional<QString> Type_;
+		QString Mode_;
+	};
+
+	struct StreamParser::ItemData
+	{
+		boost::optional<EscapeAwareText> Title_;
+		boost::optional<QString> Link_;
+		boost::optional<QString> AlternateLink_;
+		boost::optional<QString> Description_;
+		boost::optional<EscapeAwareText> Content_;
+		boost::optional<EscapeAwareText> Summary_;
+		QStringList ContentEncoded_;
+		QStringList ITunesSummaries_;
+		boost::optional<QString> Duration_;
+
+		boost::optional<QString> PubDate_;
+		boost::optional<QString> DCDate_;
+		boost::optional<QString> Updated_;
+		boost::optional<QString> Modified_;
+		boost::optional<QString> Issued_;
+
+		boost::optional<QString> Guid_;
+		boost::optional<QString> Id_;
+
+		QStringList DCCategories_;
+		QStringList PlainCategories_;
+		QStringList ITunesKeywords_;
+
+		AuthorData Author_;
+
+		boost::optional<QString> NumComments_;
+		boost::optional<QString> CommentsRSS_;
+		boost::optional<QString> CommentsLink_;
+
+		QList<Enclosure> Enclosures_;
+		QList<Enclosure> EncEnclosures_;
+
+		boost::optional<QString> Lat_;
+		boost::optional<QString> Long_;
+		boost::optional<QString> Point_;
+	};
+
+	struct StreamParser::ChannelData
+	{
+		boost::optional<QString> Title_;
+		boost::optional<QString> Description_;
+		boost::optional<QString> Link_;
+		boost::optional<QString> AlternateLink_;
+		boost::optional<QString> LastBuildDate_;
+		boost::optional<QString> Language_;
+		boost::optional<QString> ManagingEditor_;
+		boost::optional<QString> WebMaster_;
+		boost::optional<QString> ImageURL_;
+		boost::optional<QString> Updated_;
+		boost::optional<QString> Subtitle_;
+		boost::optional<QString> Tagline_;
+		boost::optional<QString> DCDate_;
+
+		AuthorData Author_;
+		boost::optional<QHash<QString, QString>> AtomAuthor_;
+
+		bool ItemsSeen_ = false;
+		boost::optional<QStringList> ItemResources_;
+	};
+
+	namespace
+	{
+		template<typename T, typename F>
+		void SetFirst (boost::optional<T>& opt, F&& getter)
+		{
+			if (!opt)
+				opt = getter ();
+		}
+
+		QString ValueOrEmpty (const boost::optional<QString>& opt)
+		{
+			return opt.get_value_or (QString {});
+		}
+
+		QString AttributeByLocalName (const QXmlStreamAttributes& attrs, const QString& name)
+		{
+			for (const auto& attr : attrs)
+				if (attr.name () == name)
+					return attr.value ().toString ();
+			return {};
+		}
+
+		Enclosure MakeEnclosure (const QXmlStreamAttributes& attrs, const QString& urlAttr, const IDType_t& itemId)
+		{
+			Enclosure e (itemId);
+			e.URL_ = attrs.value (urlAttr).toString ();
+			e.Type_ = attrs.value ("type").toString ();
+			e.Length_ = attrs.hasAttribute ("length") ?
+					attrs.value ("length").toLongLong () :
+					-1;
+			e.Lang_ = attrs.value ("hreflang").toString ();
+			return e;
+		}
+	}
+
+	StreamParser::StreamParser (QIODevice *device, const IDType_t& feedId)
+	: Reader_ { device }
+	, FeedID_ { feedId }
+	{
+	}
+
+	template<typename F>
+	void StreamParser::WalkChildren (F&& handler)
+	{
+		int depth = 0;
+		while (!Reader_.atEnd ())
+			switch (Reader_.readNext ())
+			{
+			case QXmlStreamReader::StartElement:
+				if (!handler (depth == 0))
+					++depth;
+				break;
+			case QXmlStreamReader::EndElement:
+				if (!depth--)
+					return;
+				break;
+			default:
+				break;
+			}
+	}
+
+	StreamParser::Result StreamParser::Parse ()
+	{
+		if (!Reader_.readNextStartElement ())
+			return Reader_.hasError () ? Result::Malformed : Result::Unsupported;
+
+		if (!DetectFormat ())
+			return Result::Unsupported;
+
+		switch (Format_)
+		{
+		case Format::RSS091:
+		case Format::RSS20:
+			WalkChildren ([this] (bool isDirect)
+					{
+						if (!isDirect || Reader_.name () != "channel")
+							return false;
+
+						ParseRSSChannel ();
+						return true;
+					});
+			break;
+		case Format::RSS10:
+			ParseRSS10 ();
+			break;
+		case Format::Atom03:
+		case Format::Atom10:
+			ParseAtomFeed ();
+			break;
+		}
+
+		while (!Reader_.atEnd ())
+			Reader_.readNext ();
+
+		if (Reader_.hasError ())
+		{
+			Channels_.clear ();
+			return Result::Malformed;
+		}
+
+		return Result::Parsed;
+	}
+
+	const channels_container_t& StreamParser::GetChannels () const
+	{
+		return Channels_;
+	}
+
+	QString StreamParser::GetErrorString () const
+	{
+		return Reader_.errorString ();
+	}
+
+	qint64 StreamParser::GetErrorLine () const
+	{
+		return Reader_.lineNumber ();
+	}
+
+	qint64 StreamParser::GetErrorColumn () const
+	{
+		return Reader_.columnNumber ();
+	}
+
+	bool StreamParser::DetectFormat ()
+	{
+		// MediaRSS is too context-dependent to be parsed in a streaming fashion.
+		for (const auto& decl : Reader_.namespaceDeclarations ())
+			if (decl.namespaceUri () == Parser::MediaRSS_)
+				return false;
+
+		const auto& name = Reader_.name ();
+		const auto& attrs = Reader_.attributes ();
+		const auto& version = attrs.value ("version");
+		if (name == "rss")
+		{
+			if (version == "2.0")
+				Format_ = Format::RSS20;
+			else if (version == "0.91" || version == "0.92")
+				Format_ = Format::RSS091;
+			else
+				return false;
+		}
+		else if (name == "RDF")
+			Format_ = Format::RSS10;
+		else if (name == "feed")
+		{
+			if (!attrs.hasAttribute ("version") || version == "1.0")
+				Format_ = Format::Atom10;
+			else if (version == "0.3")
+				Format_ = Format::Atom03;
+			else
+				return false;
+		}
+		else
+			return false;
+
+		return true;
+	}
+
+	void StreamParser::ParseRSSChannel ()
+	{
+		const auto chan = std::make_shared<Channel> (FeedID_);
+
+		ChannelData data;
+		WalkChildren ([&] (bool isDirect)
+				{
+					if (isDirect && Reader_.name () == "item")
+					{
+						chan->Items_.push_back (ParseItem (chan->ChannelID_, &data.Author_));
+						return true;
+					}
+
+					return HandleChannelElement (data, isDirect);
+				});
+
+		chan->Title_ = ValueOrEmpty (data.Title_).trimmed ();
+		chan->Description_ = ValueOrEmpty (data.Description_);
+
+		if (Format_ == Format::RSS20)
+		{
+			chan->Link_ = ValueOrEmpty (data.AlternateLink_);
+			chan->LastBuild_ = FromRFC822 (ValueOrEmpty (data.LastBuildDate_));
+			chan->Language_ = ValueOrEmpty (data.Language_);
+			chan->Author_ = data.Author_.Get ();
+			if (chan->Author_.isEmpty ())
+				chan->Author_ = ValueOrEmpty (data.ManagingEditor_);
+			if (chan->Author_.isEmpty ())
+				chan->Author_ = ValueOrEmpty (data.WebMaster_);
+			chan->PixmapURL_ = ValueOrEmpty (data.ImageURL_);
+		}
+		else
+			chan->Link_ = ValueOrEmpty (data.Link_);
+
+		if (!chan->LastBuild_.isValid () || chan->LastBuild_.isNull ())
+		{
+			if (!chan->Items_.empty ())
+				chan->LastBuild_ = chan->Items_.at (0)->PubDate_;
+			else
+				chan->LastBuild_ = QDateTime::currentDateTime ();
+		}
+
+		FinishChannel (chan);
+		Channels_.push_back (chan);
+	}
+
+	void StreamParser::ParseRSS10 ()
+	{
+		QHash<QString, Channel_ptr> item2Channel;
+
+		WalkChildren ([&] (bool isDirect)
+				{
+					if (!isDirect)
+						return false;
+
+					if (Reader_.name () == "channel")
+					{
+						const auto chan = std::make_shared<Channel> (FeedID_);
+
+						ChannelData data;
+						WalkChildren ([&] (bool isDirect) { return HandleChannelElement (data, isDirect); });
+
+						chan->Title_ = ValueOrEmpty (data.Title_).trimmed ();
+						chan->Link_ = ValueOrEmpty (data.Link_);
+						chan->Description_ = ValueOrEmpty (data.Description_);
+						chan->PixmapURL_ = ValueOrEmpty (data.ImageURL_);
+						chan->LastBuild_ = FromRFC3339 (ValueOrEmpty (data.DCDate_));
+
+						if (data.ItemResources_)
+						{
+							for (const auto& resource : *data.ItemResources_)
+								item2Channel [resource] = chan;
+							Channels_.push_back (chan);
+						}
+						return true;
+					}
+
+					if (Reader_.name () == "item")
+					{
+						const auto& about = Reader_.attributes ().value (Parser::RDF_, "about").toString ();
+						if (const auto& chan = item2Channel.value (about))
+							chan->Items_.push_back (ParseItem (chan->ChannelID_, nullptr));
+						else
+							Reader_.skipCurrentElement ();
+						return true;
+					}
+
+					return false;
+				});
+
+		for (const auto& chan : Channels_)
+			FinishChannel (chan);
+	}
+
+	void StreamParser::ParseAtomFeed ()
+	{
+		const auto chan = std::make_shared<Channel> (FeedID_);
+
+		ChannelData data;
+		WalkChildren ([&] (bool isDirect)
+				{
+					if (isDirect && Reader_.name () == "entry")
+					{
+						chan->Items_.push_back (ParseItem (chan->ChannelID_, &data.Author_));
+						return true;
+					}
+
+					return HandleChannelElement (data, isDirect);
+				});
+
+		chan->Title_ = ValueOrEmpty (data.Title_).trimmed ();
+		if (chan->Title_.isEmpty ())
+			chan->Title_ = QObject::tr ("(No title)");
+		chan->LastBuild_ = FromRFC3339 (ValueOrEmpty (data.Updated_));
+		chan->Link_ = ValueOrEmpty (data.AlternateLink_);
+		chan->Author_ = data.Author_.Get ();
+
+		if (Format_ == Format::Atom10)
+		{
+			chan->Description_ = ValueOrEmpty (data.Subtitle_);
+			if (chan->Author_.isEmpty ())
+			{
+				const auto& author = data.AtomAuthor_.get_value_or ({});
+				chan->Author_ = author.value ("name") +
+						" (" +
+						author.value ("email") +
+						")";
+			}
+		}
+		else
+			chan->Description_ = ValueOrEmpty (data.Tagline_);
+
+		chan->Language_ = "<>";
+
+		FinishChannel (chan);
+		Channels_.push_back (chan);
+	}
+
+	bool StreamParser::HandleChannelElement (ChannelData& data, bool isDirect)
+	{
+		const auto& ns = Reader_.namespaceUri ().toString ();
+		const auto& name = Reader_.name ().toString ();
+		const auto attrs = Reader_.attributes ();
+
+		boost::optional<QString> text;
+		const auto readText = [this, &text]
+		{
+			if (!text)
+				text = ReadText ();
+			return *text;
+		};
+
+		if (isDirect)
+		{
+			if (name == "title")
+				SetFirst (data.Title_, readText);
+			else if (name == "description")
+				SetFirst (data.Description_, readText);
+			else if (name == "link")
+			{
+				SetFirst (data.Link_, readText);
+				if (!attrs.hasAttribute ("rel") || attrs.value ("rel") == "alternate")
+					SetFirst (data.AlternateLink_,
+							[&]
+							{
+								return attrs.hasAttribute ("href") ?
+										attrs.value ("href").toString () :
+										readText ();
+							});
+			}
+			else if (name == "lastBuildDate")
+				SetFirst (data.LastBuildDate_, readText);
+			else if (name == "language")
+				SetFirst (data.Language_, readText);
+			else if (name == "managingEditor")
+				SetFirst (data.ManagingEditor_, readText);
+			else if (name == "webMaster")
+				SetFirst (data.WebMaster_, readText);
+			else if (name == "updated")
+				SetFirst (data.Updated_, readText);
+			else if (name == "subtitle")
+				SetFirst (data.Subtitle_, readText);
+			else if (name == "tagline")
+				SetFirst (data.Tagline_, readText);
+			else if (name == "image" && !data.ImageURL_)
+			{
+				// RSS 2.0 takes the attribute, RSS 1.0 takes the child element.
+				if (Format_ == Format::RSS10)
+				{
+					QHash<QString, QString> children;
+					ReadText (&children);
+					data.ImageURL_ = children.value ("url");
+				}
+				else
+				{
+					data.ImageURL_ = attrs.value ("url").toString ();
+					Reader_.skipCurrentElement ();
+				}
+				return true;
+			}
+			else if (name == "author" && !data.AtomAuthor_ &&
+					(Format_ == Format::Atom03 || Format_ == Format::Atom10))
+			{
+				QHash<QString, QString> children;
+				text = ReadText (&children);
+				data.AtomAuthor_ = children;
+			}
+			else if (name == "items" && !data.ItemsSeen_ && Format_ == Format::RSS10)
+			{
+				data.ItemsSeen_ = true;
+
+				QStringList resources;
+				bool hasSeq = false;
+				WalkChildren ([&] (bool)
+						{
+							if (hasSeq || Reader_.namespaceUri () != Parser::RDF_ || Reader_.name () != "Seq")
+								return false;
+
+							hasSeq = true;
+							WalkChildren ([&] (bool)
+									{
+										if (Reader_.namespaceUri () == Parser::RDF_ && Reader_.name () == "li")
+											resources << AttributeByLocalName (Reader_.attributes (), "resource");
+										return false;
+									});
+							return true;
+						});
+
+				if (hasSeq)
+					data.ItemResources_ = resources;
+				return true;
+			}
+		}
+
+		if (ns == Parser::DC_ && name == "date")
+			SetFirst (data.DCDate_, readText);
+
+		if (IsAuthorElement (ns, name))
+			RecordAuthor (data.Author_, ns, name, readText ());
+
+		return static_cast<bool> (text);
+	}
+
+	Item_ptr StreamParser::ParseItem (const IDType_t& channelId, AuthorData *channelAuthor)
+	{
+		const auto item = std::make_shared<Item> (channelId);
+
+		ItemData data;
+		WalkChildren ([&] (bool isDirect) { return HandleItemElement (data, *item, isDirect, channelAuthor); });
+
+		FillItem (*item, data);
+		return item;
+	}
+
+	bool StreamParser::HandleItemElement (ItemData& data, const Item& item, bool isDirect, AuthorData *channelAuthor)
+	{
+		const auto& ns = Reader_.namespaceUri ().toString ();
+		const auto& name = Reader_.name ().toString ();
+		const auto attrs = Reader_.attributes ();
+
+		if (name == "enclosure" && (Format_ == Format::RSS091 || Format_ == Format::RSS20))
+			data.Enclosures_ << MakeEnclosure (attrs, "url", item.ItemID_);
+		if (name == "link" && attrs.value ("rel") == "enclosure" &&
+				(Format_ == Format::Atom03 || Format_ == Format::Atom10))
+			data.Enclosures_ << MakeEnclosure (attrs, "href", item.ItemID_);
+		if (ns == Parser::Enc_ && name == "enclosure")
+		{
+			Enclosure e (item.ItemID_);
+			e.URL_ = attrs.value (Parser::RDF_, "resource").toString ();
+			e.Type_ = attrs.value (Parser::Enc_, "type").toString ();
+			e.Length_ = attrs.hasAttribute (Parser::Enc_, "length") ?
+					attrs.value (Parser::Enc_, "length").toLongLong () :
+					-1;
+			e.Lang_ = "";
+			data.EncEnclosures_ << e;
+		}
+
+		boost::optional<QString> text;
+		const auto readText = [this, &text]
+		{
+			if (!text)
+				text = ReadText ();
+			return *text;
+		};
+		const auto readEscapeAware = [&]
+		{
+			EscapeAwareText result { readText (), {}, attrs.value ("mode").toString () };
+			if (attrs.hasAttribute ("type"))
+				result.Type_ = attrs.value ("type").toString ();
+			return result;
+		};
+
+		if (isDirect)
+		{
+			if (name == "title")
+				SetFirst (data.Title_, readEscapeAware);
+			else if (name == "link")
+			{
+				SetFirst (data.Link_, readText);
+				if (!attrs.hasAttribute ("rel") || attrs.value ("rel") == "alternate")
+					SetFirst (data.AlternateLink_,
+							[&]
+							{
+								return attrs.hasAttribute ("href") ?
+										attrs.value ("href").toString () :
+										readText ();
+							});
+			}
+			else if (name == "description")
+				SetFirst (data.Description_, readText);
+			else if (name == "content")
+				SetFirst (data.Content_, readEscapeAware);
+			else if (name == "summary")
+				SetFirst (data.Summary_, readEscapeAware);
+			else if (name == "pubDate")
+				SetFirst (data.PubDate_, readText);
+			else if (name == "updated")
+				SetFirst (data.Updated_, readText);
+			else if (name == "modified")
+				SetFirst (data.Modified_, readText);
+			else if (name == "issued")
+				SetFirst (data.Issued_, readText);
+			else if (name == "guid")
+				SetFirst (data.Guid_, readText);
+			else if (name == "id")
+				SetFirst (data.Id_, readText);
+		}
+
+		if (ns == Parser::Content_ && name == "encoded")
+			data.ContentEncoded_ << readText ();
+		else if (ns == Parser::ITunes_ && name == "summary")
+			data.ITunesSummaries_ << readText ();
+		else if (ns == Parser::ITunes_ && name == "duration")
+			SetFirst (data.Duration_, readText);
+		else if (ns == Parser::ITunes_ && name == "keywords")
+			data.ITunesKeywords_ << readText ();
+		else if (ns == Parser::DC_ && name == "date")
+			SetFirst (data.DCDate_, readText);
+		else if (ns == Parser::DC_ && name == "subject")
+			data.DCCategories_ << readText ();
+		else if (ns == Parser::Slash_ && name == "comments")
+			SetFirst (data.NumComments_, readText);
+		else if (ns == Parser::WFW_ && name == "commentRss")
+			SetFirst (data.CommentsRSS_, readText);
+		else if (ns.isEmpty () && name == "comments")
+			SetFirst (data.CommentsLink_, readText);
+		else if (ns == Parser::GeoRSSW3_ && name == "lat")
+			SetFirst (data.Lat_, readText);
+		else if (ns == Parser::GeoRSSW3_ && name == "long")
+			SetFirst (data.Long_, readText);
+		else if (ns == Parser::GeoRSSSimple_ && name == "point")
+			SetFirst (data.Point_, readText);
+
+		if (name == "category")
+			data.PlainCategories_ << readText ();
+
+		if (IsAuthorElement (ns, name))
+		{
+			RecordAuthor (data.Author_, ns, name, readText ());
+			if (channelAuthor)
+				RecordAuthor (*channelAuthor, ns, name, readText ());
+		}
+
+		return static_cast<bool> (text);
+	}
+
+	void StreamParser::FillItem (Item& item, const ItemData& data) const
+	{
+		const auto& title = data.Title_ ? data.Title_->Text_ : QString {};
+		switch (Format_)
+		{
+		case Format::RSS091:
+		case Format::RSS20:
+			item.Title_ = Parser::UnescapeHTML (title);
+			if (item.Title_.isEmpty ())
+				item.Title_ = "<>";
+			item.Link_ = ValueOrEmpty (data.Link_);
+			item.Description_ = ValueOrEmpty (data.Description_);
+			item.Guid_ = ValueOrEmpty (data.Guid_);
+			break;
+		case Format::RSS10:
+			item.Title_ = title;
+			item.Link_ = ValueOrEmpty (data.Link_);
+			item.Description_ = ValueOrEmpty (data.Description_);
+			item.PubDate_ = FromRFC3339 (ValueOrEmpty (data.DCDate_));
+			break;
+		case Format::Atom03:
+			item.Title_ = ParseEscapeAware (data.Title_);
+			item.Link_ = ValueOrEmpty (data.AlternateLink_);
+			item.Guid_ = ValueOrEmpty (data.Id_);
+			item.PubDate_ = FromRFC3339 (data.Modified_ ? *data.Modified_ : ValueOrEmpty (data.Issued_));
+			item.Description_ = ParseEscapeAware (data.Content_ ? data.Content_ : data.Summary_);
+			break;
+		case Format::Atom10:
+			item.Title_ = title;
+			item.Link_ = ValueOrEmpty (data.AlternateLink_);
+			item.Guid_ = ValueOrEmpty (data.Id_);
+			item.PubDate_ = FromRFC3339 (ValueOrEmpty (data.Updated_));
+			item.Description_ = ParseEscapeAware (data.Content_ ? data.Content_ : data.Summary_);
+			break;
+		}
+
+		const auto& extDescriptions = data.ContentEncoded_ + data.ITunesSummaries_;
+		if (!extDescriptions.isEmpty ())
+		{
+			const auto& ext = *std::max_element (extDescriptions.begin (), extDescriptions.end (),
+					Util::ComparingBy (&QString::size));
+			if (ext.size () > item.Description_.size ())
+				item.Description_ = ext;
+		}
+
+		if (Format_ == Format::RSS20 && data.Duration_)
+		{
+			if (!item.Description_.isEmpty ())
+				item.Description_ += "<br /><br />";
+			item.Description_ += QObject::tr ("Duration: %1").arg (*data.Duration_);
+		}
+
+		if (Format_ == Format::RSS20 && data.PubDate_ && !data.PubDate_->isEmpty ())
+		{
+			item.PubDate_ = FromRFC822 (*data.PubDate_);
+			if (!item.PubDate_.isValid () || item.PubDate_.isNull ())
+				item.PubDate_ = QDateTime::currentDateTime ();
+		}
+		else if (Format_ == Format::RSS091)
+		{
+			item.PubDate_ = FromRFC822 (ValueOrEmpty (data.PubDate_));
+			if (!item.PubDate_.isValid () || item.PubDate_.isNull ())
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "can't parse RSS 0.91 item pubDate:"
+						<< ValueOrEmpty (data.PubDate_);
+				item.PubDate_ = QDateTime::currentDateTime ();
+			}
+		}
+
+		if (item.Guid_.isEmpty () && Format_ != Format::Atom03 && Format_ != Format::Atom10)
+			item.Guid_ = "empty";
+
+		auto dcCategories = data.DCCategories_;
+		dcCategories.removeAll ("");
+		auto plainCategories = data.PlainCategories_;
+		plainCategories.removeAll ("");
+		item.Categories_ = dcCategories + plainCategories;
+		for (const auto& keyword : data.ITunesKeywords_)
+			item.Categories_ << QObject::tr ("Podcast %1").arg (keyword);
+
+		item.Unread_ = true;
+		item.Author_ = data.Author_.Get ();
+		item.NumComments_ = data.NumComments_ ? data.NumComments_->toInt () : -1;
+		item.CommentsLink_ = ValueOrEmpty (data.CommentsRSS_);
+		item.CommentsPageLink_ = ValueOrEmpty (data.CommentsLink_);
+		item.Enclosures_ = data.Enclosures_ + data.EncEnclosures_;
+
+		item.Latitude_ = 0;
+		item.Longitude_ = 0;
+		if (data.Lat_ && data.Long_)
+		{
+			item.Latitude_ = data.Lat_->toDouble ();
+			item.Longitude_ = data.Long_->toDouble ();
+		}
+		else if (data.Point_)
+		{
+			const auto& splitted = data.Point_->split (' ', QString::KeepEmptyParts);
+			if (splitted.size () == 2)
+			{
+				item.Latitude_ = splitted.at (0).toDouble ();
+				item.Longitude_ = splitted.at (1).toDouble ();
+			}
+		}
+	}
+
+	void StreamParser::FinishChannel (const Channel_ptr& chan) const
+	{
+		if (chan->Link_.isEmpty ())
+		{
+			qWarning () << Q_FUNC_INFO
+				<< "detected empty link for"
+				<< chan->Title_;
+			chan->Link_ = "about:blank";
+		}
+		for (const auto& item : chan->Items_)
+			item->Title_ = item->Title_.trimmed ().simplified ();
+	}
+
+	QString StreamParser::ReadText (QHash<QString, QString> *childrenTexts)
+	{
+		QString result;
+
+		int depth = 0;
+		QString child;
+		int childStart = 0;
+		while (!Reader_.atEnd ())
+			switch (Reader_.readNext ())
+			{
+			case QXmlStreamReader::Characters:
+				// Whitespace-only nodes are dropped to match QDomElement::text().
+				if (!Reader_.isWhitespace ())
+					result += Reader_.text ();
+				break;
+			case QXmlStreamReader::StartElement:
+				if (!depth++)
+				{
+					child = Reader_.name ().toString ();
+					childStart = result.size ();
+				}
+				break;
+			case QXmlStreamReader::EndElement:
+				if (!depth--)
+					return result;
+				if (!depth && childrenTexts && !childrenTexts->contains (child))
+					(*childrenTexts) [child] = result.mid (childStart);
+				break;
+			default:
+				break;
+			}
+
+		return result;
+	}
+
+	QString StreamParser::ParseEscapeAware (const boost::optional<EscapeAwareText>& text)
+	{
+		if (!text)
+			return {};
+
+		if (!text->Type_ ||
+				*text->Type_ == "text" ||
+				(*text->Type_ == "text/html" && text->Mode_ != "escaped"))
+			return text->Text_;
+
+		return Parser::UnescapeHTML (text->Text_);
+	}
+
+	QDateTime StreamParser::FromRFC822 (const QString& str)
+	{
+		return static_cast<const RSSParser&> (RSS20Parser::Instance ()).RFC822TimeToQDateTime (str);
+	}
+
+	QDateTime StreamParser::FromRFC3339 (const QString& str)
+	{
+		return static_cast<const Parser&> (Atom10Parser::Instance ()).FromRFC3339 (str);
+	}
+
+	bool StreamParser::IsAuthorElement (const QString& ns, const QString& name)
+	{
+		return name == "author" || (ns == Parser::DC_ && name == "creator");
+	}
+
+	void StreamParser::RecordAuthor (AuthorData& data, const QString& ns, const QString& name, const QString& text)
+	{
+		if (ns == Parser::ITunes_ && name == "author")
+			SetFirst (data.ITunes_, [&] { return text; });
+		else if (ns == Parser::DC_ && name == "creator")
+			SetFirst (data.DC_, [&] { return text; });
+
+		if (name == "author")
+			SetFirst (data.Plain_, [&] { return text; });
+	}
+}
+}
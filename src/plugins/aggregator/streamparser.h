@@ -0,0 +1,128 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QHash>
+#include <QXmlStreamReader>
+#include "channel.h"
+
+class QIODevice;
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	/** @brief Parses feeds without building their DOM tree.
+	 *
+	 * This parser handles RSS 0.91/0.92/2.0, RSS 1.0 and Atom 0.3/1.0
+	 * documents with a QXmlStreamReader, creating channels and items
+	 * as the corresponding elements are read, so it is suitable for
+	 * being run in a thread pool on large feeds.
+	 *
+	 * Documents in other formats or using the MediaRSS extension are
+	 * reported as unsupported, and the DOM-based parsers should be
+	 * used for them instead.
+	 *
+	 * The resulting channels have the same semantics as the ones
+	 * produced by Parser::ParseFeed().
+	 */
+	class StreamParser
+	{
+	public:
+		enum class Result
+		{
+			Parsed,
+			Unsupported,
+			Malformed
+		};
+	private:
+		enum class Format
+		{
+			RSS091,
+			RSS10,
+			RSS20,
+			Atom03,
+			Atom10
+		};
+
+		struct AuthorData;
+		struct EscapeAwareText;
+		struct ItemData;
+		struct ChannelData;
+
+		QXmlStreamReader Reader_;
+		const IDType_t FeedID_;
+
+		Format Format_ = Format::RSS20;
+		channels_container_t Channels_;
+	public:
+		/** @brief Constructs the parser reading from the given device.
+		 *
+		 * @param[in] device The device with the XML document, opened
+		 * for reading.
+		 * @param[in] feedId The ID of the feed the channels belong to.
+		 */
+		StreamParser (QIODevice *device, const IDType_t& feedId);
+
+		Result Parse ();
+
+		const channels_container_t& GetChannels () const;
+
+		QString GetErrorString () const;
+		qint64 GetErrorLine () const;
+		qint64 GetErrorColumn () const;
+	private:
+		bool DetectFormat ();
+
+		void ParseRSSChannel ();
+		void ParseRSS10 ();
+		void ParseAtomFeed ();
+
+		bool HandleChannelElement (ChannelData&, bool isDirect);
+		Item_ptr ParseItem (const IDType_t& channelId, AuthorData *channelAuthor);
+		bool HandleItemElement (ItemData&, const Item&, bool isDirect, AuthorData *channelAuthor);
+		void FillItem (Item&, const ItemData&) const;
+		void FinishChannel (const Channel_ptr&) const;
+
+		template<typename F>
+		void WalkChildren (F&&);
+
+		QString ReadText (QHash<QString, QString> *childrenTexts = nullptr);
+
+		static QString ParseEscapeAware (const boost::optional<EscapeAwareText>&);
+		static QDateTime FromRFC822 (const QString&);
+		static QDateTime FromRFC3339 (const QString&);
+
+		static bool IsAuthorElement (const QString& ns, const QString& name);
+		static void RecordAuthor (AuthorData&, const QString& ns, const QString& name, const QString& text);
+	};
+}
+}
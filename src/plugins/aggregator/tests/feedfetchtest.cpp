@@ -0,0 +1,237 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "feedfetchtest.h"
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QNetworkAccessManager>
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include "feedfetch.h"
+
+QTEST_GUILESS_MAIN (LeechCraft::Aggregator::FeedFetchTest)
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	namespace
+	{
+		const QByteArray ETag = "\"v1\"";
+
+		QByteArray ReadHeader (const QByteArray& request, const QByteArray& name)
+		{
+			for (const auto& line : request.split ('\n'))
+			{
+				const auto colon = line.indexOf (':');
+				if (colon > 0 && line.left (colon).trimmed ().toLower () == name.toLower ())
+					return line.mid (colon + 1).trimmed ();
+			}
+			return {};
+		}
+
+		FeedFetchResult WaitResult (const QFuture<FeedFetchResult>& future)
+		{
+			QFutureWatcher<FeedFetchResult> watcher;
+			QSignalSpy spy { &watcher, &QFutureWatcherBase::finished };
+			watcher.setFuture (future);
+			if (!future.isFinished ())
+				spy.wait (10000);
+			return future.result ();
+		}
+	}
+
+	void FeedFetchTest::initTestCase ()
+	{
+		Server_ = new QTcpServer { this };
+		QVERIFY (Server_->listen (QHostAddress::LocalHost));
+		connect (Server_,
+				&QTcpServer::newConnection,
+				this,
+				&FeedFetchTest::HandleConnection);
+
+		NAM_ = new QNetworkAccessManager { this };
+	}
+
+	void FeedFetchTest::init ()
+	{
+		Body_ = "<rss version=\"2.0\"><channel><title>Test</title></channel></rss>";
+		IgnoreValidators_ = false;
+		Stall_ = false;
+		Requests_ = 0;
+	}
+
+	void FeedFetchTest::cleanupTestCase ()
+	{
+		Server_->close ();
+	}
+
+	void FeedFetchTest::HandleConnection ()
+	{
+		while (const auto socket = Server_->nextPendingConnection ())
+		{
+			connect (socket,
+					&QTcpSocket::disconnected,
+					socket,
+					&QObject::deleteLater);
+
+			auto request = std::make_shared<QByteArray> ();
+			connect (socket,
+					&QTcpSocket::readyRead,
+					socket,
+					[this, socket, request]
+					{
+						*request += socket->readAll ();
+						if (!request->contains ("\r\n\r\n"))
+							return;
+
+						++Requests_;
+
+						if (!IgnoreValidators_ && ReadHeader (*request, "If-None-Match") == ETag)
+						{
+							socket->write ("HTTP/1.1 304 Not Modified\r\n"
+									"ETag: " + ETag + "\r\n"
+									"Connection: close\r\n\r\n");
+							socket->disconnectFromHost ();
+							return;
+						}
+
+						socket->write ("HTTP/1.1 200 OK\r\n"
+								"Content-Type: application/rss+xml\r\n"
+								"ETag: " + ETag + "\r\n"
+								"Content-Length: " + QByteArray::number (Body_.size () + (Stall_ ? 1 : 0)) + "\r\n"
+								"Connection: close\r\n\r\n");
+						if (Stall_)
+							return;
+
+						socket->write (Body_);
+						socket->disconnectFromHost ();
+					});
+		}
+	}
+
+	QString FeedFetchTest::GetUrl () const
+	{
+		return QString { "http://127.0.0.1:%1/feed.xml" }.arg (Server_->serverPort ());
+	}
+
+	FeedFetchResult FeedFetchTest::Fetch (const QByteArray& etag, const QByteArray& hash, int timeout)
+	{
+		boost::optional<Feed::FetchState> state;
+		if (!etag.isEmpty () || !hash.isEmpty ())
+			state = Feed::FetchState { 1, etag, {}, hash };
+
+		const auto fetch = new FeedFetch { NAM_, GetUrl (), 1, state, timeout };
+		return WaitResult (fetch->GetFuture ());
+	}
+
+	void FeedFetchTest::testFirstFetch ()
+	{
+		const auto& result = Fetch ({}, {});
+
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::Updated);
+		QCOMPARE (result.State_.FeedID_, IDType_t { 1 });
+		QCOMPARE (result.State_.ETag_, ETag);
+		QCOMPARE (result.State_.BodyHash_, QCryptographicHash::hash (Body_, QCryptographicHash::Sha1));
+
+		QFile file { result.FileName_ };
+		QVERIFY (file.open (QIODevice::ReadOnly));
+		QCOMPARE (file.readAll (), Body_);
+		file.remove ();
+	}
+
+	void FeedFetchTest::testNotModified ()
+	{
+		const auto& result = Fetch (ETag, QCryptographicHash::hash (Body_, QCryptographicHash::Sha1));
+
+		QCOMPARE (Requests_, 1);
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::NotModified);
+		QVERIFY (result.FileName_.isEmpty ());
+	}
+
+	void FeedFetchTest::testUnchangedBody ()
+	{
+		IgnoreValidators_ = true;
+
+		const auto& result = Fetch ("\"v0\"", QCryptographicHash::hash (Body_, QCryptographicHash::Sha1));
+
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::Unchanged);
+		QCOMPARE (result.State_.ETag_, ETag);
+		QVERIFY (result.FileName_.isEmpty ());
+	}
+
+	void FeedFetchTest::testChangedBody ()
+	{
+		IgnoreValidators_ = true;
+
+		const auto& oldHash = QCryptographicHash::hash (Body_, QCryptographicHash::Sha1);
+		Body_.replace ("Test", "Changed");
+
+		const auto& result = Fetch (ETag, oldHash);
+
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::Updated);
+		QVERIFY (result.State_.BodyHash_ != oldHash);
+		QVERIFY (QFile::remove (result.FileName_));
+	}
+
+	void FeedFetchTest::testEmptyBody ()
+	{
+		Body_.clear ();
+
+		const auto& result = Fetch ({}, {});
+
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::Empty);
+	}
+
+	void FeedFetchTest::testStalled ()
+	{
+		Stall_ = true;
+
+		QElapsedTimer timer;
+		timer.start ();
+		const auto& result = Fetch ({}, {}, 300);
+
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::Error);
+		QVERIFY (!result.Error_.isEmpty ());
+		QVERIFY (timer.elapsed () < 5000);
+	}
+
+	void FeedFetchTest::testAbort ()
+	{
+		Stall_ = true;
+
+		const auto fetch = new FeedFetch { NAM_, GetUrl (), 1, {}, 5000 };
+		QTimer::singleShot (100, fetch, [fetch] { fetch->Abort (); });
+
+		const auto& result = WaitResult (fetch->GetFuture ());
+		QCOMPARE (result.Outcome_, FeedFetchResult::Outcome::Aborted);
+	}
+}
+}
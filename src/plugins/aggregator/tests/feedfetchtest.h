@@ -0,0 +1,79 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+
+class QTcpServer;
+class QNetworkAccessManager;
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	struct FeedFetchResult;
+
+	/** Fetches a feed from a local stand-in HTTP server.
+	 *
+	 * The server replies with a fixed document and ETag, honours
+	 * If-None-Match unless told to ignore validators, and can be told
+	 * to stall after sending the headers.
+	 */
+	class FeedFetchTest : public QObject
+	{
+		Q_OBJECT
+
+		QTcpServer *Server_ = nullptr;
+		QNetworkAccessManager *NAM_ = nullptr;
+
+		QByteArray Body_;
+		bool IgnoreValidators_ = false;
+		bool Stall_ = false;
+		int Requests_ = 0;
+	private slots:
+		void initTestCase ();
+		void init ();
+		void cleanupTestCase ();
+
+		void testFirstFetch ();
+		void testNotModified ();
+		void testUnchangedBody ();
+		void testChangedBody ();
+		void testEmptyBody ();
+		void testStalled ();
+		void testAbort ();
+	private:
+		void HandleConnection ();
+		FeedFetchResult Fetch (const QByteArray& etag, const QByteArray& hash, int timeout = 5000);
+		QString GetUrl () const;
+	};
+}
+}
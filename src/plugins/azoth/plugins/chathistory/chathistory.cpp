@@ -172,7 +172,7 @@ namespace ChatHistory
 		const auto account = entry->GetParentAccount ();
 		const QString& accId = account->GetAccountID ();
 		const QString& entryId = entry->GetEntryID ();
-		Util::Sequence (this, StorageMgr_->GetChatLogs (accId, entryId, 0, num)) >>
+		Util::Sequence (this, StorageMgr_->GetChatLogs (accId, entryId, num)) >>
 				std::bind (&Plugin::HandleGotChatLogs,
 						this, QPointer<QObject> { entryObj }, std::placeholders::_1);
 	}
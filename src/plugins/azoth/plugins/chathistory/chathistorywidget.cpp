@@ -255,7 +255,7 @@ namespace ChatHistory
 	}
 
 	void ChatHistoryWidget::HandleGotChatLogs (const QString& accountId,
-			const QString& entryId, const ChatLogsResult_t& result)
+			const QString& entryId, const ChatLogsPageResult_t& result)
 	{
 		const auto& selEntry = Ui_.Contacts_->selectionModel ()->
 				currentIndex ().data (MRIDRole).toString ();
@@ -264,7 +264,6 @@ namespace ChatHistory
 				entryId != selEntry)
 			return;
 
-		Amount_ = 0;
 		Ui_.HistView_->clear ();
 
 		auto& formatter = Params_.PluginProxy_->GetFormatterProxy ();
@@ -284,6 +283,12 @@ namespace ChatHistory
 			return;
 		}
 
+		const auto& page = result.GetRight ();
+		OldestRowId_ = page.OldestRowId_;
+		NewestRowId_ = page.NewestRowId_;
+		HasOlder_ = page.HasOlder_;
+		HasNewer_ = page.HasNewer_;
+
 		const auto& ourName = entry ?
 				entry->GetParentAccount ()->GetOurNick () :
 				QString ();
@@ -298,8 +303,9 @@ namespace ChatHistory
 
 		int scrollPos = -1;
 
-		for (const auto& logItem : result.GetRight ())
+		for (int i = 0; i < page.Items_.size (); ++i)
 		{
+			const auto& logItem = page.Items_.at (i);
 			const bool isChat = logItem.Type_ == IMessage::Type::ChatMessage;
 			const bool isIncoming = logItem.Dir_ == IMessage::Direction::In;
 
@@ -352,7 +358,7 @@ namespace ChatHistory
 
 			html += postNick + ' ' + msgText;
 
-			const bool isSearchRes = SearchResultPosition_ == PerPageAmount_ - ++Amount_;
+			const bool isSearchRes = i == page.AnchorIndex_;
 			if (isChat && !isSearchRes)
 			{
 				const auto& color = formatter.GetNickColor (isIncoming ? remoteName : ourName, colors);
@@ -446,8 +452,29 @@ namespace ChatHistory
 				}
 		}
 
-		Backpages_ = *position / PerPageAmount_;
-		SearchResultPosition_ = *position % PerPageAmount_;
+		Anchor_ = { ChatLogsAnchor::Kind::Around, *position };
+		RequestLogs ();
+	}
+
+	void ChatHistoryWidget::HandleGotDatePosition (const QString& accountId,
+			const QString& entryId, const SearchResult_t& result)
+	{
+		if (accountId != CurrentAccount_ ||
+				entryId != CurrentEntry_)
+			return;
+
+		if (const auto err = result.MaybeLeft ())
+		{
+			QMessageBox::critical (this,
+					"LeechCraft",
+					tr ("Unable to perform the search.") + " " + *err);
+			return;
+		}
+
+		if (const auto position = result.GetRight ())
+			Anchor_ = { ChatLogsAnchor::Kind::Around, *position };
+		else
+			Anchor_ = {};
 		RequestLogs ();
 	}
 
@@ -495,8 +522,7 @@ namespace ChatHistory
 		{
 			SearchShift_ = 0;
 			PreviousSearchText_.clear ();
-			Backpages_ = 0;
-			SearchResultPosition_ = -1;
+			Anchor_ = {};
 		}
 		ContactSelectedAsGlobSearch_ = false;
 
@@ -523,7 +549,7 @@ namespace ChatHistory
 
 		Util::Sequence (this,
 				Params_.StorageMgr_->Search (CurrentAccount_, CurrentEntry_, QDateTime { date })) >>
-				std::bind (&ChatHistoryWidget::HandleGotSearchPosition,
+				std::bind (&ChatHistoryWidget::HandleGotDatePosition,
 						this, CurrentAccount_, CurrentEntry_, _1);
 	}
 
@@ -534,8 +560,7 @@ namespace ChatHistory
 		if (text.isEmpty ())
 		{
 			PreviousSearchText_.clear ();
-			Backpages_ = 0;
-			SearchResultPosition_ = -1;
+			Anchor_ = {};
 			RequestLogs ();
 			return;
 		}
@@ -555,21 +580,19 @@ namespace ChatHistory
 
 	void ChatHistoryWidget::previousHistory ()
 	{
-		if (Amount_ < PerPageAmount_)
+		if (!HasOlder_)
 			return;
 
-		++Backpages_;
-		SearchResultPosition_ = -1;
+		Anchor_ = { ChatLogsAnchor::Kind::Before, OldestRowId_ };
 		RequestLogs ();
 	}
 
 	void ChatHistoryWidget::nextHistory ()
 	{
-		if (Backpages_ <= 0)
+		if (!HasNewer_)
 			return;
 
-		--Backpages_;
-		SearchResultPosition_ = -1;
+		Anchor_ = { ChatLogsAnchor::Kind::After, NewestRowId_ };
 		RequestLogs ();
 	}
 
@@ -594,7 +617,7 @@ namespace ChatHistory
 			ContactsModel_->removeRow (item->row ());
 		}
 
-		Backpages_ = 0;
+		Anchor_ = {};
 		RequestLogs ();
 	}
 
@@ -652,8 +675,8 @@ namespace ChatHistory
 
 	void ChatHistoryWidget::RequestLogs ()
 	{
-		const auto& future = Params_.StorageMgr_->GetChatLogs (CurrentAccount_,
-				CurrentEntry_, Backpages_, PerPageAmount_);
+		const auto& future = Params_.StorageMgr_->GetChatLogsPage (CurrentAccount_,
+				CurrentEntry_, Anchor_, PerPageAmount_);
 		Util::Sequence (this, future) >>
 				std::bind (&ChatHistoryWidget::HandleGotChatLogs, this, CurrentAccount_, CurrentEntry_, _1);
 	}
@@ -77,10 +77,12 @@ namespace ChatHistory
 
 		QStandardItemModel *ContactsModel_;
 		QSortFilterProxyModel *SortFilter_;
-		int Backpages_ = 0;
-		int Amount_ = 0;
+		ChatLogsAnchor Anchor_;
+		qint64 OldestRowId_ = -1;
+		qint64 NewestRowId_ = -1;
+		bool HasOlder_ = false;
+		bool HasNewer_ = false;
 		int SearchShift_ = 0;
-		int SearchResultPosition_ = -1;
 		bool ContactSelectedAsGlobSearch_ = false;
 		QString CurrentAccount_;
 		QString CurrentEntry_;
@@ -108,8 +110,9 @@ namespace ChatHistory
 	private:
 		void HandleGotOurAccounts (const QStringList&);
 		void HandleGotUsersForAccount (const QString&, const UsersForAccountResult_t&);
-		void HandleGotChatLogs (const QString&, const QString&, const ChatLogsResult_t&);
+		void HandleGotChatLogs (const QString&, const QString&, const ChatLogsPageResult_t&);
 		void HandleGotSearchPosition (const QString&, const QString&, const SearchResult_t&);
+		void HandleGotDatePosition (const QString&, const QString&, const SearchResult_t&);
 		void HandleGotDaysForSheet (const QString&, const QString&, int, int, const DaysResult_t&);
 	private slots:
 		void on_AccountBox__currentIndexChanged (int);
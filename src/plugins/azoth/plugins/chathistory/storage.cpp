@@ -60,11 +60,6 @@ namespace ChatHistory
 	{
 	}
 
-	bool Storage::RawSearchResult::IsEmpty () const
-	{
-		return RowID_ < 0 || !EntryID_ || !AccountID_;
-	}
-
 	Storage::Storage (QObject *parent)
 	: QObject (parent)
 	, DB_ (std::make_shared<QSqlDatabase> (QSqlDatabase::addDatabase ("QSQLITE",
@@ -99,6 +94,8 @@ namespace ChatHistory
 		QSqlQuery pragma (*DB_);
 		pragma.exec ("PRAGMA foreign_keys = ON;");
 		pragma.exec ("PRAGMA synchronous = OFF");
+		// Lets the background integrity check run without blocking writes.
+		pragma.exec ("PRAGMA journal_mode = WAL;");
 
 		InitializeTables ();
 
@@ -145,17 +142,12 @@ namespace ChatHistory
 		UsersForAccountGetter_.prepare ("SELECT DISTINCT azoth_acc2users2.UserId, EntryID FROM azoth_users, azoth_acc2users2 "
 				"WHERE azoth_acc2users2.UserId = azoth_users.Id AND azoth_acc2users2.AccountID = :account_id;");
 
-		RowID2Pos_ = QSqlQuery (*DB_);
-		RowID2Pos_.prepare ("SELECT COUNT(1) FROM azoth_history "
+		Date2RowId_ = QSqlQuery (*DB_);
+		Date2RowId_.prepare ("SELECT rowid FROM azoth_history "
 				"WHERE Id = :entry_id "
 				"AND AccountID = :account_id "
-				"AND rowid > :rowid");
-
-		Date2Pos_ = QSqlQuery (*DB_);
-		Date2Pos_.prepare ("SELECT COUNT(1) FROM azoth_history "
-				"WHERE Id = :entry_id "
-				"AND AccountID = :account_id "
-				"AND Date >= :date");
+				"AND Date >= :date "
+				"ORDER BY Date ASC LIMIT 1;");
 
 		GetMonthDates_ = QSqlQuery (*DB_);
 		GetMonthDates_.prepare ("SELECT Date FROM azoth_history "
@@ -164,36 +156,33 @@ namespace ChatHistory
 				"AND Date >= :lower_date "
 				"AND Date <= :upper_date");
 
-		LogsSearcher_ = QSqlQuery (*DB_);
-		LogsSearcher_.prepare ("SELECT Rowid FROM azoth_history "
-				"WHERE Id = :inner_entry_id "
-				"AND AccountID = :inner_account_id "
-				"AND ((Message LIKE :text AND :insensitive) OR (Message GLOB :ctext AND :sensitive)) "
-				"ORDER BY Rowid DESC "
-				"LIMIT 1 OFFSET :offset;");
-
-		LogsSearcherWOContact_ = QSqlQuery (*DB_);
-		LogsSearcherWOContact_.prepare ("SELECT Date, Id FROM azoth_history "
-				"WHERE AccountID = :account_id "
-				"AND Date = (SELECT Date FROM azoth_history "
-				"	WHERE AccountID = :inner_account_id "
-				"	AND ((Message LIKE :text AND :insensitive) OR (Message GLOB :ctext AND :sensitive)) "
-				"	ORDER BY Rowid DESC "
-				"	LIMIT 1 OFFSET :offset);");
-
-		LogsSearcherWOContactAccount_ = QSqlQuery (*DB_);
-		LogsSearcherWOContactAccount_.prepare ("SELECT Date, Id, AccountID FROM azoth_history "
-				"WHERE Date = (SELECT Date FROM azoth_history "
-				"	WHERE ((Message LIKE :text AND :insensitive) OR (Message GLOB :ctext AND :sensitive)) "
-				"	ORDER BY Rowid DESC "
-				"	LIMIT 1 OFFSET :offset);");
-
-		HistoryGetter_ = QSqlQuery (*DB_);
-		HistoryGetter_.prepare ("SELECT Date, Direction, Message, Variant, Type, RichMessage, EscapePolicy "
+		OlderHistoryGetter_ = QSqlQuery (*DB_);
+		OlderHistoryGetter_.prepare ("SELECT rowid, Date, Direction, Message, Variant, Type, RichMessage, EscapePolicy "
+				"FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND rowid < :rowid "
+				"ORDER BY rowid DESC LIMIT :limit;");
+
+		NewerHistoryGetter_ = QSqlQuery (*DB_);
+		NewerHistoryGetter_.prepare ("SELECT rowid, Date, Direction, Message, Variant, Type, RichMessage, EscapePolicy "
 				"FROM azoth_history "
 				"WHERE Id = :entry_id "
 				"AND AccountID = :account_id "
-				"ORDER BY Rowid DESC LIMIT :limit OFFSET :offset;");
+				"AND rowid > :rowid "
+				"ORDER BY rowid ASC LIMIT :limit;");
+
+		OlderHistoryChecker_ = QSqlQuery (*DB_);
+		OlderHistoryChecker_.prepare ("SELECT EXISTS (SELECT 1 FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND rowid < :rowid);");
+
+		NewerHistoryChecker_ = QSqlQuery (*DB_);
+		NewerHistoryChecker_.prepare ("SELECT EXISTS (SELECT 1 FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND rowid > :rowid);");
 
 		HistoryClearer_ = QSqlQuery (*DB_);
 		HistoryClearer_.prepare ("DELETE FROM azoth_history WHERE Id = :entry_id AND AccountID = :account_id;");
@@ -320,11 +309,19 @@ namespace ChatHistory
 
 		UpdateTables ();
 
-		if (!query.exec ("CREATE INDEX IF NOT EXISTS azoth_history_id_accountid ON azoth_history (Id, AccountId);"))
-		{
-			Util::DBLock::DumpError (query);
-			throw std::runtime_error ("Unable to index `azoth_history`.");
-		}
+		// Rowid is implicitly the last column of these indexes, so they
+		// also serve the keyset paging by rowid within a conversation.
+		for (const auto& str : {
+					"CREATE INDEX IF NOT EXISTS azoth_history_id_accountid ON azoth_history (Id, AccountId);",
+					"CREATE INDEX IF NOT EXISTS azoth_history_id_accountid_date ON azoth_history (Id, AccountId, Date);"
+				})
+			if (!query.exec (str))
+			{
+				Util::DBLock::DumpError (query);
+				throw std::runtime_error ("Unable to index `azoth_history`.");
+			}
+
+		InitializeSearchIndex ();
 
 		if (!hadAcc2User)
 			RegenUsersCache ();
@@ -367,6 +364,176 @@ namespace ChatHistory
 		}
 	}
 
+	namespace
+	{
+		const QString FTS5TrigramName = "fts5-trigram";
+		const QString FTS5Name = "fts5";
+		const QString FTS4Name = "fts4";
+
+		const qint64 SearchIndexBackfillBatch = 5000;
+
+		/** Checks whether FTS5 has the trigram tokenizer, which is only
+		 * there since SQLite 3.34.
+		 */
+		bool IsTrigramAvailable (QSqlQuery& query)
+		{
+			if (!query.exec ("CREATE VIRTUAL TABLE temp.azoth_history_trigram_probe "
+						"USING fts5 (Message, tokenize='trigram');"))
+				return false;
+
+			query.exec ("DROP TABLE temp.azoth_history_trigram_probe;");
+			return true;
+		}
+
+		void DropSearchIndexState (QSqlQuery& query)
+		{
+			for (const auto& str : {
+						"DROP TRIGGER IF EXISTS azoth_history_fts_insert;",
+						"DROP TRIGGER IF EXISTS azoth_history_fts_delete;",
+						"DROP TABLE azoth_history_fts_state;"
+					})
+				if (!query.exec (str))
+				{
+					Util::DBLock::DumpError (query);
+					throw std::runtime_error ("Unable to drop the search index.");
+				}
+		}
+	}
+
+	void Storage::InitializeSearchIndex ()
+	{
+		QSqlQuery query { *DB_ };
+
+		const auto& tables = DB_->tables ();
+		if (tables.contains ("azoth_history_fts_state") &&
+				query.exec ("SELECT Module, IndexedFrom FROM azoth_history_fts_state;") &&
+				query.next ())
+		{
+			const auto& module = query.value (0).toString ();
+			const auto indexedFrom = query.value (1).value<qint64> ();
+			query.finish ();
+
+			if (!query.exec ("SELECT rowid FROM azoth_history_fts WHERE 0;"))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "the"
+						<< module
+						<< "module is unavailable, dropping the search index triggers";
+				Util::DBLock::DumpError (query);
+
+				// Otherwise inserting into or deleting from azoth_history would fail.
+				DropSearchIndexState (query);
+				return;
+			}
+			query.finish ();
+
+			// Word indexes only help with the searches starting at a word
+			// boundary, so they are replaced once trigrams are available.
+			if (module == FTS5TrigramName || !IsTrigramAvailable (query))
+			{
+				IndexedFrom_ = indexedFrom;
+				if (module == FTS5TrigramName)
+					SearchIndex_ = SearchIndex::FTS5Trigram;
+				else
+					SearchIndex_ = module == FTS5Name ? SearchIndex::FTS5 : SearchIndex::FTS4;
+				return;
+			}
+
+			qDebug () << Q_FUNC_INFO
+					<< "replacing the"
+					<< module
+					<< "search index with a trigram one";
+			DropSearchIndexState (query);
+		}
+
+		// A leftover of an index whose state has been lost, if any.
+		query.exec ("DROP TABLE IF EXISTS azoth_history_fts;");
+
+		struct Candidate
+		{
+			SearchIndex Index_;
+			QString Module_;
+			QString Query_;
+		};
+		const QList<Candidate> candidates
+		{
+			{
+				SearchIndex::FTS5Trigram,
+				FTS5TrigramName,
+				"CREATE VIRTUAL TABLE azoth_history_fts USING fts5 (Message, content='azoth_history', tokenize='trigram');"
+			},
+			{
+				SearchIndex::FTS5,
+				FTS5Name,
+				"CREATE VIRTUAL TABLE azoth_history_fts USING fts5 (Message, content='azoth_history');"
+			},
+			{
+				SearchIndex::FTS4,
+				FTS4Name,
+				"CREATE VIRTUAL TABLE azoth_history_fts USING fts4 (content='azoth_history', Message, tokenize=unicode61);"
+			},
+			{
+				SearchIndex::FTS4,
+				FTS4Name,
+				"CREATE VIRTUAL TABLE azoth_history_fts USING fts4 (content='azoth_history', Message);"
+			}
+		};
+
+		const auto pos = std::find_if (candidates.begin (), candidates.end (),
+				[&query] (const Candidate& candidate) { return query.exec (candidate.Query_); });
+		if (pos == candidates.end ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "neither FTS5 nor FTS4 are available, searching without an index";
+			return;
+		}
+
+		const bool isFts5 = pos->Index_ != SearchIndex::FTS4;
+
+		QStringList queries
+		{
+			"CREATE TABLE azoth_history_fts_state ("
+				"Module TEXT NOT NULL, "
+				"IndexedFrom INTEGER NOT NULL"
+				");",
+			QString { "INSERT INTO azoth_history_fts_state (Module, IndexedFrom) "
+					"SELECT '%1', IFNULL(MAX(rowid), 0) + 1 FROM azoth_history;" }
+				.arg (pos->Module_),
+			"CREATE TRIGGER azoth_history_fts_insert AFTER INSERT ON azoth_history "
+				"WHEN new.rowid >= (SELECT IndexedFrom FROM azoth_history_fts_state) "
+				"BEGIN "
+				"INSERT INTO azoth_history_fts (rowid, Message) VALUES (new.rowid, new.Message); "
+				"END;"
+		};
+		if (isFts5)
+			queries << "CREATE TRIGGER azoth_history_fts_delete AFTER DELETE ON azoth_history "
+					"WHEN old.rowid >= (SELECT IndexedFrom FROM azoth_history_fts_state) "
+					"BEGIN "
+					"INSERT INTO azoth_history_fts (azoth_history_fts, rowid, Message) "
+					"VALUES ('delete', old.rowid, old.Message); "
+					"END;";
+		else
+			queries << "CREATE TRIGGER azoth_history_fts_delete BEFORE DELETE ON azoth_history "
+					"WHEN old.rowid >= (SELECT IndexedFrom FROM azoth_history_fts_state) "
+					"BEGIN "
+					"DELETE FROM azoth_history_fts WHERE rowid = old.rowid; "
+					"END;";
+		queries << "SELECT IndexedFrom FROM azoth_history_fts_state;";
+
+		for (const auto& str : queries)
+			if (!query.exec (str))
+			{
+				Util::DBLock::DumpError (query);
+				throw std::runtime_error ("Unable to create the search index for Azoth history.");
+			}
+
+		if (!query.next ())
+			throw std::runtime_error ("Unable to fetch the search index state.");
+
+		IndexedFrom_ = query.value (0).value<qint64> ();
+		SearchIndex_ = pos->Index_;
+	}
+
 	QHash<QString, qint32> Storage::GetUsers ()
 	{
 		if (!UserSelector_.exec ())
@@ -516,60 +683,91 @@ namespace ChatHistory
 		}
 	}
 
-	Storage::RawSearchResult Storage::SearchImpl (const QString& accountId,
-			const QString& entryId, const QString& text, int shift, bool cs)
+	namespace
 	{
-		if (!Accounts_.contains (accountId))
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "Accounts_ doesn't contain"
-					<< accountId
-					<< "; raw contents"
-					<< Accounts_;
-			return {};
-		}
-		if (!Users_.contains (entryId))
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "Users_ doesn't contain"
-					<< entryId
-					<< "; raw contents"
-					<< Users_;
-			return {};
-		}
+		/** Checks whether the search text has any characters that are
+		 * special in the LIKE or GLOB pattern it is matched with, which
+		 * the index knows nothing about.
+		 */
+		bool HasWildcards (const QString& text, bool cs)
+		{
+			const QString wildcards { cs ? "*?[" : "%_" };
+			return std::any_of (text.begin (), text.end (),
+					[&wildcards] (const QChar& ch) { return wildcards.contains (ch); });
+		}
+
+		/** Turns the search text into an FTS query for the trigram index,
+		 * matching any messages containing the text.
+		 *
+		 * Texts shorter than a trigram can't be looked up in the index,
+		 * for them an empty query is returned.
+		 */
+		QString MakeTrigramMatchExpression (const QString& text)
+		{
+			if (text.toUcs4 ().size () < 3)
+				return {};
+
+			return '"' + QString { text }.replace ('"', "\"\"") + '"';
+		}
+
+		/** Turns the search text into an FTS query for a word index,
+		 * requiring all the words of the text, the last one possibly
+		 * being incomplete.
+		 *
+		 * Words are only matched by their beginnings, so the text must
+		 * start with a separator, otherwise it may start in the middle
+		 * of a word, and an empty query is returned. Separators outside
+		 * of ASCII may be word characters for the tokenizer, so texts
+		 * with them are refused as well.
+		 */
+		QString MakeWordsMatchExpression (const QString& text, bool isFts5)
+		{
+			if (text.isEmpty () || text.at (0).isLetterOrNumber ())
+				return {};
+
+			QStringList phrases;
+			QString word;
+			for (const auto& ch : text)
+			{
+				if (ch.isLetterOrNumber ())
+				{
+					word += ch;
+					continue;
+				}
+
+				if (ch.unicode () >= 128)
+					return {};
+
+				if (!word.isEmpty ())
+				{
+					phrases << '"' + word + '"';
+					word.clear ();
+				}
+			}
 
-		const qint32 intEntryId = Users_ [entryId];
-		const qint32 intAccId = Accounts_ [accountId];
-		LogsSearcher_.bindValue (":entry_id", intEntryId);
-		LogsSearcher_.bindValue (":account_id", intAccId);
-		LogsSearcher_.bindValue (":inner_entry_id", intEntryId);
-		LogsSearcher_.bindValue (":inner_account_id", intAccId);
-		LogsSearcher_.bindValue (":text", '%' + text + '%');
-		LogsSearcher_.bindValue (":ctext", '*' + text + '*');
-		LogsSearcher_.bindValue (":sensitive", static_cast<int> (cs));
-		LogsSearcher_.bindValue (":insensitive", static_cast<int> (!cs));
-		LogsSearcher_.bindValue (":offset", shift);
-		if (!LogsSearcher_.exec ())
-		{
-			Util::DBLock::DumpError (LogsSearcher_);
-			return {};
-		}
-		auto guard = CleanupQueryGuard (LogsSearcher_);
+			if (!word.isEmpty ())
+				phrases << (isFts5 ?
+						'"' + word + "\"*" :
+						'"' + word + "*\"");
 
-		if (!LogsSearcher_.next ())
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to move to the next entry";
-			Util::DBLock::DumpError (LogsSearcher_);
-			return {};
+			return phrases.join (" ");
 		}
 
-		return { intEntryId, intAccId, LogsSearcher_.value (0).value<qint64> () };
+		const int SearchBatchSize = 32;
 	}
 
-	Storage::RawSearchResult Storage::SearchImpl (const QString& accountId,
-			const QString& text, int shift, bool cs)
+	bool Storage::ResetSearchCursor (const QString& accountId, const QString& entryId,
+			const QString& text, bool cs)
 	{
+		SearchCursor_ = SearchCursor {};
+		SearchCursor_.AccountId_ = accountId;
+		SearchCursor_.EntryId_ = entryId;
+		SearchCursor_.Text_ = text;
+		SearchCursor_.CS_ = cs;
+
+		if (accountId.isEmpty ())
+			return true;
+
 		if (!Accounts_.contains (accountId))
 		{
 			qWarning () << Q_FUNC_INFO
@@ -577,112 +775,140 @@ namespace ChatHistory
 					<< accountId
 					<< "; raw contents"
 					<< Accounts_;
-			return {};
+			return false;
 		}
+		SearchCursor_.AccountID_ = Accounts_ [accountId];
 
-		const qint32 intAccId = Accounts_ [accountId];
-		LogsSearcherWOContact_.bindValue (":account_id", intAccId);
-		LogsSearcherWOContact_.bindValue (":inner_account_id", intAccId);
-		LogsSearcherWOContact_.bindValue (":text", '%' + text + '%');
-		LogsSearcherWOContact_.bindValue (":ctext", '*' + text + '*');
-		LogsSearcherWOContact_.bindValue (":sensitive", static_cast<int> (cs));
-		LogsSearcherWOContact_.bindValue (":insensitive", static_cast<int> (!cs));
-		LogsSearcherWOContact_.bindValue (":offset", shift);
-		if (!LogsSearcherWOContact_.exec ())
-		{
-			Util::DBLock::DumpError (LogsSearcherWOContact_);
-			return RawSearchResult ();
-		}
+		if (entryId.isEmpty ())
+			return true;
 
-		if (!LogsSearcherWOContact_.next ())
+		if (!Users_.contains (entryId))
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "unable to move to the next entry";
-			return RawSearchResult ();
+					<< "Users_ doesn't contain"
+					<< entryId
+					<< "; raw contents"
+					<< Users_;
+			return false;
 		}
+		SearchCursor_.EntryID_ = Users_ [entryId];
 
-		auto guard = CleanupQueryGuard (LogsSearcherWOContact_);
-
-		return
-		{
-			LogsSearcherWOContact_.value (1).toInt (),
-			intAccId,
-			LogsSearcherWOContact_.value (0).value<qint64> ()
-		};
+		return true;
 	}
 
-	Storage::RawSearchResult Storage::SearchImpl (const QString& text, int shift, bool cs)
+	bool Storage::FetchSearchHits (int count)
 	{
-		LogsSearcherWOContactAccount_.bindValue (":text", '%' + text + '%');
-		LogsSearcherWOContactAccount_.bindValue (":ctext", '*' + text + '*');
-		LogsSearcherWOContactAccount_.bindValue (":sensitive", static_cast<int> (cs));
-		LogsSearcherWOContactAccount_.bindValue (":insensitive", static_cast<int> (!cs));
-		LogsSearcherWOContactAccount_.bindValue (":offset", shift);
-		if (!LogsSearcherWOContactAccount_.exec ())
-		{
-			Util::DBLock::DumpError (LogsSearcherWOContactAccount_);
-			return RawSearchResult ();
-		}
+		auto& cursor = SearchCursor_;
+
+		QString conditions;
+		if (cursor.AccountID_)
+			conditions += " AND h.AccountID = :account_id";
+		if (cursor.EntryID_)
+			conditions += " AND h.Id = :entry_id";
+		conditions += cursor.CS_ ?
+				" AND h.Message GLOB :pattern" :
+				" AND h.Message LIKE :pattern";
+
+		auto runQuery = [&] (const QString& queryStr, auto binder) -> boost::optional<int>
+		{
+			QSqlQuery query { *DB_ };
+			query.prepare (queryStr);
+			binder (query);
+			if (cursor.AccountID_)
+				query.bindValue (":account_id", cursor.AccountID_);
+			if (cursor.EntryID_)
+				query.bindValue (":entry_id", cursor.EntryID_);
+			query.bindValue (":pattern", cursor.CS_ ?
+					'*' + cursor.Text_ + '*' :
+					'%' + cursor.Text_ + '%');
+			query.bindValue (":before", cursor.Before_);
+			query.bindValue (":limit", count);
 
-		if (!LogsSearcherWOContactAccount_.next ())
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to move to the next entry";
-			return RawSearchResult ();
-		}
-
-		auto guard = CleanupQueryGuard (LogsSearcherWOContactAccount_);
+			if (!query.exec ())
+			{
+				Util::DBLock::DumpError (query);
+				return {};
+			}
 
-		return
-		{
-			LogsSearcherWOContactAccount_.value (1).toInt (),
-			LogsSearcherWOContactAccount_.value (2).toInt (),
-			LogsSearcherWOContactAccount_.value (0).value<qint64> ()
+			int fetched = 0;
+			while (query.next ())
+			{
+				cursor.Before_ = query.value (0).value<qint64> ();
+				cursor.Hits_.append ({
+						query.value (1).toInt (),
+						query.value (2).toInt (),
+						cursor.Before_
+					});
+				++fetched;
+			}
+			return fetched;
 		};
-	}
 
-	SearchResult_t Storage::SearchRowIdImpl (qint32 accountId, qint32 entryId, qint64 rowId)
-	{
-		RowID2Pos_.bindValue (":rowid", rowId);
-		RowID2Pos_.bindValue (":account_id", accountId);
-		RowID2Pos_.bindValue (":entry_id", entryId);
-		if (!RowID2Pos_.exec ())
-		{
-			Util::DBLock::DumpError (RowID2Pos_);
-			return SearchResult_t::Left ("Unable to execute search query.");
-		}
-
-		if (!RowID2Pos_.next ())
-			return SearchResult_t::Right ({});
-
-		const int index = RowID2Pos_.value (0).toInt ();
-		RowID2Pos_.finish ();
-
-		return SearchResult_t::Right (index);
-	}
-
-	SearchResult_t Storage::SearchDateImpl (qint32 accountId, qint32 entryId, const QDateTime& dt)
-	{
-		Date2Pos_.bindValue (":date", dt);
-		Date2Pos_.bindValue (":account_id", accountId);
-		Date2Pos_.bindValue (":entry_id", entryId);
-		if (!Date2Pos_.exec ())
-		{
-			Util::DBLock::DumpError (Date2Pos_);
-			return SearchResult_t::Left ("Unable to execute search query.");
-		}
-
-		if (!Date2Pos_.next ())
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to navigate to next record";
-			return SearchResult_t::Left ("Unable to navigate to the search results.");
-		}
-
-		const int index = Date2Pos_.value (0).toInt ();
-		Date2Pos_.finish ();
+		// Hits go from the latest stored message to the earliest one, in
+		// the rowid order, which is how the history widget steps through
+		// them. This is the insertion order, not necessarily the one of
+		// the message dates.
+		//
+		// The index narrows down the candidates, while the pattern keeps
+		// the exact matching semantics and case sensitivity. If the index
+		// can't find every message containing the text, the indexed
+		// messages are scanned just like the rest.
+		QString match;
+		if (!HasWildcards (cursor.Text_, cursor.CS_))
+			switch (SearchIndex_)
+			{
+			case SearchIndex::None:
+				break;
+			case SearchIndex::FTS4:
+				match = MakeWordsMatchExpression (cursor.Text_, false);
+				break;
+			case SearchIndex::FTS5:
+				match = MakeWordsMatchExpression (cursor.Text_, true);
+				break;
+			case SearchIndex::FTS5Trigram:
+				match = MakeTrigramMatchExpression (cursor.Text_);
+				break;
+			}
 
-		return SearchResult_t::Right (index);
+		if (!match.isEmpty () &&
+				cursor.Before_ > IndexedFrom_)
+		{
+			const auto indexed = runQuery ("SELECT h.rowid, h.Id, h.AccountID FROM azoth_history_fts "
+						"JOIN azoth_history h ON h.rowid = azoth_history_fts.rowid "
+						"WHERE azoth_history_fts MATCH :match "
+						"AND azoth_history_fts.rowid >= :indexed_from "
+						"AND azoth_history_fts.rowid < :before" + conditions + " "
+						"ORDER BY azoth_history_fts.rowid DESC "
+						"LIMIT :limit;",
+					[&] (QSqlQuery& query)
+					{
+						query.bindValue (":match", match);
+						query.bindValue (":indexed_from", IndexedFrom_);
+					});
+			if (!indexed)
+				return false;
+
+			if (*indexed == count)
+				return true;
+
+			count -= *indexed;
+			cursor.Before_ = IndexedFrom_;
+		}
+
+		// Messages not covered by the index (if any) are scanned by their
+		// rowids, still going from the last hit instead of using an OFFSET.
+		const auto scanned = runQuery ("SELECT h.rowid, h.Id, h.AccountID FROM azoth_history h "
+					"WHERE h.rowid < :before" + conditions + " "
+					"ORDER BY h.rowid DESC "
+					"LIMIT :limit;",
+				[] (QSqlQuery&) {});
+		if (!scanned)
+			return false;
+
+		if (*scanned < count)
+			cursor.Exhausted_ = true;
+
+		return true;
 	}
 
 	boost::optional<int> Storage::GetAllHistoryCount ()
@@ -864,6 +1090,9 @@ namespace ChatHistory
 		}
 
 		lock.Good ();
+
+		// The hits found so far don't include the new messages.
+		SearchCursor_ = SearchCursor {};
 	}
 
 	IHistoryPlugin::MaxTimestampResult_t Storage::GetMaxTimestamp (const QString& accountId)
@@ -946,8 +1175,68 @@ namespace ChatHistory
 		}
 	}
 
+	boost::optional<Storage::RowLogList_t> Storage::FetchLogs (QSqlQuery& query,
+			qint32 accountId, qint32 entryId, qint64 rowId, int limit)
+	{
+		query.bindValue (":entry_id", entryId);
+		query.bindValue (":account_id", accountId);
+		query.bindValue (":rowid", rowId);
+		query.bindValue (":limit", limit);
+
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			return {};
+		}
+
+		RowLogList_t result;
+		while (query.next ())
+			result.push_back ({
+					query.value (0).value<qint64> (),
+					{
+						query.value (1).toDateTime (),
+						GetMsgDirection (query.value (2)),
+						query.value (3).toString (),
+						query.value (4).toString (),
+						GetMsgType (query.value (5)),
+						query.value (6).toString (),
+						GetMsgEscapePolicy (query.value (7))
+					}
+				});
+		return result;
+	}
+
+	boost::optional<bool> Storage::HasLogs (QSqlQuery& query, qint32 accountId, qint32 entryId, qint64 rowId)
+	{
+		query.bindValue (":entry_id", entryId);
+		query.bindValue (":account_id", accountId);
+		query.bindValue (":rowid", rowId);
+
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			return {};
+		}
+
+		auto guard = CleanupQueryGuard (query);
+		if (!query.next ())
+			return {};
+
+		return query.value (0).toBool ();
+	}
+
 	ChatLogsResult_t Storage::GetChatLogs (const QString& accountId,
-			const QString& entryId, int backpages, int amount)
+			const QString& entryId, int amount)
+	{
+		const auto& page = GetChatLogsPage (accountId, entryId, {}, amount);
+		if (const auto err = page.MaybeLeft ())
+			return ChatLogsResult_t::Left (*err);
+
+		return ChatLogsResult_t::Right (page.GetRight ().Items_);
+	}
+
+	ChatLogsPageResult_t Storage::GetChatLogsPage (const QString& accountId,
+			const QString& entryId, const ChatLogsAnchor& anchor, int amount)
 	{
 		if (!Accounts_.contains (accountId))
 		{
@@ -956,7 +1245,7 @@ namespace ChatHistory
 					<< accountId
 					<< "; raw contents"
 					<< Accounts_;
-			return ChatLogsResult_t::Left ("Unknown account.");
+			return ChatLogsPageResult_t::Left ("Unknown account.");
 		}
 		if (!Users_.contains (entryId))
 		{
@@ -965,52 +1254,113 @@ namespace ChatHistory
 					<< entryId
 					<< "; raw contents"
 					<< Users_;
-			return ChatLogsResult_t::Left ("Unknown user.");
+			return ChatLogsPageResult_t::Left ("Unknown user.");
 		}
 
-		HistoryGetter_.bindValue (":entry_id", Users_ [entryId]);
-		HistoryGetter_.bindValue (":account_id", Accounts_ [accountId]);
-		HistoryGetter_.bindValue (":limit", amount);
-		HistoryGetter_.bindValue (":offset", amount * backpages);
+		const auto accId = Accounts_ [accountId];
+		const auto userId = Users_ [entryId];
 
-		if (!HistoryGetter_.exec ())
+		auto older = [&] (qint64 before, int limit)
 		{
-			Util::DBLock::DumpError (HistoryGetter_);
-			return ChatLogsResult_t::Left ("Unable to execute the SQL query.");
-		}
-
-		LogList_t result;
-		while (HistoryGetter_.next ())
-			result.push_back ({
-					HistoryGetter_.value (0).toDateTime (),
-					GetMsgDirection (HistoryGetter_.value (1)),
-					HistoryGetter_.value (2).toString (),
-					HistoryGetter_.value (3).toString (),
-					GetMsgType (HistoryGetter_.value (4)),
-					HistoryGetter_.value (5).toString (),
-					GetMsgEscapePolicy (HistoryGetter_.value (6))
-				});
-
-		std::reverse (result.begin (), result.end ());
+			return FetchLogs (OlderHistoryGetter_, accId, userId, before, limit);
+		};
+		auto newer = [&] (qint64 after, int limit)
+		{
+			return FetchLogs (NewerHistoryGetter_, accId, userId, after, limit);
+		};
 
-		return ChatLogsResult_t::Right (result);
+		const auto minRowId = std::numeric_limits<qint64>::min ();
+		const auto maxRowId = std::numeric_limits<qint64>::max ();
+
+		// Both parts are ordered from the anchor outwards.
+		boost::optional<RowLogList_t> olderPart { RowLogList_t {} };
+		boost::optional<RowLogList_t> newerPart { RowLogList_t {} };
+		int anchorIndex = -1;
+
+		switch (anchor.Kind_)
+		{
+		case ChatLogsAnchor::Kind::Newest:
+			olderPart = older (maxRowId, amount);
+			break;
+		case ChatLogsAnchor::Kind::Oldest:
+			newerPart = newer (minRowId, amount);
+			break;
+		case ChatLogsAnchor::Kind::Before:
+			olderPart = older (anchor.RowId_, amount);
+			if (olderPart && olderPart->size () < amount)
+				return GetChatLogsPage (accountId, entryId, { ChatLogsAnchor::Kind::Oldest, 0 }, amount);
+			break;
+		case ChatLogsAnchor::Kind::After:
+			newerPart = newer (anchor.RowId_, amount);
+			if (newerPart && newerPart->size () < amount)
+				return GetChatLogsPage (accountId, entryId, { ChatLogsAnchor::Kind::Newest, 0 }, amount);
+			break;
+		case ChatLogsAnchor::Kind::Around:
+			newerPart = newer (anchor.RowId_, amount / 2);
+			if (!newerPart)
+				break;
+			olderPart = older (anchor.RowId_ + 1, amount - newerPart->size ());
+			if (olderPart && !olderPart->isEmpty () && olderPart->first ().first == anchor.RowId_)
+				anchorIndex = olderPart->size () - 1;
+			break;
+		}
+
+		if (!olderPart || !newerPart)
+			return ChatLogsPageResult_t::Left ("Unable to execute the SQL query.");
+
+		std::reverse (olderPart->begin (), olderPart->end ());
+
+		ChatLogsPage page;
+		page.AnchorIndex_ = anchorIndex;
+		for (const auto& part : { *olderPart, *newerPart })
+			for (const auto& pair : part)
+				page.Items_ << pair.second;
+
+		if (page.Items_.isEmpty ())
+			return ChatLogsPageResult_t::Right (page);
+
+		page.OldestRowId_ = olderPart->isEmpty () ?
+				newerPart->first ().first :
+				olderPart->first ().first;
+		page.NewestRowId_ = newerPart->isEmpty () ?
+				olderPart->last ().first :
+				newerPart->last ().first;
+
+		const auto hasOlder = HasLogs (OlderHistoryChecker_, accId, userId, page.OldestRowId_);
+		const auto hasNewer = HasLogs (NewerHistoryChecker_, accId, userId, page.NewestRowId_);
+		if (!hasOlder || !hasNewer)
+			return ChatLogsPageResult_t::Left ("Unable to execute the SQL query.");
+
+		page.HasOlder_ = *hasOlder;
+		page.HasNewer_ = *hasNewer;
+
+		return ChatLogsPageResult_t::Right (page);
 	}
 
 	SearchResult_t Storage::Search (const QString& accountId,
 			const QString& entryId, const QString& text, int shift, bool cs)
 	{
-		RawSearchResult res;
-		if (!accountId.isEmpty () && !entryId.isEmpty ())
-			res = SearchImpl (accountId, entryId, text, shift, cs);
-		else if (!accountId.isEmpty ())
-			res = SearchImpl (accountId, text, shift, cs);
-		else
-			res = SearchImpl (text, shift, cs);
+		if (SearchCursor_.AccountId_ != accountId ||
+				SearchCursor_.EntryId_ != entryId ||
+				SearchCursor_.Text_ != text ||
+				SearchCursor_.CS_ != cs)
+			if (!ResetSearchCursor (accountId, entryId, text, cs))
+			{
+				SearchCursor_ = SearchCursor {};
+				return SearchResult_t::Right ({});
+			}
 
-		if (res.IsEmpty ())
+		while (SearchCursor_.Hits_.size () <= shift && !SearchCursor_.Exhausted_)
+			if (!FetchSearchHits (std::max (shift + 1 - SearchCursor_.Hits_.size (), SearchBatchSize)))
+			{
+				SearchCursor_ = SearchCursor {};
+				return SearchResult_t::Left ("Unable to execute search query.");
+			}
+
+		if (shift < 0 || shift >= SearchCursor_.Hits_.size ())
 			return SearchResult_t::Right ({});
 
-		return SearchRowIdImpl (res.AccountID_, res.EntryID_, res.RowID_);
+		return SearchResult_t::Right (SearchCursor_.Hits_.at (shift).RowID_);
 	}
 
 	SearchResult_t Storage::SearchDate (const QString& account, const QString& entry, const QDateTime& dt)
@@ -1034,9 +1384,20 @@ namespace ChatHistory
 			return SearchResult_t::Left ("Unknown user.");
 		}
 
-		const qint32 entryId = Users_ [entry];
-		const qint32 accId = Accounts_ [account];
-		return SearchDateImpl (accId, entryId, dt);
+		Date2RowId_.bindValue (":date", dt);
+		Date2RowId_.bindValue (":account_id", Accounts_ [account]);
+		Date2RowId_.bindValue (":entry_id", Users_ [entry]);
+		if (!Date2RowId_.exec ())
+		{
+			Util::DBLock::DumpError (Date2RowId_);
+			return SearchResult_t::Left ("Unable to execute search query.");
+		}
+
+		auto guard = CleanupQueryGuard (Date2RowId_);
+		if (!Date2RowId_.next ())
+			return SearchResult_t::Right ({});
+
+		return SearchResult_t::Right (Date2RowId_.value (0).value<qint64> ());
 	}
 
 	DaysResult_t Storage::GetDaysForSheet (const QString& account, const QString& entry, int year, int month)
@@ -1103,6 +1464,8 @@ namespace ChatHistory
 		Util::DBLock lock (*DB_);
 		lock.Init ();
 
+		SearchCursor_ = SearchCursor {};
+
 		const auto userId = Users_.take (entryId);
 		HistoryClearer_.bindValue (":entry_id", userId);
 		HistoryClearer_.bindValue (":account_id", Accounts_ [accountId]);
@@ -1120,6 +1483,113 @@ namespace ChatHistory
 
 		lock.Good ();
 	}
+
+	void Storage::ResetSearchIndex ()
+	{
+		Util::DBLock lock { *DB_ };
+		try
+		{
+			lock.Init ();
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to start transaction:"
+					<< e.what ();
+			return;
+		}
+
+		SearchIndex_ = SearchIndex::None;
+		SearchCursor_ = SearchCursor {};
+
+		QSqlQuery query { *DB_ };
+		for (const auto& str : {
+					"DROP TRIGGER IF EXISTS azoth_history_fts_insert;",
+					"DROP TRIGGER IF EXISTS azoth_history_fts_delete;",
+					"DROP TABLE IF EXISTS azoth_history_fts_state;"
+				})
+			if (!query.exec (str))
+			{
+				Util::DBLock::DumpError (query);
+				return;
+			}
+
+		try
+		{
+			InitializeSearchIndex ();
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			SearchIndex_ = SearchIndex::None;
+			return;
+		}
+
+		lock.Good ();
+	}
+
+	bool Storage::BackfillSearchIndex ()
+	{
+		if (SearchIndex_ == SearchIndex::None)
+			return false;
+
+		QSqlQuery query { *DB_ };
+		if (!query.exec ("SELECT MIN(rowid) FROM azoth_history;") ||
+				!query.next ())
+		{
+			Util::DBLock::DumpError (query);
+			return false;
+		}
+
+		const auto& minRowIdVar = query.value (0);
+		query.finish ();
+		if (minRowIdVar.isNull ())
+			return false;
+
+		const auto minRowId = minRowIdVar.value<qint64> ();
+		if (IndexedFrom_ <= minRowId)
+			return false;
+
+		const auto from = std::max (IndexedFrom_ - SearchIndexBackfillBatch, minRowId);
+
+		Util::DBLock lock { *DB_ };
+		try
+		{
+			lock.Init ();
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to start transaction:"
+					<< e.what ();
+			return false;
+		}
+
+		query.prepare ("INSERT INTO azoth_history_fts (rowid, Message) "
+				"SELECT rowid, Message FROM azoth_history "
+				"WHERE rowid >= :from AND rowid < :to;");
+		query.bindValue (":from", from);
+		query.bindValue (":to", IndexedFrom_);
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			return false;
+		}
+
+		query.prepare ("UPDATE azoth_history_fts_state SET IndexedFrom = :from;");
+		query.bindValue (":from", from);
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			return false;
+		}
+
+		lock.Good ();
+
+		IndexedFrom_ = from;
+		return IndexedFrom_ > minRowId;
+	}
 }
 }
 }
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <memory>
+#include <limits>
 #include <QSqlQuery>
 #include <QHash>
 #include <QVariant>
@@ -63,13 +64,12 @@ namespace ChatHistory
 		QSqlQuery MessageDumper_;
 		QSqlQuery MessageDumperFuzzy_;
 		QSqlQuery UsersForAccountGetter_;
-		QSqlQuery RowID2Pos_;
-		QSqlQuery Date2Pos_;
+		QSqlQuery Date2RowId_;
 		QSqlQuery GetMonthDates_;
-		QSqlQuery LogsSearcher_;
-		QSqlQuery LogsSearcherWOContact_;
-		QSqlQuery LogsSearcherWOContactAccount_;
-		QSqlQuery HistoryGetter_;
+		QSqlQuery OlderHistoryGetter_;
+		QSqlQuery NewerHistoryGetter_;
+		QSqlQuery OlderHistoryChecker_;
+		QSqlQuery NewerHistoryChecker_;
 		QSqlQuery HistoryClearer_;
 		QSqlQuery UserClearer_;
 		QSqlQuery EntryCacheSetter_;
@@ -89,9 +89,40 @@ namespace ChatHistory
 
 			RawSearchResult () = default;
 			RawSearchResult (qint32 entryId, qint32 accountId, qint64 rowId);
+		};
 
-			bool IsEmpty () const;
+		enum class SearchIndex
+		{
+			None,
+			FTS4,
+			FTS5,
+			FTS5Trigram
 		};
+		SearchIndex SearchIndex_ = SearchIndex::None;
+
+		/** Rows with rowid not less than this one are covered by the
+		 * full-text index, the ones below still wait for the backfill.
+		 */
+		qint64 IndexedFrom_ = 0;
+
+		/** Keeps the hits found so far for the last search, so that going
+		 * to the next or previous hit doesn't rescan the history.
+		 */
+		struct SearchCursor
+		{
+			QString AccountId_;
+			QString EntryId_;
+			QString Text_;
+			bool CS_ = false;
+
+			qint32 AccountID_ = 0;
+			qint32 EntryID_ = 0;
+
+			QList<RawSearchResult> Hits_;
+			qint64 Before_ = std::numeric_limits<qint64>::max ();
+			bool Exhausted_ = false;
+		};
+		SearchCursor SearchCursor_;
 	public:
 		Storage (QObject* = nullptr);
 
@@ -114,7 +145,9 @@ namespace ChatHistory
 		QStringList GetOurAccounts () const;
 		UsersForAccountResult_t GetUsersForAccount (const QString&);
 		ChatLogsResult_t GetChatLogs (const QString& accountId,
-				const QString& entryId, int backpages, int amount);
+				const QString& entryId, int amount);
+		ChatLogsPageResult_t GetChatLogsPage (const QString& accountId,
+				const QString& entryId, const ChatLogsAnchor& anchor, int amount);
 
 		void AddMessages (const QString& accountId, const QString& entryId,
 				const QString& visibleName, const QList<LogItem>&, bool fuzzy);
@@ -130,9 +163,25 @@ namespace ChatHistory
 
 		void RegenUsersCache ();
 		void ClearHistory (const QString& accountId, const QString& entryId);
+
+		/** Indexes the next batch of the messages that were stored before
+		 * the full-text index has been created.
+		 *
+		 * @return Whether there are still messages left to index.
+		 */
+		bool BackfillSearchIndex ();
+
+		/** Drops the full-text index and starts it anew, leaving the
+		 * existing messages to BackfillSearchIndex().
+		 *
+		 * The index refers to the rows by their rowids, which aren't
+		 * preserved when the database is dumped and restored.
+		 */
+		void ResetSearchIndex ();
 	private:
 		void InitializeTables ();
 		void UpdateTables ();
+		void InitializeSearchIndex ();
 
 		QHash<QString, qint32> GetUsers ();
 		qint32 GetUserID (const QString&);
@@ -143,13 +192,14 @@ namespace ChatHistory
 		QHash<QString, qint32> GetAccounts ();
 		qint32 GetAccountID (const QString&);
 		void AddAccount (const QString& id);
-		RawSearchResult SearchImpl (const QString& accountId, const QString& entryId,
-				const QString& text, int shift, bool cs);
-		RawSearchResult SearchImpl (const QString& accountId, const QString& text, int shift, bool cs);
-		RawSearchResult SearchImpl (const QString& text, int shift, bool cs);
 
-		SearchResult_t SearchRowIdImpl (qint32, qint32, qint64);
-		SearchResult_t SearchDateImpl (qint32, qint32, const QDateTime&);
+		bool ResetSearchCursor (const QString& accountId, const QString& entryId,
+				const QString& text, bool cs);
+		bool FetchSearchHits (int count);
+
+		using RowLogList_t = QList<QPair<qint64, LogItem>>;
+		boost::optional<RowLogList_t> FetchLogs (QSqlQuery&, qint32, qint32, qint64, int);
+		boost::optional<bool> HasLogs (QSqlQuery&, qint32, qint32, qint64);
 	};
 }
 }
@@ -30,6 +30,7 @@
 #include "storagemanager.h"
 #include <cmath>
 #include <QMessageBox>
+#include <QTimer>
 #include <util/util.h>
 #include <util/threads/futures.h>
 #include <util/threads/workerthreadbase.h>
@@ -55,12 +56,18 @@ namespace ChatHistory
 		StorageThread_->SetPaused (true);
 		StorageThread_->SetAutoQuit (true);
 
+		// The storage is destroyed by the time the thread finishes.
+		connect (StorageThread_.get (),
+				&QThread::finished,
+				[] { Util::ConsistencyChecker::MarkCleanShutdown (Storage::GetDatabasePath ()); });
+
 		Util::Sequence (this, StorageThread_->ScheduleImpl (&Storage::Initialize)) >>
 				[this] (const Storage::InitializationResult_t& res)
 				{
 					if (res.IsRight ())
 					{
 						StorageThread_->SetPaused (false);
+						ScheduleSearchIndexBackfill ();
 						return;
 					}
 
@@ -186,9 +193,15 @@ namespace ChatHistory
 	}
 
 	QFuture<ChatLogsResult_t> StorageManager::GetChatLogs (const QString& accountId,
-			const QString& entryId, int backpages, int amount)
+			const QString& entryId, int amount)
 	{
-		return StorageThread_->ScheduleImpl (&Storage::GetChatLogs, accountId, entryId, backpages, amount);
+		return StorageThread_->ScheduleImpl (&Storage::GetChatLogs, accountId, entryId, amount);
+	}
+
+	QFuture<ChatLogsPageResult_t> StorageManager::GetChatLogsPage (const QString& accountId,
+			const QString& entryId, const ChatLogsAnchor& anchor, int amount)
+	{
+		return StorageThread_->ScheduleImpl (&Storage::GetChatLogsPage, accountId, entryId, anchor, amount);
 	}
 
 	QFuture<SearchResult_t> StorageManager::Search (const QString& accountId, const QString& entryId,
@@ -223,6 +236,16 @@ namespace ChatHistory
 		StorageThread_->start (QThread::LowestPriority);
 	}
 
+	void StorageManager::ScheduleSearchIndexBackfill ()
+	{
+		Util::Sequence (this, StorageThread_->ScheduleImpl (&Storage::BackfillSearchIndex)) >>
+				[this] (bool hasMore)
+				{
+					if (hasMore)
+						QTimer::singleShot (1000, this, [this] { ScheduleSearchIndexBackfill (); });
+				};
+	}
+
 	void StorageManager::HandleStorageError (const Storage::InitializationError_t& error)
 	{
 		Util::Visit (error,
@@ -237,6 +260,9 @@ namespace ChatHistory
 
 	void StorageManager::HandleDumpFinished (qint64 oldSize, qint64 newSize)
 	{
+		// The restored rows got new rowids, so the old index is useless.
+		StorageThread_->ScheduleImpl (&Storage::ResetSearchIndex);
+
 		StartStorage ();
 
 		Util::Sequence (this, StorageThread_->ScheduleImpl (&Storage::GetAllHistoryCount)) >>
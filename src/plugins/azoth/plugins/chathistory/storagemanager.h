@@ -59,8 +59,9 @@ namespace ChatHistory
 
 		QFuture<UsersForAccountResult_t> GetUsersForAccount (const QString&);
 
-		QFuture<ChatLogsResult_t> GetChatLogs (const QString& accountId, const QString& entryId,
-				int backpages, int amount);
+		QFuture<ChatLogsResult_t> GetChatLogs (const QString& accountId, const QString& entryId, int amount);
+		QFuture<ChatLogsPageResult_t> GetChatLogsPage (const QString& accountId, const QString& entryId,
+				const ChatLogsAnchor& anchor, int amount);
 
 		QFuture<SearchResult_t> Search (const QString& accountId, const QString& entryId,
 				const QString& text, int shift, bool cs);
@@ -72,6 +73,7 @@ namespace ChatHistory
 		void RegenUsersCache ();
 	private:
 		void StartStorage ();
+		void ScheduleSearchIndexBackfill ();
 		void HandleStorageError (const Storage::InitializationError_t&);
 		void HandleDumpFinished (qint64, qint64);
 	};
@@ -54,7 +54,43 @@ namespace ChatHistory
 
 	using ChatLogsResult_t = Util::Either<QString, LogList_t>;
 
-	using SearchResult_t = Util::Either<QString, boost::optional<int>>;
+	/** Identifies a page of the history with some entry by the rowid of
+	 * a message it starts, ends or is centered at.
+	 */
+	struct ChatLogsAnchor
+	{
+		enum class Kind
+		{
+			Newest,
+			Oldest,
+			Before,
+			After,
+			Around
+		} Kind_ = Kind::Newest;
+
+		qint64 RowId_ = 0;
+	};
+
+	struct ChatLogsPage
+	{
+		LogList_t Items_;
+
+		qint64 OldestRowId_ = -1;
+		qint64 NewestRowId_ = -1;
+
+		/** Index of the item the page has been requested around, or -1.
+		 */
+		int AnchorIndex_ = -1;
+
+		bool HasOlder_ = false;
+		bool HasNewer_ = false;
+	};
+
+	using ChatLogsPageResult_t = Util::Either<QString, ChatLogsPage>;
+
+	/** The rowid of the found message, if any.
+	 */
+	using SearchResult_t = Util::Either<QString, boost::optional<qint64>>;
 
 	using DaysResult_t = Util::Either<QString, QList<int>>;
 }
@@ -28,6 +28,7 @@
  **********************************************************************/
 
 #include "core.h"
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <typeinfo>
@@ -57,6 +58,10 @@
 #include <QDataStream>
 #include <QDesktopServices>
 #include <QUrlQuery>
+#include <QSaveFile>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
+#include <QFutureWatcher>
 #include <libtorrent/bencode.hpp>
 #include <libtorrent/entry.hpp>
 #include <libtorrent/create_torrent.hpp>
@@ -115,7 +120,6 @@ namespace BitTorrent
 	Core::Core ()
 	: StatusKeeper_ { new CachedStatusKeeper { this } }
 	, NotifyManager_ { new NotifyManager { this } }
-	, FinishedTimer_ { new QTimer }
 	, WarningWatchdog_ { new QTimer }
 	, GeoIP_ { std::make_shared<GeoIP> () }
 	{
@@ -158,6 +162,18 @@ namespace BitTorrent
 #endif
 		}
 
+		const int AlertsPollInterval = 2000;
+
+		/** The interval of alerts polling while the torrents are being
+		 * restored, so that the rows appear without noticeable delay.
+		 */
+		const int RestoreAlertsPollInterval = 100;
+
+		/** The delay between requesting the statuses of the changed
+		 * torrents and fetching the resulting state_update_alert.
+		 */
+		const int StatusUpdateDelay = 100;
+
 		bool DecodeEntry (const QByteArray& data, libtorrent::bdecode_node& e)
 		{
 			boost::system::error_code ec;
@@ -215,17 +231,13 @@ namespace BitTorrent
 			tr ("Ratio")
 		};
 
-		connect (FinishedTimer_.get (),
-				SIGNAL (timeout ()),
-				this,
-				SLOT (checkFinished ()));
-		FinishedTimer_->start (10000);
+		WriterPool_.setMaxThreadCount (1);
 
 		connect (WarningWatchdog_.get (),
 				SIGNAL (timeout ()),
 				this,
 				SLOT (queryLibtorrent ()));
-		WarningWatchdog_->start (2000);
+		WarningWatchdog_->start (AlertsPollInterval);
 
 		connect (SessionSettingsMgr_,
 				SIGNAL (scrapeRequested ()),
@@ -243,8 +255,13 @@ namespace BitTorrent
 	{
 		Session_->pause ();
 		writeSettings ();
+		SaveSessionState ();
+
+		Session_->wait_for_alert (libtorrent::time_duration (5));
+		queryLibtorrent ();
+
+		WriterPool_.waitForDone ();
 
-		FinishedTimer_.reset ();
 		WarningWatchdog_.reset ();
 
 		qDeleteAll (children ());
@@ -920,6 +937,24 @@ namespace BitTorrent
 			else
 				return libtorrent::storage_mode_sparse;
 		}
+
+		/** Returns the largest of the files selected for download, or
+		 * -1 if none is selected.
+		 */
+		int GetLiveFileIndex (const libtorrent::torrent_info& ti, const std::vector<int>& priorities)
+		{
+			const auto& files = ti.files ();
+
+			int result = -1;
+			boost::int64_t maxSize = -1;
+			for (int i = 0; i < files.num_files (); ++i)
+				if (priorities [i] && files.file_size (i) > maxSize)
+				{
+					maxSize = files.file_size (i);
+					result = i;
+				}
+			return result;
+		}
 	};
 
 	int Core::AddMagnet (const QString& magnet,
@@ -960,6 +995,7 @@ namespace BitTorrent
 
 		beginInsertRows ({}, Handles_.size (), Handles_.size ());
 		Handles_ << tmp;
+		HandleIndex_.Append (handle.info_hash ());
 		endInsertRows ();
 
 		return tmp.ID_;
@@ -1039,15 +1075,18 @@ namespace BitTorrent
 				newId,
 				params
 			});
+		HandleIndex_.Append (handle.info_hash ());
 		endInsertRows ();
 
 		if (tryLive)
 		{
-			LiveStreamManager_->EnableOn (handle);
+			const auto liveFile = GetLiveFileIndex (*atp.ti, priorities);
+			if (liveFile != -1)
+				LiveStreamManager_->EnableOn (handle, liveFile);
 			handle.resume ();
 		}
 
-		ScheduleSave ();
+		MarkIndexDirty ();
 		return newId;
 	}
 
@@ -1074,10 +1113,11 @@ namespace BitTorrent
 		Session_->remove_torrent (Handles_.at (pos).Handle_, roptions);
 		int id = Handles_.at (pos).ID_;
 		Handles_.removeAt (pos);
+		HandleIndex_.Remove (pos);
 		Proxy_->FreeID (id);
 		endRemoveRows ();
 
-		ScheduleSave ();
+		MarkIndexDirty ();
 		emit taskRemoved (id);
 	}
 
@@ -1088,7 +1128,6 @@ namespace BitTorrent
 
 		Handles_.at (pos).Handle_.pause ();
 		Handles_.at (pos).Handle_.auto_managed (false);
-		checkFinished ();
 	}
 
 	void Core::ResumeTorrent (int pos)
@@ -1099,7 +1138,6 @@ namespace BitTorrent
 		Handles_.at (pos).Handle_.resume ();
 		Handles_ [pos].State_ = TSIdle;
 		Handles_.at (pos).Handle_.auto_managed (Handles_.at (pos).AutoManaged_);
-		checkFinished ();
 	}
 
 	void Core::ForceReannounce (int pos)
@@ -1220,6 +1258,7 @@ namespace BitTorrent
 		{
 			Handles_ [idx].FilePriorities_.at (file) = priority;
 			Handles_.at (idx).Handle_.prioritize_files (Handles_.at (idx).FilePriorities_);
+			MarkIndexDirty ();
 		}
 		catch (...)
 		{
@@ -1311,6 +1350,7 @@ namespace BitTorrent
 
 		Handles_.at (idx).Handle_.auto_managed (man);
 		Handles_ [idx].AutoManaged_ = man;
+		MarkIndexDirty ();
 	}
 
 	bool Core::IsTorrentSequentialDownload (int idx) const
@@ -1371,12 +1411,14 @@ namespace BitTorrent
 					0);
 		Session_->set_ip_filter (filter);
 
+		FilterDirty_ = true;
 		ScheduleSave ();
 	}
 
 	void Core::ClearFilter ()
 	{
 		Session_->set_ip_filter (libtorrent::ip_filter ());
+		FilterDirty_ = true;
 		ScheduleSave ();
 	}
 
@@ -1405,7 +1447,7 @@ namespace BitTorrent
 		return result;
 	}
 
-	void Core::SaveResumeData (const libtorrent::save_resume_data_alert& a) const
+	void Core::SaveResumeData (const libtorrent::save_resume_data_alert& a)
 	{
 		const auto torrent = FindHandle (a.handle);
 		if (torrent == Handles_.end ())
@@ -1427,21 +1469,10 @@ namespace BitTorrent
 
 		const auto& filePath = Util::CreateIfNotExists ("bittorrent")
 				.filePath (torrent->TorrentFileName_ + ".resume");
-		QFile file { filePath };
 
-		if (!file.open (QIODevice::WriteOnly))
-		{
-			qWarning () << QString ("Could not open file %1 for write: %2")
-				.arg (file.fileName ())
-				.arg (file.errorString ());
-			return;
-		}
-
-		std::deque<char> outbuf;
-		libtorrent::bencode (std::back_inserter (outbuf), *a.resume_data.get ());
-
-		for (size_t i = 0; i < outbuf.size (); ++i)
-			file.write (&outbuf.at (i), 1);
+		QByteArray resumeData;
+		libtorrent::bencode (std::back_inserter (resumeData), *a.resume_data.get ());
+		ScheduleFileWrite (filePath, resumeData);
 	}
 
 	void Core::HandleMetadata (const libtorrent::metadata_received_alert& a)
@@ -1472,13 +1503,15 @@ namespace BitTorrent
 				info.metadata ().get () + info.metadata_size ());
 		libtorrent::entry e;
 		e ["info"] = infoE;
+		torrent->TorrentFileContents_.clear ();
 		libtorrent::bencode (std::back_inserter (torrent->TorrentFileContents_), e);
+		torrent->TorrentFileStored_ = false;
 
 		qDebug () << "HandleMetadata"
 			<< std::distance (Handles_.begin (), torrent)
 			<< torrent->TorrentFileName_;
 
-		ScheduleSave ();
+		MarkIndexDirty ();
 	}
 
 	void Core::PieceRead (const libtorrent::read_piece_alert& a)
@@ -1486,8 +1519,16 @@ namespace BitTorrent
 		LiveStreamManager_->PieceRead (a);
 	}
 
+	void Core::PieceFinished (const libtorrent::piece_finished_alert& a)
+	{
+		LiveStreamManager_->PieceFinished (a);
+	}
+
 	void Core::UpdateStatus (const std::vector<libtorrent::torrent_status>& statuses)
 	{
+		// The statuses may refer to torrents restored during this alerts pop.
+		FlushRestoredBatch ();
+
 		for (const auto& status : statuses)
 		{
 			StatusKeeper_->HandleStatusUpdatePosted (status);
@@ -1500,10 +1541,65 @@ namespace BitTorrent
 			}
 
 			const auto row = std::distance (Handles_.begin (), pos);
+			UpdateTorrentState (row, status);
 			emit dataChanged (index (row, 0), index (row, columnCount () - 1));
 		}
 	}
 
+	void Core::UpdateTorrentState (int row, const libtorrent::torrent_status& status)
+	{
+		auto& torrent = Handles_ [row];
+		if (torrent.State_ == TSSeeding)
+			return;
+
+		if (status.paused)
+		{
+			torrent.State_ = TSIdle;
+			return;
+		}
+
+		switch (status.state)
+		{
+		case libtorrent::torrent_status::queued_for_checking:
+		case libtorrent::torrent_status::checking_files:
+		case libtorrent::torrent_status::checking_resume_data:
+		case libtorrent::torrent_status::allocating:
+		case libtorrent::torrent_status::downloading_metadata:
+			torrent.State_ = TSPreparing;
+			break;
+		case libtorrent::torrent_status::downloading:
+			torrent.State_ = TSDownloading;
+			break;
+		case libtorrent::torrent_status::finished:
+		case libtorrent::torrent_status::seeding:
+			const auto oldState = torrent.State_;
+			torrent.State_ = TSSeeding;
+			if (oldState == TSDownloading)
+			{
+				HandleSingleFinished (row);
+				ScheduleSave ();
+			}
+			break;
+		}
+	}
+
+	void Core::RequestStatusUpdate ()
+	{
+		if (StatusUpdateRequested_)
+			return;
+
+		StatusUpdateRequested_ = true;
+		Session_->post_torrent_updates ();
+
+		QTimer::singleShot (StatusUpdateDelay,
+				this,
+				[this]
+				{
+					StatusUpdateRequested_ = false;
+					queryLibtorrent ();
+				});
+	}
+
 	void Core::HandleTorrentChecked (const libtorrent::torrent_handle& h)
 	{
 		const auto pos = FindHandle (h);
@@ -1537,12 +1633,10 @@ namespace BitTorrent
 				end = selections.end (); i != end; ++i)
 		{
 			Handles_.at (*i).Handle_.queue_position_up ();
-			std::swap (Handles_ [*i],
-					Handles_ [*i - 1]);
-
-			emit dataChanged (index (*i - 1, 0),
-					index (*i, columnCount () - 1));
+			MoveRow (*i, *i - 1);
 		}
+
+		MarkIndexDirty ();
 	}
 
 	void Core::MoveDown (const std::vector<int>& selections)
@@ -1559,12 +1653,10 @@ namespace BitTorrent
 				end = selections.rend (); i != end; ++i)
 		{
 			Handles_.at (*i).Handle_.queue_position_down ();
-			std::swap (Handles_ [*i],
-					Handles_ [*i + 1]);
-
-			emit dataChanged (index (*i, 0),
-					index (*i + 1, columnCount () - 1));
+			MoveRow (*i, *i + 1);
 		}
+
+		MarkIndexDirty ();
 	}
 
 	void Core::MoveToTop (const std::vector<int>& selections)
@@ -1577,9 +1669,15 @@ namespace BitTorrent
 			if (*i <= 0 || !CheckValidity (*i))
 				return;
 
-		for (auto i = selections.rbegin (),
-				end = selections.rend (); i != end; ++i)
-			MoveToTop (*i);
+		auto rows = selections;
+		std::sort (rows.begin (), rows.end ());
+
+		// Each moved row shifts the rows above it down by one.
+		int moved = 0;
+		for (auto i = rows.rbegin (), end = rows.rend (); i != end; ++i)
+			MoveToTop (*i + moved++);
+
+		MarkIndexDirty ();
 	}
 
 	void Core::MoveToBottom (const std::vector<int>& selections)
@@ -1592,9 +1690,15 @@ namespace BitTorrent
 			if (*i < 0 || !CheckValidity (*i))
 				return;
 
-		for (auto i = selections.begin (),
-				end = selections.end (); i != end; ++i)
-			MoveToBottom (*i);
+		auto rows = selections;
+		std::sort (rows.begin (), rows.end ());
+
+		// Each moved row shifts the rows below it up by one.
+		int moved = 0;
+		for (auto i = rows.begin (), end = rows.end (); i != end; ++i)
+			MoveToBottom (*i - moved++);
+
+		MarkIndexDirty ();
 	}
 
 	QList<FileInfo> Core::GetTorrentFiles (int idx) const
@@ -1639,127 +1743,141 @@ namespace BitTorrent
 
 	auto Core::FindHandle (const libtorrent::torrent_handle& h) -> HandleDict_t::iterator
 	{
-		return std::find_if (Handles_.begin (), Handles_.end (),
-				[&h] (const TorrentStruct& ts) { return ts.Handle_ == h; });
+		const auto row = HandleIndex_.Find (h.info_hash ());
+		return row == -1 ? Handles_.end () : Handles_.begin () + row;
 	}
 
 	auto Core::FindHandle (const libtorrent::torrent_handle& h) const -> HandleDict_t::const_iterator
 	{
-		return std::find_if (Handles_.begin (), Handles_.end (),
-				[&h] (const TorrentStruct& ts) { return ts.Handle_ == h; });
+		const auto row = HandleIndex_.Find (h.info_hash ());
+		return row == -1 ? Handles_.end () : Handles_.begin () + row;
 	}
 
-	void Core::MoveToTop (int row)
+	void Core::MoveRow (int from, int to)
 	{
-		Handles_.at (row).Handle_.queue_position_top ();
+		if (from == to)
+			return;
 
-		beginRemoveRows (QModelIndex (), row, row);
-		TorrentStruct tmp = Handles_.takeAt (row);
-		endRemoveRows ();
+		beginMoveRows ({}, from, from, {}, to > from ? to + 1 : to);
+		Handles_.move (from, to);
+		HandleIndex_.Move (from, to);
+		endMoveRows ();
+	}
 
-		beginInsertRows (QModelIndex (), 0, 0);
-		Handles_.push_front (tmp);
-		endInsertRows ();
+	void Core::MoveToTop (int row)
+	{
+		Handles_.at (row).Handle_.queue_position_top ();
+		MoveRow (row, 0);
 	}
 
 	void Core::MoveToBottom (int row)
 	{
 		Handles_.at (row).Handle_.queue_position_bottom ();
+		MoveRow (row, Handles_.size () - 1);
+	}
 
-		beginRemoveRows (QModelIndex (), row, row);
-		TorrentStruct tmp = Handles_.takeAt (row);
-		endRemoveRows ();
+	namespace
+	{
+		QByteArray GetInfoHashKey (const libtorrent::sha1_hash& hash)
+		{
+			return QByteArray::fromStdString (hash.to_string ());
+		}
+	}
 
-		beginInsertRows (QModelIndex (), Handles_.size (), Handles_.size ());
-		Handles_.push_back (tmp);
-		endInsertRows ();
+	auto Core::DecodeRestoredTorrent (RestoredTorrent torrent) -> RestoredTorrent
+	{
+		QFile file (torrent.TorrentPath_);
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			torrent.Error_ = tr ("Could not open saved torrent %1 for read.")
+					.arg (torrent.Filename_);
+			return torrent;
+		}
+
+		torrent.TorrentData_ = file.readAll ();
+		if (torrent.TorrentData_.isEmpty ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "empty torrent data for"
+					<< torrent.Filename_;
+			return torrent;
+		}
+
+		libtorrent::bdecode_node e;
+		if (!DecodeEntry (torrent.TorrentData_, e))
+		{
+			torrent.TorrentData_.clear ();
+			return torrent;
+		}
+
+		try
+		{
+			torrent.Params_.ti = boost::make_shared<libtorrent::torrent_info> (e);
+		}
+		catch (const std::exception& ex)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "cannot parse"
+					<< torrent.Filename_
+					<< ex.what ();
+			torrent.TorrentData_.clear ();
+			return torrent;
+		}
+
+		QFile resumeDataFile (torrent.ResumePath_);
+		if (resumeDataFile.open (QIODevice::ReadOnly))
+		{
+			const auto& resumed = resumeDataFile.readAll ();
+			torrent.Params_.resume_data.assign (resumed.constData (),
+					resumed.constData () + resumed.size ());
+		}
+
+		if (torrent.Priorities_.empty ())
+			torrent.Priorities_.resize (torrent.Params_.ti->num_files (), 1);
+
+		return torrent;
 	}
 
 	void Core::RestoreTorrents ()
 	{
 		const auto& torrentsDir = Util::CreateIfNotExists ("bittorrent");
+		const auto storageMode = GetCurrentStorageMode ();
 
 		QSettings settings (QCoreApplication::organizationName (),
 				QCoreApplication::applicationName () + "_Torrent");
 		settings.beginGroup ("Core");
-		int torrents = settings.beginReadArray ("AddedTorrents");
-		qDebug () << Q_FUNC_INFO << "gonna restore" << torrents << "torrents";
-		for (int i = 0; i < torrents; ++i)
+
+		QList<RestoredTorrent> torrents;
+		int count = settings.beginReadArray ("AddedTorrents");
+		qDebug () << Q_FUNC_INFO << "gonna restore" << count << "torrents";
+		for (int i = 0; i < count; ++i)
 		{
 			settings.setArrayIndex (i);
-			const auto& pathStr = settings.value ("SavePath").toString ();
-			const auto& path = std::string (pathStr.toUtf8 ().constData ());
-			QString filename = settings.value ("Filename").toString ();
-			QFile torrent (torrentsDir.filePath (filename));
-			if (!torrent.open (QIODevice::ReadOnly))
-			{
-				ShowError (tr ("Could not open saved torrent %1 for read.").arg (filename));
-				continue;
-			}
-			QByteArray data = torrent.readAll ();
-			torrent.close ();
-			if (data.isEmpty ())
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "empty torrent data for"
-						<< filename;
-				continue;
-			}
-
-			QFile resumeDataFile (torrentsDir.filePath (filename + ".resume"));
-			QByteArray resumed;
-			if (resumeDataFile.open (QIODevice::ReadOnly))
-			{
-				resumed = resumeDataFile.readAll ();
-				resumeDataFile.close ();
-			}
 
-			bool automanaged = settings.value ("AutoManaged", true).toBool ();
-			TaskParameters taskParameters = static_cast<TaskParameters> (settings
+			RestoredTorrent torrent;
+			torrent.Index_ = torrents.size ();
+			torrent.Filename_ = settings.value ("Filename").toString ();
+			torrent.TorrentPath_ = torrentsDir.filePath (torrent.Filename_);
+			torrent.ResumePath_ = torrentsDir.filePath (torrent.Filename_ + ".resume");
+			torrent.Tags_ = settings.value ("Tags").toStringList ();
+			torrent.AutoManaged_ = settings.value ("AutoManaged", true).toBool ();
+			torrent.Parameters_ = static_cast<TaskParameters> (settings
 						.value ("Parameters").toInt ());
 
-			auto handle = RestoreSingleTorrent (data,
-					resumed,
-					path,
-					automanaged,
-					taskParameters & NoAutostart);
-			if (!handle.is_valid ())
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "got invalid handle for"
-						<< filename;
-				continue;
-			}
-
-			std::vector<int> priorities;
-			QByteArray prioritiesLine = settings.value ("Priorities").toByteArray ();
+			const auto& prioritiesLine = settings.value ("Priorities").toByteArray ();
 			std::copy (prioritiesLine.begin (), prioritiesLine.end (),
-					std::back_inserter (priorities));
+					std::back_inserter (torrent.Priorities_));
 
-			if (priorities.empty ())
-			{
-				const auto& infoPtr = StatusKeeper_->GetStatus (handle,
-							libtorrent::torrent_handle::query_torrent_file).torrent_file.lock ();
-				const auto numFiles = infoPtr ? infoPtr->num_files () : 0;
-				priorities.resize (numFiles);
-				std::fill (priorities.begin (), priorities.end (), 1);
-			}
-
-			handle.prioritize_files (priorities);
+			auto& atp = torrent.Params_;
+			atp.storage_mode = storageMode;
+			atp.save_path = settings.value ("SavePath").toString ().toStdString ();
+			if (!torrent.AutoManaged_)
+				atp.flags &= ~libtorrent::add_torrent_params::flag_auto_managed;
+			if (torrent.Parameters_ & NoAutostart)
+				atp.flags |= libtorrent::add_torrent_params::flag_paused;
+			atp.flags |= libtorrent::add_torrent_params::flag_duplicate_is_error;
 
-			beginInsertRows ({}, Handles_.size (), Handles_.size ());
-			Handles_.append ({
-					priorities,
-					handle,
-					data,
-					filename,
-					settings.value ("Tags").toStringList (),
-					automanaged,
-					Proxy_->GetID (),
-					taskParameters
-				});
-			endInsertRows ();
-			qDebug () << "restored a torrent";
+			torrents << torrent;
 		}
 		settings.endArray ();
 
@@ -1774,45 +1892,130 @@ namespace BitTorrent
 		}
 		settings.endArray ();
 		settings.endGroup ();
+
+		if (torrents.isEmpty ())
+			return;
+
+		PendingRestores_ = torrents.size ();
+		WarningWatchdog_->setInterval (RestoreAlertsPollInterval);
+
+		auto watcher = new QFutureWatcher<RestoredTorrent> (this);
+		connect (watcher,
+				&QFutureWatcher<RestoredTorrent>::resultReadyAt,
+				this,
+				[this, watcher] (int idx) { HandleTorrentDecoded (watcher->resultAt (idx)); });
+		connect (watcher,
+				&QFutureWatcherBase::finished,
+				watcher,
+				&QObject::deleteLater);
+		watcher->setFuture (QtConcurrent::mapped (torrents, &Core::DecodeRestoredTorrent));
 	}
 
-	libtorrent::torrent_handle Core::RestoreSingleTorrent (const QByteArray& data,
-			const QByteArray& resumeData,
-			const boost::filesystem::path& path,
-			bool automanaged,
-			bool pause)
+	void Core::HandleTorrentDecoded (const RestoredTorrent& decoded)
 	{
-		libtorrent::torrent_handle handle;
-
-		libtorrent::bdecode_node e;
-		if (!DecodeEntry (data, e))
-			return handle;
+		DecodedRestores_ [decoded.Index_] = decoded;
 
-		try
+		// Add the torrents in their original order to keep the queue.
+		while (DecodedRestores_.contains (NextRestoreToAdd_))
 		{
-			libtorrent::add_torrent_params atp;
-			atp.ti = boost::make_shared<libtorrent::torrent_info> (e);
-			atp.storage_mode = GetCurrentStorageMode ();
-			atp.save_path = path.string ();
-			if (!automanaged)
-				atp.flags &= ~libtorrent::add_torrent_params::flag_auto_managed;
-			if (pause)
-				atp.flags |= libtorrent::add_torrent_params::flag_paused;
-			atp.flags |= libtorrent::add_torrent_params::flag_duplicate_is_error;
+			const auto torrent = DecodedRestores_.take (NextRestoreToAdd_++);
+			if (!torrent.Error_.isEmpty ())
+				ShowError (torrent.Error_);
 
-			std::copy (resumeData.constData (),
-					resumeData.constData () + resumeData.size (),
-					std::back_inserter (atp.resume_data));
+			if (!torrent.Params_.ti)
+			{
+				ResolveRestore ();
+				continue;
+			}
 
-			handle = Session_->add_torrent (atp);
+			const auto& key = GetInfoHashKey (torrent.Params_.ti->info_hash ());
+			if (RestoredHashes_.contains (key))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "duplicate torrent"
+						<< torrent.Filename_;
+				ResolveRestore ();
+				continue;
+			}
+
+			RestoredHashes_ << key;
+			AddingRestores_ [key] = torrent;
+			Session_->async_add_torrent (torrent.Params_);
 		}
-		catch (const libtorrent::libtorrent_exception& e)
+	}
+
+	void Core::HandleTorrentAdded (const libtorrent::add_torrent_alert& a)
+	{
+		if (!a.params.ti)
+			return;
+
+		const auto pos = AddingRestores_.find (GetInfoHashKey (a.params.ti->info_hash ()));
+		if (pos == AddingRestores_.end () || pos->Params_.ti != a.params.ti)
+			return;
+
+		const auto torrent = *pos;
+		AddingRestores_.erase (pos);
+
+		if (a.error)
 		{
-			qWarning () << Q_FUNC_INFO << e.what ();
-			HandleLibtorrentException (e);
+			qWarning () << Q_FUNC_INFO
+					<< "unable to restore"
+					<< torrent.Filename_
+					<< a.error.message ().c_str ();
+			ShowError (tr ("Unable to restore torrent %1: %2")
+					.arg (torrent.Filename_)
+					.arg (QString::fromUtf8 (a.error.message ().c_str ())));
+			ResolveRestore ();
+			return;
 		}
 
-		return handle;
+		auto handle = a.handle;
+		handle.prioritize_files (torrent.Priorities_);
+
+		RestoredBatch_.append ({
+				torrent.Priorities_,
+				handle,
+				torrent.TorrentData_,
+				torrent.Filename_,
+				torrent.Tags_,
+				torrent.AutoManaged_,
+				Proxy_->GetID (),
+				torrent.Parameters_
+			});
+		RestoredBatch_.last ().TorrentFileStored_ = true;
+
+		ResolveRestore ();
+	}
+
+	void Core::ResolveRestore ()
+	{
+		if (--PendingRestores_)
+			return;
+
+		qDebug () << Q_FUNC_INFO
+				<< "restored"
+				<< Handles_.size () + RestoredBatch_.size ()
+				<< "torrents";
+
+		WarningWatchdog_->setInterval (AlertsPollInterval);
+		RestoredHashes_.clear ();
+
+		if (IndexDirty_)
+			ScheduleSave ();
+	}
+
+	void Core::FlushRestoredBatch ()
+	{
+		if (RestoredBatch_.isEmpty ())
+			return;
+
+		beginInsertRows ({}, Handles_.size (), Handles_.size () + RestoredBatch_.size () - 1);
+		Handles_ += RestoredBatch_;
+		for (const auto& torrent : RestoredBatch_)
+			HandleIndex_.Append (torrent.Handle_.info_hash ());
+		endInsertRows ();
+
+		RestoredBatch_.clear ();
 	}
 
 	void Core::HandleSingleFinished (int i)
@@ -1923,6 +2126,7 @@ namespace BitTorrent
 
 		Handles_ [torrent].Tags_ = Util::Map (tags,
 				[this] (const QString& tag) { return Proxy_->GetTagsManager ()->GetID (tag); });
+		MarkIndexDirty ();
 	}
 
 	void Core::ScheduleSave ()
@@ -1937,6 +2141,71 @@ namespace BitTorrent
 		SaveScheduled_ = true;
 	}
 
+	void Core::MarkIndexDirty ()
+	{
+		IndexDirty_ = true;
+		ScheduleSave ();
+	}
+
+	namespace
+	{
+		bool WriteFileAtomically (const QString& path, const QByteArray& data)
+		{
+			QSaveFile file { path };
+			if (!file.open (QIODevice::WriteOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< path
+						<< "for writing:"
+						<< file.errorString ();
+				return false;
+			}
+
+			file.write (data);
+			if (!file.commit ())
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to commit"
+						<< path
+						<< file.errorString ();
+				return false;
+			}
+
+			return true;
+		}
+	}
+
+	QFuture<bool> Core::ScheduleFileWrite (const QString& path, const QByteArray& data)
+	{
+		return QtConcurrent::run (&WriterPool_, [path, data] { return WriteFileAtomically (path, data); });
+	}
+
+	void Core::ScheduleTorrentFileWrite (TorrentStruct& torrent, const QString& path)
+	{
+		// Marked as stored right away so that the following saves don't
+		// queue the same write again while this one is pending.
+		torrent.TorrentFileStored_ = true;
+
+		const auto handle = torrent.Handle_;
+		auto watcher = new QFutureWatcher<bool> (this);
+		connect (watcher,
+				&QFutureWatcherBase::finished,
+				this,
+				[this, watcher, handle]
+				{
+					watcher->deleteLater ();
+					if (watcher->result ())
+						return;
+
+					// Retry on the next save.
+					const auto pos = FindHandle (handle);
+					if (pos != Handles_.end ())
+						pos->TorrentFileStored_ = false;
+				});
+		watcher->setFuture (ScheduleFileWrite (path, torrent.TorrentFileContents_));
+	}
+
 	void Core::HandleLibtorrentException (const libtorrent::libtorrent_exception& e)
 	{
 		ShowError (tr ("Error code %1 of category:<blockquote>%2</blockquote>"
@@ -1954,12 +2223,8 @@ namespace BitTorrent
 		Proxy_->GetEntityManager ()->HandleEntity (e);
 	}
 
-	void Core::writeSettings ()
+	void Core::WriteTorrentsIndex ()
 	{
-		SaveScheduled_ = false;
-
-		const auto& torrentsDir = Util::CreateIfNotExists ("bittorrent");
-
 		QSettings settings (QCoreApplication::organizationName (),
 				QCoreApplication::applicationName () + "_Torrent");
 		settings.beginGroup ("Core");
@@ -1974,46 +2239,32 @@ namespace BitTorrent
 					<< i;
 				continue;
 			}
-			if (Handles_.at (i).TorrentFileName_.isEmpty ())
+
+			const auto& torrent = Handles_.at (i);
+			if (torrent.TorrentFileName_.isEmpty ())
 			{
 				qWarning () << Q_FUNC_INFO
 					<< "empty file name"
 					<< i;
 				continue;
 			}
-			int oldCurrent = CurrentTorrent_;
-			CurrentTorrent_ = i;
+
 			try
 			{
-				QFile file_info (torrentsDir.filePath (Handles_.at (i).TorrentFileName_));
-				if (!file_info.open (QIODevice::WriteOnly))
-					ShowError (QString ("Cannot write settings! "
-								"Cannot open file %1 for write!")
-							.arg (Handles_.at (i).TorrentFileName_));
-				else
-				{
-					file_info.write (Handles_.at (i).TorrentFileContents_);
-					file_info.close ();
-
-					const auto& handle = Handles_.at (i).Handle_;
-					if (handle.need_save_resume_data ())
-						handle.save_resume_data ();
-
-					const auto& savePath = StatusKeeper_->GetStatus (handle,
-								libtorrent::torrent_handle::query_save_path).save_path;
-					settings.setValue ("SavePath", QString::fromUtf8 (savePath.c_str ()));
-					settings.setValue ("Filename", Handles_.at (i).TorrentFileName_);
-					settings.setValue ("Tags", Handles_.at (i).Tags_);
-					settings.setValue ("ID", Handles_.at (i).ID_);
-					settings.setValue ("Parameters", static_cast<int> (Handles_.at (i).Parameters_));
-					settings.setValue ("AutoManaged", Handles_.at (i).AutoManaged_);
-
-					QByteArray prioritiesLine;
-					std::copy (Handles_.at (i).FilePriorities_.begin (),
-							Handles_.at (i).FilePriorities_.end (),
-							std::back_inserter (prioritiesLine));
-					settings.setValue ("Priorities", prioritiesLine);
-				}
+				const auto& savePath = StatusKeeper_->GetStatus (torrent.Handle_,
+							libtorrent::torrent_handle::query_save_path).save_path;
+				settings.setValue ("SavePath", QString::fromUtf8 (savePath.c_str ()));
+				settings.setValue ("Filename", torrent.TorrentFileName_);
+				settings.setValue ("Tags", torrent.Tags_);
+				settings.setValue ("ID", torrent.ID_);
+				settings.setValue ("Parameters", static_cast<int> (torrent.Parameters_));
+				settings.setValue ("AutoManaged", torrent.AutoManaged_);
+
+				QByteArray prioritiesLine;
+				std::copy (torrent.FilePriorities_.begin (),
+						torrent.FilePriorities_.end (),
+						std::back_inserter (prioritiesLine));
+				settings.setValue ("Priorities", prioritiesLine);
 			}
 			catch (const std::exception& e)
 			{
@@ -2023,10 +2274,16 @@ namespace BitTorrent
 			{
 				qWarning () << Q_FUNC_INFO << "unknown exception";
 			}
-			CurrentTorrent_ = oldCurrent;
 		}
 		settings.endArray ();
+		settings.endGroup ();
+	}
 
+	void Core::WriteIPFilter ()
+	{
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "_Torrent");
+		settings.beginGroup ("Core");
 		settings.beginWriteArray ("IPFilter");
 		settings.remove ("");
 		int i = 0;
@@ -2039,7 +2296,10 @@ namespace BitTorrent
 		}
 		settings.endArray ();
 		settings.endGroup ();
+	}
 
+	void Core::SaveSessionState ()
+	{
 		boost::uint32_t saveflags = 0xffffffff;
 		if (!Session_->is_dht_running ())
 			saveflags &= ~libtorrent::session::save_dht_state;
@@ -2051,51 +2311,62 @@ namespace BitTorrent
 		libtorrent::bencode (std::back_inserter (sessionStateBA), sessionState);
 		XmlSettingsManager::Instance ()->setProperty ("SessionState", sessionStateBA);
 
-		Session_->wait_for_alert (libtorrent::time_duration (5));
+		LastSessionStateSave_.start ();
+	}
 
-		queryLibtorrent ();
+	namespace
+	{
+		/** The session state (DHT nodes, session-wide settings) changes
+		 * slowly, so it is saved at most this often except on shutdown.
+		 */
+		const int SessionStateSaveInterval = 5 * 60 * 1000;
 	}
 
-	void Core::checkFinished ()
+	void Core::writeSettings ()
 	{
-		for (int i = 0; i < Handles_.size (); ++i)
+		SaveScheduled_ = false;
+
+		const auto& torrentsDir = Util::CreateIfNotExists ("bittorrent");
+
+		for (auto& torrent : Handles_)
 		{
-			if (Handles_.at (i).State_ == TSSeeding)
+			if (!torrent.Handle_.is_valid ())
 				continue;
 
-			const auto& status = Handles_.at (i).Handle_.status (0);
-			libtorrent::torrent_status::state_t state = status.state;
-
-			if (status.paused)
+			if (!torrent.TorrentFileStored_ &&
+					!torrent.TorrentFileName_.isEmpty () &&
+					!torrent.TorrentFileContents_.isEmpty ())
 			{
-				Handles_ [i].State_ = TSIdle;
-				continue;
+				ScheduleTorrentFileWrite (torrent, torrentsDir.filePath (torrent.TorrentFileName_));
 			}
 
-			switch (state)
+			try
 			{
-			case libtorrent::torrent_status::queued_for_checking:
-			case libtorrent::torrent_status::checking_files:
-			case libtorrent::torrent_status::checking_resume_data:
-			case libtorrent::torrent_status::allocating:
-			case libtorrent::torrent_status::downloading_metadata:
-				Handles_ [i].State_ = TSPreparing;
-				break;
-			case libtorrent::torrent_status::downloading:
-				Handles_ [i].State_ = TSDownloading;
-				break;
-			case libtorrent::torrent_status::finished:
-			case libtorrent::torrent_status::seeding:
-				TorrentState oldState = Handles_ [i].State_;
-				Handles_ [i].State_ = TSSeeding;
-				if (oldState == TSDownloading)
-				{
-					HandleSingleFinished (i);
-					ScheduleSave ();
-				}
-				break;
+				if (torrent.Handle_.need_save_resume_data ())
+					torrent.Handle_.save_resume_data ();
 			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO << e.what ();
+			}
+		}
+
+		// The index would lose the torrents that are still being restored.
+		if (IndexDirty_ && !PendingRestores_)
+		{
+			WriteTorrentsIndex ();
+			IndexDirty_ = false;
 		}
+
+		if (FilterDirty_)
+		{
+			WriteIPFilter ();
+			FilterDirty_ = false;
+		}
+
+		if (!LastSessionStateSave_.isValid () ||
+				LastSessionStateSave_.elapsed () >= SessionStateSaveInterval)
+			SaveSessionState ();
 	}
 
 	struct SimpleDispatcher
@@ -2137,6 +2408,8 @@ namespace BitTorrent
 					.arg (GetTorrentName (a.handle))
 					.arg (QString::fromUtf8 (a.storage_path ()));
 			IEM_->HandleEntity (Util::MakeNotification ("BitTorrent", text, Priority::Info));
+
+			Core_.MarkIndexDirty ();
 		}
 
 		void operator() (const libtorrent::storage_moved_failed_alert& a) const
@@ -2147,6 +2420,11 @@ namespace BitTorrent
 			IEM_->HandleEntity (Util::MakeNotification ("BitTorrent", text, Priority::Critical));
 		}
 
+		void operator() (const libtorrent::add_torrent_alert& a) const
+		{
+			Core_.HandleTorrentAdded (a);
+		}
+
 		void operator() (const libtorrent::metadata_received_alert& a) const
 		{
 			Core_.HandleMetadata (a);
@@ -2186,20 +2464,30 @@ namespace BitTorrent
 			NeedToLog_ = false;
 		}
 
-		void operator() (const libtorrent::torrent_paused_alert& a) const
+		void operator() (const libtorrent::torrent_paused_alert&) const
 		{
-			Core_.UpdateStatus ({ a.handle.status () });
+			Core_.RequestStatusUpdate ();
 		}
 
-		void operator() (const libtorrent::torrent_resumed_alert& a) const
+		void operator() (const libtorrent::torrent_resumed_alert&) const
 		{
-			Core_.UpdateStatus ({ a.handle.status () });
+			Core_.RequestStatusUpdate ();
 		}
 
 		void operator() (const libtorrent::torrent_checked_alert& a) const
 		{
 			Core_.HandleTorrentChecked (a.handle);
-			Core_.UpdateStatus ({ a.handle.status () });
+			Core_.RequestStatusUpdate ();
+		}
+
+		void operator() (const libtorrent::state_changed_alert&) const
+		{
+			Core_.RequestStatusUpdate ();
+		}
+
+		void operator() (const libtorrent::torrent_finished_alert&) const
+		{
+			Core_.RequestStatusUpdate ();
 		}
 
 		void operator() (const libtorrent::dht_announce_alert& a)
@@ -2254,8 +2542,9 @@ namespace BitTorrent
 			Core_.UpdateStatus ({ a.handle.status () });
 		}
 
-		void operator() (const libtorrent::piece_finished_alert&) const
+		void operator() (const libtorrent::piece_finished_alert& a) const
 		{
+			Core_.PieceFinished (a);
 		}
 	private:
 		QString GetTorrentName (const libtorrent::torrent_handle& handle) const
@@ -2321,6 +2610,7 @@ namespace BitTorrent
 			{
 				HandleAlert<
 					libtorrent::external_ip_alert
+					, libtorrent::add_torrent_alert
 					, libtorrent::save_resume_data_alert
 					, libtorrent::save_resume_data_failed_alert
 					, libtorrent::storage_moved_alert
@@ -2334,6 +2624,8 @@ namespace BitTorrent
 					, libtorrent::torrent_paused_alert
 					, libtorrent::torrent_resumed_alert
 					, libtorrent::torrent_checked_alert
+					, libtorrent::state_changed_alert
+					, libtorrent::torrent_finished_alert
 					, libtorrent::dht_announce_alert
 					, libtorrent::dht_reply_alert
 					, libtorrent::dht_bootstrap_alert
@@ -2362,6 +2654,8 @@ namespace BitTorrent
 				qWarning () << Q_FUNC_INFO << typeid (e).name ();
 			}
 		}
+
+		FlushRestoredBatch ();
 	}
 
 	void Core::scrape ()
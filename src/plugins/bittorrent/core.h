@@ -36,8 +36,14 @@
 #include <QAbstractItemModel>
 #include <QPair>
 #include <QList>
+#include <QHash>
+#include <QMap>
+#include <QSet>
 #include <QVector>
 #include <QIcon>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QFuture>
 #include <libtorrent/alert_types.hpp>
 #include <libtorrent/torrent_info.hpp>
 #include <libtorrent/torrent_handle.hpp>
@@ -48,6 +54,7 @@
 #include "torrentinfo.h"
 #include "fileinfo.h"
 #include "peerinfo.h"
+#include "rowindex.h"
 
 class QTimer;
 class QDomElement;
@@ -115,6 +122,11 @@ namespace BitTorrent
 
 			bool PauseAfterCheck_ = false;
 
+			/** Whether TorrentFileContents_ are already stored in the
+			 * torrents directory under TorrentFileName_.
+			 */
+			bool TorrentFileStored_ = false;
+
 			TorrentStruct (const libtorrent::torrent_handle& handle,
 					const QStringList& tags,
 					int id,
@@ -146,6 +158,31 @@ namespace BitTorrent
 			}
 		};
 
+		/** A torrent from the AddedTorrents list that is being restored.
+		 *
+		 * The files are read and decoded on a worker thread, then the
+		 * torrent is added to the session asynchronously, and the row
+		 * appears in the model when the corresponding add_torrent_alert
+		 * arrives.
+		 */
+		struct RestoredTorrent
+		{
+			int Index_ = -1;
+			QString TorrentPath_;
+			QString ResumePath_;
+
+			QString Filename_;
+			QStringList Tags_;
+			bool AutoManaged_ = true;
+			TaskParameters Parameters_ = NoParameters;
+			std::vector<int> Priorities_;
+
+			QByteArray TorrentData_;
+			libtorrent::add_torrent_params Params_;
+
+			QString Error_;
+		};
+
 		friend struct SimpleDispatcher;
 	public:
 		struct PerTrackerStats
@@ -164,12 +201,25 @@ namespace BitTorrent
 
 		typedef QList<TorrentStruct> HandleDict_t;
 		HandleDict_t Handles_;
+		InfoHashIndex HandleIndex_;
 		QList<QString> Headers_;
 		mutable int CurrentTorrent_ = -1;
-		std::shared_ptr<QTimer> FinishedTimer_, WarningWatchdog_;
+		std::shared_ptr<QTimer> WarningWatchdog_;
 		std::shared_ptr<LiveStreamManager> LiveStreamManager_;
 		QString ExternalAddress_;
 		bool SaveScheduled_ = false;
+		bool StatusUpdateRequested_ = false;
+		bool IndexDirty_ = false;
+		bool FilterDirty_ = false;
+		QElapsedTimer LastSessionStateSave_;
+		QThreadPool WriterPool_;
+
+		int PendingRestores_ = 0;
+		int NextRestoreToAdd_ = 0;
+		QMap<int, RestoredTorrent> DecodedRestores_;
+		QHash<QByteArray, RestoredTorrent> AddingRestores_;
+		QSet<QByteArray> RestoredHashes_;
+		QList<TorrentStruct> RestoredBatch_;
 		QToolBar *Toolbar_ = nullptr;
 		QWidget *TabWidget_ = nullptr;
 		ICoreProxy_ptr Proxy_;
@@ -329,10 +379,12 @@ namespace BitTorrent
 		QMap<BanRange_t, bool> GetFilter () const;
 		bool CheckValidity (int) const;
 
-		void SaveResumeData (const libtorrent::save_resume_data_alert&) const;
+		void SaveResumeData (const libtorrent::save_resume_data_alert&);
 		void HandleMetadata (const libtorrent::metadata_received_alert&);
 		void PieceRead (const libtorrent::read_piece_alert&);
+		void PieceFinished (const libtorrent::piece_finished_alert&);
 		void UpdateStatus (const std::vector<libtorrent::torrent_status>&);
+		void RequestStatusUpdate ();
 
 		void HandleTorrentChecked (const libtorrent::torrent_handle&);
 
@@ -346,15 +398,17 @@ namespace BitTorrent
 		HandleDict_t::iterator FindHandle (const libtorrent::torrent_handle&);
 		HandleDict_t::const_iterator FindHandle (const libtorrent::torrent_handle&) const;
 
+		void MoveRow (int from, int to);
 		void MoveToTop (int);
 		void MoveToBottom (int);
 		void RestoreTorrents ();
-		libtorrent::torrent_handle RestoreSingleTorrent (const QByteArray&,
-				const QByteArray&,
-				const boost::filesystem::path&,
-				bool,
-				bool);
+		static RestoredTorrent DecodeRestoredTorrent (RestoredTorrent);
+		void HandleTorrentDecoded (const RestoredTorrent&);
+		void HandleTorrentAdded (const libtorrent::add_torrent_alert&);
+		void ResolveRestore ();
+		void FlushRestoredBatch ();
 
+		void UpdateTorrentState (int, const libtorrent::torrent_status&);
 		void HandleSingleFinished (int);
 		void HandleFileRenamed (const libtorrent::file_renamed_alert&);
 
@@ -371,12 +425,23 @@ namespace BitTorrent
 		 */
 		void UpdateTagsImpl (const QStringList& tags, int torrent);
 		void ScheduleSave ();
+		/** Marks the list of added torrents as changed and schedules
+		 * saving it.
+		 */
+		void MarkIndexDirty ();
+		QFuture<bool> ScheduleFileWrite (const QString& path, const QByteArray& data);
+		/** Writes the .torrent file of the torrent in the writer pool.
+		 * The torrent is marked as not stored again if the write fails.
+		 */
+		void ScheduleTorrentFileWrite (TorrentStruct& torrent, const QString& path);
+		void WriteTorrentsIndex ();
+		void WriteIPFilter ();
+		void SaveSessionState ();
 		void HandleLibtorrentException (const libtorrent::libtorrent_exception&);
 
 		void ShowError (const QString&);
 	private slots:
 		void writeSettings ();
-		void checkFinished ();
 		void scrape ();
 		void queryLibtorrent ();
 	signals:
@@ -28,6 +28,7 @@
  **********************************************************************/
 
 #include "livestreamdevice.h"
+#include <algorithm>
 #include <QtDebug>
 #include "cachedstatuskeeper.h"
 
@@ -37,24 +38,78 @@ namespace BitTorrent
 {
 	using th = libtorrent::torrent_handle;
 
-	LiveStreamDevice::LiveStreamDevice (const libtorrent::torrent_handle& h,
-			CachedStatusKeeper *keeper, QObject *parent)
-	: QIODevice (parent)
-	, StatusKeeper_ (keeper)
-	, Handle_ (h)
-	, TI_
+	namespace
 	{
-		[&]
+		/** How much data after the read position is requested in advance.
+		 */
+		const qint64 ReadAheadBytes = 16 * 1024 * 1024;
+		const int MinWindowSize = 4;
+
+		/** The deadline for the first and the last pieces of the file
+		 * that are needed to start the playback, in milliseconds.
+		 */
+		const int InitialDeadline = 500;
+
+		/** The time it is assumed to take to download a piece when the
+		 * download rate is unknown, in milliseconds.
+		 */
+		const int DefaultPieceTime = 60000;
+
+		libtorrent::torrent_info GetTorrentInfo (const libtorrent::torrent_handle& h,
+				CachedStatusKeeper *keeper)
 		{
-			const auto tf = keeper->GetStatus (h, th::query_pieces | th::query_torrent_file).torrent_file.lock ();
+			const auto tf = keeper->GetStatus (h, th::query_torrent_file).torrent_file.lock ();
 			if (!tf)
 				throw std::runtime_error { LiveStreamDevice::tr ("No metadata is available yet.").toStdString () };
 			return *tf;
-		} ()
+		}
+
+		int ResolveFileIndex (const libtorrent::torrent_info& ti, int file)
+		{
+			const auto& files = ti.files ();
+			if (file == -1)
+			{
+				boost::int64_t maxSize = -1;
+				for (int i = 0; i < files.num_files (); ++i)
+					if (files.file_size (i) > maxSize)
+					{
+						maxSize = files.file_size (i);
+						file = i;
+					}
+			}
+
+			if (file < 0 || file >= files.num_files ())
+				throw std::runtime_error { LiveStreamDevice::tr ("Invalid file index %1.")
+							.arg (file)
+							.toStdString () };
+
+			return file;
+		}
 	}
+
+	LiveStreamDevice::LiveStreamDevice (const libtorrent::torrent_handle& h,
+			CachedStatusKeeper *keeper, int file, QObject *parent)
+	: QIODevice (parent)
+	, StatusKeeper_ (keeper)
+	, Handle_ (h)
+	, TI_ (GetTorrentInfo (h, keeper))
+	, FileIndex_ (ResolveFileIndex (TI_, file))
+	, FileOffset_ (TI_.files ().file_offset (FileIndex_))
+	, FileSize_ (TI_.files ().file_size (FileIndex_))
+	, FirstPiece_ (FileOffset_ / PieceLength_)
+	, LastPiece_ ((FileOffset_ + std::max<qint64> (FileSize_ - 1, 0)) / PieceLength_)
+	, WindowSize_ (std::max<int> (MinWindowSize, ReadAheadBytes / PieceLength_))
+	, HavePieces_ (TI_.num_pieces (), false)
+	, AvailableFrom_ (FirstPiece_)
+	, AvailableTo_ (FirstPiece_)
 	{
+		if (!h.file_priority (FileIndex_))
+			h.file_priority (FileIndex_, 1);
+		SavedFirstPriority_ = std::max (h.piece_priority (FirstPiece_), 1);
+		SavedLastPriority_ = std::max (h.piece_priority (LastPiece_), 1);
+
 		const auto& tpath = keeper->GetStatus (h, th::query_save_path).save_path;
-		const auto& fpath = TI_.files ().file_path (0);
+		const auto& fpath = TI_.files ().file_path (FileIndex_);
 		File_.setFileName (QString::fromStdString (tpath + '/' + fpath));
 
 		if (!QIODevice::open (QIODevice::ReadOnly | QIODevice::Unbuffered))
@@ -65,24 +120,47 @@ namespace BitTorrent
 			throw std::runtime_error { QIODevice::errorString ().toStdString () };
 		}
 
+		SyncPieces (FirstPiece_, LastPiece_);
 		reschedule ();
 	}
 
-	qint64 LiveStreamDevice::bytesAvailable () const
+	LiveStreamDevice::~LiveStreamDevice ()
 	{
-		qint64 result = 0;
-		const auto& pieces = StatusKeeper_->GetStatus (Handle_, th::query_pieces).pieces;
-		qDebug () << Q_FUNC_INFO << Offset_ << ReadPos_ << pieces [ReadPos_];
-		for (int i = ReadPos_; pieces [i]; ++i)
+		if (!Handle_.is_valid ())
+			return;
+
+		ResetDeadlines (0, -1);
+
+		if (!IsReady_)
 		{
-			result += TI_.piece_size (i);
-			qDebug () << "added:" << result;
+			for (const auto piece : { FirstPiece_, LastPiece_ })
+				if (!HavePieces_ [piece])
+					Handle_.reset_piece_deadline (piece);
+			Handle_.piece_priority (FirstPiece_, SavedFirstPriority_);
+			Handle_.piece_priority (LastPiece_, SavedLastPriority_);
 		}
-		result -= Offset_;
-		if (result < 0)
-			result = 0;
-		qDebug () << "result:" << result;
-		return result;
+	}
+
+	int LiveStreamDevice::GetFileIndex () const
+	{
+		return FileIndex_;
+	}
+
+	qint64 LiveStreamDevice::bytesAvailable () const
+	{
+		if (ReadPos_ >= FileSize_)
+			return 0;
+
+		const auto piece = GetPiece (ReadPos_);
+		if (piece < AvailableFrom_ || piece > AvailableTo_)
+			AvailableFrom_ = AvailableTo_ = piece;
+
+		while (AvailableTo_ <= LastPiece_ && HavePieces_ [AvailableTo_])
+			++AvailableTo_;
+
+		return AvailableTo_ > piece ?
+				GetPieceEnd (AvailableTo_ - 1) - ReadPos_ :
+				0;
 	}
 
 	bool LiveStreamDevice::isSequential () const
@@ -102,61 +180,64 @@ namespace BitTorrent
 
 	qint64 LiveStreamDevice::pos () const
 	{
-		qint64 result = 0;
-		for (int i = 0; i < ReadPos_; ++i)
-			result += TI_.piece_size (i);
-		result += Offset_;
-		return result;
+		return ReadPos_;
 	}
 
 	bool LiveStreamDevice::seek (qint64 pos)
 	{
-		QIODevice::seek (pos);
-		qDebug () << Q_FUNC_INFO << pos;
+		if (pos < 0 || pos > FileSize_)
+			return false;
 
-		int i = 0;
-		while (pos >= TI_.piece_size (i))
-			pos -= TI_.piece_size (i++);
-		ReadPos_ = i;
-		Offset_ = pos;
+		QIODevice::seek (pos);
 
-		qDebug () << ReadPos_ << Offset_;
+		const auto oldPiece = GetPiece (ReadPos_);
+		ReadPos_ = pos;
 
-		reschedule ();
+		if (GetPiece (ReadPos_) != oldPiece)
+			reschedule ();
 
 		return true;
 	}
 
 	qint64 LiveStreamDevice::size () const
 	{
-		return StatusKeeper_->GetStatus (Handle_, 0).total_wanted;
+		return FileSize_;
 	}
 
-	void LiveStreamDevice::PieceRead (const libtorrent::read_piece_alert&)
+	void LiveStreamDevice::PieceRead (const libtorrent::read_piece_alert& a)
 	{
-		CheckReady ();
-		CheckNextChunk ();
-		reschedule ();
+		if (a.buffer)
+			MarkPiece (a.piece);
+	}
+
+	void LiveStreamDevice::PieceFinished (const libtorrent::piece_finished_alert& a)
+	{
+		MarkPiece (a.piece_index);
 	}
 
 	void LiveStreamDevice::CheckReady ()
 	{
-		const auto& pieces = StatusKeeper_->GetStatus (Handle_, th::query_pieces).pieces;
-		if (!IsReady_ &&
-				pieces [0] &&
-				pieces [NumPieces_ - 1])
-		{
-			std::vector<int> prios (NumPieces_, 1);
-			Handle_.prioritize_pieces (prios);
+		if (IsReady_ ||
+				!HavePieces_ [FirstPiece_] ||
+				!HavePieces_ [LastPiece_])
+			return;
 
-			IsReady_ = true;
-			emit ready (this);
-		}
+		Handle_.piece_priority (FirstPiece_, SavedFirstPriority_);
+		Handle_.piece_priority (LastPiece_, SavedLastPriority_);
+
+		IsReady_ = true;
+		reschedule ();
+
+		emit ready (this);
 	}
 
 	qint64 LiveStreamDevice::readData (char *data, qint64 max)
 	{
-		if (!File_.open (QIODevice::ReadOnly))
+		const auto available = bytesAvailable ();
+		if (!available)
+			return 0;
+
+		if (!File_.isOpen () && !File_.open (QIODevice::ReadOnly))
 		{
 			qWarning () << Q_FUNC_INFO
 				<< "could not open underlying file"
@@ -164,18 +245,25 @@ namespace BitTorrent
 				<< File_.errorString ();
 			return -1;
 		}
-		qint64 ba = bytesAvailable ();
-		File_.seek (pos ());
-		const qint64 result = File_.read (data, std::min (max, ba));
-		File_.close ();
 
-		qDebug () << Q_FUNC_INFO << result << Offset_ << ReadPos_ << max << ba;
+		if (!File_.seek (ReadPos_))
+		{
+			qWarning () << Q_FUNC_INFO
+				<< "could not seek underlying file"
+				<< File_.fileName ()
+				<< "to"
+				<< ReadPos_;
+			return -1;
+		}
 
-		Offset_ += result;
-		while (Offset_ >= TI_.piece_size (ReadPos_))
-			Offset_ -= TI_.piece_size (ReadPos_++);
+		const auto result = File_.read (data, std::min (max, available));
+		if (result <= 0)
+			return result;
 
-		qDebug () << Offset_ << ReadPos_ << bytesAvailable ();
+		const auto oldPiece = GetPiece (ReadPos_);
+		ReadPos_ += result;
+		if (GetPiece (ReadPos_) != oldPiece)
+			reschedule ();
 
 		return result;
 	}
@@ -185,56 +273,85 @@ namespace BitTorrent
 		return -1;
 	}
 
-	void LiveStreamDevice::CheckNextChunk ()
+	int LiveStreamDevice::GetPiece (qint64 pos) const
 	{
-		bool hasMoreData = false;
-		const auto& pieces = StatusKeeper_->GetStatus (Handle_, th::query_pieces).pieces;
-		for (int i = ReadPos_ + 1;
-				i < NumPieces_ && pieces [i];
-				++i, hasMoreData = true);
+		const auto piece = (FileOffset_ + pos) / PieceLength_;
+		return std::min<qint64> (piece, LastPiece_);
+	}
+
+	qint64 LiveStreamDevice::GetPieceEnd (int piece) const
+	{
+		return std::min (static_cast<qint64> (piece + 1) * PieceLength_ - FileOffset_, FileSize_);
+	}
 
-		if (hasMoreData)
+	void LiveStreamDevice::MarkPiece (int piece)
+	{
+		if (piece < FirstPiece_ || piece > LastPiece_ || HavePieces_ [piece])
+			return;
+
+		HavePieces_ [piece] = true;
+
+		if (!IsReady_)
+		{
+			CheckReady ();
+			return;
+		}
+
+		const auto current = GetPiece (ReadPos_);
+		if (piece >= current && piece < current + WindowSize_)
 			emit readyRead ();
 	}
 
+	void LiveStreamDevice::SyncPieces (int from, int to)
+	{
+		const auto& pieces = StatusKeeper_->GetStatus (Handle_, th::query_pieces).pieces;
+		to = std::min (to, pieces.size () - 1);
+		for (int i = from; i <= to; ++i)
+			if (pieces [i])
+				HavePieces_ [i] = true;
+	}
+
+	void LiveStreamDevice::ResetDeadlines (int keepFrom, int keepTo)
+	{
+		for (int i = ScheduledFrom_; i <= ScheduledTo_; ++i)
+			if ((i < keepFrom || i > keepTo) && !HavePieces_ [i])
+				Handle_.reset_piece_deadline (i);
+	}
+
 	void LiveStreamDevice::reschedule ()
 	{
-		const auto& status = StatusKeeper_->GetStatus (Handle_, th::query_pieces);
-		const auto& pieces = status.pieces;
-		int speed = status.download_payload_rate;
-		int size = TI_.piece_length ();
-		const int time = speed ?
-			static_cast<double> (size) / speed * 1000 :
-			60000;
-
-		int thisDeadline = 0;
-		for (int i = ReadPos_; i < NumPieces_; ++i)
-			if (!pieces [i])
-				Handle_.set_piece_deadline (i,
-						IsReady_ ?
-							(thisDeadline += time) :
-							1000000,
-						1);
 		if (!IsReady_)
 		{
-			std::vector<int> prios (NumPieces_, 0);
-			if (pieces.size () > 1)
-				prios [1] = 1;
+			SyncPieces (FirstPiece_, FirstPiece_);
+			SyncPieces (LastPiece_, LastPiece_);
 
-			if (!pieces [0])
-			{
-				qDebug () << "scheduling first piece";
-				Handle_.set_piece_deadline (0, 500, 1);
-				prios [0] = 7;
-			}
-			if (!pieces [NumPieces_ - 1])
+			for (const auto piece : { FirstPiece_, LastPiece_ })
 			{
-				qDebug () << "scheduling last piece";
-				Handle_.set_piece_deadline (NumPieces_ - 1, 500, 1);
-				prios [NumPieces_ - 1] = 7;
+				Handle_.piece_priority (piece, 7);
+				if (!HavePieces_ [piece])
+					Handle_.set_piece_deadline (piece, InitialDeadline, th::alert_when_available);
 			}
-			Handle_.prioritize_pieces (prios);
+			return;
 		}
+
+		const auto current = GetPiece (ReadPos_);
+		const auto windowEnd = std::min (LastPiece_, current + WindowSize_ - 1);
+		SyncPieces (current, windowEnd);
+
+		// Drop the deadlines left behind by a seek.
+		ResetDeadlines (current, windowEnd);
+		ScheduledFrom_ = current;
+		ScheduledTo_ = windowEnd;
+
+		const auto speed = StatusKeeper_->GetStatus (Handle_, 0).download_payload_rate;
+		const int pieceTime = speed ?
+				static_cast<double> (PieceLength_) / speed * 1000 :
+				DefaultPieceTime;
+
+		int deadline = 0;
+		for (int i = current; i <= windowEnd; ++i)
+			if (!HavePieces_ [i])
+				Handle_.set_piece_deadline (i, deadline += pieceTime, th::alert_when_available);
 	}
 }
 }
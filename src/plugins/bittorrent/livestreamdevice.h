@@ -29,7 +29,7 @@
 
 #pragma once
 
-#include <QVector>
+#include <vector>
 #include <QFile>
 #include <libtorrent/torrent_handle.hpp>
 #include <libtorrent/torrent_info.hpp>
@@ -41,6 +41,20 @@ namespace BitTorrent
 {
 	class CachedStatusKeeper;
 
+	/** Streams a single file of a torrent while it is being downloaded.
+	 *
+	 * The pieces in a window after the current read position get
+	 * deadlines so that libtorrent downloads them in order, and the
+	 * window follows the reads and seeks. The data itself is read from
+	 * the file on disk once the corresponding pieces are downloaded.
+	 *
+	 * The device learns about new pieces from PieceRead() and
+	 * PieceFinished() that should be called for the corresponding
+	 * alerts of the torrent.
+	 *
+	 * Only the pieces of the streamed file are touched, so several
+	 * devices may stream different files of the same torrent.
+	 */
 	class LiveStreamDevice : public QIODevice
 	{
 		Q_OBJECT
@@ -49,33 +63,68 @@ namespace BitTorrent
 
 		const libtorrent::torrent_handle Handle_;
 		const libtorrent::torrent_info TI_;
-		const int NumPieces_ = TI_.num_pieces ();
+		const int PieceLength_ = TI_.piece_length ();
+
+		const int FileIndex_;
+		// The offset of the file in the torrent data.
+		const qint64 FileOffset_;
+		const qint64 FileSize_;
+		const int FirstPiece_;
+		const int LastPiece_;
+		const int WindowSize_;
+
+		std::vector<bool> HavePieces_;
+		// The [from, to) range of downloaded pieces around the read position.
+		mutable int AvailableFrom_ = 0;
+		mutable int AvailableTo_ = 0;
+
+		qint64 ReadPos_ = 0;
+		bool IsReady_ = false;
+
+		// The priorities of the first and the last pieces to be restored
+		// once they are downloaded.
+		int SavedFirstPriority_ = 1;
+		int SavedLastPriority_ = 1;
+
+		// The [from, to] range of pieces this device has set deadlines for.
+		int ScheduledFrom_ = 0;
+		int ScheduledTo_ = -1;
 
-		int LastIndex_ = 0;
-		// Which piece would be read next.
-		int ReadPos_ = 0;
-		// Offset in the next piece pointed by ReadPos_;
-		int Offset_ = 0;
-		bool IsReady_ = 0;
 		QFile File_;
 	public:
-		LiveStreamDevice (const libtorrent::torrent_handle&, CachedStatusKeeper*, QObject* = nullptr);
+		/** Creates a device for the given file of the torrent.
+		 *
+		 * If the file index is -1, the largest file is streamed.
+		 *
+		 * @throws std::runtime_error if the torrent has no metadata yet
+		 * or the file index is out of range.
+		 */
+		LiveStreamDevice (const libtorrent::torrent_handle&, CachedStatusKeeper*,
+				int file = -1, QObject* = nullptr);
+		~LiveStreamDevice ();
+
+		int GetFileIndex () const;
 
-		virtual qint64 bytesAvailable () const;
-		virtual bool isSequential () const;
-		virtual bool isWritable () const;
-		virtual bool open (OpenMode);
-		virtual qint64 pos () const;
-		virtual bool seek (qint64);
-		virtual qint64 size () const;
+		qint64 bytesAvailable () const override;
+		bool isSequential () const override;
+		bool isWritable () const override;
+		bool open (OpenMode) override;
+		qint64 pos () const override;
+		bool seek (qint64) override;
+		qint64 size () const override;
 
 		void PieceRead (const libtorrent::read_piece_alert&);
+		void PieceFinished (const libtorrent::piece_finished_alert&);
 		void CheckReady ();
 	protected:
-		virtual qint64 readData (char*, qint64);
-		virtual qint64 writeData (const char*, qint64);
+		qint64 readData (char*, qint64) override;
+		qint64 writeData (const char*, qint64) override;
 	private:
-		void CheckNextChunk ();
+		int GetPiece (qint64) const;
+		qint64 GetPieceEnd (int) const;
+		void MarkPiece (int);
+		void SyncPieces (int, int);
+		void ResetDeadlines (int keepFrom, int keepTo);
 	private slots:
 		void reschedule ();
 	signals:
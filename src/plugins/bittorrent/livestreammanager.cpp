@@ -28,6 +28,7 @@
  **********************************************************************/
 
 #include "livestreammanager.h"
+#include <algorithm>
 #include <interfaces/core/ientitymanager.h>
 #include "livestreamdevice.h"
 
@@ -43,49 +44,64 @@ namespace BitTorrent
 	{
 	}
 
-	void LiveStreamManager::EnableOn (const libtorrent::torrent_handle& handle)
+	void LiveStreamManager::EnableOn (const libtorrent::torrent_handle& handle, int file)
 	{
-		if (!Handle2Device_.contains (handle))
-		{
-			LiveStreamDevice *lsd = nullptr;
-			try
-			{
-				lsd = new LiveStreamDevice { handle, StatusKeeper_, this };
-			}
-			catch (const std::runtime_error& e)
-			{
-				qWarning () << Q_FUNC_INFO
-						<< e.what ();
-				return;
-			}
+		auto& devices = Handle2Devices_ [handle];
+		const bool isStreamed = std::any_of (devices.begin (), devices.end (),
+				[file] (LiveStreamDevice *device) { return file == -1 || device->GetFileIndex () == file; });
+		if (isStreamed)
+			return;
 
-			Handle2Device_ [handle] = lsd;
-			connect (lsd,
-					SIGNAL (ready (LiveStreamDevice*)),
-					this,
-					SLOT (handleDeviceReady (LiveStreamDevice*)));
-			lsd->CheckReady ();
+		LiveStreamDevice *lsd = nullptr;
+		try
+		{
+			lsd = new LiveStreamDevice { handle, StatusKeeper_, file, this };
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			if (devices.isEmpty ())
+				Handle2Devices_.remove (handle);
+			return;
 		}
+
+		devices << lsd;
+		connect (lsd,
+				SIGNAL (ready (LiveStreamDevice*)),
+				this,
+				SLOT (handleDeviceReady (LiveStreamDevice*)));
+		lsd->CheckReady ();
 	}
 
 	bool LiveStreamManager::IsEnabledOn (const libtorrent::torrent_handle& handle)
 	{
-		return Handle2Device_.contains (handle);
+		return Handle2Devices_.contains (handle);
 	}
 
 	void LiveStreamManager::PieceRead (const libtorrent::read_piece_alert& a)
 	{
-		const auto& handle = a.handle;
-
-		if (!Handle2Device_.contains (handle))
+		const auto pos = Handle2Devices_.find (a.handle);
+		if (pos == Handle2Devices_.end ())
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "Handle2Device_ doesn't contain handle"
-					<< Handle2Device_.size ();
+					<< "Handle2Devices_ doesn't contain handle"
+					<< Handle2Devices_.size ();
 			return;
 		}
 
-		Handle2Device_ [handle]->PieceRead (a);
+		for (const auto device : *pos)
+			device->PieceRead (a);
+	}
+
+	void LiveStreamManager::PieceFinished (const libtorrent::piece_finished_alert& a)
+	{
+		const auto pos = Handle2Devices_.find (a.handle);
+		if (pos == Handle2Devices_.end ())
+			return;
+
+		for (const auto device : *pos)
+			device->PieceFinished (a);
 	}
 
 	void LiveStreamManager::handleDeviceReady (LiveStreamDevice *lsd)
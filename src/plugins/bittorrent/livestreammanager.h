@@ -49,13 +49,18 @@ namespace BitTorrent
 
 		const ICoreProxy_ptr Proxy_;
 		CachedStatusKeeper * const StatusKeeper_;
-		QMap<libtorrent::torrent_handle, LiveStreamDevice*> Handle2Device_;
+		QMap<libtorrent::torrent_handle, QList<LiveStreamDevice*>> Handle2Devices_;
 	public:
 		LiveStreamManager (CachedStatusKeeper*, const ICoreProxy_ptr&, QObject* = nullptr);
 
-		void EnableOn (const libtorrent::torrent_handle&);
+		/** Starts streaming the given file of the torrent.
+		 *
+		 * If the file index is -1, the largest file is streamed.
+		 */
+		void EnableOn (const libtorrent::torrent_handle&, int file = -1);
 		bool IsEnabledOn (const libtorrent::torrent_handle&);
 		void PieceRead (const libtorrent::read_piece_alert&);
+		void PieceFinished (const libtorrent::piece_finished_alert&);
 	private slots:
 		void handleDeviceReady (LiveStreamDevice*);
 	};
@@ -0,0 +1,129 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <libtorrent/sha1_hash.hpp>
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	/** Maps keys to the rows of a list-based model.
+	 *
+	 * The index mirrors the order of the rows, so it must be updated
+	 * along with every change of the underlying list. Looking up a row
+	 * is O(1), while removing or moving a row is linear in the number
+	 * of rows between the affected positions.
+	 */
+	template<typename Key, typename Hash = std::hash<Key>>
+	class RowIndex
+	{
+		std::unordered_map<Key, int, Hash> Key2Row_;
+		std::vector<Key> Row2Key_;
+	public:
+		/** Returns the row of the given key, or -1 if there is none.
+		 */
+		int Find (const Key& key) const
+		{
+			const auto pos = Key2Row_.find (key);
+			return pos == Key2Row_.end () ? -1 : pos->second;
+		}
+
+		int GetSize () const
+		{
+			return Row2Key_.size ();
+		}
+
+		void Append (const Key& key)
+		{
+			Key2Row_ [key] = Row2Key_.size ();
+			Row2Key_.push_back (key);
+		}
+
+		void Remove (int row)
+		{
+			Key2Row_.erase (Row2Key_ [row]);
+			Row2Key_.erase (Row2Key_.begin () + row);
+			Reindex (row, Row2Key_.size () - 1);
+		}
+
+		/** Moves the row from the position \em from so that it ends up
+		 * at the position \em to, like QList::move() does.
+		 */
+		void Move (int from, int to)
+		{
+			if (from == to)
+				return;
+
+			const auto key = Row2Key_ [from];
+			Row2Key_.erase (Row2Key_.begin () + from);
+			Row2Key_.insert (Row2Key_.begin () + to, key);
+			Reindex (std::min (from, to), std::max (from, to));
+		}
+
+		void Swap (int row1, int row2)
+		{
+			std::swap (Row2Key_ [row1], Row2Key_ [row2]);
+			Key2Row_ [Row2Key_ [row1]] = row1;
+			Key2Row_ [Row2Key_ [row2]] = row2;
+		}
+
+		void Clear ()
+		{
+			Key2Row_.clear ();
+			Row2Key_.clear ();
+		}
+	private:
+		void Reindex (int from, int to)
+		{
+			for (int i = from; i <= to; ++i)
+				Key2Row_ [Row2Key_ [i]] = i;
+		}
+	};
+
+	struct InfoHashHasher
+	{
+		size_t operator() (const libtorrent::sha1_hash& hash) const
+		{
+			// The info hash is a SHA-1 digest, so any of its bytes are good enough.
+			size_t result;
+			std::memcpy (&result, &hash [0], sizeof (result));
+			return result;
+		}
+	};
+
+	using InfoHashIndex = RowIndex<libtorrent::sha1_hash, InfoHashHasher>;
+}
+}
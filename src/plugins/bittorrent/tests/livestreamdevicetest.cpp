@@ -0,0 +1,367 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "livestreamdevicetest.h"
+#include <chrono>
+#include <random>
+#include <QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <boost/make_shared.hpp>
+#include <libtorrent/alert_types.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/settings_pack.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include "livestreamdevice.h"
+#include "cachedstatuskeeper.h"
+
+QTEST_GUILESS_MAIN (LeechCraft::BitTorrent::LiveStreamDeviceTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		const int PieceSize = 64 * 1024;
+
+		// Any single wait in the test, in milliseconds.
+		const int Timeout = 30000;
+
+		// The sizes are chosen so that the files don't start or end at piece boundaries.
+		const QList<QPair<QString, int>> Files
+		{
+			{ "first.bin", 100 * 1024 + 123 },
+			{ "second.bin", 3 * 1024 * 1024 + 77 },
+			{ "third.bin", 50 * 1024 }
+		};
+
+		QByteArray MakeContents (int size, int seed)
+		{
+			std::mt19937 gen { static_cast<std::mt19937::result_type> (seed) };
+			std::uniform_int_distribution<int> dist { 0, 255 };
+
+			QByteArray result (size, Qt::Uninitialized);
+			for (auto& c : result)
+				c = static_cast<char> (dist (gen));
+			return result;
+		}
+
+		std::unique_ptr<libtorrent::session> MakeSession ()
+		{
+			libtorrent::settings_pack pack;
+			pack.set_str (libtorrent::settings_pack::listen_interfaces, "127.0.0.1:0");
+			pack.set_bool (libtorrent::settings_pack::enable_dht, false);
+			pack.set_bool (libtorrent::settings_pack::enable_lsd, false);
+			pack.set_bool (libtorrent::settings_pack::enable_upnp, false);
+			pack.set_bool (libtorrent::settings_pack::enable_natpmp, false);
+			pack.set_bool (libtorrent::settings_pack::allow_multiple_connections_per_ip, true);
+			pack.set_int (libtorrent::settings_pack::alert_mask,
+					libtorrent::alert::status_notification |
+						libtorrent::alert::progress_notification |
+						libtorrent::alert::storage_notification |
+						libtorrent::alert::error_notification);
+			return std::unique_ptr<libtorrent::session> { new libtorrent::session { pack } };
+		}
+	}
+
+	void LiveStreamDeviceTest::initTestCase ()
+	{
+		QVERIFY (SeedDir_.isValid ());
+		QVERIFY (LeechDir_.isValid ());
+
+		const QDir seedDir { SeedDir_.path () };
+		QVERIFY (seedDir.mkdir ("content"));
+
+		int seed = 0;
+		for (const auto& pair : Files)
+		{
+			const auto& contents = MakeContents (pair.second, ++seed);
+			Contents_ [pair.first] = contents;
+
+			QFile file { seedDir.filePath ("content/" + pair.first) };
+			QVERIFY (file.open (QIODevice::WriteOnly));
+			QCOMPARE (file.write (contents), static_cast<qint64> (contents.size ()));
+		}
+
+		libtorrent::file_storage fs;
+		libtorrent::add_files (fs, seedDir.filePath ("content").toStdString ());
+
+		libtorrent::create_torrent ct { fs, PieceSize };
+		libtorrent::error_code ec;
+		libtorrent::set_piece_hashes (ct, SeedDir_.path ().toStdString (), ec);
+		QVERIFY2 (!ec, ec.message ().c_str ());
+
+		std::vector<char> torrentData;
+		libtorrent::bencode (std::back_inserter (torrentData), ct.generate ());
+		TI_ = boost::make_shared<libtorrent::torrent_info> (torrentData.data (),
+				static_cast<int> (torrentData.size ()));
+
+		Seeder_ = MakeSession ();
+		Leecher_ = MakeSession ();
+
+		libtorrent::add_torrent_params seedParams;
+		seedParams.ti = TI_;
+		seedParams.save_path = SeedDir_.path ().toStdString ();
+		seedParams.flags |= libtorrent::add_torrent_params::flag_seed_mode;
+		Seeder_->add_torrent (seedParams);
+
+		StatusKeeper_ = new CachedStatusKeeper { this };
+	}
+
+	void LiveStreamDeviceTest::init ()
+	{
+		LeechDir_.reset (new QTemporaryDir);
+		QVERIFY (LeechDir_->isValid ());
+
+		libtorrent::add_torrent_params leechParams;
+		leechParams.ti = TI_;
+		leechParams.save_path = LeechDir_->path ().toStdString ();
+		LeechHandle_ = Leecher_->add_torrent (leechParams);
+		LeechHandle_.connect_peer ({ libtorrent::address::from_string ("127.0.0.1"), Seeder_->listen_port () });
+	}
+
+	void LiveStreamDeviceTest::cleanup ()
+	{
+		Leecher_->remove_torrent (LeechHandle_);
+
+		// Wait for the removal so that the next test can add the same torrent.
+		QElapsedTimer timer;
+		timer.start ();
+		bool isRemoved = false;
+		while (!isRemoved && timer.elapsed () < Timeout)
+		{
+			Leecher_->wait_for_alert (std::chrono::milliseconds (50));
+
+			std::vector<libtorrent::alert*> alerts;
+			Leecher_->pop_alerts (&alerts);
+			for (const auto alert : alerts)
+				if (libtorrent::alert_cast<libtorrent::torrent_removed_alert> (alert))
+					isRemoved = true;
+		}
+		QVERIFY (isRemoved);
+
+		LeechHandle_ = {};
+		LeechDir_.reset ();
+	}
+
+	void LiveStreamDeviceTest::cleanupTestCase ()
+	{
+		Leecher_.reset ();
+		Seeder_.reset ();
+	}
+
+	void LiveStreamDeviceTest::testSeek ()
+	{
+		const auto& contents = Contents_ ["second.bin"];
+
+		LiveStreamDevice device { LeechHandle_, StatusKeeper_ };
+		QCOMPARE (device.GetFileIndex (), GetFileIndex ("second.bin"));
+		QCOMPARE (device.size (), static_cast<qint64> (contents.size ()));
+		QVERIFY (WaitReady ({ &device }));
+
+		const qint64 middle = contents.size () * 2 / 3;
+		QVERIFY (device.seek (middle));
+		QCOMPARE (device.pos (), middle);
+		QVERIFY (Read (device, 100 * 1024) == contents.mid (middle, 100 * 1024));
+		QCOMPARE (device.pos (), middle + 100 * 1024);
+
+		QVERIFY (device.seek (1000));
+		QVERIFY (Read (device, 5000) == contents.mid (1000, 5000));
+
+		const qint64 tail = contents.size () - 10;
+		QVERIFY (device.seek (tail));
+		QVERIFY (Read (device, 10) == contents.right (10));
+		QCOMPARE (device.bytesAvailable (), Q_INT64_C (0));
+
+		QVERIFY (!device.seek (contents.size () + 1));
+	}
+
+	void LiveStreamDeviceTest::testStreamFile ()
+	{
+		const auto& contents = Contents_ ["first.bin"];
+
+		LiveStreamDevice device { LeechHandle_, StatusKeeper_, GetFileIndex ("first.bin") };
+		QCOMPARE (device.size (), static_cast<qint64> (contents.size ()));
+		QVERIFY (WaitReady ({ &device }));
+
+		QVERIFY (Read (device, contents.size ()) == contents);
+	}
+
+	void LiveStreamDeviceTest::testTwoDevices ()
+	{
+		const auto& first = Contents_ ["first.bin"];
+		const auto& second = Contents_ ["second.bin"];
+
+		LiveStreamDevice firstDevice { LeechHandle_, StatusKeeper_, GetFileIndex ("first.bin") };
+		LiveStreamDevice secondDevice { LeechHandle_, StatusKeeper_, GetFileIndex ("second.bin") };
+		QVERIFY (WaitReady ({ &firstDevice, &secondDevice }));
+
+		// The second device must not have deprioritized the first file.
+		const auto& prios = LeechHandle_.piece_priorities ();
+		const auto& fs = TI_->files ();
+		const auto firstOffset = fs.file_offset (GetFileIndex ("first.bin"));
+		const auto firstEnd = firstOffset + fs.file_size (GetFileIndex ("first.bin")) - 1;
+		for (auto i = firstOffset / PieceSize; i <= firstEnd / PieceSize; ++i)
+			QVERIFY (prios [i] > 0);
+
+		QByteArray firstRead;
+		QByteArray secondRead;
+		const int chunk = 16 * 1024;
+		while (firstRead.size () < first.size () || secondRead.size () < second.size ())
+		{
+			const auto firstSize = firstRead.size ();
+			const auto secondSize = secondRead.size ();
+
+			if (firstRead.size () < first.size ())
+				firstRead += Read (firstDevice,
+						std::min (chunk, first.size () - firstRead.size ()),
+						{ &secondDevice });
+			if (secondRead.size () < second.size ())
+				secondRead += Read (secondDevice,
+						std::min (chunk, second.size () - secondRead.size ()),
+						{ &firstDevice });
+
+			if (firstRead.size () == firstSize && secondRead.size () == secondSize)
+				break;
+		}
+
+		QVERIFY (firstRead == first);
+		QVERIFY (secondRead == second);
+	}
+
+	void LiveStreamDeviceTest::testSeekKeepsOtherPieces ()
+	{
+		const auto& contents = Contents_ ["second.bin"];
+
+		// A piece of first.bin outside of the streamed file.
+		const auto& fs = TI_->files ();
+		const int otherPiece = fs.file_offset (GetFileIndex ("first.bin")) / PieceSize;
+		const auto secondIdx = GetFileIndex ("second.bin");
+		const int secondFirst = fs.file_offset (secondIdx) / PieceSize;
+		const int secondLast = (fs.file_offset (secondIdx) + fs.file_size (secondIdx) - 1) / PieceSize;
+		QVERIFY (otherPiece < secondFirst || otherPiece > secondLast);
+
+		LiveStreamDevice device { LeechHandle_, StatusKeeper_, secondIdx };
+
+		// Set after the device is created, so a snapshot restore would lose it.
+		LeechHandle_.piece_priority (otherPiece, 2);
+
+		QVERIFY (WaitReady ({ &device }));
+		QCOMPARE (LeechHandle_.piece_priority (otherPiece), 2);
+
+		const qint64 middle = contents.size () / 2;
+		QVERIFY (device.seek (middle));
+		QVERIFY (Read (device, 10 * 1024) == contents.mid (middle, 10 * 1024));
+		QVERIFY (device.seek (0));
+		QVERIFY (Read (device, 10 * 1024) == contents.left (10 * 1024));
+
+		QCOMPARE (LeechHandle_.piece_priority (otherPiece), 2);
+	}
+
+	int LiveStreamDeviceTest::GetFileIndex (const QString& name) const
+	{
+		const auto& files = LeechHandle_.torrent_file ()->files ();
+		for (int i = 0; i < files.num_files (); ++i)
+			if (QString::fromStdString (files.file_path (i)).endsWith (name))
+				return i;
+		return -1;
+	}
+
+	bool LiveStreamDeviceTest::WaitReady (const QList<LiveStreamDevice*>& devices)
+	{
+		int readyCount = 0;
+		for (const auto device : devices)
+		{
+			connect (device,
+					&LiveStreamDevice::ready,
+					[&readyCount] { ++readyCount; });
+			device->CheckReady ();
+		}
+
+		QElapsedTimer timer;
+		timer.start ();
+		while (readyCount < devices.size () && timer.elapsed () < Timeout)
+			PumpAlerts (devices);
+		return readyCount == devices.size ();
+	}
+
+	void LiveStreamDeviceTest::PumpAlerts (const QList<LiveStreamDevice*>& devices)
+	{
+		Leecher_->post_torrent_updates ();
+		Leecher_->wait_for_alert (std::chrono::milliseconds (50));
+
+		std::vector<libtorrent::alert*> alerts;
+		Leecher_->pop_alerts (&alerts);
+		for (const auto alert : alerts)
+			if (const auto update = libtorrent::alert_cast<libtorrent::state_update_alert> (alert))
+			{
+				for (const auto& status : update->status)
+					StatusKeeper_->HandleStatusUpdatePosted (status);
+			}
+			else if (const auto read = libtorrent::alert_cast<libtorrent::read_piece_alert> (alert))
+			{
+				for (const auto device : devices)
+					device->PieceRead (*read);
+			}
+			else if (const auto finished = libtorrent::alert_cast<libtorrent::piece_finished_alert> (alert))
+			{
+				for (const auto device : devices)
+					device->PieceFinished (*finished);
+			}
+
+		// The seeder's alerts aren't interesting, just don't let them pile up.
+		Seeder_->pop_alerts (&alerts);
+
+		QCoreApplication::processEvents ();
+	}
+
+	QByteArray LiveStreamDeviceTest::Read (LiveStreamDevice& device, qint64 count,
+			const QList<LiveStreamDevice*>& others)
+	{
+		QByteArray result;
+
+		QElapsedTimer timer;
+		timer.start ();
+		while (result.size () < count && timer.elapsed () < Timeout)
+		{
+			if (!device.bytesAvailable ())
+			{
+				PumpAlerts (QList<LiveStreamDevice*> { &device } + others);
+				continue;
+			}
+
+			result += device.read (count - result.size ());
+		}
+
+		return result;
+	}
+}
+}
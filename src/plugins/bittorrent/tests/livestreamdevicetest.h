@@ -0,0 +1,89 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTemporaryDir>
+#include <boost/shared_ptr.hpp>
+#include <libtorrent/session.hpp>
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_info.hpp>
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	class CachedStatusKeeper;
+	class LiveStreamDevice;
+
+	/** Streams a file of a multi-file torrent between two local
+	 * libtorrent sessions.
+	 *
+	 * The seeding session serves a generated torrent with several files
+	 * of random data, and the downloading session streams one of them
+	 * through LiveStreamDevice, reading and seeking while the torrent
+	 * is being downloaded. Each test starts with an empty download.
+	 */
+	class LiveStreamDeviceTest : public QObject
+	{
+		Q_OBJECT
+
+		QTemporaryDir SeedDir_;
+		std::unique_ptr<QTemporaryDir> LeechDir_;
+
+		boost::shared_ptr<libtorrent::torrent_info> TI_;
+		std::unique_ptr<libtorrent::session> Seeder_;
+		std::unique_ptr<libtorrent::session> Leecher_;
+		libtorrent::torrent_handle LeechHandle_;
+
+		CachedStatusKeeper *StatusKeeper_ = nullptr;
+
+		QHash<QString, QByteArray> Contents_;
+	private slots:
+		void initTestCase ();
+		void init ();
+		void cleanup ();
+		void cleanupTestCase ();
+
+		void testSeek ();
+		void testStreamFile ();
+		void testTwoDevices ();
+		void testSeekKeepsOtherPieces ();
+	private:
+		int GetFileIndex (const QString&) const;
+		bool WaitReady (const QList<LiveStreamDevice*>&);
+		void PumpAlerts (const QList<LiveStreamDevice*>&);
+		QByteArray Read (LiveStreamDevice&, qint64 count, const QList<LiveStreamDevice*>& others = {});
+	};
+}
+}
@@ -0,0 +1,162 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "rowindextest.h"
+#include <algorithm>
+#include <random>
+#include <QtTest>
+
+QTEST_GUILESS_MAIN (LeechCraft::BitTorrent::RowIndexTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		const int TorrentsCount = 10000;
+		const int AlertsCount = 10000;
+
+		// The number of bytes in a SHA-1 digest.
+		const int HashSize = 20;
+
+		libtorrent::sha1_hash MakeHash (std::mt19937& gen)
+		{
+			std::uniform_int_distribution<int> dist { 0, 255 };
+
+			libtorrent::sha1_hash hash;
+			for (int i = 0; i < HashSize; ++i)
+				hash [i] = dist (gen);
+			return hash;
+		}
+
+		void CheckConsistency (const InfoHashIndex& index, const QList<libtorrent::sha1_hash>& list)
+		{
+			QCOMPARE (index.GetSize (), list.size ());
+			for (int i = 0; i < list.size (); ++i)
+				QCOMPARE (index.Find (list.at (i)), i);
+		}
+	}
+
+	void RowIndexTest::initTestCase ()
+	{
+		std::mt19937 gen { 42 };
+
+		for (int i = 0; i < TorrentsCount; ++i)
+			Torrents_.append ({ MakeHash (gen) });
+
+		std::uniform_int_distribution<int> dist { 0, TorrentsCount - 1 };
+		for (int i = 0; i < AlertsCount; ++i)
+			Alerts_ << Torrents_.at (dist (gen)).Hash_;
+	}
+
+	void RowIndexTest::testAgainstList ()
+	{
+		std::mt19937 gen { 1 };
+
+		InfoHashIndex index;
+		QList<libtorrent::sha1_hash> list;
+
+		for (int i = 0; i < 100; ++i)
+		{
+			const auto& hash = MakeHash (gen);
+			index.Append (hash);
+			list << hash;
+		}
+		CheckConsistency (index, list);
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			std::uniform_int_distribution<int> rowDist { 0, list.size () - 1 };
+			const auto from = rowDist (gen);
+			const auto to = rowDist (gen);
+
+			switch (std::uniform_int_distribution<int> { 0, 3 } (gen))
+			{
+			case 0:
+			{
+				const auto& hash = MakeHash (gen);
+				index.Append (hash);
+				list << hash;
+				break;
+			}
+			case 1:
+				if (list.size () > 1)
+				{
+					index.Remove (from);
+					list.removeAt (from);
+				}
+				break;
+			case 2:
+				index.Move (from, to);
+				list.move (from, to);
+				break;
+			case 3:
+				index.Swap (from, to);
+				list.swap (from, to);
+				break;
+			}
+
+			CheckConsistency (index, list);
+		}
+
+		QCOMPARE (index.Find (MakeHash (gen)), -1);
+	}
+
+	void RowIndexTest::benchDispatchLinear ()
+	{
+		auto torrents = Torrents_;
+
+		QBENCHMARK
+		{
+			for (const auto& hash : Alerts_)
+			{
+				const auto pos = std::find_if (torrents.begin (), torrents.end (),
+						[&hash] (const FakeTorrent& torrent) { return torrent.Hash_ == hash; });
+				++pos->AlertsCount_;
+			}
+		}
+	}
+
+	void RowIndexTest::benchDispatchIndexed ()
+	{
+		auto torrents = Torrents_;
+
+		InfoHashIndex index;
+		for (const auto& torrent : torrents)
+			index.Append (torrent.Hash_);
+
+		QBENCHMARK
+		{
+			for (const auto& hash : Alerts_)
+				++torrents [index.Find (hash)].AlertsCount_;
+		}
+	}
+}
+}
@@ -0,0 +1,175 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+
+#include "collectionpaths.h"
+#include <algorithm>
+#include <QStringList>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	bool IsAtOrUnder (const QString& path, const QString& dir)
+	{
+		return path.startsWith (dir) &&
+				(path.size () == dir.size () || path.at (dir.size ()) == '/');
+	}
+
+	QString RebasePath (const QString& path, const QString& from, const QString& to)
+	{
+		return to + path.mid (from.size ());
+	}
+
+	QStringList GetPathsUnder (const QSet<QString>& paths, const QString& dir)
+	{
+		QStringList result;
+		for (const auto& path : paths)
+			if (IsAtOrUnder (path, dir))
+				result << path;
+		return result;
+	}
+
+	QHash<QString, QString> GetMovedPaths (const QSet<QString>& paths,
+			const QString& from, const QString& to)
+	{
+		QHash<QString, QString> result;
+		for (const auto& path : paths)
+			if (IsAtOrUnder (path, from))
+				result [path] = RebasePath (path, from, to);
+		return result;
+	}
+
+	void CollectionPathsQueue::AddDir (const QString& dir)
+	{
+		if (std::any_of (Dirs_.begin (), Dirs_.end (),
+				[&dir] (const QString& other) { return IsAtOrUnder (dir, other); }))
+			return;
+
+		const auto pos = std::remove_if (Dirs_.begin (), Dirs_.end (),
+				[&dir] (const QString& other) { return IsAtOrUnder (other, dir); });
+		Dirs_.erase (pos, Dirs_.end ());
+
+		for (auto filePos = Files_.begin (); filePos != Files_.end (); )
+			if (IsAtOrUnder (*filePos, dir))
+				filePos = Files_.erase (filePos);
+			else
+				++filePos;
+
+		Dirs_ << dir;
+	}
+
+	void CollectionPathsQueue::AddFile (const QString& file)
+	{
+		Removals_.remove (file);
+
+		if (std::none_of (Dirs_.begin (), Dirs_.end (),
+				[&file] (const QString& dir) { return IsAtOrUnder (file, dir); }))
+			Files_ << file;
+	}
+
+	void CollectionPathsQueue::AddRemoval (const QString& path)
+	{
+		Files_.remove (path);
+		Removals_ << path;
+	}
+
+	namespace
+	{
+		void Rebase (QList<QString>& paths, const QString& from, const QString& to)
+		{
+			for (auto& path : paths)
+				if (IsAtOrUnder (path, from))
+					path = RebasePath (path, from, to);
+		}
+
+		void Rebase (QSet<QString>& paths, const QString& from, const QString& to)
+		{
+			QSet<QString> rebased;
+			for (auto pos = paths.begin (); pos != paths.end (); )
+				if (IsAtOrUnder (*pos, from))
+				{
+					rebased << RebasePath (*pos, from, to);
+					pos = paths.erase (pos);
+				}
+				else
+					++pos;
+			paths += rebased;
+		}
+	}
+
+	void CollectionPathsQueue::Move (const QString& from, const QString& to)
+	{
+		Rebase (Dirs_, from, to);
+		Rebase (Files_, from, to);
+		Rebase (Removals_, from, to);
+	}
+
+	bool CollectionPathsQueue::HasDirs () const
+	{
+		return !Dirs_.isEmpty ();
+	}
+
+	QList<QString> CollectionPathsQueue::GetDirs () const
+	{
+		return Dirs_;
+	}
+
+	QSet<QString> CollectionPathsQueue::GetFiles () const
+	{
+		return Files_;
+	}
+
+	QSet<QString> CollectionPathsQueue::GetRemovals () const
+	{
+		return Removals_;
+	}
+
+	QList<QString> CollectionPathsQueue::TakeDirs ()
+	{
+		auto dirs = Dirs_;
+		Dirs_.clear ();
+		return dirs;
+	}
+
+	QSet<QString> CollectionPathsQueue::TakeFiles ()
+	{
+		auto files = Files_;
+		Files_.clear ();
+		return files;
+	}
+
+	QSet<QString> CollectionPathsQueue::TakeRemovals ()
+	{
+		auto removals = Removals_;
+		Removals_.clear ();
+		return removals;
+	}
+}
+}
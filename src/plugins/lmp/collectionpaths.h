@@ -0,0 +1,108 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** @brief Checks whether the \em path is the \em dir or lies under it.
+	 *
+	 * Unlike a bare prefix check, \em /music/ab is not under \em /music/a.
+	 */
+	bool IsAtOrUnder (const QString& path, const QString& dir);
+
+	/** @brief Returns the \em path under \em from moved to be under \em to.
+	 *
+	 * The \em path is expected to be at or under \em from.
+	 */
+	QString RebasePath (const QString& path, const QString& from, const QString& to);
+
+	/** @brief Returns the \em paths that are at or under the \em dir.
+	 */
+	QStringList GetPathsUnder (const QSet<QString>& paths, const QString& dir);
+
+	/** @brief Returns the new paths of the \em paths after the \em from
+	 * has been renamed to \em to.
+	 *
+	 * Only the paths at or under \em from are included, mapped from
+	 * their old values.
+	 */
+	QHash<QString, QString> GetMovedPaths (const QSet<QString>& paths,
+			const QString& from, const QString& to);
+
+	/** @brief The paths changed in the collection and waiting for a rescan.
+	 *
+	 * Directories cover the files and directories under them, so those
+	 * are not queued separately. Removals are kept apart, since they
+	 * are applied only if the paths are still gone by the time the
+	 * queue is processed.
+	 */
+	class CollectionPathsQueue
+	{
+		QList<QString> Dirs_;
+		QSet<QString> Files_;
+		QSet<QString> Removals_;
+	public:
+		/** @brief Queues the \em dir to be rescanned as a whole.
+		 */
+		void AddDir (const QString& dir);
+
+		/** @brief Queues the \em file to be resolved.
+		 */
+		void AddFile (const QString& file);
+
+		/** @brief Queues the \em path to be removed if it is still gone.
+		 */
+		void AddRemoval (const QString& path);
+
+		/** @brief Updates the queued paths after the \em from has been
+		 * renamed to \em to.
+		 */
+		void Move (const QString& from, const QString& to);
+
+		bool HasDirs () const;
+
+		QList<QString> GetDirs () const;
+		QSet<QString> GetFiles () const;
+		QSet<QString> GetRemovals () const;
+
+		QList<QString> TakeDirs ();
+		QSet<QString> TakeFiles ();
+		QSet<QString> TakeRemovals ();
+	};
+}
+}
@@ -0,0 +1,208 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "collectionscan.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <QDir>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const QStringList& GetNameFilters ()
+		{
+			static const QStringList nameFilters
+			{
+				"*.aiff",
+				"*.ape",
+				"*.asf",
+				"*.flac",
+				"*.m4a",
+				"*.mp3",
+				"*.mp4",
+				"*.mpc",
+				"*.mpeg",
+				"*.mpg",
+				"*.ogg",
+				"*.tta",
+				"*.wav",
+				"*.wma",
+				"*.wv",
+				"*.wvp"
+			};
+			return nameFilters;
+		}
+
+		QFileInfoList ListEntries (const QString& dirPath, bool followSymlinks)
+		{
+			auto filters = QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot;
+			if (!followSymlinks)
+				filters |= QDir::NoSymLinks;
+
+			auto list = QDir (dirPath).entryInfoList (GetNameFilters (), filters);
+			list.erase (std::remove_if (list.begin (), list.end (),
+						[] (const QFileInfo& entryInfo)
+						{
+							return entryInfo.isSymLink () &&
+									entryInfo.symLinkTarget () == entryInfo.absoluteFilePath ();
+						}),
+					list.end ());
+			return list;
+		}
+	}
+
+	bool IsMediaFile (const QString& path)
+	{
+		for (const auto& filter : GetNameFilters ())
+			if (path.endsWith (filter.mid (1), Qt::CaseInsensitive))
+				return true;
+
+		return false;
+	}
+
+	QList<QFileInfo> RecIterateInfo (const QString& dirPath, bool followSymlinks, std::atomic<bool> *stopFlag)
+	{
+		const QFileInfo dirInfo (dirPath);
+		if (dirInfo.isFile ())
+		{
+			if (IsMediaFile (dirPath))
+				return { dirInfo };
+
+			return {};
+		}
+
+		QList<QFileInfo> result;
+		for (const auto& entryInfo : ListEntries (dirPath, followSymlinks))
+		{
+			if (stopFlag && stopFlag->load (std::memory_order_relaxed))
+				return result;
+
+			if (entryInfo.isDir ())
+				result += RecIterateInfo (entryInfo.absoluteFilePath (), followSymlinks, stopFlag);
+			else if (entryInfo.isFile ())
+				result += entryInfo;
+		}
+
+		return result;
+	}
+
+	QList<QFileInfo> ParallelIterateInfo (const QString& dirPath, bool followSymlinks)
+	{
+		const QFileInfo dirInfo (dirPath);
+		if (dirInfo.isFile ())
+			return RecIterateInfo (dirPath, followSymlinks);
+
+		// Expand the tree breadth-first until there are enough subtrees
+		// to keep the pool busy (or until the tree turns out to be shallow),
+		// then walk the subtrees concurrently.
+		const auto targetDirs = std::max (QThreadPool::globalInstance ()->maxThreadCount (), 1) * 4;
+		const auto maxExpandDepth = 3;
+
+		QList<QFileInfo> result;
+		QStringList frontier { dirPath };
+		for (int depth = 0;
+				depth < maxExpandDepth && !frontier.isEmpty () && frontier.size () < targetDirs;
+				++depth)
+		{
+			QStringList nextFrontier;
+			for (const auto& dir : frontier)
+				for (const auto& entryInfo : ListEntries (dir, followSymlinks))
+				{
+					if (entryInfo.isDir ())
+						nextFrontier << entryInfo.absoluteFilePath ();
+					else if (entryInfo.isFile ())
+						result << entryInfo;
+				}
+			frontier = nextFrontier;
+		}
+
+		if (frontier.isEmpty ())
+			return result;
+
+		const std::function<QList<QFileInfo> (QString)> walker = [followSymlinks] (const QString& dir)
+				{
+					return RecIterateInfo (dir, followSymlinks);
+				};
+		for (const auto& subtree : QtConcurrent::blockingMapped (frontier, walker))
+			result += subtree;
+
+		return result;
+	}
+
+	FileStamp GetFileStamp (const QFileInfo& info)
+	{
+		return { info.lastModified (), info.size () };
+	}
+
+	ScanDiff DiffFiles (const QList<QFileInfo>& files, const FileStamps_t& stored)
+	{
+		ScanDiff result;
+		result.UnchangedFiles_.reserve (files.size ());
+
+		for (const auto& info : files)
+		{
+			const auto& path = info.absoluteFilePath ();
+
+			const auto pos = stored.find (path);
+			if (pos == stored.end ())
+			{
+				result.ChangedFiles_ << path;
+				continue;
+			}
+
+			const auto& current = GetFileStamp (info);
+			const auto& storedStamp = *pos;
+
+			const bool sameMTime = storedStamp.MTime_.isValid () &&
+					std::abs (storedStamp.MTime_.msecsTo (current.MTime_)) < 1500;
+			const bool knownSize = storedStamp.Size_ >= 0;
+			if (sameMTime && (!knownSize || storedStamp.Size_ == current.Size_))
+			{
+				result.UnchangedFiles_ << path;
+
+				// Backfill the size for the files stamped by older versions.
+				if (!knownSize)
+					result.UpdatedStamps_ [path] = current;
+				continue;
+			}
+
+			result.ChangedFiles_ << path;
+			result.UpdatedStamps_ [path] = current;
+		}
+
+		return result;
+	}
+}
+}
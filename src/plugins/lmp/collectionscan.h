@@ -0,0 +1,98 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** @brief Checks if the path has the extension of a supported
+	 * media file.
+	 */
+	bool IsMediaFile (const QString& path);
+
+	QList<QFileInfo> RecIterateInfo (const QString& dirPath,
+			bool followSymlinks = false, std::atomic<bool> *stopFlag = nullptr);
+
+	/** @brief Walks the media files under the dirPath in parallel.
+	 *
+	 * Returns the same set of files as RecIterateInfo(), but the
+	 * subdirectories are traversed on the global thread pool, and the
+	 * order of the returned entries is unspecified. The returned
+	 * QFileInfo objects already have their stat() data cached.
+	 */
+	QList<QFileInfo> ParallelIterateInfo (const QString& dirPath, bool followSymlinks = false);
+
+	/** @brief The on-disk state of a collection file as of the last scan.
+	 */
+	struct FileStamp
+	{
+		QDateTime MTime_;
+
+		/** Negative if unknown (for instance, stored by an older version).
+		 */
+		qint64 Size_ = -1;
+	};
+
+	using FileStamps_t = QHash<QString, FileStamp>;
+
+	FileStamp GetFileStamp (const QFileInfo&);
+
+	struct ScanDiff
+	{
+		QSet<QString> UnchangedFiles_;
+		QSet<QString> ChangedFiles_;
+
+		/** Stamps of the already known files that should be written
+		 * back to the storage.
+		 */
+		FileStamps_t UpdatedStamps_;
+	};
+
+	/** @brief Compares the walked files against the stored snapshot.
+	 *
+	 * A file is unchanged if it is present in the stored snapshot and
+	 * its mtime is within 1.5 seconds of the stored one (to account for
+	 * the filesystems with coarse timestamps) and its size matches the
+	 * stored one, if the latter is known.
+	 *
+	 * Files missing from the snapshot are considered to be new and are
+	 * reported as changed without updating their stamps, since they are
+	 * stamped when they are added to the collection.
+	 */
+	ScanDiff DiffFiles (const QList<QFileInfo>& files, const FileStamps_t& stored);
+}
+}
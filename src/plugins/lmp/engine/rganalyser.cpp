@@ -129,8 +129,14 @@ namespace LMP
 		gst_element_add_pad (SinkBin_, ghostPad);
 		gst_object_unref (pad);
 
+		// GST_PLAY_FLAG_AUDIO, playbin doesn't export its flags enum.
+		const gint playFlagAudio = 1 << 1;
+
 		g_object_set (GST_OBJECT (RGAnalysis_), "num-tracks", paths.size (), nullptr);
-		g_object_set (GST_OBJECT (Pipeline_), "audio-sink", SinkBin_, nullptr);
+		g_object_set (GST_OBJECT (Pipeline_),
+				"audio-sink", SinkBin_,
+				"flags", playFlagAudio,
+				nullptr);
 
 		CheckFinish ();
 
@@ -31,6 +31,7 @@
 #include <functional>
 #include <algorithm>
 #include <numeric>
+#include <QFileInfo>
 #include <QStandardItemModel>
 #include <QtConcurrentMap>
 #include <QtConcurrentRun>
@@ -50,6 +51,7 @@
 #include "xmlsettingsmanager.h"
 #include "localcollectionwatcher.h"
 #include "localcollectionmodel.h"
+#include "collectionpaths.h"
 
 namespace LeechCraft
 {
@@ -136,15 +138,6 @@ namespace LMP
 		RemoveRootPaths (RootPaths_);
 	}
 
-	namespace
-	{
-		struct IterateResult
-		{
-			QSet<QString> UnchangedFiles_;
-			QSet<QString> ChangedFiles_;
-		};
-	}
-
 	void LocalCollection::Scan (const QString& path, bool root)
 	{
 		if (root)
@@ -154,56 +147,39 @@ namespace LMP
 				.property ("FollowSymLinks").toBool ();
 		auto worker = [path, symLinks]
 		{
-			IterateResult result;
-
 			LocalCollectionStorage storage;
 
-			const auto& paths = storage.GetTracksPaths ();
-
-			const auto& allInfos = RecIterateInfo (path, symLinks);
-			for (const auto& info : allInfos)
+			FileStamps_t stored;
+			try
 			{
-				const auto& trackPath = info.absoluteFilePath ();
-				const auto& mtime = info.lastModified ();
-				try
-				{
-					const auto& storedDt = storage.GetMTime (trackPath);
-					if (storedDt.isValid () &&
-							std::abs (storedDt.msecsTo (mtime)) < 1500)
-					{
-						result.UnchangedFiles_ << trackPath;
-						continue;
-					}
-				}
-				catch (const std::exception& e)
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "error getting mtime"
-							<< trackPath
-							<< e.what ();
-				}
+				stored = storage.GetFileStamps (path);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error getting file stamps for"
+						<< path
+						<< e.what ();
+			}
 
-				if (paths.contains (trackPath))
-				{
-					try
-					{
-						storage.SetMTime (trackPath, mtime);
-					}
-					catch (const std::exception& e)
-					{
-						qWarning () << Q_FUNC_INFO
-								<< "error setting mtime"
-								<< trackPath
-								<< e.what ();
-					}
-				}
-				result.ChangedFiles_ << trackPath;
+			auto result = DiffFiles (ParallelIterateInfo (path, symLinks), stored);
+
+			try
+			{
+				storage.SetFileStamps (result.UpdatedStamps_);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error setting file stamps for"
+						<< path
+						<< e.what ();
 			}
 
 			return result;
 		};
 		Util::Sequence (this, QtConcurrent::run (worker)) >>
-				[this, path] (const IterateResult& result)
+				[this, path] (const ScanDiff& result)
 				{
 					CheckRemovedFiles (result.ChangedFiles_ + result.UnchangedFiles_, path);
 
@@ -249,6 +225,119 @@ namespace LMP
 			Scan (path, true);
 	}
 
+	void LocalCollection::RescanFiles (QSet<QString> paths)
+	{
+		for (auto pos = paths.begin (); pos != paths.end (); )
+			if (!IsMediaFile (*pos) || GetDirStatus (*pos) == DirStatus::None)
+				pos = paths.erase (pos);
+			else
+				++pos;
+
+		if (paths.isEmpty ())
+			return;
+
+		FileStamps_t stamps;
+		for (const auto& path : paths)
+			if (PresentPaths_.contains (path))
+				stamps [path] = GetFileStamp (QFileInfo { path });
+
+		try
+		{
+			Storage_->SetFileStamps (stamps);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error setting file stamps"
+					<< e.what ();
+		}
+
+		if (Watcher_->isRunning ())
+			NewPathsQueue_ << paths;
+		else
+			InitiateScan (paths);
+	}
+
+	void LocalCollection::RemovePath (const QString& path)
+	{
+		for (const auto& present : GetPathsUnder (PresentPaths_, path))
+			RemoveTrack (present);
+	}
+
+	bool LocalCollection::MovePath (const QString& from, const QString& to)
+	{
+		QHash<int, QString> newPaths;
+		const auto& moved = GetMovedPaths (PresentPaths_, from, to);
+		for (auto i = moved.begin (); i != moved.end (); ++i)
+		{
+			const auto trackId = FindTrack (i.key ());
+			if (trackId != -1)
+				newPaths [trackId] = i.value ();
+		}
+
+		if (newPaths.isEmpty ())
+			return false;
+
+		if (GetDirStatus (to) == DirStatus::None)
+		{
+			RemovePath (from);
+			return true;
+		}
+
+		for (auto i = newPaths.begin (); i != newPaths.end (); )
+		{
+			if (IsMediaFile (*i))
+			{
+				// The file might have been moved over an already known one.
+				RemoveTrack (*i);
+				++i;
+			}
+			else
+			{
+				RemoveTrack (Track2Path_ [i.key ()]);
+				i = newPaths.erase (i);
+			}
+		}
+
+		try
+		{
+			Storage_->SetTracksPaths (newPaths);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error moving tracks from"
+					<< from
+					<< "to"
+					<< to
+					<< e.what ();
+			return true;
+		}
+
+		for (auto i = newPaths.begin (); i != newPaths.end (); ++i)
+		{
+			const auto trackId = i.key ();
+			const auto& newPath = i.value ();
+
+			const auto& oldPath = Track2Path_.take (trackId);
+			Path2Track_.remove (oldPath);
+			PresentPaths_.remove (oldPath);
+
+			Track2Path_ [trackId] = newPath;
+			Path2Track_ [newPath] = trackId;
+			PresentPaths_ << newPath;
+
+			if (const auto& album = GetTrackAlbum (trackId))
+				for (auto& track : album->Tracks_)
+					if (track.ID_ == trackId)
+						track.FilePath_ = newPath;
+
+			CollectionModel_->SetTrackPath (trackId, newPath);
+		}
+
+		return true;
+	}
+
 	LocalCollection::DirStatus LocalCollection::GetDirStatus (const QString& dir) const
 	{
 		if (RootPaths_.contains (dir))
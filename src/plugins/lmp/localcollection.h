@@ -124,6 +124,23 @@ namespace LMP
 		void Unscan (const QString&);
 		void Rescan ();
 
+		/** Resolves the given changed or new files directly, without
+		 * rescanning their directories.
+		 */
+		void RescanFiles (QSet<QString>);
+
+		/** Removes the track at the given path or all the tracks under
+		 * it, if it is a directory.
+		 */
+		void RemovePath (const QString&);
+
+		/** Updates the paths of the tracks at or under the given path
+		 * after it has been renamed, keeping the tracks themselves.
+		 *
+		 * Returns false if there are no known tracks there.
+		 */
+		bool MovePath (const QString& from, const QString& to);
+
 		DirStatus GetDirStatus (const QString&) const;
 		QStringList GetDirs () const;
 
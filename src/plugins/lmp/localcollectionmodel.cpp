@@ -282,6 +282,12 @@ namespace LMP
 		item->parent ()->removeRow (item->row ());
 	}
 
+	void LocalCollectionModel::SetTrackPath (int id, const QString& path)
+	{
+		if (const auto item = Track2Item_.value (id))
+			item->setData (path, Role::TrackPath);
+	}
+
 	void LocalCollectionModel::RemoveAlbum (int id)
 	{
 		for (const auto item : Album2Item_.take (id))
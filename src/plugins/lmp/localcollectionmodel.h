@@ -91,6 +91,7 @@ namespace LMP
 		void IgnoreTrack (int);
 
 		void RemoveTrack (int);
+		void SetTrackPath (int, const QString&);
 		void RemoveAlbum (int);
 		void RemoveArtist (int);
 
@@ -31,6 +31,8 @@
 #include <stdexcept>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QDir>
 #include <QFileInfo>
 #include <QThread>
 #include <util/util.h>
@@ -154,7 +156,7 @@ namespace LMP
 					break;
 				}
 
-			SetMTime (info.LocalPath_, QFileInfo { info.LocalPath_ }.lastModified ());
+			SetFileStamp (info.LocalPath_, GetFileStamp (QFileInfo { info.LocalPath_ }));
 		}
 		lock.Good ();
 
@@ -269,6 +271,25 @@ namespace LMP
 		}
 	}
 
+	void LocalCollectionStorage::SetTracksPaths (const QHash<int, QString>& paths)
+	{
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (auto i = paths.begin (), end = paths.end (); i != end; ++i)
+		{
+			SetTrackPath_.bindValue (":track_id", i.key ());
+			SetTrackPath_.bindValue (":path", i.value ());
+			if (!SetTrackPath_.exec ())
+			{
+				Util::DBLock::DumpError (SetTrackPath_);
+				throw std::runtime_error ("cannot set track path");
+			}
+		}
+
+		lock.Good ();
+	}
+
 	void LocalCollectionStorage::RemoveAlbum (int id)
 	{
 		RemoveAlbum_.bindValue (":album_id", id);
@@ -366,26 +387,45 @@ namespace LMP
 		}
 	}
 
-	QDateTime LocalCollectionStorage::GetMTime (const QString& filepath)
+	FileStamps_t LocalCollectionStorage::GetFileStamps (const QString& root)
 	{
-		GetFileMTime_.bindValue (":filepath", filepath);
-		if (!GetFileMTime_.exec ())
+		// Paths under the root are exactly the ones in [root/, root0),
+		// which lets SQLite use the index on tracks.Path.
+		const auto& cleanRoot = QDir::cleanPath (root);
+		auto lower = cleanRoot;
+		if (!lower.endsWith ('/'))
+			lower += '/';
+		auto upper = lower;
+		upper [upper.size () - 1] = QChar { '/' + 1 };
+
+		GetFileStamps_.bindValue (":root", cleanRoot);
+		GetFileStamps_.bindValue (":lower", lower);
+		GetFileStamps_.bindValue (":upper", upper);
+		if (!GetFileStamps_.exec ())
 		{
-			Util::DBLock::DumpError (GetFileMTime_);
-			throw std::runtime_error ("cannot get file mtime");
+			Util::DBLock::DumpError (GetFileStamps_);
+			throw std::runtime_error ("cannot get file stamps");
 		}
 
-		const auto& result = GetFileMTime_.next () ?
-				GetFileMTime_.value (0).toDateTime () :
-				QDateTime ();
-		GetFileMTime_.finish ();
+		FileStamps_t result;
+		while (GetFileStamps_.next ())
+		{
+			const auto& size = GetFileStamps_.value (2);
+			result [GetFileStamps_.value (0).toString ()] =
+			{
+				GetFileStamps_.value (1).toDateTime (),
+				size.isNull () ? -1 : size.toLongLong ()
+			};
+		}
+		GetFileStamps_.finish ();
 		return result;
 	}
 
-	void LocalCollectionStorage::SetMTime (const QString& filepath, const QDateTime& mtime)
+	void LocalCollectionStorage::SetFileStamp (const QString& filepath, const FileStamp& stamp)
 	{
 		SetFileMTime_.bindValue (":filepath", filepath);
-		SetFileMTime_.bindValue (":mtime", mtime);
+		SetFileMTime_.bindValue (":mtime", stamp.MTime_);
+		SetFileMTime_.bindValue (":size", stamp.Size_ >= 0 ? QVariant { stamp.Size_ } : QVariant {});
 		if (!SetFileMTime_.exec ())
 		{
 			Util::DBLock::DumpError (SetFileMTime_);
@@ -393,6 +433,20 @@ namespace LMP
 		}
 	}
 
+	void LocalCollectionStorage::SetFileStamps (const FileStamps_t& stamps)
+	{
+		if (stamps.isEmpty ())
+			return;
+
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (auto i = stamps.begin (), end = stamps.end (); i != end; ++i)
+			SetFileStamp (i.key (), i.value ());
+
+		lock.Good ();
+	}
+
 	const int LovedStateID = 1;
 	const int BannedStateID = 2;
 
@@ -468,6 +522,20 @@ namespace LMP
 		}
 	}
 
+	void LocalCollectionStorage::SetRgTracksInfo (const QList<QPair<int, RGData>>& infos)
+	{
+		if (infos.isEmpty ())
+			return;
+
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (const auto& pair : infos)
+			SetRgTrackInfo (pair.first, pair.second);
+
+		lock.Good ();
+	}
+
 	RGData LocalCollectionStorage::GetRgTrackInfo (const QString& filepath)
 	{
 		GetTrackRgData_.bindValue (":filepath", filepath);
@@ -739,6 +807,9 @@ namespace LMP
 		RemoveTrack_ = QSqlQuery (DB_);
 		RemoveTrack_.prepare ("DELETE FROM tracks WHERE Id = :track_id;");
 
+		SetTrackPath_ = QSqlQuery (DB_);
+		SetTrackPath_.prepare ("UPDATE tracks SET Path = :path WHERE Id = :track_id;");
+
 		RemoveAlbum_ = QSqlQuery (DB_);
 		RemoveAlbum_.prepare ("DELETE FROM albums WHERE Id = :album_id;");
 
@@ -767,11 +838,13 @@ namespace LMP
 		GetFileIdMTime_ = QSqlQuery (DB_);
 		GetFileIdMTime_.prepare ("SELECT MTime FROM fileTimes WHERE fileTimes.TrackID = :track_id;");
 
-		GetFileMTime_ = QSqlQuery (DB_);
-		GetFileMTime_.prepare ("SELECT MTime FROM fileTimes, tracks WHERE tracks.Path = :filepath AND tracks.Id = fileTimes.TrackID;");
+		GetFileStamps_ = QSqlQuery (DB_);
+		GetFileStamps_.prepare ("SELECT tracks.Path, fileTimes.MTime, fileTimes.Size "
+				"FROM tracks LEFT OUTER JOIN fileTimes ON tracks.Id = fileTimes.TrackID "
+				"WHERE tracks.Path = :root OR (tracks.Path >= :lower AND tracks.Path < :upper);");
 
 		SetFileMTime_ = QSqlQuery (DB_);
-		SetFileMTime_.prepare ("INSERT OR REPLACE INTO fileTimes (TrackID, MTime) VALUES ((SELECT Id FROM tracks WHERE Path = :filepath), :mtime);");
+		SetFileMTime_.prepare ("INSERT OR REPLACE INTO fileTimes (TrackID, MTime, Size) VALUES ((SELECT Id FROM tracks WHERE Path = :filepath), :mtime, :size);");
 
 		GetLovedBanned_ = QSqlQuery (DB_);
 		GetLovedBanned_.prepare ("SELECT TrackId FROM lovedBanned WHERE State = :state;");
@@ -934,6 +1007,16 @@ namespace LMP
 
 		QSqlQuery (DB_).exec ("CREATE UNIQUE INDEX IF NOT EXISTS index_tracksPaths ON tracks (Path);");
 
+		if (!DB_.record ("fileTimes").contains ("Size"))
+		{
+			QSqlQuery q { DB_ };
+			if (!q.exec ("ALTER TABLE fileTimes ADD COLUMN Size INTEGER;"))
+			{
+				Util::DBLock::DumpError (q);
+				throw std::runtime_error ("cannot add file sizes to fileTimes");
+			}
+		}
+
 		lock.Good ();
 	}
 }
@@ -35,6 +35,7 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include "mediainfo.h"
+#include "collectionscan.h"
 #include "interfaces/lmp/collectiontypes.h"
 
 namespace LeechCraft
@@ -64,6 +65,7 @@ namespace LMP
 		QSqlQuery GetIgnoredTracks_;
 
 		QSqlQuery RemoveTrack_;
+		QSqlQuery SetTrackPath_;
 		QSqlQuery RemoveAlbum_;
 		QSqlQuery RemoveArtist_;
 
@@ -74,7 +76,7 @@ namespace LMP
 		QSqlQuery UpdateTrackStats_;
 
 		QSqlQuery GetFileIdMTime_;
-		QSqlQuery GetFileMTime_;
+		QSqlQuery GetFileStamps_;
 		QSqlQuery SetFileMTime_;
 
 		// 1 is loved, 2 is banned
@@ -112,6 +114,7 @@ namespace LMP
 		QList<int> GetIgnoredTracks ();
 
 		void RemoveTrack (int);
+		void SetTracksPaths (const QHash<int, QString>&);
 		void RemoveAlbum (int);
 		void RemoveArtist (int);
 
@@ -121,8 +124,13 @@ namespace LMP
 		void SetTrackStats (const Collection::TrackStats&);
 		void RecordTrackPlayed (int, const QDateTime&);
 
-		QDateTime GetMTime (const QString&);
-		void SetMTime (const QString&, const QDateTime&);
+		/** Returns the stamps of all the known tracks under the given
+		 * root path (or the track at that path, if it is a file). Tracks
+		 * that have never been stamped have invalid mtimes.
+		 */
+		FileStamps_t GetFileStamps (const QString& root);
+		void SetFileStamp (const QString&, const FileStamp&);
+		void SetFileStamps (const FileStamps_t&);
 
 		void SetTrackLoved (int);
 		void SetTrackBanned (int);
@@ -132,6 +140,7 @@ namespace LMP
 
 		QList<int> GetOutdatedRgTracks ();
 		void SetRgTrackInfo (int, const RGData&);
+		void SetRgTracksInfo (const QList<QPair<int, RGData>>&);
 		RGData GetRgTrackInfo (const QString&);
 	private:
 		void MarkLovedBanned (int, int);
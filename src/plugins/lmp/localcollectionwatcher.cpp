@@ -28,7 +28,7 @@
  **********************************************************************/
 
 #include "localcollectionwatcher.h"
-#include <algorithm>
+#include <QFileInfo>
 #include <QTimer>
 #include "core.h"
 #include "localcollection.h"
@@ -47,6 +47,18 @@ namespace LMP
 				SIGNAL (directoryChanged (QString)),
 				this,
 				SLOT (handleDirectoryChanged (QString)));
+		connect (Watcher_,
+				SIGNAL (fileChanged (QString)),
+				this,
+				SLOT (handleFileChanged (QString)));
+		connect (Watcher_,
+				SIGNAL (pathRemoved (QString)),
+				this,
+				SLOT (handlePathRemoved (QString)));
+		connect (Watcher_,
+				SIGNAL (pathMoved (QString, QString)),
+				this,
+				SLOT (handlePathMoved (QString, QString)));
 
 		ScanTimer_->setSingleShot (true);
 		connect (ScanTimer_,
@@ -65,34 +77,69 @@ namespace LMP
 		Watcher_->RemoveRoot (path);
 	}
 
-	void LocalCollectionWatcher::ScheduleDir (const QString& dir)
+	void LocalCollectionWatcher::RestartTimer ()
 	{
-		if (ScanTimer_->isActive ())
-			ScanTimer_->stop ();
-		ScanTimer_->start (5000);
+		// Single files (like the ones just retagged) are cheap to rescan,
+		// while directories are usually being filled for a while.
+		ScanTimer_->start (Queue_.HasDirs () ? 5000 : 1000);
+	}
 
-		if (std::any_of (ScheduledDirs_.begin (), ScheduledDirs_.end (),
-				[&dir] (const QString& other) { return dir.startsWith (other); }))
-			return;
+	void LocalCollectionWatcher::handleDirectoryChanged (const QString& path)
+	{
+		Queue_.AddDir (path);
+		RestartTimer ();
+	}
 
-		const auto pos = std::remove_if (ScheduledDirs_.begin (), ScheduledDirs_.end (),
-				[&dir] (const QString& other) { return other.startsWith (dir); });
-		ScheduledDirs_.erase (pos, ScheduledDirs_.end ());
+	void LocalCollectionWatcher::handleFileChanged (const QString& path)
+	{
+		Queue_.AddFile (path);
+		RestartTimer ();
+	}
+
+	void LocalCollectionWatcher::handlePathRemoved (const QString& path)
+	{
+		// Some editors save files by deleting and recreating them, so
+		// the removal is only applied if the path is still gone later.
+		Queue_.AddRemoval (path);
 
-		ScheduledDirs_ << dir;
+		RestartTimer ();
 	}
 
-	void LocalCollectionWatcher::handleDirectoryChanged (const QString& path)
+	void LocalCollectionWatcher::handlePathMoved (const QString& from, const QString& to)
 	{
-		ScheduleDir (path);
+		Queue_.Move (from, to);
+
+		if (Core::Instance ().GetLocalCollection ()->MovePath (from, to))
+			return;
+
+		if (QFileInfo { to }.isDir ())
+			Queue_.AddDir (to);
+		else
+			Queue_.AddFile (to);
+		RestartTimer ();
 	}
 
 	void LocalCollectionWatcher::rescanQueue ()
 	{
-		for (const auto& path : ScheduledDirs_)
-			Core::Instance ().GetLocalCollection ()->Scan (path, false);
+		const auto collection = Core::Instance ().GetLocalCollection ();
+
+		for (const auto& path : Queue_.TakeRemovals ())
+		{
+			const QFileInfo info { path };
+			if (!info.exists ())
+				collection->RemovePath (path);
+			else if (info.isDir ())
+				Queue_.AddDir (path);
+			else
+				Queue_.AddFile (path);
+		}
+
+		for (const auto& path : Queue_.TakeDirs ())
+			collection->Scan (path, false);
+
+		collection->RescanFiles (Queue_.TakeFiles ());
 
-		ScheduledDirs_.clear ();
+		ScanTimer_->stop ();
 	}
 }
 }
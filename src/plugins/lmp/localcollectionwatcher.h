@@ -33,6 +33,7 @@
 #include <QHash>
 #include <QSet>
 #include <QStringList>
+#include "collectionpaths.h"
 
 class QFileSystemWatcher;
 class QTimer;
@@ -49,7 +50,7 @@ namespace LMP
 
 		RecursiveDirWatcher * const Watcher_;
 
-		QList<QString> ScheduledDirs_;
+		CollectionPathsQueue Queue_;
 		QTimer * const ScanTimer_;
 	public:
 		LocalCollectionWatcher (QObject* = nullptr);
@@ -57,9 +58,12 @@ namespace LMP
 		void AddPath (const QString&);
 		void RemovePath (const QString&);
 	private:
-		void ScheduleDir (const QString&);
+		void RestartTimer ();
 	private slots:
 		void handleDirectoryChanged (const QString&);
+		void handleFileChanged (const QString&);
+		void handlePathRemoved (const QString&);
+		void handlePathMoved (const QString&, const QString&);
 		void rescanQueue ();
 	};
 }
@@ -29,8 +29,10 @@
 
 #include "recursivedirwatcher.h"
 
-#ifdef Q_OS_MAC
+#if defined (Q_OS_MAC)
 #include "recursivedirwatcher_mac.h"
+#elif defined (Q_OS_LINUX)
+#include "recursivedirwatcher_inotify.h"
 #else
 #include "recursivedirwatcher_generic.h"
 #endif
@@ -47,6 +49,20 @@ namespace LMP
 				SIGNAL (directoryChanged (QString)),
 				this,
 				SIGNAL (directoryChanged (QString)));
+#ifdef Q_OS_LINUX
+		connect (Impl_,
+				SIGNAL (fileChanged (QString)),
+				this,
+				SIGNAL (fileChanged (QString)));
+		connect (Impl_,
+				SIGNAL (pathRemoved (QString)),
+				this,
+				SIGNAL (pathRemoved (QString)));
+		connect (Impl_,
+				SIGNAL (pathMoved (QString, QString)),
+				this,
+				SIGNAL (pathMoved (QString, QString)));
+#endif
 	}
 
 	void RecursiveDirWatcher::AddRoot (const QString& root)
@@ -49,6 +49,26 @@ namespace LMP
 		void RemoveRoot (const QString&);
 	signals:
 		void directoryChanged (const QString&);
+
+		/* The signals below are only emitted by the backends that
+		 * track individual files (currently the inotify one). Other
+		 * backends report everything via directoryChanged().
+		 */
+
+		/** Emitted when a file has been written to or has appeared in
+		 * a watched directory.
+		 */
+		void fileChanged (const QString& path);
+
+		/** Emitted when a file or a directory has been removed or moved
+		 * out of the watched trees.
+		 */
+		void pathRemoved (const QString& path);
+
+		/** Emitted when a file or a directory has been renamed within
+		 * the watched trees.
+		 */
+		void pathMoved (const QString& from, const QString& to);
 	};
 }
 }
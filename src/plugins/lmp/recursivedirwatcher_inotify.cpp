@@ -0,0 +1,309 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "recursivedirwatcher_inotify.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QtConcurrentRun>
+#include <QtDebug>
+#include <util/threads/futures.h>
+#include "collectionpaths.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const uint32_t WatchMask = IN_CLOSE_WRITE |
+				IN_CREATE |
+				IN_DELETE |
+				IN_MOVED_FROM |
+				IN_MOVED_TO |
+				IN_ONLYDIR;
+
+		struct WatchResult
+		{
+			QList<QPair<int, QString>> Watches_;
+			bool LimitReached_ = false;
+		};
+
+		void AddWatchesRec (int fd, const QString& path, WatchResult& result)
+		{
+			const auto wd = inotify_add_watch (fd, QFile::encodeName (path).constData (), WatchMask);
+			if (wd < 0)
+			{
+				if (errno == ENOSPC)
+					result.LimitReached_ = true;
+				else
+					qWarning () << Q_FUNC_INFO
+							<< "cannot watch"
+							<< path
+							<< std::strerror (errno);
+				return;
+			}
+
+			result.Watches_.append ({ wd, path });
+
+			QDir dir { path };
+			for (const auto& item : dir.entryList (QDir::Dirs | QDir::NoDotAndDotDot))
+				AddWatchesRec (fd, dir.filePath (item), result);
+		}
+
+		WatchResult AddWatchesRec (int fd, const QString& path)
+		{
+			WatchResult result;
+			AddWatchesRec (fd, path, result);
+			return result;
+		}
+	}
+
+	RecursiveDirWatcherImpl::RecursiveDirWatcherImpl (QObject *parent)
+	: QObject { parent }
+	, Fd_ { inotify_init1 (IN_NONBLOCK | IN_CLOEXEC) }
+	, FdGuard_ { nullptr, [fd = Fd_] (void*) { if (fd >= 0) close (fd); } }
+	{
+		if (Fd_ < 0)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "cannot initialize inotify:"
+					<< std::strerror (errno);
+			return;
+		}
+
+		const auto notifier = new QSocketNotifier { Fd_, QSocketNotifier::Read, this };
+		connect (notifier,
+				SIGNAL (activated (int)),
+				this,
+				SLOT (readEvents ()));
+	}
+
+	void RecursiveDirWatcherImpl::AddRoot (const QString& rawRoot)
+	{
+		if (Fd_ < 0)
+			return;
+
+		const auto& root = QDir::cleanPath (rawRoot);
+		Roots_ << root;
+
+		qDebug () << Q_FUNC_INFO << "scanning" << root;
+		const auto fd = Fd_;
+		const auto fdGuard = FdGuard_;
+		Util::Sequence (this, QtConcurrent::run ([fd, fdGuard, root] { return AddWatchesRec (fd, root); })) >>
+				[this, root] (const WatchResult& result)
+				{
+					if (!Roots_.contains (root))
+					{
+						for (const auto& pair : result.Watches_)
+							if (!WD2Dir_.contains (pair.first))
+								inotify_rm_watch (Fd_, pair.first);
+						return;
+					}
+
+					RegisterWatches (result.Watches_, result.LimitReached_);
+				};
+	}
+
+	void RecursiveDirWatcherImpl::RemoveRoot (const QString& rawRoot)
+	{
+		const auto& root = QDir::cleanPath (rawRoot);
+		Roots_.removeAll (root);
+		RemoveWatches (root);
+	}
+
+	void RecursiveDirWatcherImpl::AddWatches (const QString& dir)
+	{
+		const auto& result = AddWatchesRec (Fd_, dir);
+		RegisterWatches (result.Watches_, result.LimitReached_);
+	}
+
+	void RecursiveDirWatcherImpl::RegisterWatches (const QList<QPair<int, QString>>& watches, bool limitReached)
+	{
+		for (const auto& pair : watches)
+		{
+			WD2Dir_ [pair.first] = pair.second;
+			Dir2WD_ [pair.second] = pair.first;
+		}
+
+		if (limitReached && !LimitReported_)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "inotify watches limit reached, some directories won't be watched;"
+					<< "consider raising fs.inotify.max_user_watches";
+			LimitReported_ = true;
+		}
+	}
+
+	void RecursiveDirWatcherImpl::ForgetWatch (int wd)
+	{
+		const auto& dir = WD2Dir_.take (wd);
+		if (Dir2WD_.value (dir, -1) == wd)
+			Dir2WD_.remove (dir);
+	}
+
+	void RecursiveDirWatcherImpl::RemoveWatches (const QString& dir)
+	{
+		for (auto i = Dir2WD_.begin (); i != Dir2WD_.end (); )
+			if (IsAtOrUnder (i.key (), dir))
+			{
+				inotify_rm_watch (Fd_, *i);
+				WD2Dir_.remove (*i);
+				i = Dir2WD_.erase (i);
+			}
+			else
+				++i;
+	}
+
+	void RecursiveDirWatcherImpl::RenameWatches (const QString& from, const QString& to)
+	{
+		QHash<QString, int> renamed;
+		for (auto i = Dir2WD_.begin (); i != Dir2WD_.end (); )
+			if (IsAtOrUnder (i.key (), from))
+			{
+				renamed [RebasePath (i.key (), from, to)] = *i;
+				i = Dir2WD_.erase (i);
+			}
+			else
+				++i;
+
+		for (auto i = renamed.begin (); i != renamed.end (); ++i)
+		{
+			Dir2WD_ [i.key ()] = *i;
+			WD2Dir_ [*i] = i.key ();
+		}
+	}
+
+	void RecursiveDirWatcherImpl::HandleEvent (const inotify_event& event)
+	{
+		if (event.mask & IN_Q_OVERFLOW)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "inotify queue overflow, rescanning the roots";
+			for (const auto& root : Roots_)
+				emit directoryChanged (root);
+			return;
+		}
+
+		if (event.mask & IN_IGNORED)
+		{
+			ForgetWatch (event.wd);
+			return;
+		}
+
+		const auto& dir = WD2Dir_.value (event.wd);
+		if (dir.isEmpty () || !event.len)
+			return;
+
+		const auto& path = dir + '/' + QFile::decodeName (event.name);
+		const bool isDir = event.mask & IN_ISDIR;
+
+		if (event.mask & IN_MOVED_FROM)
+			PendingMoves_ [event.cookie] = { path, isDir };
+		else if (event.mask & IN_MOVED_TO)
+		{
+			if (PendingMoves_.contains (event.cookie))
+			{
+				const auto& from = PendingMoves_.take (event.cookie).Path_;
+				if (isDir)
+					RenameWatches (from, path);
+				emit pathMoved (from, path);
+			}
+			else if (isDir)
+			{
+				AddWatches (path);
+				emit directoryChanged (path);
+			}
+			else
+				emit fileChanged (path);
+		}
+		else if (event.mask & IN_CREATE)
+		{
+			// Files are reported once they are closed after writing.
+			if (isDir)
+			{
+				AddWatches (path);
+				emit directoryChanged (path);
+			}
+		}
+		else if (event.mask & IN_CLOSE_WRITE)
+			emit fileChanged (path);
+		else if (event.mask & IN_DELETE)
+			emit pathRemoved (path);
+	}
+
+	void RecursiveDirWatcherImpl::FlushPendingMoves ()
+	{
+		// Both halves of a rename within the watched trees practically
+		// always come in the same batch, so what's left has been moved
+		// out of them. If that's wrong, the other half is just scanned
+		// as a new path.
+		for (const auto& move : PendingMoves_)
+		{
+			if (move.IsDir_)
+				RemoveWatches (move.Path_);
+			emit pathRemoved (move.Path_);
+		}
+		PendingMoves_.clear ();
+	}
+
+	void RecursiveDirWatcherImpl::readEvents ()
+	{
+		alignas (inotify_event) char buffer [64 * 1024];
+
+		while (true)
+		{
+			const auto length = read (Fd_, buffer, sizeof (buffer));
+			if (length < 0 && errno == EINTR)
+				continue;
+			if (length <= 0)
+			{
+				if (length < 0 && errno != EAGAIN)
+					qWarning () << Q_FUNC_INFO
+							<< "error reading inotify events:"
+							<< std::strerror (errno);
+				break;
+			}
+
+			for (auto ptr = buffer; ptr < buffer + length; )
+			{
+				const auto event = reinterpret_cast<const inotify_event*> (ptr);
+				HandleEvent (*event);
+				ptr += sizeof (inotify_event) + event->len;
+			}
+		}
+
+		FlushPendingMoves ();
+	}
+}
+}
@@ -0,0 +1,89 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+
+struct inotify_event;
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	class RecursiveDirWatcherImpl : public QObject
+	{
+		Q_OBJECT
+
+		const int Fd_;
+		/** Closes the Fd_ once both this object and the watch scans
+		 * running in the thread pool are done with it.
+		 */
+		const std::shared_ptr<void> FdGuard_;
+
+		QStringList Roots_;
+		QHash<int, QString> WD2Dir_;
+		QHash<QString, int> Dir2WD_;
+
+		struct PendingMove
+		{
+			QString Path_;
+			bool IsDir_;
+		};
+		QHash<quint32, PendingMove> PendingMoves_;
+
+		bool LimitReported_ = false;
+	public:
+		RecursiveDirWatcherImpl (QObject*);
+
+		void AddRoot (const QString&);
+		void RemoveRoot (const QString&);
+	private:
+		void AddWatches (const QString&);
+		void RegisterWatches (const QList<QPair<int, QString>>&, bool limitReached);
+		void ForgetWatch (int);
+		void RemoveWatches (const QString&);
+		void RenameWatches (const QString&, const QString&);
+
+		void HandleEvent (const inotify_event&);
+		void FlushPendingMoves ();
+	private slots:
+		void readEvents ();
+	signals:
+		void directoryChanged (const QString&);
+
+		void fileChanged (const QString&);
+		void pathRemoved (const QString&);
+		void pathMoved (const QString& from, const QString& to);
+	};
+}
+}
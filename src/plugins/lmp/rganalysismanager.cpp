@@ -28,10 +28,11 @@
  **********************************************************************/
 
 #include "rganalysismanager.h"
+#include <algorithm>
+#include <QThread>
 #include "localcollection.h"
 #include "localcollectionstorage.h"
 #include "engine/rganalyser.h"
-#include "engine/rgfilter.h"
 #include "xmlsettingsmanager.h"
 
 namespace LeechCraft
@@ -51,18 +52,64 @@ namespace LMP
 				this, "handleScanFinished");
 	}
 
+	RgAnalysisManager::~RgAnalysisManager ()
+	{
+		try
+		{
+			FlushResults ();
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to save ReplayGain data:"
+					<< e.what ();
+		}
+	}
+
 	namespace
 	{
 		bool IsScanAllowed ()
 		{
 			return XmlSettingsManager::Instance ().property ("AutobuildRG").toBool ();
 		}
+
+		int GetMaxAnalysers ()
+		{
+			const auto configured = XmlSettingsManager::Instance ()
+					.property ("RgAnalysisJobs").toInt ();
+			if (configured > 0)
+				return configured;
+
+			// Leave a core for the playback, and don't have too many
+			// pipelines fight for the disk.
+			return std::max (1, std::min (QThread::idealThreadCount () - 1, 8));
+		}
+
+		const int ResultsBatchSize = 256;
+	}
+
+	void RgAnalysisManager::FlushResults ()
+	{
+		const auto results = PendingResults_;
+		PendingResults_.clear ();
+
+		for (const auto albumId : PendingResultsAlbums_)
+			PendingAlbums_.remove (albumId);
+		PendingResultsAlbums_.clear ();
+
+		Coll_->GetStorage ()->SetRgTracksInfo (results);
 	}
 
 	void RgAnalysisManager::handleAnalysed ()
 	{
-		const auto& result = CurrentAnalyser_->GetResult ();
+		const auto analyser = static_cast<RgAnalyser*> (sender ());
+		if (!Analyser2Album_.contains (analyser))
+			return;
 
+		PendingResultsAlbums_ << Analyser2Album_.take (analyser);
+		analyser->deleteLater ();
+
+		const auto& result = analyser->GetResult ();
 		for (const auto& track : result.Tracks_)
 		{
 			const auto id = Coll_->FindTrack (track.TrackPath_);
@@ -74,39 +121,65 @@ namespace LMP
 				continue;
 			}
 
-			Coll_->GetStorage ()->SetRgTrackInfo (id,
+			PendingResults_.append ({
+					id,
 					{
 						track.TrackGain_,
 						track.TrackPeak_,
 						result.AlbumGain_,
 						result.AlbumPeak_
-					});
+					}
+				});
+		}
+
+		if (PendingResults_.size () >= ResultsBatchSize ||
+				(Analyser2Album_.isEmpty () && AlbumsQueue_.isEmpty ()))
+		{
+			try
+			{
+				FlushResults ();
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to save ReplayGain data:"
+						<< e.what ();
+			}
 		}
 
-		CurrentAnalyser_.reset ();
 		rotateQueue ();
 	}
 
 	void RgAnalysisManager::rotateQueue ()
 	{
-		if (AlbumsQueue_.isEmpty ())
-			return;
-
 		if (!IsScanAllowed ())
 		{
 			AlbumsQueue_.clear ();
+			PendingAlbums_.clear ();
 			return;
 		}
 
-		QStringList paths;
-		for (const auto& track : AlbumsQueue_.takeFirst ()->Tracks_)
-			paths << track.FilePath_;
+		const auto maxAnalysers = GetMaxAnalysers ();
+		while (Analyser2Album_.size () < maxAnalysers && !AlbumsQueue_.isEmpty ())
+		{
+			const auto album = AlbumsQueue_.takeFirst ();
 
-		CurrentAnalyser_ = std::make_shared<RgAnalyser> (paths);
-		connect (CurrentAnalyser_.get (),
-				SIGNAL (finished ()),
-				this,
-				SLOT (handleAnalysed ()));
+			QStringList paths;
+			for (const auto& track : album->Tracks_)
+				paths << track.FilePath_;
+			if (paths.isEmpty ())
+			{
+				PendingAlbums_.remove (album->ID_);
+				continue;
+			}
+
+			const auto analyser = new RgAnalyser { paths, this };
+			connect (analyser,
+					SIGNAL (finished ()),
+					this,
+					SLOT (handleAnalysed ()));
+			Analyser2Album_ [analyser] = album->ID_;
+		}
 	}
 
 	void RgAnalysisManager::handleScanFinished ()
@@ -119,16 +192,21 @@ namespace LMP
 		for (const auto track : Coll_->GetStorage ()->GetOutdatedRgTracks ())
 			albums << Coll_->GetTrackAlbumId (track);
 
-		const bool wasEmpty = AlbumsQueue_.isEmpty ();
-
 		for (auto albumId : albums)
+		{
+			if (PendingAlbums_.contains (albumId))
+				continue;
+
 			if (const auto& album = Coll_->GetAlbum (albumId))
+			{
 				AlbumsQueue_ << album;
+				PendingAlbums_ << albumId;
+			}
+		}
 
 		qDebug () << AlbumsQueue_.size ()
 				<< "albums to rescan";
-		if (wasEmpty)
-			rotateQueue ();
+		rotateQueue ();
 	}
 }
 }
@@ -30,8 +30,10 @@
 #pragma once
 
 #include <QObject>
+#include <QHash>
 #include <QSet>
 #include "interfaces/lmp/collectiontypes.h"
+#include "engine/rgfilter.h"
 
 namespace LeechCraft
 {
@@ -40,17 +42,36 @@ namespace LMP
 	class RgAnalyser;
 	class LocalCollection;
 
+	/** Keeps the ReplayGain data of the local collection up to date.
+	 *
+	 * Albums with outdated data are analysed by a pool of concurrent
+	 * pipelines, one album per pipeline, so that the album gain is
+	 * computed as soon as all the tracks of the album are done. The
+	 * results are written to the storage in batches. Since the outdated
+	 * tracks are looked up in the storage, an interrupted analysis is
+	 * resumed after the next collection scan.
+	 */
 	class RgAnalysisManager : public QObject
 	{
 		Q_OBJECT
 
 		LocalCollection * const Coll_;
 
-		std::shared_ptr<RgAnalyser> CurrentAnalyser_;
+		QHash<RgAnalyser*, int> Analyser2Album_;
 
 		QList<Collection::Album_ptr> AlbumsQueue_;
+
+		// Albums that are queued, being analysed or whose results
+		// aren't saved yet, and thus still look outdated in the storage.
+		QSet<int> PendingAlbums_;
+
+		QList<QPair<int, RGData>> PendingResults_;
+		QList<int> PendingResultsAlbums_;
 	public:
 		RgAnalysisManager (LocalCollection *coll, QObject* = nullptr);
+		~RgAnalysisManager ();
+	private:
+		void FlushResults ();
 	private slots:
 		void handleAnalysed ();
 		void rotateQueue ();
@@ -0,0 +1,177 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+
+#include "collectionpathstest.h"
+#include <QtTest>
+#include "collectionpaths.cpp"
+
+QTEST_GUILESS_MAIN (LeechCraft::LMP::CollectionPathsTest)
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		QSet<QString> MakeCollection ()
+		{
+			return
+			{
+				"/music/a/1.mp3",
+				"/music/a/2.mp3",
+				"/music/a/sub/3.mp3",
+				"/music/ab/4.mp3",
+				"/music/b/5.mp3"
+			};
+		}
+
+		QStringList GetSortedPathsUnder (const QSet<QString>& paths, const QString& dir)
+		{
+			auto result = GetPathsUnder (paths, dir);
+			result.sort ();
+			return result;
+		}
+	}
+
+	void CollectionPathsTest::testIsAtOrUnder ()
+	{
+		QVERIFY (IsAtOrUnder ("/music/a", "/music/a"));
+		QVERIFY (IsAtOrUnder ("/music/a/1.mp3", "/music/a"));
+		QVERIFY (!IsAtOrUnder ("/music/ab", "/music/a"));
+		QVERIFY (!IsAtOrUnder ("/music/ab/4.mp3", "/music/a"));
+		QVERIFY (!IsAtOrUnder ("/music", "/music/a"));
+	}
+
+	void CollectionPathsTest::testRemovePathSelection ()
+	{
+		const auto& collection = MakeCollection ();
+
+		QCOMPARE (GetSortedPathsUnder (collection, "/music/a"),
+				(QStringList { "/music/a/1.mp3", "/music/a/2.mp3", "/music/a/sub/3.mp3" }));
+		QCOMPARE (GetSortedPathsUnder (collection, "/music/a/1.mp3"),
+				QStringList { "/music/a/1.mp3" });
+		QVERIFY (GetPathsUnder (collection, "/music/c").isEmpty ());
+	}
+
+	void CollectionPathsTest::testMovePathSelection ()
+	{
+		const auto& collection = MakeCollection ();
+
+		const auto& dirMoved = GetMovedPaths (collection, "/music/a", "/music/z");
+		QCOMPARE (dirMoved.size (), 3);
+		QCOMPARE (dirMoved.value ("/music/a/1.mp3"), QString { "/music/z/1.mp3" });
+		QCOMPARE (dirMoved.value ("/music/a/sub/3.mp3"), QString { "/music/z/sub/3.mp3" });
+		QVERIFY (!dirMoved.contains ("/music/ab/4.mp3"));
+
+		const auto& fileMoved = GetMovedPaths (collection, "/music/b/5.mp3", "/music/b/6.mp3");
+		QCOMPARE (fileMoved.size (), 1);
+		QCOMPARE (fileMoved.value ("/music/b/5.mp3"), QString { "/music/b/6.mp3" });
+
+		QVERIFY (GetMovedPaths (collection, "/music/c", "/music/d").isEmpty ());
+	}
+
+	void CollectionPathsTest::testDirCoversNested ()
+	{
+		CollectionPathsQueue queue;
+		queue.AddDir ("/music/a/sub");
+		queue.AddFile ("/music/a/1.mp3");
+		queue.AddDir ("/music/a");
+
+		QCOMPARE (queue.GetDirs (), QList<QString> { "/music/a" });
+		QVERIFY (queue.GetFiles ().isEmpty ());
+
+		queue.AddDir ("/music/a/other");
+		queue.AddFile ("/music/a/2.mp3");
+		QCOMPARE (queue.GetDirs (), QList<QString> { "/music/a" });
+		QVERIFY (queue.GetFiles ().isEmpty ());
+	}
+
+	void CollectionPathsTest::testDirSiblingPrefix ()
+	{
+		CollectionPathsQueue queue;
+		queue.AddDir ("/music/a");
+		queue.AddDir ("/music/ab");
+		queue.AddFile ("/music/ab/4.mp3");
+
+		QCOMPARE (queue.GetDirs (), (QList<QString> { "/music/a", "/music/ab" }));
+		QVERIFY (queue.GetFiles ().isEmpty ());
+
+		CollectionPathsQueue other;
+		other.AddFile ("/music/ab/4.mp3");
+		other.AddDir ("/music/a");
+		QCOMPARE (other.GetFiles (), QSet<QString> { "/music/ab/4.mp3" });
+	}
+
+	void CollectionPathsTest::testFileAndRemovalCancel ()
+	{
+		CollectionPathsQueue queue;
+		queue.AddFile ("/music/a/1.mp3");
+		queue.AddRemoval ("/music/a/1.mp3");
+		QVERIFY (queue.GetFiles ().isEmpty ());
+		QCOMPARE (queue.GetRemovals (), QSet<QString> { "/music/a/1.mp3" });
+
+		queue.AddFile ("/music/a/1.mp3");
+		QCOMPARE (queue.GetFiles (), QSet<QString> { "/music/a/1.mp3" });
+		QVERIFY (queue.GetRemovals ().isEmpty ());
+	}
+
+	void CollectionPathsTest::testMoveRebasesQueue ()
+	{
+		CollectionPathsQueue queue;
+		queue.AddDir ("/music/a/sub");
+		queue.AddFile ("/music/a/1.mp3");
+		queue.AddFile ("/music/ab/4.mp3");
+		queue.AddRemoval ("/music/a/2.mp3");
+
+		queue.Move ("/music/a", "/music/z");
+
+		QCOMPARE (queue.GetDirs (), QList<QString> { "/music/z/sub" });
+		QCOMPARE (queue.GetFiles (), (QSet<QString> { "/music/z/1.mp3", "/music/ab/4.mp3" }));
+		QCOMPARE (queue.GetRemovals (), QSet<QString> { "/music/z/2.mp3" });
+	}
+
+	void CollectionPathsTest::testTakeEmpties ()
+	{
+		CollectionPathsQueue queue;
+		queue.AddDir ("/music/a");
+		queue.AddFile ("/music/b/5.mp3");
+		queue.AddRemoval ("/music/c");
+
+		QCOMPARE (queue.TakeRemovals (), QSet<QString> { "/music/c" });
+		QCOMPARE (queue.TakeDirs (), QList<QString> { "/music/a" });
+		QVERIFY (!queue.HasDirs ());
+		QCOMPARE (queue.TakeFiles (), QSet<QString> { "/music/b/5.mp3" });
+
+		QVERIFY (queue.GetDirs ().isEmpty ());
+		QVERIFY (queue.GetFiles ().isEmpty ());
+		QVERIFY (queue.GetRemovals ().isEmpty ());
+	}
+}
+}
@@ -0,0 +1,160 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "collectionscan_bench.h"
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include "collectionscan.cpp"
+
+QTEST_GUILESS_MAIN (LeechCraft::LMP::CollectionScan_Bench)
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		/** Lays out artists/albums/tracks like a typical collection, with
+		 * a cover and a playlist (which are not media files) per album.
+		 */
+		bool MakeTree (const QString& root)
+		{
+			const int artistsCount = 100;
+			const int albumsCount = 10;
+			const int tracksCount = 12;
+
+			const QStringList extensions { "mp3", "flac", "ogg" };
+
+			for (int artist = 0; artist < artistsCount; ++artist)
+				for (int album = 0; album < albumsCount; ++album)
+				{
+					const auto& albumPath = QString { "%1/Artist %2/%3 - Album %4" }
+							.arg (root)
+							.arg (artist)
+							.arg (2000 + album)
+							.arg (album);
+					if (!QDir::root ().mkpath (albumPath))
+						return false;
+
+					QStringList names { "cover.jpg", "album.m3u" };
+					for (int track = 0; track < tracksCount; ++track)
+						names << QString { "%1 - Track %2.%3" }
+								.arg (track + 1, 2, 10, QChar { '0' })
+								.arg (track)
+								.arg (extensions [artist % extensions.size ()]);
+
+					for (const auto& name : names)
+					{
+						QFile file { albumPath + '/' + name };
+						if (!file.open (QIODevice::WriteOnly) ||
+								file.write (name.toUtf8 ()) < 0)
+							return false;
+					}
+				}
+
+			return true;
+		}
+
+		QSet<QString> GetPaths (const QList<QFileInfo>& infos)
+		{
+			QSet<QString> result;
+			for (const auto& info : infos)
+				result << info.absoluteFilePath ();
+			return result;
+		}
+
+		FileStamps_t GetStamps (const QList<QFileInfo>& infos)
+		{
+			FileStamps_t result;
+			for (const auto& info : infos)
+				result [info.absoluteFilePath ()] = GetFileStamp (info);
+			return result;
+		}
+	}
+
+	void CollectionScan_Bench::initTestCase ()
+	{
+		Root_ = QString::fromLocal8Bit (qgetenv ("LC_LMP_SCANBENCH_ROOT"));
+		if (Root_.isEmpty ())
+		{
+			TempDir_ = std::make_shared<QTemporaryDir> ();
+			QVERIFY (TempDir_->isValid ());
+
+			Root_ = TempDir_->path ();
+			QVERIFY (MakeTree (Root_));
+		}
+
+		Files_ = RecIterateInfo (Root_);
+		QVERIFY (!Files_.isEmpty ());
+	}
+
+	void CollectionScan_Bench::testParallelWalkMatches ()
+	{
+		const auto& parallel = ParallelIterateInfo (Root_);
+		QCOMPARE (parallel.size (), Files_.size ());
+		QCOMPARE (GetPaths (parallel), GetPaths (Files_));
+	}
+
+	void CollectionScan_Bench::testNoopRescanIsUnchanged ()
+	{
+		const auto& diff = DiffFiles (ParallelIterateInfo (Root_), GetStamps (Files_));
+		QVERIFY (diff.ChangedFiles_.isEmpty ());
+		QVERIFY (diff.UpdatedStamps_.isEmpty ());
+		QCOMPARE (diff.UnchangedFiles_.size (), Files_.size ());
+	}
+
+	void CollectionScan_Bench::benchSequentialWalk ()
+	{
+		QBENCHMARK
+		{
+			RecIterateInfo (Root_);
+		}
+	}
+
+	void CollectionScan_Bench::benchParallelWalk ()
+	{
+		QBENCHMARK
+		{
+			ParallelIterateInfo (Root_);
+		}
+	}
+
+	void CollectionScan_Bench::benchNoopRescan ()
+	{
+		const auto& stamps = GetStamps (Files_);
+
+		QBENCHMARK
+		{
+			DiffFiles (ParallelIterateInfo (Root_), stamps);
+		}
+	}
+}
+}
@@ -29,7 +29,6 @@
 
 #include "util.h"
 #include <algorithm>
-#include <atomic>
 #include <QDirIterator>
 #include <QPixmap>
 #include <QApplication>
@@ -53,63 +52,6 @@ namespace LeechCraft
 {
 namespace LMP
 {
-	QList<QFileInfo> RecIterateInfo (const QString& dirPath, bool followSymlinks, std::atomic<bool> *stopFlag)
-	{
-		static const QStringList nameFilters
-		{
-			"*.aiff",
-			"*.ape",
-			"*.asf",
-			"*.flac",
-			"*.m4a",
-			"*.mp3",
-			"*.mp4",
-			"*.mpc",
-			"*.mpeg",
-			"*.mpg",
-			"*.ogg",
-			"*.tta",
-			"*.wav",
-			"*.wma",
-			"*.wv",
-			"*.wvp"
-		};
-
-		const QFileInfo dirInfo (dirPath);
-		if (dirInfo.isFile ())
-		{
-			for (const auto& filter : nameFilters)
-				if (dirPath.endsWith (filter.mid (1), Qt::CaseInsensitive))
-					return { dirInfo };
-
-			return {};
-		}
-
-		auto filters = QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot;
-		if (!followSymlinks)
-			filters |= QDir::NoSymLinks;
-
-		QList<QFileInfo> result;
-		const auto& list = QDir (dirPath).entryInfoList (nameFilters, filters);
-		for (const auto& entryInfo : list)
-		{
-			if (stopFlag && stopFlag->load (std::memory_order_relaxed))
-				return result;
-
-			const auto& path = entryInfo.absoluteFilePath ();
-			if (entryInfo.isSymLink () &&
-					entryInfo.symLinkTarget () == path)
-				continue;
-
-			if (entryInfo.isDir ())
-				result += RecIterateInfo (path, followSymlinks, stopFlag);
-			else if (entryInfo.isFile ())
-				result += entryInfo;
-		}
-
-		return result;
-	}
-
 	QStringList RecIterate (const QString& dirPath, bool followSymlinks)
 	{
 		const auto& infos = RecIterateInfo (dirPath, followSymlinks);
@@ -29,12 +29,12 @@
 
 #pragma once
 
-#include <atomic>
 #include <QStringList>
 #include <QFileInfo>
 #include <interfaces/media/idiscographyprovider.h>
 #include "interfaces/lmp/ilmpproxy.h"
 #include "interfaces/lmp/ilmputilproxy.h"
+#include "collectionscan.h"
 
 class QPixmap;
 class QPoint;
@@ -48,8 +48,6 @@ namespace LMP
 {
 	struct MediaInfo;
 
-	QList<QFileInfo> RecIterateInfo (const QString& dirPath,
-			bool followSymlinks = false, std::atomic<bool> *stopFlag = nullptr);
 	QStringList RecIterate (const QString& dirPath, bool followSymlinks = false);
 
 	QString FindAlbumArtPath (const QString& near, bool ignoreCollection = false);
@@ -91,6 +91,7 @@ namespace NamAuth
 
 	void Plugin::Release ()
 	{
+		Util::ConsistencyChecker::MarkCleanShutdown (SQLStorageBackend::GetDBPath ());
 	}
 
 	QString Plugin::GetName () const
@@ -60,6 +60,9 @@ namespace NamAuth
 			return;
 		}
 
+		// Lets the background integrity check run without blocking writes.
+		QSqlQuery { *DB_ }.exec ("PRAGMA journal_mode = WAL;");
+
 		AdaptedRecord_ = Util::oral::AdaptPtr<AuthRecord> (*DB_);
 	}
 
@@ -41,7 +41,7 @@ namespace Poshuku
 	
 	bool HistoryFilterModel::filterAcceptsRow (int row, const QModelIndex& parent) const
 	{
-		if (sourceModel ()->rowCount (sourceModel ()->index (row, 0, parent)))
+		if (!parent.isValid ())
 			return true;
 		
 		const auto& filter = filterRegExp ().pattern ();
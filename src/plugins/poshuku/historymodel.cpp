@@ -28,10 +28,14 @@
  **********************************************************************/
 
 #include "historymodel.h"
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 #include <QTimer>
 #include <QVariant>
-#include <QAction>
+#include <QLocale>
+#include <QSet>
+#include <QUrl>
 #include <QtDebug>
 #include <util/xpc/defaulthookproxy.h>
 #include <util/sll/prelude.h>
@@ -39,7 +43,6 @@
 #include <interfaces/core/iiconthememanager.h>
 #include "core.h"
 #include "xmlsettingsmanager.h"
-#include "poshuku.h"
 
 namespace LeechCraft
 {
@@ -47,7 +50,14 @@ namespace Poshuku
 {
 	namespace
 	{
-		/** Returns the number of the section for the given date.
+		const int PageSize = 256;
+
+		/** The internal ID of the section rows. The item rows store the
+			* number of their section plus one.
+			*/
+		const quintptr SectionId = 0;
+
+		/** Returns the first day of the section with the given number.
 			*
 			* - Today
 			* - Yesterday
@@ -60,31 +70,33 @@ namespace Poshuku
 			* - ...
 			* - Last N months
 			*/
-		int SectionNumber (const QDateTime& date, QDateTime current = QDateTime ())
+		QDate SectionStart (int number, const QDate& today)
 		{
-			if (!current.isValid ())
-				current = QDateTime::currentDateTime ();
-
-			QDate orig = current.date ();
-			if (date.daysTo (current) == 0)
-				return 0;
-			else if (date.daysTo (current) == 1)
-				return 1;
-			else if (date.daysTo (current) == 2)
-				return 2;
-			else if (date.daysTo (current) <= 7)
-				return 3;
-
-			int i = 0;
-			while (true)
+			switch (number)
 			{
-				current.setDate (orig.addMonths (--i));
-
-				if (date.daysTo (current) <= 0)
-					return -i + 3;
+			case 0:
+				return today;
+			case 1:
+				return today.addDays (-1);
+			case 2:
+				return today.addDays (-2);
+			case 3:
+				return today.addDays (-7);
+			default:
+				return today.addMonths (-(number - 3));
 			}
 		}
 
+		/** Returns the number of the section for the given date.
+			*/
+		int SectionNumber (const QDateTime& date, const QDate& today)
+		{
+			int number = 0;
+			while (date.date () < SectionStart (number, today))
+				++number;
+			return number;
+		}
+
 		QString SectionName (int number)
 		{
 			switch (number)
@@ -103,13 +115,17 @@ namespace Poshuku
 				return QObject::tr ("Last %n month(s)", "", number - 3);
 			}
 		}
+
+		QString NormalizeText (QString text)
+		{
+			return text.trimmed ().replace ('\n', ' ');
+		}
 	};
 
 	HistoryModel::HistoryModel (QObject *parent)
-	: QStandardItemModel { parent }
+	: QAbstractItemModel { parent }
 	, GarbageTimer_ { new QTimer { this } }
 	{
-		setHorizontalHeaderLabels ({ tr ("Title"), tr ("URL"), tr ("Date") });
 	}
 
 	void HistoryModel::HandleStorageReady ()
@@ -123,6 +139,169 @@ namespace Poshuku
 				SLOT (collectGarbage ()));
 	}
 
+	void HistoryModel::FetchAll ()
+	{
+		for (int i = 0; i < Sections_.size (); ++i)
+		{
+			const auto& sectionIdx = index (i, 0);
+			while (canFetchMore (sectionIdx))
+				fetchMore (sectionIdx);
+		}
+	}
+
+	int HistoryModel::columnCount (const QModelIndex&) const
+	{
+		return 3;
+	}
+
+	QVariant HistoryModel::data (const QModelIndex& index, int role) const
+	{
+		if (!index.isValid ())
+			return {};
+
+		if (index.internalId () == SectionId)
+		{
+			if (index.column () != ColumnTitle)
+				return {};
+
+			switch (role)
+			{
+			case Qt::DisplayRole:
+				return SectionName (index.row ());
+			case Qt::DecorationRole:
+				return Core::Instance ().GetProxy ()->
+						GetIconThemeManager ()->GetIcon ("document-open-folder");
+			default:
+				return {};
+			}
+		}
+
+		const auto& item = Sections_ [index.internalId () - 1].Items_ [index.row ()];
+		switch (role)
+		{
+		case Qt::DisplayRole:
+			switch (index.column ())
+			{
+			case ColumnTitle:
+				return NormalizeText (item.Title_);
+			case ColumnURL:
+				return NormalizeText (item.URL_);
+			case ColumnDate:
+				return QLocale {}.toString (item.DateTime_, QLocale::ShortFormat);
+			}
+			return {};
+		case Qt::DecorationRole:
+			if (index.column () == ColumnTitle)
+				return GetIcon (item.URL_);
+			return {};
+		default:
+			return {};
+		}
+	}
+
+	QVariant HistoryModel::headerData (int section, Qt::Orientation orient, int role) const
+	{
+		if (orient != Qt::Horizontal || role != Qt::DisplayRole)
+			return {};
+
+		switch (section)
+		{
+		case ColumnTitle:
+			return tr ("Title");
+		case ColumnURL:
+			return tr ("URL");
+		case ColumnDate:
+			return tr ("Date");
+		default:
+			return {};
+		}
+	}
+
+	QModelIndex HistoryModel::index (int row, int column, const QModelIndex& parent) const
+	{
+		if (!hasIndex (row, column, parent))
+			return {};
+
+		if (!parent.isValid ())
+			return createIndex (row, column, SectionId);
+
+		return createIndex (row, column, static_cast<quintptr> (parent.row () + 1));
+	}
+
+	QModelIndex HistoryModel::parent (const QModelIndex& index) const
+	{
+		if (!index.isValid () || index.internalId () == SectionId)
+			return {};
+
+		return createIndex (index.internalId () - 1, 0, SectionId);
+	}
+
+	int HistoryModel::rowCount (const QModelIndex& parent) const
+	{
+		if (!parent.isValid ())
+			return Sections_.size ();
+
+		if (parent.internalId () != SectionId || parent.column ())
+			return 0;
+
+		return Sections_ [parent.row ()].Items_.size ();
+	}
+
+	bool HistoryModel::hasChildren (const QModelIndex& parent) const
+	{
+		if (!parent.isValid ())
+			return !Sections_.isEmpty ();
+
+		if (parent.internalId () != SectionId || parent.column ())
+			return false;
+
+		const auto& section = Sections_ [parent.row ()];
+		return !section.Items_.isEmpty () || !section.Exhausted_;
+	}
+
+	bool HistoryModel::canFetchMore (const QModelIndex& parent) const
+	{
+		if (!parent.isValid () || parent.internalId () != SectionId || parent.column ())
+			return false;
+
+		return !Sections_ [parent.row ()].Exhausted_;
+	}
+
+	void HistoryModel::fetchMore (const QModelIndex& parent)
+	{
+		if (!canFetchMore (parent))
+			return;
+
+		auto& section = Sections_ [parent.row ()];
+		const auto& before = section.Items_.isEmpty () ?
+				section.Before_ :
+				section.Items_.last ().DateTime_;
+
+		history_items_t page;
+		try
+		{
+			page = Core::Instance ().GetStorageBackend ()->LoadHistoryPage (section.From_, before, PageSize);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			section.Exhausted_ = true;
+			return;
+		}
+
+		if (page.size () < PageSize)
+			section.Exhausted_ = true;
+
+		if (page.isEmpty ())
+			return;
+
+		const auto pos = section.Items_.size ();
+		beginInsertRows (parent, pos, pos + page.size () - 1);
+		section.Items_ += page;
+		endInsertRows ();
+	}
+
 	void HistoryModel::addItem (QString title, QString url, QDateTime date)
 	{
 		auto proxy = std::make_shared<Util::DefaultHookProxy> ();
@@ -150,84 +329,88 @@ namespace Poshuku
 
 	QList<QMap<QString, QVariant>> HistoryModel::getItemsMap () const
 	{
-		return Util::Map (Items_,
-				[] (const auto& item)
-				{
-					return QVariantMap
-					{
-						{ "Title", item.Title_ },
-						{ "DateTime", item.DateTime_ },
-						{ "URL", item.URL_ }
-					};
+		history_items_t items;
+		Core::Instance ().GetStorageBackend ()->LoadHistory (items);
+
+		QSet<QString> urls;
+		QList<QMap<QString, QVariant>> result;
+		for (const auto& item : items)
+		{
+			if (urls.contains (item.URL_))
+				continue;
+			urls << item.URL_;
+
+			result.append ({
+					{ "Title", item.Title_ },
+					{ "DateTime", item.DateTime_ },
+					{ "URL", item.URL_ }
 				});
+		}
+		return result;
 	}
 
-	void HistoryModel::Add (const HistoryItem& histItem, int section)
+	void HistoryModel::AddSections (int count, bool exhausted)
 	{
-		while (section >= rowCount ())
+		for (int i = 0; i < count; ++i)
 		{
-			const auto& folderIcon = Core::Instance ().GetProxy ()->
-					GetIconThemeManager ()->GetIcon ("document-open-folder");
+			const auto number = Sections_.size ();
 
-			const QList<QStandardItem*> sectItems
-			{
-				new QStandardItem { folderIcon, SectionName (rowCount ()) },
-				new QStandardItem,
-				new QStandardItem
-			};
-			for (const auto item : sectItems)
-				item->setEditable (false);
-
-			appendRow (sectItems);
+			Section section;
+			section.From_ = QDateTime { SectionStart (number, Today_) };
+			if (number)
+				section.Before_ = QDateTime { SectionStart (number - 1, Today_) };
+			section.Exhausted_ = exhausted;
+			Sections_ << section;
 		}
+	}
 
-		const auto icon = Core::Instance ().GetIcon (QUrl { histItem.URL_ });
-		auto normalizeText = [] (QString text)
-		{
-			return text.trimmed ().replace ('\n', ' ');
-		};
-		const QList<QStandardItem*> items
-		{
-			new QStandardItem { icon, normalizeText (histItem.Title_) },
-			new QStandardItem { normalizeText (histItem.URL_) },
-			new QStandardItem { QLocale {}.toString (histItem.DateTime_, QLocale::ShortFormat) }
-		};
-		for (const auto item : items)
-			item->setEditable (false);
-		item (section)->appendRow (items);
+	QIcon HistoryModel::GetIcon (const QString& url) const
+	{
+		auto pos = URL2Icon_.find (url);
+		if (pos == URL2Icon_.end ())
+			pos = URL2Icon_.insert (url, Core::Instance ().GetIcon (QUrl { url }));
+		return *pos;
 	}
 
 	void HistoryModel::loadData ()
 	{
 		collectGarbage ();
 
-		if (const auto rc = rowCount ())
-			removeRows (0, rc);
+		beginResetModel ();
 
-		Items_.clear ();
-		Core::Instance ().GetStorageBackend ()->LoadHistory (Items_);
+		Sections_.clear ();
+		URL2Icon_.clear ();
+		Today_ = QDate::currentDate ();
 
-		QSet<QString> urls;
-		for (auto i = Items_.begin (); i != Items_.end (); )
-		{
-			if (urls.contains (i->URL_))
-				i = Items_.erase (i);
-			else
-			{
-				urls << i->URL_;
-				++i;
-			}
-		}
+		if (const auto& oldest = Core::Instance ().GetStorageBackend ()->GetOldestHistoryDate ())
+			AddSections (SectionNumber (*oldest, Today_) + 1, false);
 
-		const auto& now = QDateTime::currentDateTime ();
-		for (const auto& item : Items_)
-			Add (item, SectionNumber (item.DateTime_, now));
+		endResetModel ();
 	}
 
 	void HistoryModel::handleItemAdded (const HistoryItem& item)
 	{
-		Items_.push_back (item);
-		Add (item, SectionNumber (item.DateTime_));
+		const auto number = SectionNumber (item.DateTime_, Today_);
+		if (number >= Sections_.size ())
+		{
+			beginInsertRows ({}, Sections_.size (), number);
+			AddSections (number + 1 - Sections_.size (), true);
+			endInsertRows ();
+		}
+
+		auto& section = Sections_ [number];
+		auto& items = section.Items_;
+		const auto pos = std::upper_bound (items.begin (), items.end (), item.DateTime_,
+				[] (const QDateTime& date, const HistoryItem& other) { return date > other.DateTime_; });
+		const auto row = pos - items.begin ();
+
+		// The items older than the fetched ones will be fetched later.
+		if (row == items.size () && !section.Exhausted_)
+			return;
+
+		beginInsertRows (index (number, 0), row, row);
+		items.insert (row, item);
+		endInsertRows ();
 	}
 
 	void HistoryModel::collectGarbage ()
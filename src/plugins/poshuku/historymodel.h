@@ -29,26 +29,45 @@
 
 #pragma once
 
-#include <vector>
-#include <QStringList>
+#include <QAbstractItemModel>
 #include <QDateTime>
-#include <QStandardItemModel>
+#include <QHash>
+#include <QIcon>
 #include <interfaces/core/ihookproxy.h>
 #include <interfaces/poshuku/poshukutypes.h>
 
 class QTimer;
-class QAction;
 
 namespace LeechCraft
 {
 namespace Poshuku
 {
-	class HistoryModel : public QStandardItemModel
+	/** Presents the history grouped into date sections (today,
+	 * yesterday, last week, last N months and so on).
+	 *
+	 * Only the section rows are created when the storage is ready. The
+	 * items of each section are fetched from the storage page by page
+	 * as the view asks for them (see canFetchMore() and fetchMore()),
+	 * and the icons of the items are only resolved when they are shown.
+	 */
+	class HistoryModel : public QAbstractItemModel
 	{
 		Q_OBJECT
 
 		QTimer * const GarbageTimer_;
-		history_items_t Items_;
+
+		struct Section
+		{
+			QDateTime From_;
+			QDateTime Before_;
+
+			history_items_t Items_;
+			bool Exhausted_ = false;
+		};
+		QList<Section> Sections_;
+		QDate Today_;
+
+		mutable QHash<QString, QIcon> URL2Icon_;
 	public:
 		enum Columns
 		{
@@ -60,11 +79,30 @@ namespace Poshuku
 		HistoryModel (QObject* = nullptr);
 
 		void HandleStorageReady ();
+
+		/** Fetches all the remaining items of all sections.
+		 *
+		 * This is needed for filtering, which only considers the
+		 * fetched items.
+		 */
+		void FetchAll ();
+
+		int columnCount (const QModelIndex& = {}) const override;
+		QVariant data (const QModelIndex&, int = Qt::DisplayRole) const override;
+		QVariant headerData (int, Qt::Orientation, int = Qt::DisplayRole) const override;
+		QModelIndex index (int, int, const QModelIndex& = {}) const override;
+		QModelIndex parent (const QModelIndex&) const override;
+		int rowCount (const QModelIndex& = {}) const override;
+		bool hasChildren (const QModelIndex& = {}) const override;
+
+		bool canFetchMore (const QModelIndex&) const override;
+		void fetchMore (const QModelIndex&) override;
 	public slots:
 		void addItem (QString title, QString url, QDateTime datetime);
 		QList<QMap<QString, QVariant>> getItemsMap () const;
 	private:
-		void Add (const HistoryItem&, int section);
+		void AddSections (int count, bool exhausted);
+		QIcon GetIcon (const QString&) const;
 	private slots:
 		void loadData ();
 		void collectGarbage ();
@@ -85,6 +85,10 @@ namespace Poshuku
 		const int section = Ui_.HistoryFilterType_->currentIndex ();
 		const auto& text = Ui_.HistoryFilterLine_->text ();
 
+		// the filter only sees the fetched items
+		if (!text.isEmpty ())
+			Core::Instance ().GetHistoryModel ()->FetchAll ();
+
 		switch (section)
 		{
 		case 1:
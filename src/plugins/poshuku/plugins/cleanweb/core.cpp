@@ -30,7 +30,6 @@
 #include "core.h"
 #include <algorithm>
 #include <functional>
-#include <thread>
 #include <QNetworkRequest>
 #include <QRegExp>
 #include <QFile>
@@ -42,11 +41,12 @@
 #include <QDir>
 #include <QCoreApplication>
 #include <QtConcurrentRun>
-#include <QtConcurrentMap>
 #include <QMenu>
 #include <QMainWindow>
 #include <QDir>
 #include <QElapsedTimer>
+#include <QReadLocker>
+#include <QWriteLocker>
 #include <util/xpc/util.h>
 #include <util/sys/paths.h>
 #include <util/sll/slotclosure.h>
@@ -64,6 +64,10 @@
 #include "userfiltersmodel.h"
 #include "lineparser.h"
 #include "subscriptionsmodel.h"
+#include "filtermatcher.h"
+#include "filterscache.h"
+#include "elementhidingindex.h"
+#include "verdictcache.h"
 
 Q_DECLARE_METATYPE (QNetworkReply*);
 
@@ -75,34 +79,47 @@ namespace CleanWeb
 {
 	namespace
 	{
+		Filter ParseFile (const QString& filePath)
+		{
+			QFile file (filePath);
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+					<< "could not open file"
+					<< filePath
+					<< file.errorString ();
+				return {};
+			}
+
+			const auto& data = QString::fromUtf8 (file.readAll ());
+			auto rawLines = data.split ('\n', QString::SkipEmptyParts);
+			if (!rawLines.isEmpty ())
+				rawLines.removeAt (0);
+			const auto& lines = Util::Map (rawLines, Util::QStringTrimmed {});
+
+			Filter f;
+			std::for_each (lines.begin (), lines.end (), LineParser (&f));
+			return f;
+		}
+
 		QList<Filter> ParseToFilters (const QStringList& paths)
 		{
+			const FiltersCache cache;
+
 			QList<Filter> result;
 			for (const auto& filePath : paths)
 			{
-				QFile file (filePath);
-				if (!file.open (QIODevice::ReadOnly))
+				auto f = cache.Load (filePath);
+				if (!f)
 				{
-					qWarning () << Q_FUNC_INFO
-						<< "could not open file"
-						<< filePath
-						<< file.errorString ();
-					result << Filter ();
-					continue;
+					f = ParseFile (filePath);
+					if (!f->Filters_.isEmpty () || !f->Exceptions_.isEmpty ())
+						cache.Save (filePath, *f);
 				}
 
-				const auto& data = QString::fromUtf8 (file.readAll ());
-				auto rawLines = data.split ('\n', QString::SkipEmptyParts);
-				if (!rawLines.isEmpty ())
-					rawLines.removeAt (0);
-				const auto& lines = Util::Map (rawLines, Util::QStringTrimmed {});
-
-				Filter f;
-				std::for_each (lines.begin (), lines.end (), LineParser (&f));
+				f->SD_.Filename_ = QFileInfo (filePath).fileName ();
 
-				f.SD_.Filename_ = QFileInfo (filePath).fileName ();
-
-				result << f;
+				result << *f;
 			}
 			return result;
 		}
@@ -126,7 +143,14 @@ namespace CleanWeb
 		const auto& infos = path.entryInfoList (QDir::Files | QDir::Readable);
 		const auto& paths = Util::Map (infos, &QFileInfo::absoluteFilePath);
 
-		Util::Sequence (nullptr, QtConcurrent::run (ParseToFilters, paths)) >>
+		const auto loadFilters = [paths]
+		{
+			const auto& filters = ParseToFilters (paths);
+			FiltersCache {}.RemoveStale (paths);
+			return filters;
+		};
+
+		Util::Sequence (nullptr, QtConcurrent::run (loadFilters)) >>
 				[this] (const QList<Filter>& filters)
 				{
 					SubsModel_->SetInitialFilters (filters);
@@ -186,111 +210,6 @@ namespace CleanWeb
 		}
 	}
 
-	namespace
-	{
-#if defined (Q_OS_WIN32) || defined (Q_OS_MAC)
-		// Thanks for this goes to http://www.codeproject.com/KB/string/patmatch.aspx
-		bool WildcardMatches (const char *pattern, const char *str)
-		{
-			enum State {
-				Exact,        // exact match
-				Any,        // ?
-				AnyRepeat    // *
-			};
-
-			const char *s = str;
-			const char *p = pattern;
-			const char *q = 0;
-			int state = 0;
-
-			bool match = true;
-			while (match && *p) {
-				if (*p == '*') {
-					state = AnyRepeat;
-					q = p+1;
-				} else if (*p == '?') state = Any;
-				else state = Exact;
-
-				if (*s == 0) break;
-
-				switch (state) {
-					case Exact:
-						match = *s == *p;
-						s++;
-						p++;
-						break;
-
-					case Any:
-						match = true;
-						s++;
-						p++;
-						break;
-
-					case AnyRepeat:
-						match = true;
-						s++;
-
-						if (*s == *q) p++;
-						break;
-				}
-			}
-
-			if (state == AnyRepeat) return (*s == *q);
-			else if (state == Any) return (*s == *p);
-			else return match && (*s == *p);
-		}
-#else
-#include <fnmatch.h>
-
-		bool WildcardMatches (const char *pat, const char *str)
-		{
-			return !fnmatch (pat, str, 0);
-		}
-#endif
-
-		bool Matches (const FilterItem_ptr& item,
-				const QByteArray& urlUtf8, const QString& domain)
-		{
-			const auto& opt = item->Option_;
-			if (opt.MatchObjects_ != FilterOption::MatchObject::All)
-			{
-				if (!(opt.MatchObjects_ & FilterOption::MatchObject::CSS) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::Image) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::Script) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::Object) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::ObjSubrequest))
-					return false;
-			}
-
-			if (std::any_of (opt.NotDomains_.begin (), opt.NotDomains_.end (),
-						[&domain, &opt] (const QString& notDomain)
-							{ return domain.endsWith (notDomain, opt.Case_); }))
-				return false;
-
-			if (!opt.Domains_.isEmpty () &&
-					std::none_of (opt.Domains_.begin (), opt.Domains_.end (),
-							[&domain, &opt] (const QString& doDomain)
-								{ return domain.endsWith (doDomain, opt.Case_); }))
-				return false;
-
-			switch (opt.MatchType_)
-			{
-			case FilterOption::MatchType::Regexp:
-				return item->RegExp_.Matches (urlUtf8);
-			case FilterOption::MatchType::Wildcard:
-				return WildcardMatches (item->PlainMatcher_.constData (), urlUtf8.constData ());
-			case FilterOption::MatchType::Plain:
-				return urlUtf8.indexOf (item->PlainMatcher_) >= 0;
-			case FilterOption::MatchType::Begin:
-				return urlUtf8.startsWith (item->PlainMatcher_);
-			case FilterOption::MatchType::End:
-				return urlUtf8.endsWith (item->PlainMatcher_);
-			}
-
-			return false;
-		}
-	}
-
 	namespace
 	{
 		FilterOption::MatchObjects ResourceType2Objs (IInterceptableRequests::ResourceType type)
@@ -310,25 +229,30 @@ namespace CleanWeb
 			}
 		}
 
-		bool IsSameDomain (const QUrl& url1, const QUrl& url2)
+		bool ShouldReject (const RequestContext& ctx,
+				const FilterMatcher& exceptions, const FilterMatcher& filters)
 		{
-			const auto& tld1 = url1.topLevelDomain ();
-			const auto& tld2 = url2.topLevelDomain ();
-			if (tld1 != tld2)
+			static const bool shouldDebug = qgetenv ("LC_POSHUKU_CLEANWEB_DUMP_MATCHES") == "1";
+
+			if (exceptions.FindMatch (ctx))
 				return false;
 
-			// example.com -> example (section index is -2)
-			// example.co.uk -> example (section index is -3)
-			const auto nextComponentPos = -tld1.count ('.') - 1;
+			if (const auto& item = filters.FindMatch (ctx))
+			{
+				if (shouldDebug)
+					qDebug () << Q_FUNC_INFO
+							<< ctx.UrlUtf8_
+							<< "matches"
+							<< *item;
+				return true;
+			}
 
-			const auto& nextComponent1 = url1.host ().section ('.', nextComponentPos, nextComponentPos);
-			const auto& nextComponent2 = url1.host ().section ('.', nextComponentPos, nextComponentPos);
-			return nextComponent1 == nextComponent2;
+			return false;
 		}
 
 		bool ShouldReject (const IInterceptableRequests::RequestInfo& req,
-				const QList<QList<FilterItem_ptr>>& exceptions,
-				const QList<QList<FilterItem_ptr>>& filters)
+				const FilterMatcher& exceptions, const FilterMatcher& filters,
+				VerdictCache& verdicts)
 		{
 			if (!XmlSettingsManager::Instance ()->property ("EnableFiltering").toBool ())
 				return false;
@@ -336,60 +260,16 @@ namespace CleanWeb
 			if (!req.PageUrl_.isValid ())
 				return false;
 
-			static const bool shouldDebug = qgetenv ("LC_POSHUKU_CLEANWEB_DUMP_MATCHES") == "1";
-
-			const auto objs = ResourceType2Objs (req.ResourceType_);
-
-			const QUrl& url = req.RequestUrl_;
-			const QString& urlStr = url.toString ();
-			const auto& urlUtf8 = urlStr.toUtf8 ();
-			const QString& cinUrlStr = urlStr.toLower ();
-			const auto& cinUrlUtf8 = cinUrlStr.toUtf8 ();
-
-			const QString& domain = req.PageUrl_.host ();
-			const bool isThirdParty = !IsSameDomain (req.PageUrl_, url);
+			const auto& ctx = MakeRequestContext (req.RequestUrl_, req.PageUrl_,
+					ResourceType2Objs (req.ResourceType_));
 
-			auto matches = [=] (const QList<QList<FilterItem_ptr>>& chunks)
-			{
-				return QtConcurrent::blockingMappedReduced (chunks.begin (), chunks.end (),
-						std::function<bool (const QList<FilterItem_ptr>&)>
-						{
-							[=] (const QList<FilterItem_ptr>& items)
-							{
-								for (const auto& item : items)
-								{
-									const auto& opt = item->Option_;
-									if (opt.ThirdParty_ != FilterOption::ThirdParty::Unspecified)
-										if ((opt.ThirdParty_ == FilterOption::ThirdParty::Yes) != isThirdParty)
-											continue;
-
-									if (opt.MatchObjects_ != FilterOption::MatchObject::All &&
-											!(objs & opt.MatchObjects_))
-										continue;
-
-									const auto& utf8 = item->Option_.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-									if (Matches (item, utf8, domain))
-									{
-										if (shouldDebug)
-											qDebug () << Q_FUNC_INFO
-													<< utf8
-													<< "matches"
-													<< *item;
-										return true;
-									}
-								}
-
-								return false;
-							}
-						},
-						+[] (bool& res, bool value) { res = res || value; });
-			};
-			if (matches (exceptions))
-				return false;
-			if (matches (filters))
-				return true;
+			const auto& key = MakeVerdictKey (ctx);
+			if (const auto verdict = verdicts.Get (key))
+				return *verdict == VerdictCache::Verdict::Block;
 
-			return false;
+			const auto reject = ShouldReject (ctx, exceptions, filters);
+			verdicts.Put (key, reject ? VerdictCache::Verdict::Block : VerdictCache::Verdict::Allow);
+			return reject;
 		}
 	}
 
@@ -398,7 +278,8 @@ namespace CleanWeb
 		auto interceptor = [this] (const IInterceptableRequests::RequestInfo& info)
 				-> IInterceptableRequests::Result_t
 		{
-			if (!ShouldReject (info, ExceptionsCache_, FilterItemsCache_))
+			const auto& matchers = GetMatchers ();
+			if (!ShouldReject (info, matchers->Exceptions_, matchers->Filters_, *matchers->Verdicts_))
 				return IInterceptableRequests::Allow {};
 
 			if (info.View_)
@@ -558,88 +439,28 @@ namespace CleanWeb
 		if (!XmlSettingsManager::Instance ()->property ("EnableElementHiding").toBool ())
 			return;
 
-		if (ScheduledHidings_.contains (view))
-			return;
-
-		qDebug () << Q_FUNC_INFO << view;
-		ScheduledHidings_ << view;
-
-		const auto& frameUrl = view->GetUrl ();
-		const QString& urlStr = frameUrl.toString ();
-		const auto& urlUtf8 = urlStr.toUtf8 ();
-		const QString& cinUrlStr = urlStr.toLower ();
-		const auto& cinUrlUtf8 = cinUrlStr.toUtf8 ();
-
-		const QString& domain = frameUrl.host ();
+		const auto& matchers = GetMatchers ();
+		const auto& hiding = matchers->Hiding_;
 
-		auto allFilters = SubsModel_->GetAllFilters ();
-		allFilters << UserFilters_->GetFilter ();
-
-		const auto future = QtConcurrent::run ([=]
-				{
-					QElapsedTimer timer;
-					timer.start ();
-
-					QStringList sels;
-					for (const Filter& filter : allFilters)
-						for (const auto& item : filter.Filters_)
-						{
-							if (item->Option_.HideSelector_.isEmpty ())
-								continue;
-
-							const auto& opt = item->Option_;
-							const auto& utf8 = opt.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-							if (!Matches (item, utf8, domain))
-								continue;
-
-							sels << item->Option_.HideSelector_;
-						}
-
-					const auto msecs = timer.nsecsElapsed () / 1000000;
-					const auto remaining = 1000 - msecs;
-					if (remaining > 0)
-					{
-						qDebug () << Q_FUNC_INFO
-								<< "sleeping for"
-								<< remaining
-								<< "ms";
-						std::this_thread::sleep_for (std::chrono::milliseconds { remaining });
-					}
-
-					return HidingWorkerResult { view, sels };
-				});
+		const auto& genericJS = hiding.GetGenericJS ();
+		if (!genericJS.isEmpty ())
+			HideElements (view, genericJS);
 
-		Util::Sequence (view->GetQWidget (), future) >>
-				[this] (const HidingWorkerResult& result) { HideElementsChunk (result); };
+		const auto& selectors = hiding.GetSelectors (view->GetUrl ());
+		if (!selectors.isEmpty ())
+			HideElements (view, ElementHidingIndex::MakeJS (selectors));
 	}
 
-	void Core::HideElementsChunk (HidingWorkerResult result)
+	void Core::HideElements (IWebView *view, const QString& js)
 	{
-		ScheduledHidings_.remove (result.View_);
-
-		for (auto& selector : result.Selectors_)
-			selector.replace ('\\', "\\\\")
-					.replace ('\'', "\\'")
-					;
-
-		QString js = R"(
-					(function(){
-					var elems = document.querySelectorAll('__SELECTORS__');
-					for (var i = 0; i < elems.length; ++i)
-						elems[i].remove();
-					return elems.length;
-					})();
-				)";
-		js.replace ("__SELECTORS__", result.Selectors_.join (", "));
-
-		result.View_->EvaluateJS (js,
-				[result, js] (const QVariant& res)
+		view->EvaluateJS (js,
+				[view, js] (const QVariant& res)
 				{
 					if (const auto count = res.toInt ())
 						qDebug () << "removed"
 								<< count
 								<< "elements on frame with URL"
-								<< result.View_->GetUrl ();
+								<< view->GetUrl ();
 					else if (!res.canConvert<int> ())
 						qWarning () << Q_FUNC_INFO
 								<< "failed to execute JS:"
@@ -729,65 +550,55 @@ namespace CleanWeb
 		MoreDelayedURLs_.remove (obj);
 	}
 
-	void Core::regenFilterCaches ()
+	std::shared_ptr<const Core::Matchers> Core::GetMatchers () const
 	{
-		ExceptionsCache_.clear ();
-		FilterItemsCache_.clear ();
+		QReadLocker locker { &MatchersLock_ };
+		return Matchers_;
+	}
 
+	void Core::regenFilterCaches ()
+	{
 		auto allFilters = SubsModel_->GetAllFilters ();
 		allFilters << UserFilters_->GetFilter ();
 
-		int exceptionsCount = 0;
-		int filtersCount = 0;
+		QList<FilterItem_ptr> exceptions;
+		QList<FilterItem_ptr> filters;
 		for (const Filter& filter : allFilters)
 		{
-			exceptionsCount += filter.Exceptions_.size ();
-			filtersCount += filter.Filters_.size ();
+			exceptions += filter.Exceptions_;
+			filters += filter.Filters_;
 		}
 
-		auto idealThreads = std::max (QThread::idealThreadCount (), 2);
-
-		const int exChunkSize = std::max (exceptionsCount / idealThreads / 4, 200);
-		const int fChunkSize = std::max (filtersCount / idealThreads / 4, 200);
-		qDebug () << Q_FUNC_INFO << exceptionsCount << filtersCount << exChunkSize << fChunkSize;
-
-		QList<FilterItem_ptr> lastItemsChunk, lastExceptionsChunk;
-		lastItemsChunk.reserve (fChunkSize);
-		lastExceptionsChunk.reserve (exChunkSize);
-
-		for (const Filter& filter : allFilters)
-		{
-			for (const auto& item : filter.Exceptions_)
-			{
-				if (!item->Option_.HideSelector_.isEmpty ())
-					continue;
-
-				lastExceptionsChunk << item;
-				if (lastExceptionsChunk.size () >= exChunkSize)
-				{
-					ExceptionsCache_ << lastExceptionsChunk;
-					lastExceptionsChunk.clear ();
-				}
-			}
-
-			for (const auto& item : filter.Filters_)
-			{
-				if (!item->Option_.HideSelector_.isEmpty ())
-					continue;
+		QElapsedTimer timer;
+		timer.start ();
 
-				lastItemsChunk << item;
-				if (lastItemsChunk.size () >= fChunkSize)
+		const auto& matchers = std::make_shared<const Matchers> (Matchers
 				{
-					FilterItemsCache_ << lastItemsChunk;
-					lastItemsChunk.clear ();
-				}
-			}
-		}
+					FilterMatcher { exceptions },
+					FilterMatcher { filters },
+					ElementHidingIndex { allFilters }
+				});
 
-		if (!lastItemsChunk.isEmpty ())
-			FilterItemsCache_ << lastItemsChunk;
-		if (!lastExceptionsChunk.isEmpty ())
-			ExceptionsCache_ << lastExceptionsChunk;
+		qDebug () << Q_FUNC_INFO
+				<< "compiled"
+				<< exceptions.size ()
+				<< "exceptions and"
+				<< filters.size ()
+				<< "filters in"
+				<< timer.elapsed ()
+				<< "ms;"
+				<< matchers->Filters_.GetUnindexedCount ()
+				<< "filters are checked for each request";
+
+		QWriteLocker locker { &MatchersLock_ };
+		const auto& oldVerdicts = Matchers_->Verdicts_;
+		qDebug () << Q_FUNC_INFO
+				<< "dropping verdict cache with"
+				<< oldVerdicts->GetHits ()
+				<< "hits and"
+				<< oldVerdicts->GetMisses ()
+				<< "misses";
+		Matchers_ = matchers;
 	}
 }
 }
@@ -35,11 +35,15 @@
 #include <QNetworkReply>
 #include <QDateTime>
 #include <QWebPage>
+#include <QReadWriteLock>
 #include <interfaces/iinfo.h>
 #include <interfaces/idownload.h>
 #include <interfaces/poshuku/poshukutypes.h>
 #include <interfaces/core/ihookproxy.h>
 #include "filter.h"
+#include "filtermatcher.h"
+#include "elementhidingindex.h"
+#include "verdictcache.h"
 
 class QNetworkRequest;
 class QWebPage;
@@ -56,12 +60,6 @@ namespace CleanWeb
 	class UserFiltersModel;
 	class SubscriptionsModel;
 
-	struct HidingWorkerResult
-	{
-		IWebView *View_;
-		QStringList Selectors_;
-	};
-
 	class Core : public QObject
 	{
 		Q_OBJECT
@@ -69,8 +67,19 @@ namespace CleanWeb
 		UserFiltersModel * const UserFilters_;
 		SubscriptionsModel * const SubsModel_;
 
-		QList<QList<FilterItem_ptr>> ExceptionsCache_;
-		QList<QList<FilterItem_ptr>> FilterItemsCache_;
+		struct Matchers
+		{
+			FilterMatcher Exceptions_;
+			FilterMatcher Filters_;
+			ElementHidingIndex Hiding_;
+
+			/* Tied to the filters above, so replacing the whole
+			 * structure also invalidates the cached verdicts.
+			 */
+			std::shared_ptr<VerdictCache> Verdicts_ = std::make_shared<VerdictCache> ();
+		};
+		std::shared_ptr<const Matchers> Matchers_ = std::make_shared<const Matchers> ();
+		mutable QReadWriteLock MatchersLock_;
 
 		QObjectList Downloaders_;
 
@@ -85,8 +94,6 @@ namespace CleanWeb
 
 		QHash<QObject*, QSet<QUrl>> MoreDelayedURLs_;
 
-		QSet<IWebView*> ScheduledHidings_;
-
 		const ICoreProxy_ptr Proxy_;
 	public:
 		Core (SubscriptionsModel*, UserFiltersModel*, const ICoreProxy_ptr&);
@@ -135,11 +142,13 @@ namespace CleanWeb
 		 */
 		bool Load (const QUrl& url, const QString& subscrName);
 	private:
+		std::shared_ptr<const Matchers> GetMatchers () const;
+
 		void HandleProvider (QObject*);
 
 		void Parse (const QString&);
 
-		void HideElementsChunk (HidingWorkerResult);
+		void HideElements (IWebView*, const QString&);
 		void DelayedRemoveElements (IWebView*, const QUrl&);
 		void HandleViewLayout (IWebView*);
 	private slots:
@@ -0,0 +1,201 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "elementhidingindex.h"
+#include <algorithm>
+#include <QUrl>
+#include "filtermatcher.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		bool IsDomainOnly (const FilterItem_ptr& item)
+		{
+			const auto& opt = item->Option_;
+			return opt.MatchType_ == FilterOption::MatchType::Plain &&
+					opt.Domains_.isEmpty () &&
+					opt.NotDomains_.isEmpty () &&
+					opt.ThirdParty_ == FilterOption::ThirdParty::Unspecified &&
+					opt.MatchObjects_ == FilterOption::MatchObject::All &&
+					!item->PlainMatcher_.contains ('/');
+		}
+
+		bool IsSubdomain (const QString& host, const QString& domain)
+		{
+			return host.endsWith (domain) &&
+					(host.size () == domain.size () ||
+						host.at (host.size () - domain.size () - 1) == '.');
+		}
+
+		bool IsExcluded (const QString& host, const QStringList& notDomains)
+		{
+			return std::any_of (notDomains.begin (), notDomains.end (),
+					[&host] (const QString& domain) { return IsSubdomain (host, domain); });
+		}
+
+		QString JoinEscaped (QStringList selectors)
+		{
+			for (auto& selector : selectors)
+				selector.replace ('\\', "\\\\")
+						.replace ('\'', "\\'")
+						;
+			return selectors.join (", ");
+		}
+
+		/* The generic selectors are the same for every page, and there
+		 * may be thousands of them, so they are applied once per frame
+		 * load: the flag lives on the frame's window object, which is
+		 * recreated on each navigation. The injected style sheet takes
+		 * care of the elements added after that.
+		 */
+		QString MakeGenericJS (const QStringList& selectors)
+		{
+			QString js = R"(
+					(function(){
+					if (window.__lcCleanWebGenericHidden)
+						return 0;
+					window.__lcCleanWebGenericHidden = true;
+					var style = document.createElement('style');
+					style.textContent = '__SELECTORS__ { display: none !important; }';
+					(document.head || document.documentElement).appendChild(style);
+					var elems = document.querySelectorAll('__SELECTORS__');
+					for (var i = 0; i < elems.length; ++i)
+						elems[i].remove();
+					return elems.length;
+					})();
+				)";
+			js.replace ("__SELECTORS__", JoinEscaped (selectors));
+			return js;
+		}
+	}
+
+	ElementHidingIndex::ElementHidingIndex (const QList<Filter>& filters)
+	{
+		QStringList generics;
+
+		for (const auto& filter : filters)
+			for (const auto& item : filter.Filters_)
+			{
+				const auto& selector = item->Option_.HideSelector_;
+				if (selector.isEmpty ())
+					continue;
+
+				if (!IsDomainOnly (item))
+				{
+					Others_ << item;
+					continue;
+				}
+
+				QStringList domains;
+				QStringList notDomains;
+				for (const auto& domain : QString::fromUtf8 (item->PlainMatcher_).split (',', QString::SkipEmptyParts))
+					if (domain.startsWith ('~'))
+						notDomains << domain.mid (1).toLower ();
+					else
+						domains << domain.toLower ();
+
+				if (domains.isEmpty () && notDomains.isEmpty ())
+					generics << selector;
+				else if (domains.isEmpty ())
+					ExcludedGenerics_.append ({ selector, notDomains });
+				else
+					for (const auto& domain : domains)
+						Domain2Selectors_ [domain].append ({ selector, notDomains });
+			}
+
+		generics.removeDuplicates ();
+		if (!generics.isEmpty ())
+			GenericJS_ = MakeGenericJS (generics);
+	}
+
+	QStringList ElementHidingIndex::GetSelectors (const QUrl& url) const
+	{
+		const auto& host = url.host ().toLower ();
+
+		QStringList result;
+		for (auto domain = host; !domain.isEmpty (); domain = domain.section ('.', 1))
+		{
+			const auto pos = Domain2Selectors_.find (domain);
+			if (pos == Domain2Selectors_.end ())
+				continue;
+
+			for (const auto& selector : *pos)
+				if (!IsExcluded (host, selector.NotDomains_))
+					result << selector.Selector_;
+		}
+
+		for (const auto& selector : ExcludedGenerics_)
+			if (!IsExcluded (host, selector.NotDomains_))
+				result << selector.Selector_;
+
+		if (!Others_.isEmpty ())
+		{
+			const auto& urlStr = url.toString ();
+			const auto& urlUtf8 = urlStr.toUtf8 ();
+			const auto& cinUrlUtf8 = urlStr.toLower ().toUtf8 ();
+
+			const auto& domain = url.host ();
+			for (const auto& item : Others_)
+			{
+				const auto& utf8 = item->Option_.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
+				if (Matches (item, utf8, domain))
+					result << item->Option_.HideSelector_;
+			}
+		}
+
+		result.removeDuplicates ();
+		return result;
+	}
+
+	const QString& ElementHidingIndex::GetGenericJS () const
+	{
+		return GenericJS_;
+	}
+
+	QString ElementHidingIndex::MakeJS (const QStringList& selectors)
+	{
+		QString js = R"(
+					(function(){
+					var elems = document.querySelectorAll('__SELECTORS__');
+					for (var i = 0; i < elems.length; ++i)
+						elems[i].remove();
+					return elems.length;
+					})();
+				)";
+		js.replace ("__SELECTORS__", JoinEscaped (selectors));
+		return js;
+	}
+}
+}
+}
@@ -0,0 +1,109 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+#include "filter.h"
+
+class QUrl;
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** @brief Maps page domains to the element hiding selectors.
+	 *
+	 * The index is built once when the filter lists change. Rules of
+	 * the form domain1,~domain2##selector are indexed by their
+	 * domains, so getting the selectors for a page boils down to a hash
+	 * lookup per each parent domain of the page host. Generic rules
+	 * (without any domains) are collected into a single script that is
+	 * built once and reused for all pages.
+	 *
+	 * The rules that don't fit this scheme are checked against the
+	 * page URL one by one.
+	 */
+	class ElementHidingIndex
+	{
+		struct Selector
+		{
+			QString Selector_;
+			QStringList NotDomains_;
+		};
+
+		QHash<QString, QList<Selector>> Domain2Selectors_;
+		QList<Selector> ExcludedGenerics_;
+		QList<FilterItem_ptr> Others_;
+
+		QString GenericJS_;
+	public:
+		ElementHidingIndex () = default;
+
+		/** @brief Builds the index from the hiding rules in the filters.
+		 *
+		 * @param[in] filters The filters to take hiding rules from.
+		 */
+		explicit ElementHidingIndex (const QList<Filter>& filters);
+
+		/** @brief Returns the page-specific selectors for the URL.
+		 *
+		 * The generic selectors are not included, GetGenericJS()
+		 * already takes care of them.
+		 *
+		 * @param[in] url The URL of the page.
+		 * @return The list of selectors to hide on the page.
+		 */
+		QStringList GetSelectors (const QUrl& url) const;
+
+		/** @brief Returns the script hiding the generic selectors.
+		 *
+		 * The script does its work only once per frame load, so it is
+		 * cheap to evaluate again on later layouts of the same page.
+		 *
+		 * @return The script or an empty string if there are no
+		 * generic selectors.
+		 */
+		const QString& GetGenericJS () const;
+
+		/** @brief Makes the script removing elements matching selectors.
+		 *
+		 * The script evaluates to the number of removed elements.
+		 *
+		 * @param[in] selectors The selectors, not escaped.
+		 * @return The script removing the matching elements.
+		 */
+		static QString MakeJS (const QStringList& selectors);
+	};
+}
+}
+}
@@ -40,13 +40,14 @@ namespace CleanWeb
 {
 	QDataStream& operator<< (QDataStream& out, const FilterOption& opt)
 	{
-		qint8 version = 3;
-		out << version
+		out << FilterOptionStreamVersion
 			<< static_cast<qint8> (opt.Case_)
 			<< static_cast<qint8> (opt.MatchType_)
 			<< opt.Domains_
 			<< opt.NotDomains_
-			<< static_cast<qint8> (opt.ThirdParty_);
+			<< static_cast<qint8> (opt.ThirdParty_)
+			<< static_cast<qint32> (opt.MatchObjects_)
+			<< opt.HideSelector_;
 		return out;
 	}
 
@@ -55,11 +56,12 @@ namespace CleanWeb
 		qint8 version = 0;
 		in >> version;
 
-		if (version < 1 || version > 3)
+		if (version < 1 || version > FilterOptionStreamVersion)
 		{
 			qWarning () << Q_FUNC_INFO
 				<< "unknown version"
 				<< version;
+			in.setStatus (QDataStream::ReadCorruptData);
 			return in;
 		}
 
@@ -88,6 +90,13 @@ namespace CleanWeb
 			in >> tpVal;
 			opt.ThirdParty_ = static_cast<FilterOption::ThirdParty> (tpVal);
 		}
+		if (version >= 4)
+		{
+			qint32 objs;
+			in >> objs
+				>> opt.HideSelector_;
+			opt.MatchObjects_ = FilterOption::MatchObjects { QFlag { objs } };
+		}
 
 		return in;
 	}
@@ -151,7 +160,7 @@ namespace CleanWeb
 
 	QDataStream& operator<< (QDataStream& out, const FilterItem& item)
 	{
-		out << static_cast<quint8> (2)
+		out << FilterItemStreamVersion
 			<< QString::fromUtf8 (item.PlainMatcher_)
 			<< item.RegExp_.GetPattern ()
 			<< static_cast<quint8> (item.RegExp_.GetCaseSensitivity ())
@@ -163,29 +172,33 @@ namespace CleanWeb
 	{
 		quint8 version = 0;
 		in >> version;
-		if (version < 1 || version > 2)
+		if (version < 1 || version > FilterItemStreamVersion)
 		{
 			qWarning () << Q_FUNC_INFO
 					<< "unknown version"
 					<< version;
+			in.setStatus (QDataStream::ReadCorruptData);
 			return in;
 		}
 
 		QString origStr;
 		in >> origStr;
 		item.PlainMatcher_ = origStr.toUtf8 ();
+		// Plain matchers have no regexp, so don't compile an empty one.
 		if (version == 1)
 		{
 			QRegExp rx;
 			in >> rx;
-			item.RegExp_ = Util::RegExp (rx.pattern (), rx.caseSensitivity ());
+			if (!rx.pattern ().isEmpty ())
+				item.RegExp_ = Util::RegExp (rx.pattern (), rx.caseSensitivity ());
 		}
 		else if (version == 2)
 		{
 			QString str;
 			quint8 cs;
 			in >> str >> cs;
-			item.RegExp_ = Util::RegExp (str, static_cast<Qt::CaseSensitivity> (cs));
+			if (!str.isEmpty ())
+				item.RegExp_ = Util::RegExp (str, static_cast<Qt::CaseSensitivity> (cs));
 		}
 		in >> item.Option_;
 		return in;
@@ -84,6 +84,9 @@ namespace CleanWeb
 		} ThirdParty_ = ThirdParty::Unspecified;
 	};
 
+	/// The version written by the FilterOption serialization operator.
+	const qint8 FilterOptionStreamVersion = 4;
+
 	QDataStream& operator<< (QDataStream&, const FilterOption&);
 	QDataStream& operator>> (QDataStream&, FilterOption&);
 
@@ -121,6 +124,9 @@ namespace CleanWeb
 
 	typedef std::shared_ptr<FilterItem> FilterItem_ptr;
 
+	/// The version written by the FilterItem serialization operator.
+	const quint8 FilterItemStreamVersion = 2;
+
 	QDataStream& operator<< (QDataStream&, const FilterItem&);
 	QDataStream& operator>> (QDataStream&, FilterItem&);
 
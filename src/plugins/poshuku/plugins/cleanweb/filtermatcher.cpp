@@ -0,0 +1,638 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filtermatcher.h"
+#include <algorithm>
+#include <QUrl>
+#include <QVarLengthArray>
+#include <QtDebug>
+
+#if !defined (Q_OS_WIN32) && !defined (Q_OS_MAC)
+#include <fnmatch.h>
+#endif
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	RequestContext MakeRequestContext (const QUrl& reqUrl, const QUrl& pageUrl,
+			FilterOption::MatchObjects objs)
+	{
+		const auto& urlStr = reqUrl.toString ();
+		return
+		{
+			urlStr.toUtf8 (),
+			urlStr.toLower ().toUtf8 (),
+			pageUrl.host (),
+			objs,
+			!IsSameDomain (pageUrl, reqUrl)
+		};
+	}
+
+	bool IsSameDomain (const QUrl& url1, const QUrl& url2)
+	{
+		const auto& tld1 = url1.topLevelDomain ();
+		const auto& tld2 = url2.topLevelDomain ();
+		if (tld1 != tld2)
+			return false;
+
+		// example.com -> example (section index is -2)
+		// example.co.uk -> example (section index is -3)
+		const auto nextComponentPos = -tld1.count ('.') - 1;
+
+		const auto& nextComponent1 = url1.host ().section ('.', nextComponentPos, nextComponentPos);
+		const auto& nextComponent2 = url1.host ().section ('.', nextComponentPos, nextComponentPos);
+		return nextComponent1 == nextComponent2;
+	}
+
+	namespace
+	{
+#if defined (Q_OS_WIN32) || defined (Q_OS_MAC)
+		// Thanks for this goes to http://www.codeproject.com/KB/string/patmatch.aspx
+		bool WildcardMatches (const char *pattern, const char *str)
+		{
+			enum State {
+				Exact,        // exact match
+				Any,        // ?
+				AnyRepeat    // *
+			};
+
+			const char *s = str;
+			const char *p = pattern;
+			const char *q = 0;
+			int state = 0;
+
+			bool match = true;
+			while (match && *p) {
+				if (*p == '*') {
+					state = AnyRepeat;
+					q = p+1;
+				} else if (*p == '?') state = Any;
+				else state = Exact;
+
+				if (*s == 0) break;
+
+				switch (state) {
+					case Exact:
+						match = *s == *p;
+						s++;
+						p++;
+						break;
+
+					case Any:
+						match = true;
+						s++;
+						p++;
+						break;
+
+					case AnyRepeat:
+						match = true;
+						s++;
+
+						if (*s == *q) p++;
+						break;
+				}
+			}
+
+			if (state == AnyRepeat) return (*s == *q);
+			else if (state == Any) return (*s == *p);
+			else return match && (*s == *p);
+		}
+#else
+		bool WildcardMatches (const char *pat, const char *str)
+		{
+			return !fnmatch (pat, str, 0);
+		}
+#endif
+	}
+
+	bool Matches (const FilterItem_ptr& item, const QByteArray& urlUtf8, const QString& domain)
+	{
+		const auto& opt = item->Option_;
+		if (opt.MatchObjects_ != FilterOption::MatchObject::All)
+		{
+			if (!(opt.MatchObjects_ & FilterOption::MatchObject::CSS) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::Image) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::Script) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::Object) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::ObjSubrequest))
+				return false;
+		}
+
+		if (std::any_of (opt.NotDomains_.begin (), opt.NotDomains_.end (),
+					[&domain, &opt] (const QString& notDomain)
+						{ return domain.endsWith (notDomain, opt.Case_); }))
+			return false;
+
+		if (!opt.Domains_.isEmpty () &&
+				std::none_of (opt.Domains_.begin (), opt.Domains_.end (),
+						[&domain, &opt] (const QString& doDomain)
+							{ return domain.endsWith (doDomain, opt.Case_); }))
+			return false;
+
+		switch (opt.MatchType_)
+		{
+		case FilterOption::MatchType::Regexp:
+			return item->RegExp_.Matches (urlUtf8);
+		case FilterOption::MatchType::Wildcard:
+			return WildcardMatches (item->PlainMatcher_.constData (), urlUtf8.constData ());
+		case FilterOption::MatchType::Plain:
+			return urlUtf8.indexOf (item->PlainMatcher_) >= 0;
+		case FilterOption::MatchType::Begin:
+			return urlUtf8.startsWith (item->PlainMatcher_);
+		case FilterOption::MatchType::End:
+			return urlUtf8.endsWith (item->PlainMatcher_);
+		}
+
+		return false;
+	}
+
+	bool Matches (const FilterItem_ptr& item, const RequestContext& ctx)
+	{
+		const auto& opt = item->Option_;
+		if (opt.ThirdParty_ != FilterOption::ThirdParty::Unspecified)
+			if ((opt.ThirdParty_ == FilterOption::ThirdParty::Yes) != ctx.IsThirdParty_)
+				return false;
+
+		if (opt.MatchObjects_ != FilterOption::MatchObject::All &&
+				!(ctx.Objs_ & opt.MatchObjects_))
+			return false;
+
+		const auto& utf8 = opt.Case_ == Qt::CaseSensitive ? ctx.UrlUtf8_ : ctx.CinUrlUtf8_;
+		return Matches (item, utf8, ctx.Domain_);
+	}
+
+	namespace
+	{
+		bool IsTokenChar (char c)
+		{
+			return (c >= 'a' && c <= 'z') ||
+					(c >= 'A' && c <= 'Z') ||
+					(c >= '0' && c <= '9') ||
+					c == '%';
+		}
+
+		// FNV-1a, so that the URL tokens could be hashed in place.
+		quint32 HashToken (const char *begin, const char *end)
+		{
+			quint32 hash = 2166136261u;
+			for (; begin != end; ++begin)
+			{
+				hash ^= static_cast<quint8> (*begin);
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+
+		quint32 HashToken (const QByteArray& token)
+		{
+			return HashToken (token.constData (), token.constData () + token.size ());
+		}
+
+		template<typename F>
+		void ForEachUrlToken (const QByteArray& url, F&& f)
+		{
+			const auto end = url.constData () + url.size ();
+			auto pos = url.constData ();
+			while (pos != end)
+			{
+				while (pos != end && !IsTokenChar (*pos))
+					++pos;
+
+				const auto tokenBegin = pos;
+				while (pos != end && IsTokenChar (*pos))
+					++pos;
+
+				if (pos != tokenBegin)
+					f (HashToken (tokenBegin, pos));
+			}
+		}
+
+		/* Patterns are first split into elements, each being either a
+		 * single token character, something that surely matches a
+		 * single non-token character (a separator), or something that
+		 * can match anything at all, including nothing. Tokens are the
+		 * runs of token characters surrounded by separators.
+		 */
+		enum class Element
+		{
+			TokenChar,
+			Separator,
+			Unknown
+		};
+
+		struct Elements
+		{
+			QByteArray Chars_;
+			QVector<Element> Elems_;
+
+			void Append (char c, Element elem)
+			{
+				Chars_ += c;
+				Elems_ << elem;
+			}
+
+			void Append (char c)
+			{
+				Append (c, IsTokenChar (c) ? Element::TokenChar : Element::Separator);
+			}
+		};
+
+		QList<QByteArray> ExtractTokens (const Elements& elems)
+		{
+			QList<QByteArray> result;
+
+			const auto& types = elems.Elems_;
+			for (int i = 0; i < types.size (); )
+			{
+				if (types [i] != Element::TokenChar)
+				{
+					++i;
+					continue;
+				}
+
+				const auto begin = i;
+				while (i < types.size () && types [i] == Element::TokenChar)
+					++i;
+
+				if (begin > 0 && types [begin - 1] == Element::Separator &&
+						i < types.size () && types [i] == Element::Separator)
+					result << elems.Chars_.mid (begin, i - begin);
+			}
+
+			return result;
+		}
+
+		Elements GetPlainElements (const QByteArray& pattern, FilterOption::MatchType type)
+		{
+			Elements result;
+
+			// The begin and end anchors are represented as separators.
+			if (type == FilterOption::MatchType::Begin)
+				result.Append ('^', Element::Separator);
+
+			for (const auto c : pattern)
+				result.Append (c);
+
+			if (type == FilterOption::MatchType::End)
+				result.Append ('$', Element::Separator);
+
+			return result;
+		}
+
+		Elements GetWildcardElements (const QByteArray& pattern)
+		{
+			/* Wildcards are anchored by fnmatch(), but the fallback
+			 * implementation is not that reliable, so we don't rely
+			 * on it.
+			 */
+			Elements result;
+			for (int i = 0; i < pattern.size (); ++i)
+			{
+				const auto c = pattern.at (i);
+				switch (c)
+				{
+				case '\\':
+					if (i + 1 < pattern.size () && !IsTokenChar (pattern.at (i + 1)))
+						result.Append (pattern.at (++i), Element::Separator);
+					else
+						result.Append (c, Element::Unknown);
+					break;
+				case '*':
+				case '?':
+				case '[':
+				case ']':
+					result.Append (c, Element::Unknown);
+					break;
+				default:
+					result.Append (c);
+					break;
+				}
+			}
+			return result;
+		}
+
+		bool IsClassSeparator (const QByteArray& pattern, int& i)
+		{
+			// i points to the '[' character.
+			++i;
+			bool isSeparator = true;
+
+			if (i < pattern.size () && pattern.at (i) == '^')
+			{
+				isSeparator = false;
+				++i;
+			}
+
+			const auto classBegin = i;
+			for (; i < pattern.size (); ++i)
+			{
+				const auto c = pattern.at (i);
+				if (c == ']' && i != classBegin)
+					return isSeparator;
+
+				if (IsTokenChar (c) || c == '\\' || c == '[')
+					isSeparator = false;
+				else if (c == '-' && i != classBegin &&
+						i + 1 < pattern.size () && pattern.at (i + 1) != ']')
+					isSeparator = false;
+			}
+
+			return false;
+		}
+
+		Elements GetRegexpElements (const QByteArray& pattern)
+		{
+			// Grouping and alternation are not worth the trouble.
+			if (pattern.contains ('(') || pattern.contains ('|'))
+				return {};
+
+			Elements result;
+
+			auto markLastUnknown = [&result]
+			{
+				if (!result.Elems_.isEmpty ())
+					result.Elems_.last () = Element::Unknown;
+			};
+
+			for (int i = 0; i < pattern.size (); ++i)
+			{
+				const auto c = pattern.at (i);
+				switch (c)
+				{
+				case '\\':
+					if (i + 1 == pattern.size ())
+						return {};
+					if (IsTokenChar (pattern.at (i + 1)))
+						result.Append (pattern.at (++i), Element::Unknown);
+					else
+						result.Append (pattern.at (++i), Element::Separator);
+					break;
+				case '[':
+				{
+					const auto isSep = IsClassSeparator (pattern, i);
+					if (i >= pattern.size ())
+						return {};
+					result.Append (c, isSep ? Element::Separator : Element::Unknown);
+					break;
+				}
+				case '^':
+					result.Append (c, i ? Element::Unknown : Element::Separator);
+					break;
+				case '$':
+					result.Append (c, i == pattern.size () - 1 ? Element::Separator : Element::Unknown);
+					break;
+				case '.':
+					result.Append (c, Element::Unknown);
+					break;
+				case '{':
+					markLastUnknown ();
+					while (i < pattern.size () && pattern.at (i) != '}')
+						++i;
+					break;
+				case '*':
+				case '+':
+				case '?':
+					markLastUnknown ();
+					break;
+				default:
+					result.Append (c);
+					break;
+				}
+			}
+
+			return result;
+		}
+
+		QList<QByteArray> GetTokens (const FilterItem_ptr& item)
+		{
+			const auto& opt = item->Option_;
+
+			Elements elems;
+			switch (opt.MatchType_)
+			{
+			case FilterOption::MatchType::Regexp:
+				elems = GetRegexpElements (item->RegExp_.GetPattern ().toUtf8 ());
+				break;
+			case FilterOption::MatchType::Wildcard:
+				elems = GetWildcardElements (item->PlainMatcher_);
+				break;
+			case FilterOption::MatchType::Plain:
+			case FilterOption::MatchType::Begin:
+			case FilterOption::MatchType::End:
+				elems = GetPlainElements (item->PlainMatcher_, opt.MatchType_);
+				break;
+			}
+
+			auto tokens = ExtractTokens (elems);
+			if (opt.Case_ == Qt::CaseInsensitive)
+				for (auto& token : tokens)
+					token = token.toLower ();
+			return tokens;
+		}
+
+		bool IsDomainIndexable (const FilterOption& opt)
+		{
+			return !opt.Domains_.isEmpty () &&
+					std::none_of (opt.Domains_.begin (), opt.Domains_.end (),
+							[] (const QString& domain) { return domain.isEmpty (); });
+		}
+
+		// Hashes the suffixes of a string from right to left.
+		class SuffixHasher
+		{
+			quint32 Hash_ = 0;
+		public:
+			quint32 Append (QChar c)
+			{
+				Hash_ = Hash_ * 31 + c.unicode ();
+				return Hash_;
+			}
+		};
+
+		quint32 HashDomain (const QString& domain)
+		{
+			SuffixHasher hasher;
+			quint32 hash = 0;
+			for (auto i = domain.size () - 1; i >= 0; --i)
+				hash = hasher.Append (domain.at (i));
+			return hash;
+		}
+	}
+
+	FilterMatcher::FilterMatcher (const QList<FilterItem_ptr>& items)
+	{
+		QList<QPair<FilterItem_ptr, QList<QByteArray>>> tokenized;
+		tokenized.reserve (items.size ());
+
+		QHash<QByteArray, int> tokenCounts;
+		for (const auto& item : items)
+		{
+			if (!item->Option_.HideSelector_.isEmpty ())
+				continue;
+
+			const auto& tokens = GetTokens (item);
+			for (const auto& token : tokens)
+				++tokenCounts [token.toLower ()];
+			tokenized.append ({ item, tokens });
+		}
+
+		for (const auto& pair : tokenized)
+			Add (pair.first, pair.second, tokenCounts);
+	}
+
+	void FilterMatcher::Add (const FilterItem_ptr& item,
+			const QList<QByteArray>& tokens, const QHash<QByteArray, int>& tokenCounts)
+	{
+		++Size_;
+
+		if (!tokens.isEmpty ())
+		{
+			/* Prefer the rarest token, and longer tokens among equally
+			 * rare ones, with a penalty for the tokens found in almost
+			 * every URL.
+			 */
+			static const QList<QByteArray> CommonTokens { "http", "https", "www", "com", "js" };
+
+			auto score = [&tokenCounts] (const QByteArray& token)
+			{
+				auto count = tokenCounts.value (token.toLower ());
+				if (CommonTokens.contains (token.toLower ()))
+					count += 1 << 20;
+				return std::make_pair (count, -token.size ());
+			};
+
+			const auto& best = *std::min_element (tokens.begin (), tokens.end (),
+					[&score] (const QByteArray& left, const QByteArray& right)
+						{ return score (left) < score (right); });
+
+			auto& buckets = item->Option_.Case_ == Qt::CaseSensitive ? CsTokens_ : CinTokens_;
+			buckets [HashToken (best)] << item;
+			return;
+		}
+
+		const auto& opt = item->Option_;
+		if (IsDomainIndexable (opt))
+		{
+			for (const auto& domain : opt.Domains_)
+				Domains_ [HashDomain (domain.toLower ())] << item;
+			return;
+		}
+
+		switch (opt.MatchType_)
+		{
+		case FilterOption::MatchType::Begin:
+		case FilterOption::MatchType::End:
+			Anchored_ << item;
+			break;
+		case FilterOption::MatchType::Regexp:
+			Regexps_ << item;
+			break;
+		case FilterOption::MatchType::Plain:
+		case FilterOption::MatchType::Wildcard:
+			Generic_ << item;
+			break;
+		}
+	}
+
+	FilterItem_ptr FilterMatcher::FindMatch (const RequestContext& ctx) const
+	{
+		auto checkBucket = [&ctx] (const Bucket_t& bucket) -> FilterItem_ptr
+		{
+			for (const auto& item : bucket)
+				if (Matches (item, ctx))
+					return item;
+			return {};
+		};
+
+		auto checkTokens = [&checkBucket] (const QHash<quint32, Bucket_t>& buckets,
+				const QByteArray& url) -> FilterItem_ptr
+		{
+			QVarLengthArray<quint32, 64> hashes;
+			ForEachUrlToken (url, [&hashes] (quint32 hash) { hashes.append (hash); });
+			std::sort (hashes.begin (), hashes.end ());
+			const auto end = std::unique (hashes.begin (), hashes.end ());
+
+			for (auto i = hashes.begin (); i != end; ++i)
+			{
+				const auto pos = buckets.find (*i);
+				if (pos == buckets.end ())
+					continue;
+
+				if (const auto& item = checkBucket (*pos))
+					return item;
+			}
+
+			return {};
+		};
+
+		if (!CinTokens_.isEmpty ())
+			if (const auto& item = checkTokens (CinTokens_, ctx.CinUrlUtf8_))
+				return item;
+
+		if (!CsTokens_.isEmpty ())
+			if (const auto& item = checkTokens (CsTokens_, ctx.UrlUtf8_))
+				return item;
+
+		if (!Domains_.isEmpty ())
+		{
+			const auto& domain = ctx.Domain_.toLower ();
+			SuffixHasher hasher;
+			for (auto i = domain.size () - 1; i >= 0; --i)
+			{
+				const auto pos = Domains_.find (hasher.Append (domain.at (i)));
+				if (pos == Domains_.end ())
+					continue;
+
+				if (const auto& item = checkBucket (*pos))
+					return item;
+			}
+		}
+
+		for (const auto bucket : { &Anchored_, &Regexps_, &Generic_ })
+			if (const auto& item = checkBucket (*bucket))
+				return item;
+
+		return {};
+	}
+
+	int FilterMatcher::GetSize () const
+	{
+		return Size_;
+	}
+
+	int FilterMatcher::GetUnindexedCount () const
+	{
+		return Anchored_.size () + Regexps_.size () + Generic_.size ();
+	}
+}
+}
+}
@@ -0,0 +1,152 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+#include "filter.h"
+
+class QUrl;
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** @brief Describes a single request being checked against filters.
+	 *
+	 * The URL is stored in both its original and lowercased UTF-8
+	 * forms, so that both case-sensitive and case-insensitive filter
+	 * items could be checked without reencoding the URL.
+	 */
+	struct RequestContext
+	{
+		QByteArray UrlUtf8_;
+		QByteArray CinUrlUtf8_;
+
+		/// The host of the page that has issued the request.
+		QString Domain_;
+
+		FilterOption::MatchObjects Objs_;
+		bool IsThirdParty_;
+	};
+
+	RequestContext MakeRequestContext (const QUrl& reqUrl, const QUrl& pageUrl,
+			FilterOption::MatchObjects objs);
+
+	bool IsSameDomain (const QUrl&, const QUrl&);
+
+	/** @brief Checks whether the filter item matches the given URL.
+	 *
+	 * Only the domain restrictions and the pattern of the item are
+	 * checked, third-party and object type restrictions are not.
+	 *
+	 * @param[in] item The filter item to check.
+	 * @param[in] urlUtf8 The URL, lowercased if the item is case
+	 * insensitive.
+	 * @param[in] domain The domain of the page.
+	 * @return Whether the item matches.
+	 */
+	bool Matches (const FilterItem_ptr& item, const QByteArray& urlUtf8, const QString& domain);
+
+	/** @brief Checks whether the filter item matches the request.
+	 *
+	 * This is the full check, including third-party and object type
+	 * restrictions.
+	 */
+	bool Matches (const FilterItem_ptr& item, const RequestContext& ctx);
+
+	/** @brief A compiled set of filter items optimized for matching.
+	 *
+	 * Instead of checking every filter item against every request, the
+	 * items are indexed by a single rare token taken from their
+	 * pattern. A token is a run of alphanumeric or '%' characters that
+	 * is bounded by separator characters (or by an anchor) in the
+	 * pattern, so it is guaranteed to be a whole token of any URL the
+	 * item matches. The URL of a request is thus tokenized once, and
+	 * only the items from the buckets of its tokens are checked.
+	 *
+	 * The items without such a token are put into separate buckets:
+	 * the items restricted to some domains are indexed by those
+	 * domains, begin- and end-anchored items, regular expressions and
+	 * everything else are kept in their own lists and always checked.
+	 *
+	 * The matcher is immutable after construction, so it can be used
+	 * from multiple threads simultaneously.
+	 */
+	class FilterMatcher
+	{
+		typedef QVector<FilterItem_ptr> Bucket_t;
+
+		QHash<quint32, Bucket_t> CinTokens_;
+		QHash<quint32, Bucket_t> CsTokens_;
+		QHash<quint32, Bucket_t> Domains_;
+
+		Bucket_t Anchored_;
+		Bucket_t Regexps_;
+		Bucket_t Generic_;
+
+		int Size_ = 0;
+	public:
+		FilterMatcher () = default;
+
+		/** @brief Compiles the given filter items.
+		 *
+		 * The items with a non-empty hiding selector are ignored.
+		 *
+		 * @param[in] items The filter items to compile.
+		 */
+		explicit FilterMatcher (const QList<FilterItem_ptr>& items);
+
+		/** @brief Returns the first item matching the request.
+		 *
+		 * @param[in] ctx The request to check.
+		 * @return The matching item or a null pointer if none
+		 * matches.
+		 */
+		FilterItem_ptr FindMatch (const RequestContext& ctx) const;
+
+		/** @brief Returns the number of compiled items.
+		 */
+		int GetSize () const;
+
+		/** @brief Returns the number of items checked for every request.
+		 *
+		 * These are the items that could not be indexed by a token or
+		 * by a domain.
+		 */
+		int GetUnindexedCount () const;
+	private:
+		void Add (const FilterItem_ptr&, const QList<QByteArray>&, const QHash<QByteArray, int>&);
+	};
+}
+}
+}
@@ -0,0 +1,258 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filterscache.h"
+#include <algorithm>
+#include <stdexcept>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QtDebug>
+#include <util/sys/paths.h>
+#include "lineparser.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		const quint32 CacheMagic = 0x4c434357;
+		const quint8 CacheVersion = 2;
+		const auto CacheStreamVersion = QDataStream::Qt_5_0;
+
+		const QString CacheSuffix = ".lccache";
+
+		struct SourceInfo
+		{
+			qint64 Size_;
+			qint64 MTime_;
+		};
+
+		SourceInfo GetSourceInfo (const QString& path)
+		{
+			const QFileInfo fi { path };
+			return { fi.size (), fi.lastModified ().toMSecsSinceEpoch () };
+		}
+
+		QByteArray GetSourceHash (const QString& path)
+		{
+			QFile file { path };
+			if (!file.open (QIODevice::ReadOnly))
+				return {};
+
+			QCryptographicHash hash { QCryptographicHash::Sha1 };
+			hash.addData (&file);
+			return hash.result ();
+		}
+
+		bool ReadItems (QDataStream& in, QList<FilterItem_ptr>& items)
+		{
+			quint32 count = 0;
+			in >> count;
+			if (in.status () != QDataStream::Ok)
+				return false;
+
+			items.reserve (std::min<quint32> (count, 1 << 20));
+			for (quint32 i = 0; i < count; ++i)
+			{
+				const auto& item = std::make_shared<FilterItem> ();
+				in >> *item;
+				if (in.status () != QDataStream::Ok)
+					return false;
+				items << item;
+			}
+			return true;
+		}
+
+		void WriteItems (QDataStream& out, const QList<FilterItem_ptr>& items)
+		{
+			out << static_cast<quint32> (items.size ());
+			for (const auto& item : items)
+				out << *item;
+		}
+	}
+
+	FiltersCache::FiltersCache ()
+	{
+		try
+		{
+			CacheDir_ = Util::GetUserDir (Util::UserDir::Cache, "poshuku/cleanweb");
+			IsValid_ = true;
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to get cache directory, caching is disabled:"
+					<< e.what ();
+		}
+	}
+
+	boost::optional<Filter> FiltersCache::Load (const QString& subscrPath) const
+	{
+		if (!IsValid_)
+			return {};
+
+		QFile file { GetCachePath (subscrPath) };
+		if (!file.open (QIODevice::ReadOnly))
+			return {};
+
+		const auto size = file.size ();
+		const auto mapped = file.map (0, size);
+		if (!mapped)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to map"
+					<< file.fileName ()
+					<< file.errorString ();
+			return {};
+		}
+
+		const auto& data = QByteArray::fromRawData (reinterpret_cast<const char*> (mapped), size);
+		QDataStream in { data };
+		in.setVersion (CacheStreamVersion);
+
+		quint32 magic = 0;
+		quint8 version = 0;
+		quint8 parserVersion = 0;
+		quint8 itemVersion = 0;
+		qint8 optionVersion = 0;
+		in >> magic >> version >> parserVersion >> itemVersion >> optionVersion;
+		if (magic != CacheMagic ||
+				version != CacheVersion ||
+				parserVersion != LineParser::FormatVersion ||
+				itemVersion != FilterItemStreamVersion ||
+				optionVersion != FilterOptionStreamVersion)
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "outdated cache format for"
+					<< subscrPath;
+			return {};
+		}
+
+		SourceInfo cachedInfo;
+		QByteArray cachedHash;
+		in >> cachedInfo.Size_ >> cachedInfo.MTime_ >> cachedHash;
+
+		const auto& info = GetSourceInfo (subscrPath);
+		const bool infoMatches = info.Size_ == cachedInfo.Size_ && info.MTime_ == cachedInfo.MTime_;
+		if (!infoMatches && GetSourceHash (subscrPath) != cachedHash)
+			return {};
+
+		Filter filter;
+		if (!ReadItems (in, filter.Filters_) ||
+				!ReadItems (in, filter.Exceptions_))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "corrupted cache for"
+					<< subscrPath;
+			return {};
+		}
+
+		file.unmap (mapped);
+		file.close ();
+
+		// The file has been touched without changing, so refresh the tag
+		// reusing the hash that has just been checked.
+		if (!infoMatches)
+			Write (subscrPath, cachedHash, filter);
+
+		return filter;
+	}
+
+	void FiltersCache::Save (const QString& subscrPath, const Filter& filter) const
+	{
+		if (!IsValid_)
+			return;
+
+		Write (subscrPath, GetSourceHash (subscrPath), filter);
+	}
+
+	void FiltersCache::Write (const QString& subscrPath, const QByteArray& hash, const Filter& filter) const
+	{
+		QSaveFile file { GetCachePath (subscrPath) };
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		const auto& info = GetSourceInfo (subscrPath);
+
+		QDataStream out { &file };
+		out.setVersion (CacheStreamVersion);
+		out << CacheMagic
+				<< CacheVersion
+				<< LineParser::FormatVersion
+				<< FilterItemStreamVersion
+				<< FilterOptionStreamVersion
+				<< info.Size_
+				<< info.MTime_
+				<< hash;
+		WriteItems (out, filter.Filters_);
+		WriteItems (out, filter.Exceptions_);
+
+		if (!file.commit ())
+			qWarning () << Q_FUNC_INFO
+					<< "unable to save"
+					<< file.fileName ()
+					<< file.errorString ();
+	}
+
+	void FiltersCache::RemoveStale (const QStringList& subscrPaths) const
+	{
+		if (!IsValid_)
+			return;
+
+		QSet<QString> actual;
+		for (const auto& path : subscrPaths)
+			actual << QFileInfo { GetCachePath (path) }.fileName ();
+
+		for (const auto& name : CacheDir_.entryList ({ "*" + CacheSuffix }, QDir::Files))
+			if (!actual.contains (name) && !CacheDir_.remove (name))
+				qWarning () << Q_FUNC_INFO
+						<< "unable to remove stale cache"
+						<< name;
+	}
+
+	QString FiltersCache::GetCachePath (const QString& subscrPath) const
+	{
+		return CacheDir_.filePath (QFileInfo { subscrPath }.fileName () + CacheSuffix);
+	}
+}
+}
+}
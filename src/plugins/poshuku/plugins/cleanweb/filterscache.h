@@ -0,0 +1,90 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QDir>
+#include "filter.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** @brief Binary cache of the parsed subscriptions.
+	 *
+	 * Each subscription file gets its own cache file with the parsed
+	 * filter items, tagged with the size, modification time and
+	 * content hash of the subscription file it has been made from.
+	 * The cache file is memory-mapped during loading.
+	 *
+	 * If the size or the modification time of the subscription differ
+	 * from the ones stored in the cache, the content hash is checked,
+	 * so redownloading the same list doesn't result in reparsing it.
+	 *
+	 * The cache is also tagged with the parser and the filter items
+	 * serialization versions, and is discarded if any of them change.
+	 */
+	class FiltersCache
+	{
+		QDir CacheDir_;
+		bool IsValid_ = false;
+	public:
+		FiltersCache ();
+
+		/** @brief Loads the cached parsed version of the subscription.
+		 *
+		 * @param[in] subscrPath The full path to the subscription file.
+		 * @return The parsed filter or an empty optional if there is
+		 * no up-to-date cache for the subscription.
+		 */
+		boost::optional<Filter> Load (const QString& subscrPath) const;
+
+		/** @brief Saves the parsed version of the subscription.
+		 *
+		 * @param[in] subscrPath The full path to the subscription file.
+		 * @param[in] filter The filter parsed from that file.
+		 */
+		void Save (const QString& subscrPath, const Filter& filter) const;
+
+		/** @brief Removes the cache of the subscriptions not in the list.
+		 *
+		 * @param[in] subscrPaths The full paths to the subscriptions
+		 * that are still present.
+		 */
+		void RemoveStale (const QStringList& subscrPaths) const;
+	private:
+		QString GetCachePath (const QString&) const;
+		void Write (const QString&, const QByteArray&, const Filter&) const;
+	};
+}
+}
+}
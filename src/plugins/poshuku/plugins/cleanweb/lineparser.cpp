@@ -28,6 +28,7 @@
  **********************************************************************/
 
 #include "lineparser.h"
+#include <QRegExp>
 #include <QtDebug>
 #include "filter.h"
 
@@ -176,9 +177,14 @@ namespace CleanWeb
 				if (!Util::RegExp::IsFast ())
 					return;
 
-				actualLine.replace ('*', ".*");
-				if (f.MatchType_ != FilterOption::MatchType::Wildcard)
-					actualLine.replace ('?', "\\?");
+				/* Everything besides the wildcards and separators is
+				 * matched literally, otherwise the dots in domain names
+				 * would match any character.
+				 */
+				if (f.MatchType_ == FilterOption::MatchType::Wildcard)
+					actualLine.replace ("\\?", "?");
+				actualLine = QRegExp::escape (actualLine);
+				actualLine.replace ("\\*", ".*");
 				switch (f.MatchType_)
 				{
 				case FilterOption::MatchType::End:
@@ -195,7 +201,7 @@ namespace CleanWeb
 				case FilterOption::MatchType::Regexp:
 					break;
 				}
-				actualLine.replace ('^', "[/?=&:]");
+				actualLine.replace ("\\^", "[/?=&:]");
 				f.MatchType_ = FilterOption::MatchType::Regexp;
 			}
 
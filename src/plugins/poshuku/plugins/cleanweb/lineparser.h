@@ -29,6 +29,8 @@
 
 #pragma once
 
+#include <QtGlobal>
+
 class QString;
 
 namespace LeechCraft
@@ -45,6 +47,12 @@ namespace CleanWeb
 		int Total_ = 0;
 		int Success_ = 0;
 	public:
+		/** The version of the parsing rules. Bump it whenever the same
+		 * line starts being parsed into different filter items, so that
+		 * the cached parsed subscriptions get invalidated.
+		 */
+		static constexpr quint8 FormatVersion = 1;
+
 		LineParser (Filter*);
 
 		int GetTotal () const;
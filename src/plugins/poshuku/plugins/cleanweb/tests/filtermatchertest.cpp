@@ -0,0 +1,251 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filtermatchertest.h"
+#include <algorithm>
+#include <functional>
+#include <QtTest>
+#include <QtConcurrentMap>
+#include <QFile>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QUrl>
+#include "lineparser.h"
+
+QTEST_GUILESS_MAIN (LeechCraft::Poshuku::CleanWeb::FilterMatcherTest)
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		QString GetDataPath (const char *envVar, const QString& defName)
+		{
+			const auto& env = qgetenv (envVar);
+			return env.isEmpty () ?
+					QString { CLEANWEB_TESTS_DATA_DIR "/" } + defName :
+					QString::fromLocal8Bit (env);
+		}
+
+		QStringList ReadLines (const QString& path)
+		{
+			QFile file { path };
+			if (!file.open (QIODevice::ReadOnly))
+				qFatal ("unable to open %s: %s",
+						qPrintable (path),
+						qPrintable (file.errorString ()));
+
+			QStringList result;
+			for (const auto& line : QString::fromUtf8 (file.readAll ()).split ('\n', QString::SkipEmptyParts))
+				result << line.trimmed ();
+			return result;
+		}
+
+		FilterOption::MatchObjects ParseType (const QString& type)
+		{
+			if (type == "image")
+				return FilterOption::MatchObject::Image;
+			if (type == "script")
+				return FilterOption::MatchObject::Script;
+			if (type == "stylesheet")
+				return FilterOption::MatchObject::CSS;
+			if (type == "subframe")
+				return FilterOption::MatchObject::Subdocument;
+			return FilterOption::MatchObject::All;
+		}
+
+		bool MatchLinear (const QList<FilterItem_ptr>& items, const RequestContext& ctx)
+		{
+			return std::any_of (items.begin (), items.end (),
+					[&ctx] (const FilterItem_ptr& item) { return Matches (item, ctx); });
+		}
+
+		bool ShouldRejectLinear (const QList<FilterItem_ptr>& exceptions,
+				const QList<FilterItem_ptr>& filters, const RequestContext& ctx)
+		{
+			return !MatchLinear (exceptions, ctx) && MatchLinear (filters, ctx);
+		}
+
+		QList<QList<FilterItem_ptr>> Chunk (const QList<FilterItem_ptr>& items)
+		{
+			const auto chunkSize = std::max (items.size () / std::max (QThread::idealThreadCount (), 2) / 4, 200);
+
+			QList<QList<FilterItem_ptr>> result;
+			for (int i = 0; i < items.size (); i += chunkSize)
+				result << items.mid (i, chunkSize);
+			return result;
+		}
+
+		bool MatchConcurrent (const QList<QList<FilterItem_ptr>>& chunks, const RequestContext& ctx)
+		{
+			return QtConcurrent::blockingMappedReduced (chunks.begin (), chunks.end (),
+					std::function<bool (const QList<FilterItem_ptr>&)>
+					{
+						[&ctx] (const QList<FilterItem_ptr>& items) { return MatchLinear (items, ctx); }
+					},
+					+[] (bool& res, bool value) { res = res || value; });
+		}
+
+		bool ShouldRejectIndexed (const FilterMatcher& exceptions,
+				const FilterMatcher& filters, const RequestContext& ctx)
+		{
+			return !exceptions.FindMatch (ctx) && filters.FindMatch (ctx);
+		}
+
+		template<typename F>
+		void ReportPerRequest (const QList<RequestContext>& requests, F&& f)
+		{
+			QElapsedTimer timer;
+			timer.start ();
+			for (const auto& req : requests)
+				f (req);
+			qDebug () << timer.nsecsElapsed () / std::max (requests.size (), 1) << "ns per request";
+		}
+	}
+
+	void FilterMatcherTest::initTestCase ()
+	{
+		auto filterLines = ReadLines (GetDataPath ("LC_POSHUKU_CLEANWEB_BENCH_FILTERS", "filters.txt"));
+		if (!filterLines.isEmpty ())
+			filterLines.removeAt (0);
+
+		Filter filter;
+		std::for_each (filterLines.begin (), filterLines.end (), LineParser (&filter));
+
+		for (const auto& item : filter.Filters_)
+			if (item->Option_.HideSelector_.isEmpty ())
+				Filters_ << item;
+		for (const auto& item : filter.Exceptions_)
+			if (item->Option_.HideSelector_.isEmpty ())
+				Exceptions_ << item;
+
+		for (const auto& line : ReadLines (GetDataPath ("LC_POSHUKU_CLEANWEB_BENCH_REQUESTS", "requests.txt")))
+		{
+			if (line.startsWith ('#'))
+				continue;
+
+			const auto& parts = line.split (' ', QString::SkipEmptyParts);
+			if (parts.size () != 3)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "skipping malformed line"
+						<< line;
+				continue;
+			}
+
+			Requests_ << MakeRequestContext (QUrl { parts.at (2) }, QUrl { parts.at (1) }, ParseType (parts.at (0)));
+		}
+
+		qDebug () << Filters_.size () << "filters," << Exceptions_.size () << "exceptions," << Requests_.size () << "requests";
+	}
+
+	void FilterMatcherTest::testRegexpEscaping ()
+	{
+		if (!Util::RegExp::IsFast ())
+			QSKIP ("separator-matching filters are only supported with PCRE");
+
+		Filter filter;
+		LineParser { &filter } ("||ads.example.com^");
+
+		const FilterMatcher matcher { filter.Filters_ };
+		QVERIFY (matcher.GetSize ());
+		QCOMPARE (matcher.GetUnindexedCount (), 0);
+
+		auto check = [&matcher] (const QString& url)
+		{
+			return static_cast<bool> (matcher.FindMatch (MakeRequestContext (QUrl { url },
+					QUrl { "http://example.org/" }, FilterOption::MatchObject::Image)));
+		};
+
+		QVERIFY (check ("http://ads.example.com/banner.png"));
+		QVERIFY (check ("http://sub.ads.example.com/banner.png"));
+		QVERIFY (!check ("http://adsXexample.com/banner.png"));
+	}
+
+	void FilterMatcherTest::testEquivalence ()
+	{
+		const FilterMatcher exceptions { Exceptions_ };
+		const FilterMatcher filters { Filters_ };
+
+		int rejected = 0;
+		for (const auto& req : Requests_)
+		{
+			const auto linear = ShouldRejectLinear (Exceptions_, Filters_, req);
+			const auto indexed = ShouldRejectIndexed (exceptions, filters, req);
+			if (linear != indexed)
+				qWarning () << "mismatch for" << req.UrlUtf8_ << "on" << req.Domain_;
+			QCOMPARE (indexed, linear);
+
+			rejected += indexed;
+		}
+
+		qDebug () << rejected << "of" << Requests_.size () << "requests rejected;"
+				<< filters.GetUnindexedCount () << "of" << filters.GetSize () << "filters are unindexed";
+	}
+
+	void FilterMatcherTest::benchLinear ()
+	{
+		auto f = [this] (const RequestContext& req) { ShouldRejectLinear (Exceptions_, Filters_, req); };
+		ReportPerRequest (Requests_, f);
+		QBENCHMARK { std::for_each (Requests_.begin (), Requests_.end (), f); }
+	}
+
+	void FilterMatcherTest::benchLinearConcurrent ()
+	{
+		const auto& exceptions = Chunk (Exceptions_);
+		const auto& filters = Chunk (Filters_);
+
+		auto f = [&] (const RequestContext& req)
+		{
+			return !MatchConcurrent (exceptions, req) && MatchConcurrent (filters, req);
+		};
+		ReportPerRequest (Requests_, f);
+		QBENCHMARK { std::for_each (Requests_.begin (), Requests_.end (), f); }
+	}
+
+	void FilterMatcherTest::benchIndexed ()
+	{
+		const FilterMatcher exceptions { Exceptions_ };
+		const FilterMatcher filters { Filters_ };
+
+		auto f = [&] (const RequestContext& req) { ShouldRejectIndexed (exceptions, filters, req); };
+		ReportPerRequest (Requests_, f);
+		QBENCHMARK { std::for_each (Requests_.begin (), Requests_.end (), f); }
+	}
+
+	void FilterMatcherTest::benchCompile ()
+	{
+		QBENCHMARK { FilterMatcher { Filters_ }; }
+	}
+}
+}
+}
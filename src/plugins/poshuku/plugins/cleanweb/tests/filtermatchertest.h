@@ -0,0 +1,78 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include "filter.h"
+#include "filtermatcher.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	/** Replays a recorded corpus of requests against a filter list.
+	 *
+	 * The filter list is an Adblock Plus subscription file, and the
+	 * corpus has a request per line, in the following format:
+	 *
+	 *     <resource type> <page URL> <request URL>
+	 *
+	 * where resource type is one of image, script, stylesheet,
+	 * subframe or other.
+	 *
+	 * By default the small lists from the data directory are used, the
+	 * LC_POSHUKU_CLEANWEB_BENCH_FILTERS and LC_POSHUKU_CLEANWEB_BENCH_REQUESTS
+	 * environment variables can be used to point to real-world ones.
+	 */
+	class FilterMatcherTest : public QObject
+	{
+		Q_OBJECT
+
+		QList<FilterItem_ptr> Filters_;
+		QList<FilterItem_ptr> Exceptions_;
+
+		QList<RequestContext> Requests_;
+	private slots:
+		void initTestCase ();
+
+		void testRegexpEscaping ();
+		void testEquivalence ();
+
+		void benchLinear ();
+		void benchLinearConcurrent ();
+		void benchIndexed ();
+		void benchCompile ();
+	};
+}
+}
+}
@@ -0,0 +1,107 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "verdictcache.h"
+#include <algorithm>
+#include <QMutexLocker>
+#include "filtermatcher.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	VerdictCache::VerdictCache (int capacity)
+	{
+		for (auto& shard : Shards_)
+			shard.Cache_.setMaxCost (std::max (capacity / ShardsCount, 1));
+	}
+
+	boost::optional<VerdictCache::Verdict> VerdictCache::Get (const Key& key)
+	{
+		auto& shard = GetShard (key);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		if (const auto verdict = shard.Cache_.object (key))
+		{
+			++Hits_;
+			return *verdict;
+		}
+
+		++Misses_;
+		return {};
+	}
+
+	void VerdictCache::Put (const Key& key, Verdict verdict)
+	{
+		auto& shard = GetShard (key);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		shard.Cache_.insert (key, new Verdict { verdict });
+	}
+
+	quint64 VerdictCache::GetHits () const
+	{
+		return Hits_;
+	}
+
+	quint64 VerdictCache::GetMisses () const
+	{
+		return Misses_;
+	}
+
+	VerdictCache::Shard& VerdictCache::GetShard (const Key& key)
+	{
+		return Shards_ [qHash (key) % ShardsCount];
+	}
+
+	VerdictCache::Key MakeVerdictKey (const RequestContext& ctx)
+	{
+		return { ctx.UrlUtf8_, ctx.Domain_, ctx.Objs_, ctx.IsThirdParty_ };
+	}
+
+	bool operator== (const VerdictCache::Key& left, const VerdictCache::Key& right)
+	{
+		return left.IsThirdParty_ == right.IsThirdParty_ &&
+				left.Objs_ == right.Objs_ &&
+				left.Url_ == right.Url_ &&
+				left.Domain_ == right.Domain_;
+	}
+
+	uint qHash (const VerdictCache::Key& key)
+	{
+		return qHash (key.Url_) ^
+				qHash (key.Domain_) * 31 ^
+				static_cast<uint> (key.Objs_) << 1 ^
+				static_cast<uint> (key.IsThirdParty_);
+	}
+}
+}
+}
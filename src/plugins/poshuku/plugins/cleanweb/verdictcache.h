@@ -0,0 +1,114 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <boost/optional.hpp>
+#include <QCache>
+#include <QMutex>
+#include "filter.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	struct RequestContext;
+
+	/** @brief Caches the filtering verdicts for the recently seen requests.
+	 *
+	 * The cache is split into several LRU shards, each guarded by its
+	 * own mutex, so that the requests coming from different threads
+	 * rarely contend for the same lock.
+	 *
+	 * The cache is tied to a specific set of compiled filters, so it is
+	 * invalidated by just replacing it together with the filters.
+	 */
+	class VerdictCache
+	{
+	public:
+		enum class Verdict
+		{
+			Allow,
+			Block
+		};
+
+		struct Key
+		{
+			QByteArray Url_;
+			QString Domain_;
+			FilterOption::MatchObjects Objs_;
+			bool IsThirdParty_;
+		};
+	private:
+		static const int ShardsCount = 16;
+
+		struct Shard
+		{
+			QMutex Mutex_;
+			QCache<Key, Verdict> Cache_;
+		};
+		std::array<Shard, ShardsCount> Shards_;
+
+		std::atomic<quint64> Hits_ { 0 };
+		std::atomic<quint64> Misses_ { 0 };
+	public:
+		/** @brief Creates the cache holding up to the given number of verdicts.
+		 *
+		 * @param[in] capacity The maximum number of verdicts to keep.
+		 */
+		explicit VerdictCache (int capacity = 16384);
+
+		VerdictCache (const VerdictCache&) = delete;
+		VerdictCache& operator= (const VerdictCache&) = delete;
+
+		/** @brief Returns the cached verdict for the request, if any.
+		 */
+		boost::optional<Verdict> Get (const Key& key);
+
+		/** @brief Stores the verdict for the request.
+		 */
+		void Put (const Key& key, Verdict verdict);
+
+		quint64 GetHits () const;
+		quint64 GetMisses () const;
+	private:
+		Shard& GetShard (const Key&);
+	};
+
+	VerdictCache::Key MakeVerdictKey (const RequestContext&);
+
+	bool operator== (const VerdictCache::Key&, const VerdictCache::Key&);
+	uint qHash (const VerdictCache::Key&);
+}
+}
+}
@@ -29,7 +29,6 @@
 
 #include "sqlstoragebackend.h"
 #include <stdexcept>
-#include <cmath>
 #include <QDir>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -81,6 +80,18 @@ namespace Poshuku
 		}
 	};
 
+	struct SQLStorageBackend::HistoryFrecency
+	{
+		oral::PKey<QString, oral::NoAutogen> URL_;
+		QString Title_;
+		double Frecency_;
+
+		static QString ClassName ()
+		{
+			return "HistoryFrecency";
+		}
+	};
+
 	struct SQLStorageBackend::Favorites
 	{
 		oral::PKey<QString, oral::NoAutogen> Title_;
@@ -129,6 +140,10 @@ BOOST_FUSION_ADAPT_STRUCT (LeechCraft::Poshuku::SQLStorageBackend::History,
 		Date_,
 		Title_,
 		URL_)
+BOOST_FUSION_ADAPT_STRUCT (LeechCraft::Poshuku::SQLStorageBackend::HistoryFrecency,
+		URL_,
+		Title_,
+		Frecency_)
 BOOST_FUSION_ADAPT_STRUCT (LeechCraft::Poshuku::SQLStorageBackend::Favorites,
 		Title_,
 		URL_,
@@ -185,10 +200,15 @@ namespace Poshuku
 		if (type == SBSQLite)
 			Util::RunTextQuery (DB_, "PRAGMA journal_model = WAL;");
 
-		auto adaptedPtrs = std::tie (History_, Favorites_, FormsNever_);
+		auto adaptedPtrs = std::tie (History_, Frecency_, Favorites_, FormsNever_);
 		type == SBSQLite ?
 				oral::AdaptPtrs<oral::SQLiteImplFactory> (DB_, adaptedPtrs) :
 				oral::AdaptPtrs<oral::PostgreSQLImplFactory> (DB_, adaptedPtrs);
+
+		Util::RunTextQuery (DB_, "DROP INDEX IF EXISTS idx_history_url;");
+		Util::RunTextQuery (DB_, "CREATE INDEX IF NOT EXISTS idx_history_url_date ON History (URL, Date);");
+
+		InitializeFrecency ();
 	}
 
 	void SQLStorageBackend::LoadHistory (history_items_t& items) const
@@ -197,60 +217,94 @@ namespace Poshuku
 			items.push_back (item.ToHistoryItem ());
 	}
 
-	namespace
+	std::optional<QDateTime> SQLStorageBackend::GetOldestHistoryDate () const
 	{
-		double Score (const QList<int>& diffs)
+		return History_->SelectOne
+				.Build ()
+				.Select (sph::fields<&History::Date_>)
+				.Order (oral::OrderBy<sph::asc<&History::Date_>>)
+				.Limit (1)
+				();
+	}
+
+	history_items_t SQLStorageBackend::LoadHistoryPage (const QDateTime& from,
+			const QDateTime& before, int count) const
+	{
+		const QString beforeClause = before.isValid () ? "AND h.Date < :before " : "";
+
+		QSqlQuery query { DB_ };
+		query.prepare ("SELECT h.Date, h.Title, h.URL FROM History h "
+				"WHERE h.Date >= :from " + beforeClause +
+				"AND NOT EXISTS (SELECT 1 FROM History newer WHERE newer.URL = h.URL AND newer.Date > h.Date) "
+				"ORDER BY h.Date DESC "
+				"LIMIT :count;");
+		query.bindValue (":from", from);
+		if (before.isValid ())
+			query.bindValue (":before", before);
+		query.bindValue (":count", count);
+		if (!query.exec ())
 		{
-			const auto k = 1 / 86400.; // decay rate should be the same order of magnitude as a day
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("unable to load history page");
+		}
 
-			double result = 0;
-			for (auto diff : diffs)
-				result += std::exp (-k * diff);
-			return result;
+		history_items_t result;
+		while (query.next ())
+			result.push_back ({
+					query.value (1).toString (),
+					query.value (0).toDateTime (),
+					query.value (2).toString ()
+				});
+		return result;
+	}
+
+	namespace
+	{
+		const int MaxCompletionItems = 100;
+
+		bool IsFrecencyTracked (const QString& url)
+		{
+			return !url.startsWith ("data:");
 		}
 	}
 
 	history_items_t SQLStorageBackend::LoadResemblingHistory (const QString& base) const
 	{
-		using namespace oral::infix;
-
-		const auto& pat = "%" + base + "%";
-		const auto& allItems = History_->Select.Build ()
-				.Select (sph::all)
-				.Where (sph::f<&History::Title_> |like| pat || sph::f<&History::URL_> |like| pat)
-				.Order (oral::OrderBy<sph::desc<&History::Date_>>)
-				();
+		return CompletionIndex_.Find (base, MaxCompletionItems);
+	}
 
-		const auto& now = QDateTime::currentDateTime ();
+	void SQLStorageBackend::AddToHistory (const HistoryItem& item)
+	{
+		QList<CompletionUpdate> updates;
 
-		QHash<QString, QString> url2title;
-		QHash<QString, QList<int>> url2diffs;
-		for (const auto& item : allItems)
 		{
-			if (item.URL_.startsWith ("data:"))
-				continue;
+			Util::DBLock lock { DB_ };
+			lock.Init ();
 
-			if (!url2title.contains (item.URL_))
-				url2title [item.URL_] = item.Title_;
+			// A visit with the same date replaces the existing one, which
+			// then doesn't count towards the frecency of its URL anymore.
+			const auto& replaced = History_->SelectOne (sph::f<&History::Date_> == item.DateTime_);
 
-			url2diffs [item.URL_] << item.Date_->secsTo (now);
-		}
+			History_->Insert (History::FromHistoryItem (item), oral::InsertAction::Replace::PKey<History>);
 
-		auto scored = Util::Map (Util::Stlize (url2diffs),
-				[] (const auto& pair) { return QPair { pair.first, Score (pair.second) }; });
-		std::sort (scored.rbegin (), scored.rend (), Util::ComparingBy (Util::Snd));
+			if (replaced && IsFrecencyTracked (replaced->URL_))
+				updates << RemoveVisits (replaced->URL_, { *replaced->Date_ });
 
-		return Util::Map (scored,
-				[&url2title] (const auto& pair)
-				{
-					const auto& url = pair.first;
-					return HistoryItem { url2title [url], {}, url };
-				});
-	}
+			if (IsFrecencyTracked (item.URL_))
+			{
+				const auto& prevFrecency = Frecency_->SelectOne (sph::fields<&HistoryFrecency::Frecency_>,
+						sph::f<&HistoryFrecency::URL_> == item.URL_);
+				const auto frecency = URLCompletionIndex::AddVisit (prevFrecency, item.DateTime_);
+				Frecency_->Insert (HistoryFrecency { item.URL_, item.Title_, frecency },
+						oral::InsertAction::Replace::PKey<HistoryFrecency>);
+				updates << CompletionUpdate { item.URL_, item.Title_, frecency };
+			}
+
+			lock.Good ();
+		}
+
+		ApplyCompletionUpdates (updates);
 
-	void SQLStorageBackend::AddToHistory (const HistoryItem& item)
-	{
-		History_->Insert (History::FromHistoryItem (item), oral::InsertAction::Replace::PKey<History>);
 		emit added (item);
 	}
 
@@ -269,7 +323,27 @@ namespace Poshuku
 		const auto& threshold = countDateThreshold ?
 				std::min (*countDateThreshold, ageDateThreshold) :
 				ageDateThreshold;
-		History_->DeleteBy (sph::f<&History::Date_> < threshold);
+
+		QHash<QString, QList<QDateTime>> url2visits;
+		for (const auto& item : History_->Select (sph::f<&History::Date_> < threshold))
+			if (IsFrecencyTracked (item.URL_))
+				url2visits [item.URL_] << *item.Date_;
+
+		QList<CompletionUpdate> updates;
+
+		{
+			Util::DBLock lock { DB_ };
+			lock.Init ();
+
+			History_->DeleteBy (sph::f<&History::Date_> < threshold);
+
+			for (const auto& pair : Util::Stlize (url2visits))
+				updates << RemoveVisits (pair.first, pair.second);
+
+			lock.Good ();
+		}
+
+		ApplyCompletionUpdates (updates);
 	}
 
 	void SQLStorageBackend::LoadFavorites (FavoritesModel::items_t& items) const
@@ -308,5 +382,60 @@ namespace Poshuku
 	{
 		return FormsNever_->Select (sph::count<>, sph::f<&FormsNever::URL_> == url);
 	}
+
+	void SQLStorageBackend::InitializeFrecency ()
+	{
+		if (!Frecency_->Select (sph::count<>) && History_->Select (sph::count<>))
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "building the frecency table from the history";
+
+			QHash<QString, QPair<QString, std::optional<double>>> url2frecency;
+			for (const auto& item : History_->Select.Build ().Order (oral::OrderBy<sph::asc<&History::Date_>>) ())
+			{
+				if (!IsFrecencyTracked (item.URL_))
+					continue;
+
+				auto& frecency = url2frecency [item.URL_];
+				frecency.first = item.Title_;
+				frecency.second = URLCompletionIndex::AddVisit (frecency.second, *item.Date_);
+			}
+
+			QList<HistoryFrecency> records;
+			for (const auto& pair : Util::Stlize (url2frecency))
+				records.append (HistoryFrecency { pair.first, pair.second.first, *pair.second.second });
+			Frecency_->InsertBatch (records);
+		}
+
+		for (const auto& frecency : Frecency_->Select ())
+			CompletionIndex_.Add (*frecency.URL_, frecency.Title_, frecency.Frecency_);
+	}
+
+	auto SQLStorageBackend::RemoveVisits (const QString& url, const QList<QDateTime>& visits) -> CompletionUpdate
+	{
+		if (!History_->Select (sph::count<>, sph::f<&History::URL_> == url))
+		{
+			Frecency_->DeleteBy (sph::f<&HistoryFrecency::URL_> == url);
+			return { url, {}, {} };
+		}
+
+		auto frecency = Frecency_->SelectOne (sph::f<&HistoryFrecency::URL_> == url);
+		if (!frecency)
+			return { url, {}, {} };
+
+		for (const auto& visit : visits)
+			frecency->Frecency_ = URLCompletionIndex::RemoveVisit (frecency->Frecency_, visit);
+		Frecency_->Update (*frecency);
+		return { url, frecency->Title_, frecency->Frecency_ };
+	}
+
+	void SQLStorageBackend::ApplyCompletionUpdates (const QList<CompletionUpdate>& updates)
+	{
+		for (const auto& update : updates)
+			if (update.Frecency_)
+				CompletionIndex_.Add (update.URL_, update.Title_, *update.Frecency_);
+			else
+				CompletionIndex_.Remove (update.URL_);
+	}
 }
 }
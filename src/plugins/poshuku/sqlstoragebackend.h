@@ -30,6 +30,7 @@
 #pragma once
 
 #include "storagebackend.h"
+#include "urlcompletionindex.h"
 #include <QSqlDatabase>
 #include <util/sll/util.h>
 #include <util/db/oral/oralfwd.h>
@@ -44,16 +45,22 @@ namespace Poshuku
 		const Util::DefaultScopeGuard DBGuard_;
 	public:
 		struct History;
+		struct HistoryFrecency;
 		struct Favorites;
 		struct FormsNever;
 	private:
 		Util::oral::ObjectInfo_ptr<History> History_;
+		Util::oral::ObjectInfo_ptr<HistoryFrecency> Frecency_;
 		Util::oral::ObjectInfo_ptr<Favorites> Favorites_;
 		Util::oral::ObjectInfo_ptr<FormsNever> FormsNever_;
+
+		URLCompletionIndex CompletionIndex_;
 	public:
 		SQLStorageBackend (Type);
 
 		void LoadHistory (history_items_t&) const override;
+		std::optional<QDateTime> GetOldestHistoryDate () const override;
+		history_items_t LoadHistoryPage (const QDateTime&, const QDateTime&, int) const override;
 		history_items_t LoadResemblingHistory (const QString&) const override;
 		void AddToHistory (const HistoryItem&) override;
 		void ClearOldHistory (int, int) override;
@@ -63,6 +70,21 @@ namespace Poshuku
 		void UpdateFavorites (const FavoritesModel::FavoritesItem&) override;
 		void SetFormsIgnored (const QString&, bool) override;
 		bool GetFormsIgnored (const QString&) const override;
+	private:
+		/** A change to the completion index, applied only after the
+		 * transaction changing the frecency table is committed. An
+		 * empty frecency means the URL is removed from the index.
+		 */
+		struct CompletionUpdate
+		{
+			QString URL_;
+			QString Title_;
+			std::optional<double> Frecency_;
+		};
+
+		void InitializeFrecency ();
+		CompletionUpdate RemoveVisits (const QString&, const QList<QDateTime>&);
+		void ApplyCompletionUpdates (const QList<CompletionUpdate>&);
 	};
 }
 }
@@ -30,6 +30,7 @@
 #ifndef PLUGINS_POSHUKU_STORAGEBACKEND_H
 #define PLUGINS_POSHUKU_STORAGEBACKEND_H
 #include <memory>
+#include <optional>
 #include <QObject>
 #include "interfaces/poshuku/poshukutypes.h"
 #include "interfaces/poshuku/istoragebackend.h"
@@ -62,13 +63,41 @@ namespace Poshuku
 		static std::shared_ptr<StorageBackend> Create (Type);
 		static std::shared_ptr<StorageBackend> Create ();
 
+		/** @brief Get the date of the oldest history item.
+			*
+			* @return The date of the oldest history item, or an empty
+			* optional if the history is empty.
+			*/
+		virtual std::optional<QDateTime> GetOldestHistoryDate () const = 0;
+
+		/** @brief Get a page of history items visited in a date range.
+			*
+			* Returns at most count history items visited not earlier than
+			* from and earlier than before, sorted by date in descending
+			* order. Only the most recent visit of each URL is considered,
+			* so a URL is only returned for the range containing its latest
+			* visit.
+			*
+			* The next page is obtained by passing the date of the last
+			* returned item as before.
+			*
+			* @param[in] from The lower bound of the date range, inclusive.
+			* @param[in] before The upper bound of the date range, exclusive,
+			* or an invalid date to leave the range unbounded.
+			* @param[in] count The maximum number of items to return.
+			* @return The history items in the date range.
+			*/
+		virtual history_items_t LoadHistoryPage (const QDateTime& from,
+				const QDateTime& before, int count) const = 0;
+
 		/** @brief Get resembling history items from the storage.
 			*
-			* Puts resembling history items (HistoryItem) from the
-			* storage backend into the passed container. An item is considered
-			* resembling if its title or URL contains base string. The
-			* resembling items container should be sorted by date in descending
-			* order.
+			* Returns resembling history items (HistoryItem) from the
+			* storage backend. An item is considered resembling if its title
+			* or URL contains base string. The resembling items should be
+			* sorted by their frecency (how often and how recently they were
+			* visited) in descending order, and only the best ones should be
+			* returned.
 			*
 			* @param[in] base The base string.
 			* @return The similar history items.
@@ -0,0 +1,262 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "urlcompletionindextest.h"
+#include <cmath>
+#include <random>
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+QTEST_GUILESS_MAIN (LeechCraft::Poshuku::URLCompletionIndexTest)
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	namespace
+	{
+		const int BenchVisitsCount = 1000000;
+		const int BenchURLsCount = 100000;
+
+		const QStringList Words
+		{
+			"news", "mail", "forum", "wiki",
+			"shop", "blog", "docs", "video",
+			"maps", "music", "photo", "games",
+			"sport", "travel", "code", "search"
+		};
+
+		QString MakeHost (int num)
+		{
+			const auto host = num / 50;
+			return Words [host % 16] + Words [host / 16 % 16] + QString::number (host / 256) + ".com";
+		}
+
+		QString MakeURL (int num)
+		{
+			return "https://www." + MakeHost (num) + "/" + Words [num % 16] + "/" + QString::number (num);
+		}
+
+		QString MakeTitle (int num)
+		{
+			return Words [num / 7 % 16] + " " + Words [num / 3 % 16] + " - " + MakeHost (num);
+		}
+
+		void RunQuery (QSqlQuery& query)
+		{
+			if (!query.exec ())
+				qFatal ("unable to execute query: %s", qPrintable (query.lastError ().text ()));
+		}
+
+		QSqlDatabase MakeHistoryDB ()
+		{
+			auto db = QSqlDatabase::addDatabase ("QSQLITE", "org.LeechCraft.Poshuku.Tests.History");
+			db.setDatabaseName (":memory:");
+			if (!db.open ())
+				qFatal ("unable to open database: %s", qPrintable (db.lastError ().text ()));
+
+			QSqlQuery create { db };
+			create.prepare ("CREATE TABLE History (Date TIMESTAMP PRIMARY KEY, Title TEXT, URL TEXT);");
+			RunQuery (create);
+
+			std::mt19937 gen { 42 };
+			std::uniform_real_distribution<> dist;
+
+			const auto& now = QDateTime::currentDateTime ();
+			const auto yearMSecs = 365 * 86400 * 1000.;
+
+			db.transaction ();
+			QSqlQuery insert { db };
+			insert.prepare ("INSERT OR IGNORE INTO History (Date, Title, URL) VALUES (?, ?, ?);");
+			for (int i = 0; i < BenchVisitsCount; ++i)
+			{
+				// squaring makes the low numbered URLs visited way more often
+				const auto r = dist (gen);
+				const auto num = static_cast<int> (r * r * BenchURLsCount);
+				const auto& date = now.addMSecs (-static_cast<qint64> (dist (gen) * yearMSecs));
+
+				insert.addBindValue (date);
+				insert.addBindValue (MakeTitle (num));
+				insert.addBindValue (MakeURL (num));
+				RunQuery (insert);
+			}
+			db.commit ();
+
+			return db;
+		}
+
+		void FillIndex (URLCompletionIndex& index, const QSqlDatabase& db)
+		{
+			QHash<QString, QPair<QString, std::optional<double>>> url2frecency;
+
+			QSqlQuery select { db };
+			select.prepare ("SELECT Date, Title, URL FROM History ORDER BY Date;");
+			RunQuery (select);
+			while (select.next ())
+			{
+				auto& frecency = url2frecency [select.value (2).toString ()];
+				frecency.first = select.value (1).toString ();
+				frecency.second = URLCompletionIndex::AddVisit (frecency.second, select.value (0).toDateTime ());
+			}
+
+			for (auto it = url2frecency.begin (); it != url2frecency.end (); ++it)
+				index.Add (it.key (), it->first, *it->second);
+		}
+
+		QStringList GetURLs (const history_items_t& items)
+		{
+			QStringList result;
+			for (const auto& item : items)
+				result << item.URL_;
+			return result;
+		}
+	}
+
+	void URLCompletionIndexTest::initTestCase ()
+	{
+		QElapsedTimer timer;
+		timer.start ();
+
+		{
+			const auto& db = MakeHistoryDB ();
+			FillIndex (BenchIndex_, db);
+		}
+		QSqlDatabase::removeDatabase ("org.LeechCraft.Poshuku.Tests.History");
+
+		qDebug () << "indexed" << BenchIndex_.GetSize () << "URLs in" << timer.elapsed () << "ms";
+	}
+
+	void URLCompletionIndexTest::testFrecency ()
+	{
+		const auto& now = QDateTime::currentDateTime ();
+
+		const auto once = URLCompletionIndex::AddVisit ({}, now);
+		const auto twice = URLCompletionIndex::AddVisit (once, now);
+		QVERIFY (qFuzzyCompare (twice - once, std::log (2.)));
+
+		const auto weekAgo = now.addDays (-7);
+		const auto old = URLCompletionIndex::AddVisit (URLCompletionIndex::AddVisit ({}, weekAgo), weekAgo);
+		QVERIFY (old < once);
+	}
+
+	void URLCompletionIndexTest::testRemoveVisit ()
+	{
+		const auto& now = QDateTime::currentDateTime ();
+		const auto& dayAgo = now.addDays (-1);
+
+		const auto both = URLCompletionIndex::AddVisit (URLCompletionIndex::AddVisit ({}, dayAgo), now);
+		QVERIFY (qFuzzyCompare (URLCompletionIndex::RemoveVisit (both, dayAgo),
+				URLCompletionIndex::AddVisit ({}, now)));
+	}
+
+	void URLCompletionIndexTest::testMatching ()
+	{
+		URLCompletionIndex index;
+		index.Add ("http://example.com/a", "Some Page", 1);
+		index.Add ("http://example.com/b", "Other", 3);
+		index.Add ("http://example.org/PAGES", "Third", 2);
+
+		QCOMPARE (GetURLs (index.Find ("page", 10)),
+				(QStringList { "http://example.org/PAGES", "http://example.com/a" }));
+		QCOMPARE (GetURLs (index.Find ("example.com", 1)),
+				(QStringList { "http://example.com/b" }));
+		QVERIFY (index.Find ("missing", 10).isEmpty ());
+	}
+
+	void URLCompletionIndexTest::testHostPrefixFirst ()
+	{
+		URLCompletionIndex index;
+		index.Add ("http://example.com/kde", "Example", 10);
+		index.Add ("http://www.kde.org/", "KDE", 1);
+
+		QCOMPARE (GetURLs (index.Find ("kde", 10)),
+				(QStringList { "http://www.kde.org/", "http://example.com/kde" }));
+	}
+
+	void URLCompletionIndexTest::testTitleUpdate ()
+	{
+		URLCompletionIndex index;
+		index.Add ("http://example.com/", "Old title", 1);
+		index.Add ("http://example.com/", "New title", 2);
+
+		QCOMPARE (index.GetSize (), 1);
+		QCOMPARE (index.Find ("new", 10).size (), 1);
+		QVERIFY (index.Find ("old", 10).isEmpty ());
+	}
+
+	void URLCompletionIndexTest::testRemove ()
+	{
+		URLCompletionIndex index;
+		index.Add ("http://example.com/", "Example", 1);
+		index.Add ("http://example.org/", "Example", 2);
+		index.Remove ("http://example.org/");
+
+		QCOMPARE (index.GetSize (), 1);
+		QCOMPARE (GetURLs (index.Find ("example", 10)), QStringList { "http://example.com/" });
+		QCOMPARE (GetURLs (index.Find ("", 10)), QStringList { "http://example.com/" });
+	}
+
+	void URLCompletionIndexTest::testCompaction ()
+	{
+		URLCompletionIndex index;
+		for (int i = 0; i < 100; ++i)
+			index.Add (MakeURL (i), MakeTitle (i), i);
+		for (int i = 0; i < 90; ++i)
+			index.Remove (MakeURL (i));
+
+		QCOMPARE (index.GetSize (), 10);
+		QCOMPARE (GetURLs (index.Find ("", 3)),
+				(QStringList { MakeURL (99), MakeURL (98), MakeURL (97) }));
+		QCOMPARE (GetURLs (index.Find ("/95", 10)), QStringList { MakeURL (95) });
+		QVERIFY (index.Find ("/42", 10).isEmpty ());
+
+		index.Add (MakeURL (42), "Back again", 1000);
+		QCOMPARE (index.GetSize (), 11);
+		QCOMPARE (GetURLs (index.Find ("back again", 10)), QStringList { MakeURL (42) });
+		QCOMPARE (GetURLs (index.Find ("", 1)), QStringList { MakeURL (42) });
+	}
+
+	void URLCompletionIndexTest::benchFind_data ()
+	{
+		QTest::addColumn<QString> ("text");
+
+		for (const auto& text : { "n", "ne", "news", "newsmail", "forum/12", "search - code", "nonexistent" })
+			QTest::newRow (text) << QString { text };
+	}
+
+	void URLCompletionIndexTest::benchFind ()
+	{
+		QFETCH (QString, text);
+
+		QBENCHMARK { BenchIndex_.Find (text, 100); }
+	}
+}
+}
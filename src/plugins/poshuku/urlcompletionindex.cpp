@@ -0,0 +1,285 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "urlcompletionindex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QDateTime>
+#include <QSet>
+#include <QUrl>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	namespace
+	{
+		const auto DecayRate = 1 / 86400.; // decay rate should be the same order of magnitude as a day
+
+		double GetTime (const QDateTime& dt)
+		{
+			return dt.toMSecsSinceEpoch () / 1000.;
+		}
+
+		QString GetHaystack (const QString& url, const QString& title)
+		{
+			return (title + '\n' + url).toLower ();
+		}
+
+		QString GetHostKey (const QString& url)
+		{
+			auto host = QUrl { url }.host ().toLower ();
+			if (host.startsWith ("www."))
+				host.remove (0, 4);
+			return host;
+		}
+
+		quint64 GetTrigram (const QChar *chars)
+		{
+			return (static_cast<quint64> (chars [0].unicode ()) << 32) |
+					(static_cast<quint64> (chars [1].unicode ()) << 16) |
+					chars [2].unicode ();
+		}
+
+		QSet<quint64> GetTrigrams (const QString& str)
+		{
+			QSet<quint64> result;
+			for (int i = 0; i + 3 <= str.size (); ++i)
+				result << GetTrigram (str.constData () + i);
+			return result;
+		}
+
+		bool Contains (const std::vector<int>& ids, int id)
+		{
+			return std::find (ids.begin (), ids.end (), id) != ids.end ();
+		}
+	}
+
+	double URLCompletionIndex::AddVisit (const std::optional<double>& rank, const QDateTime& visit)
+	{
+		const auto visitRank = DecayRate * GetTime (visit);
+		if (!rank)
+			return visitRank;
+
+		const auto max = std::max (*rank, visitRank);
+		const auto min = std::min (*rank, visitRank);
+		return max + std::log1p (std::exp (min - max));
+	}
+
+	double URLCompletionIndex::RemoveVisit (double rank, const QDateTime& visit)
+	{
+		const auto visitRank = DecayRate * GetTime (visit);
+		if (visitRank >= rank)
+			return std::numeric_limits<double>::lowest ();
+
+		return rank + std::log1p (-std::exp (visitRank - rank));
+	}
+
+	void URLCompletionIndex::Add (const QString& url, const QString& title, double rank)
+	{
+		const auto pos = URL2Item_.find (url);
+		if (pos == URL2Item_.end ())
+		{
+			const int id = Items_.size ();
+			Items_.push_back ({ url, title, GetHaystack (url, title), rank, true });
+			URL2Item_ [url] = id;
+			ByRank_.insert ({ rank, id });
+			Host2Items_ [GetHostKey (url)].push_back (id);
+			AddTrigrams (id, {}, Items_.back ().Haystack_);
+			return;
+		}
+
+		const auto id = *pos;
+		auto& item = Items_ [id];
+
+		ByRank_.erase (std::make_pair (item.Rank_, id));
+		item.Rank_ = rank;
+		ByRank_.insert ({ rank, id });
+
+		if (item.Title_ != title)
+		{
+			const auto oldHaystack = item.Haystack_;
+			item.Title_ = title;
+			item.Haystack_ = GetHaystack (url, title);
+			AddTrigrams (id, oldHaystack, item.Haystack_);
+		}
+	}
+
+	void URLCompletionIndex::Remove (const QString& url)
+	{
+		const auto pos = URL2Item_.find (url);
+		if (pos == URL2Item_.end ())
+			return;
+
+		auto& item = Items_ [*pos];
+		ByRank_.erase (std::make_pair (item.Rank_, *pos));
+		URL2Item_.erase (pos);
+
+		// The postings still refer to the item, so it is only marked as
+		// dead instead of being erased, until there are enough dead ones
+		// for rebuilding the index to pay off.
+		item = { {}, {}, {}, 0, false };
+		if (++DeadCount_ * 2 >= static_cast<int> (Items_.size ()))
+			Compact ();
+	}
+
+	void URLCompletionIndex::Clear ()
+	{
+		Items_.clear ();
+		URL2Item_.clear ();
+		Trigram2Items_.clear ();
+		Host2Items_.clear ();
+		ByRank_.clear ();
+		DeadCount_ = 0;
+	}
+
+	int URLCompletionIndex::GetSize () const
+	{
+		return URL2Item_.size ();
+	}
+
+	history_items_t URLCompletionIndex::Find (const QString& text, int count) const
+	{
+		const auto& needle = text.toLower ();
+
+		std::vector<int> ids;
+		if (!needle.isEmpty ())
+			FindHostPrefixed (needle, count, ids);
+		if (static_cast<int> (ids.size ()) < count)
+			FindContaining (needle, count, ids);
+
+		history_items_t result;
+		result.reserve (ids.size ());
+		for (const auto id : ids)
+			result.push_back ({ Items_ [id].Title_, {}, Items_ [id].URL_ });
+		return result;
+	}
+
+	void URLCompletionIndex::Compact ()
+	{
+		// This also drops the postings of the trigrams that aren't in the
+		// updated titles anymore. The live items keep their relative
+		// order, and so do the ones of equal rank in ByRank_.
+		const auto items = std::move (Items_);
+		Clear ();
+		for (const auto& item : items)
+			if (item.Alive_)
+				Add (item.URL_, item.Title_, item.Rank_);
+	}
+
+	void URLCompletionIndex::AddTrigrams (int id, const QString& oldHaystack, const QString& haystack)
+	{
+		const auto& oldTrigrams = GetTrigrams (oldHaystack);
+		for (const auto trigram : GetTrigrams (haystack))
+			if (!oldTrigrams.contains (trigram))
+				Trigram2Items_ [trigram].push_back (id);
+	}
+
+	bool URLCompletionIndex::Matches (int id, const QString& needle) const
+	{
+		const auto& item = Items_ [id];
+		return item.Alive_ && item.Haystack_.contains (needle);
+	}
+
+	namespace
+	{
+		template<typename Items>
+		void TakeBest (std::vector<int>& found, int count, std::vector<int>& ids, const Items& items)
+		{
+			std::sort (found.begin (), found.end ());
+			found.erase (std::unique (found.begin (), found.end ()), found.end ());
+
+			const auto wanted = std::min<size_t> (count - ids.size (), found.size ());
+			std::partial_sort (found.begin (), found.begin () + wanted, found.end (),
+					[&items] (int left, int right) { return items [left].Rank_ > items [right].Rank_; });
+			ids.insert (ids.end (), found.begin (), found.begin () + wanted);
+		}
+	}
+
+	void URLCompletionIndex::FindHostPrefixed (const QString& needle, int count, std::vector<int>& ids) const
+	{
+		std::vector<int> found;
+		for (auto it = Host2Items_.lowerBound (needle);
+				it != Host2Items_.end () && it.key ().startsWith (needle); ++it)
+			for (const auto id : *it)
+				if (Items_ [id].Alive_)
+					found.push_back (id);
+
+		TakeBest (found, count, ids, Items_);
+	}
+
+	void URLCompletionIndex::FindContaining (const QString& needle, int count, std::vector<int>& ids) const
+	{
+		// Checking the entries sharing the least frequent trigram pays off
+		// unless it is so common that the matches are likely to be dense
+		// enough for a scan in the rank order to stop early.
+		if (const auto postings = GetRarestPostings (needle);
+				postings && postings->size () <= Items_.size () / 8)
+		{
+			std::vector<int> found;
+			for (const auto id : *postings)
+				if (Matches (id, needle) && !Contains (ids, id))
+					found.push_back (id);
+
+			TakeBest (found, count, ids, Items_);
+			return;
+		}
+
+		for (const auto& pair : ByRank_)
+		{
+			if (static_cast<int> (ids.size ()) >= count)
+				break;
+
+			if (Matches (pair.second, needle) && !Contains (ids, pair.second))
+				ids.push_back (pair.second);
+		}
+	}
+
+	const std::vector<int>* URLCompletionIndex::GetRarestPostings (const QString& needle) const
+	{
+		static const std::vector<int> NoPostings;
+
+		if (needle.size () < 3)
+			return nullptr;
+
+		const std::vector<int> *rarest = nullptr;
+		for (int i = 0; i + 3 <= needle.size (); ++i)
+		{
+			const auto pos = Trigram2Items_.find (GetTrigram (needle.constData () + i));
+			if (pos == Trigram2Items_.end ())
+				return &NoPostings;
+
+			if (!rarest || pos->size () < rarest->size ())
+				rarest = &*pos;
+		}
+		return rarest;
+	}
+}
+}
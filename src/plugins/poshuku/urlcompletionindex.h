@@ -0,0 +1,145 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <optional>
+#include <set>
+#include <vector>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <interfaces/poshuku/poshukutypes.h>
+
+class QDateTime;
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	/** @brief In-memory index of visited URLs for the address bar
+	 * completion.
+	 *
+	 * Each URL is ranked by its frecency: the sum of exp(-k * age) over
+	 * all its visits, with k being the reciprocal of a day. The rank is
+	 * kept in the log domain relative to the epoch (see AddVisit()), so
+	 * it doesn't decay with time and only changes when the URL is
+	 * visited.
+	 *
+	 * Lookups are served by a prefix index over the hosts and a trigram
+	 * index over the titles and URLs, so completing a string only checks
+	 * the entries sharing its least frequent trigram instead of the
+	 * whole history.
+	 */
+	class URLCompletionIndex
+	{
+		struct Item
+		{
+			QString URL_;
+			QString Title_;
+			QString Haystack_;
+			double Rank_;
+			bool Alive_;
+		};
+		std::vector<Item> Items_;
+		QHash<QString, int> URL2Item_;
+
+		QHash<quint64, std::vector<int>> Trigram2Items_;
+		QMap<QString, std::vector<int>> Host2Items_;
+
+		std::set<std::pair<double, int>, std::greater<>> ByRank_;
+
+		/** Removed items stay in Items_ and the postings until the next
+		 * compaction, which happens once they make up half of Items_.
+		 */
+		int DeadCount_ = 0;
+	public:
+		/** @brief Returns the rank of a URL after one more visit.
+		 *
+		 * @param[in] rank The rank of the URL before the visit, or an
+		 * empty optional if it has never been visited.
+		 * @param[in] visit The time of the visit.
+		 * @return The rank of the URL including the \em visit.
+		 */
+		static double AddVisit (const std::optional<double>& rank, const QDateTime& visit);
+
+		/** @brief Returns the rank of a URL without one of its visits.
+		 *
+		 * @param[in] rank The rank of the URL including the \em visit.
+		 * @param[in] visit The time of the visit to exclude.
+		 * @return The rank of the URL excluding the \em visit.
+		 */
+		static double RemoveVisit (double rank, const QDateTime& visit);
+
+		/** @brief Adds the \em url to the index or updates it.
+		 *
+		 * @param[in] url The URL to add.
+		 * @param[in] title The title of the page at the \em url.
+		 * @param[in] rank The rank of the \em url.
+		 */
+		void Add (const QString& url, const QString& title, double rank);
+
+		/** @brief Removes the \em url from the index.
+		 *
+		 * @param[in] url The URL to remove.
+		 */
+		void Remove (const QString& url);
+
+		/** @brief Removes all URLs from the index.
+		 */
+		void Clear ();
+
+		/** @brief Returns the number of URLs in the index.
+		 *
+		 * @return The number of URLs in the index.
+		 */
+		int GetSize () const;
+
+		/** @brief Returns the best ranked URLs matching the \em text.
+		 *
+		 * A URL matches if its title or the URL itself contains the
+		 * \em text case-insensitively. URLs whose host (ignoring the
+		 * leading <em>www.</em>) starts with the \em text come first.
+		 *
+		 * @param[in] text The string to complete.
+		 * @param[in] count The maximum number of URLs to return.
+		 * @return The matching URLs, the best ranked first.
+		 */
+		history_items_t Find (const QString& text, int count) const;
+	private:
+		void Compact ();
+		void AddTrigrams (int, const QString&, const QString&);
+
+		bool Matches (int, const QString&) const;
+		void FindHostPrefixed (const QString&, int, std::vector<int>&) const;
+		void FindContaining (const QString&, int, std::vector<int>&) const;
+		const std::vector<int>* GetRarestPostings (const QString&) const;
+	};
+}
+}
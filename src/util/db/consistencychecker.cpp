@@ -29,8 +29,15 @@
 
 #include "consistencychecker.h"
 #include <memory>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QSettings>
 #include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QThread>
 #include <QMessageBox>
 #include <QtConcurrentRun>
 #include <util/sll/slotclosure.h>
@@ -41,6 +48,15 @@
 #include "dumper.h"
 #include "util.h"
 
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef HAVE_SQLITE3_API
+#include <sqlite3.h>
+#endif
+
 namespace LeechCraft
 {
 namespace Util
@@ -66,6 +82,11 @@ namespace Util
 	, DBPath_ { dbPath }
 	, DialogContext_ { dialogContext }
 	{
+		if (const auto app = QCoreApplication::instance ())
+			connect (app,
+					&QCoreApplication::aboutToQuit,
+					this,
+					[this] { StopRequested_ = true; });
 	}
 
 	std::shared_ptr<ConsistencyChecker> ConsistencyChecker::Create (const QString& dbPath, const QString& dialogContext)
@@ -73,6 +94,108 @@ namespace Util
 		return std::shared_ptr<ConsistencyChecker> { new ConsistencyChecker { dbPath, dialogContext } };
 	}
 
+	namespace
+	{
+		const auto FullCheckInterval = 7 * 24 * 60 * 60;
+
+		QString GetMarkerPath (const QString& dbPath)
+		{
+			return dbPath + ".unclean";
+		}
+
+		class CheckerSettings : public QSettings
+		{
+		public:
+			CheckerSettings (const QString& dbPath)
+			: QSettings { QCoreApplication::organizationName (),
+					QCoreApplication::applicationName () + "_Util_ConsistencyChecker" }
+			{
+				auto group = dbPath;
+				group.replace ('/', '_');
+				group.replace ('\\', '_');
+				beginGroup (group);
+			}
+		};
+
+#ifdef Q_OS_LINUX
+		const int IOPrioWhoProcess = 1;
+		const int IOPrioClassShift = 13;
+		const int IOPrioClassIdle = 3;
+#endif
+
+		/** Lowers the CPU and (on Linux) I/O priorities of the calling
+		 * thread, restoring them on destruction.
+		 */
+		class LowPriorityGuard
+		{
+			QThread * const Thread_;
+			const QThread::Priority PrevPriority_;
+#ifdef Q_OS_LINUX
+			const long PrevIOPrio_;
+#endif
+		public:
+			LowPriorityGuard ()
+			: Thread_ { QThread::currentThread () }
+			, PrevPriority_ { Thread_->priority () }
+#ifdef Q_OS_LINUX
+			, PrevIOPrio_ { syscall (SYS_ioprio_get, IOPrioWhoProcess, 0) }
+#endif
+			{
+				Thread_->setPriority (QThread::IdlePriority);
+#ifdef Q_OS_LINUX
+				syscall (SYS_ioprio_set, IOPrioWhoProcess, 0, IOPrioClassIdle << IOPrioClassShift);
+#endif
+			}
+
+			~LowPriorityGuard ()
+			{
+				Thread_->setPriority (PrevPriority_ == QThread::InheritPriority ?
+						QThread::NormalPriority :
+						PrevPriority_);
+#ifdef Q_OS_LINUX
+				if (PrevIOPrio_ >= 0)
+					syscall (SYS_ioprio_set, IOPrioWhoProcess, 0, PrevIOPrio_);
+#endif
+			}
+
+			LowPriorityGuard (const LowPriorityGuard&) = delete;
+			LowPriorityGuard& operator= (const LowPriorityGuard&) = delete;
+		};
+
+		/** Makes the long-running statements on the \em db abort once
+		 * the \em stop flag is set.
+		 */
+		void InstallStopHandler (QSqlDatabase& db, const std::atomic<bool> *stop)
+		{
+#ifdef HAVE_SQLITE3_API
+			const auto& handle = db.driver ()->handle ();
+			if (qstrcmp (handle.typeName (), "sqlite3*"))
+				return;
+
+			const auto sqlite = *static_cast<sqlite3* const*> (handle.data ());
+			if (!sqlite)
+				return;
+
+			sqlite3_progress_handler (sqlite,
+					10000,
+					[] (void *stop) { return static_cast<const std::atomic<bool>*> (stop)->load () ? 1 : 0; },
+					const_cast<std::atomic<bool>*> (stop));
+#else
+			Q_UNUSED (db)
+			Q_UNUSED (stop)
+#endif
+		}
+	}
+
+	void ConsistencyChecker::MarkCleanShutdown (const QString& dbPath)
+	{
+		const auto& markerPath = GetMarkerPath (dbPath);
+		if (QFile::exists (markerPath) && !QFile::remove (markerPath))
+			qWarning () << Q_FUNC_INFO
+					<< "unable to remove"
+					<< markerPath;
+	}
+
 	QFuture<ConsistencyChecker::CheckResult_t> ConsistencyChecker::StartCheck ()
 	{
 		const auto managed = shared_from_this ();
@@ -80,10 +203,64 @@ namespace Util
 	}
 
 	ConsistencyChecker::CheckResult_t ConsistencyChecker::CheckDB ()
+	{
+		const auto& markerPath = GetMarkerPath (DBPath_);
+		const bool wasClean = !QFile::exists (markerPath);
+
+		QFile marker { markerPath };
+		if (!marker.open (QIODevice::WriteOnly))
+			qWarning () << Q_FUNC_INFO
+					<< "unable to create the shutdown marker"
+					<< markerPath
+					<< marker.errorString ();
+
+		CheckerSettings settings { DBPath_ };
+		if (settings.value ("FullCheckFailed", false).toBool ())
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "the last full check of"
+					<< DBPath_
+					<< "has failed, checking it again";
+
+			const auto isGood = RunCheck ("PRAGMA integrity_check;", "FullCheckDuration");
+			SaveFullCheckResult (isGood);
+			if (isGood)
+				return Succeeded {};
+			else
+				return std::make_shared<FailedImpl> (shared_from_this ());
+		}
+
+		if (!wasClean && !RunCheck ("PRAGMA quick_check;", "QuickCheckDuration"))
+			return std::make_shared<FailedImpl> (shared_from_this ());
+
+		const auto& lastFullCheck = settings.value ("LastFullCheck").toDateTime ();
+		const bool needsFullCheck = !wasClean ||
+				settings.value ("FullCheckPending", false).toBool () ||
+				!lastFullCheck.isValid () ||
+				lastFullCheck.secsTo (QDateTime::currentDateTime ()) > FullCheckInterval;
+		if (needsFullCheck)
+		{
+			// If we crash during the check, it'll be rerun next time.
+			settings.setValue ("FullCheckPending", true);
+
+			const auto managed = shared_from_this ();
+			QtConcurrent::run ([managed] { managed->RunBackgroundFullCheck (); });
+		}
+		else if (wasClean)
+			qDebug () << Q_FUNC_INFO
+					<< DBPath_
+					<< "has been closed cleanly, skipping the check";
+
+		return Succeeded {};
+	}
+
+	bool ConsistencyChecker::RunCheck (const QString& pragmaText, const QString& durationKey)
 	{
 		qDebug () << Q_FUNC_INFO
 				<< "checking"
-				<< DBPath_;
+				<< DBPath_
+				<< "with"
+				<< pragmaText;
 		const auto& connName = Util::GenConnectionName ("ConsistencyChecker_" + DBPath_);
 
 		std::shared_ptr<QSqlDatabase> db
@@ -101,22 +278,64 @@ namespace Util
 		{
 			qWarning () << Q_FUNC_INFO
 					<< "cannot open the DB, but that's not the kind of errors we're solving.";
-			return Succeeded {};
+			return true;
 		}
 
+		InstallStopHandler (*db, &StopRequested_);
+
+		QElapsedTimer timer;
+		timer.start ();
+
 		QSqlQuery pragma { *db };
-		const auto isGood = pragma.exec ("PRAGMA integrity_check;") &&
+		const auto isGood = pragma.exec (pragmaText) &&
 				pragma.next () &&
 				pragma.value (0) == "ok";
+		pragma.finish ();
+
+		const auto elapsed = timer.elapsed ();
+		CheckerSettings { DBPath_ }.setValue (durationKey, elapsed);
+
 		qDebug () << Q_FUNC_INFO
 				<< "done checking"
 				<< DBPath_
-				<< "; result is:"
+				<< "in"
+				<< elapsed
+				<< "ms; result is:"
 				<< isGood;
+		return isGood;
+	}
+
+	void ConsistencyChecker::RunBackgroundFullCheck ()
+	{
+		LowPriorityGuard guard;
+		const auto isGood = RunCheck ("PRAGMA integrity_check;", "FullCheckDuration");
+
+		// FullCheckPending stays set, so the check is rerun next time.
+		if (StopRequested_)
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "the full check of"
+					<< DBPath_
+					<< "has been interrupted";
+			return;
+		}
+
+		SaveFullCheckResult (isGood);
+	}
+
+	void ConsistencyChecker::SaveFullCheckResult (bool isGood)
+	{
+		if (!isGood)
+			qWarning () << Q_FUNC_INFO
+					<< "full check of"
+					<< DBPath_
+					<< "has failed, it will be repaired on next start";
+
+		CheckerSettings settings { DBPath_ };
+		settings.setValue ("FullCheckPending", false);
+		settings.setValue ("FullCheckFailed", !isGood);
 		if (isGood)
-			return Succeeded {};
-		else
-			return std::make_shared<FailedImpl> (shared_from_this ());
+			settings.setValue ("LastFullCheck", QDateTime::currentDateTime ());
 	}
 
 	QFuture<ConsistencyChecker::DumpResult_t> ConsistencyChecker::DumpReinit ()
@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <boost/variant.hpp>
 #include <QObject>
@@ -50,12 +51,24 @@ namespace Util
 		const QString DBPath_;
 		const QString DialogContext_;
 
+		std::atomic<bool> StopRequested_ { false };
+
 		friend class FailedImpl;
 
 		ConsistencyChecker (const QString& dbPath, const QString& dialogContext, QObject* = nullptr);
 	public:
 		static std::shared_ptr<ConsistencyChecker> Create (const QString& dbPath, const QString& dialogContext);
 
+		/** @brief Marks the database at \em dbPath as closed cleanly.
+		 *
+		 * This lets the next StartCheck() for this database skip the
+		 * startup check. Call this once the database owner has finished
+		 * writing to the database for the current session.
+		 *
+		 * @param[in] dbPath The path to the database file.
+		 */
+		static void MarkCleanShutdown (const QString& dbPath);
+
 		struct DumpFinished
 		{
 			qint64 OldFileSize_;
@@ -76,9 +89,30 @@ namespace Util
 
 		using CheckResult_t = boost::variant<Succeeded, Failed>;
 
+		/** @brief Checks the database according to the tiered policy.
+		 *
+		 * If the previous session has called MarkCleanShutdown(), nothing
+		 * is checked before reporting the result. Otherwise, a
+		 * <code>PRAGMA quick_check</code> is run first.
+		 *
+		 * A full <code>PRAGMA integrity_check</code> is then run in
+		 * background at the lowest CPU and I/O priority, if either the
+		 * shutdown was unclean or the last full check is more than a week
+		 * old. If that background check finds problems, the next
+		 * StartCheck() runs the full check before reporting the result,
+		 * so that the database can be repaired. The background check is
+		 * interrupted when the application quits, and is rerun on the
+		 * next start.
+		 *
+		 * The durations of the checks are logged and saved to the
+		 * application settings.
+		 */
 		QFuture<CheckResult_t> StartCheck ();
 	private:
 		CheckResult_t CheckDB ();
+		bool RunCheck (const QString& pragma, const QString& durationKey);
+		void RunBackgroundFullCheck ();
+		void SaveFullCheckResult (bool);
 
 		QFuture<DumpResult_t> DumpReinit ();
 		void DumpReinitImpl (QFutureInterface<DumpResult_t>);
@@ -43,6 +43,23 @@ namespace LeechCraft::Util::oral::detail
 		virtual ~IInsertQueryBuilder () = default;
 
 		virtual std::shared_ptr<QSqlQuery> GetQuery (InsertAction) = 0;
+
+		/** Returns the maximum number of rows a single query returned by
+		 * GetBatchQuery() can insert. 1 means multirow inserts aren't
+		 * supported, and GetQuery() should be used instead.
+		 */
+		virtual int GetMaxBatchRows () const
+		{
+			return 1;
+		}
+
+		/** Returns a query inserting the given number of rows at once,
+		 * with the values bound positionally row by row.
+		 */
+		virtual std::shared_ptr<QSqlQuery> GetBatchQuery (InsertAction, int)
+		{
+			return {};
+		}
 	};
 
 	using IInsertQueryBuilder_ptr = std::unique_ptr<IInsertQueryBuilder>;
@@ -29,10 +29,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 #include <type_traits>
 #include <memory>
 #include <optional>
+#include <typeindex>
+#include <unordered_map>
 #include <boost/fusion/include/for_each.hpp>
 #include <boost/fusion/include/fold.hpp>
 #include <boost/fusion/include/filter_if.hpp>
@@ -42,6 +46,7 @@
 #include <boost/fusion/include/zip.hpp>
 #include <boost/fusion/container/generation/make_vector.hpp>
 #include <boost/variant/variant.hpp>
+#include <boost/variant/get.hpp>
 #include <QStringList>
 #include <QDateTime>
 #include <QPair>
@@ -375,6 +380,18 @@ namespace oral
 			return result;
 		}
 
+		template<typename Seq>
+		CachedFieldsData RemoveAutogenPKey (CachedFieldsData data) noexcept
+		{
+			if constexpr (HasAutogenPKey<Seq> ())
+			{
+				constexpr auto index = FindPKey<Seq>::result_type::value;
+				data.Fields_.removeAt (index);
+				data.BoundFields_.removeAt (index);
+			}
+			return data;
+		}
+
 		template<typename Seq>
 		class AdaptInsert
 		{
@@ -387,7 +404,7 @@ namespace oral
 		public:
 			template<typename ImplFactory>
 			AdaptInsert (const QSqlDatabase& db, CachedFieldsData data, ImplFactory&& factory) noexcept
-			: Data_ { RemovePKey (data) }
+			: Data_ { RemoveAutogenPKey<Seq> (data) }
 			, QueryBuilder_ { factory.MakeInsertQueryBuilder (db, Data_) }
 			{
 			}
@@ -420,16 +437,127 @@ namespace oral
 						return lastId;
 				}
 			}
+		};
 
-			static CachedFieldsData RemovePKey (CachedFieldsData data) noexcept
+		template<typename Seq, bool = HasAutogenPKey<Seq> ()>
+		struct AutogenPKeyValue
+		{
+			using type = Void;
+		};
+
+		template<typename Seq>
+		struct AutogenPKeyValue<Seq, true>
+		{
+			using type = typename ValueAtC_t<Seq, FindPKey<Seq>::result_type::value>::value_type;
+		};
+
+		/** Inserts a range of records in a single transaction.
+		 *
+		 * If the backend supports multirow inserts, the records are
+		 * inserted by chunks with as many rows per statement as the bind
+		 * parameters limit allows. Otherwise, or if autogenerated primary
+		 * keys can't be reliably recovered from a multirow insert (that
+		 * is, for anything but the default insert action), the records
+		 * are inserted one by one via the same prepared query.
+		 *
+		 * Returns the list of generated primary keys in the order of the
+		 * records if the record has an autogenerated primary key.
+		 */
+		template<typename Seq>
+		class AdaptInsertBatch
+		{
+			mutable QSqlDatabase DB_;
+			const CachedFieldsData Data_;
+
+			constexpr static bool HasAutogen_ = HasAutogenPKey<Seq> ();
+			using PKeyValue_t = typename AutogenPKeyValue<Seq>::type;
+
+			IInsertQueryBuilder_ptr QueryBuilder_;
+		public:
+			template<typename ImplFactory>
+			AdaptInsertBatch (const QSqlDatabase& db, CachedFieldsData data, ImplFactory&& factory) noexcept
+			: DB_ { db }
+			, Data_ { RemoveAutogenPKey<Seq> (data) }
+			, QueryBuilder_ { factory.MakeInsertQueryBuilder (db, Data_) }
 			{
+			}
+
+			template<typename Range>
+			auto operator() (const Range& range, InsertAction action = InsertAction::Default) const
+			{
+				DBLock lock { DB_ };
+				lock.Init ();
+
+				QList<PKeyValue_t> ids;
+				if (const auto maxRows = GetMaxBatchRows (action); maxRows > 1)
+					RunBatched (range, action, maxRows, ids);
+				else
+					RunSingle (range, action, ids);
+
+				lock.Good ();
+
 				if constexpr (HasAutogen_)
+					return ids;
+			}
+		private:
+			int GetMaxBatchRows (const InsertAction& action) const
+			{
+				if (HasAutogen_ && !boost::get<InsertAction::DefaultTag> (&action.Selector_))
+					return 1;
+
+				return QueryBuilder_->GetMaxBatchRows ();
+			}
+
+			template<typename Range>
+			void RunSingle (const Range& range, InsertAction action, QList<PKeyValue_t>& ids) const
+			{
+				const auto query = QueryBuilder_->GetQuery (action);
+				const auto& inserter = MakeInserter<Seq> (Data_, query, !HasAutogen_);
+				for (const auto& item : range)
 				{
-					constexpr auto index = FindPKey<Seq>::result_type::value;
-					data.Fields_.removeAt (index);
-					data.BoundFields_.removeAt (index);
+					inserter (item);
+
+					if constexpr (HasAutogen_)
+						ids << FromVariant<PKeyValue_t> {} (query->lastInsertId ());
+				}
+			}
+
+			template<typename Range>
+			void RunBatched (const Range& range, InsertAction action, int maxRows, QList<PKeyValue_t>& ids) const
+			{
+				auto it = std::begin (range);
+				auto remaining = static_cast<int> (std::distance (it, std::end (range)));
+				while (remaining > 0)
+				{
+					const auto rows = std::min (remaining, maxRows);
+					const auto query = QueryBuilder_->GetBatchQuery (action, rows);
+
+					int pos = 0;
+					for (int i = 0; i < rows; ++i, ++it)
+						boost::fusion::for_each (*it,
+								[&] (const auto& elem)
+								{
+									using Elem = std::decay_t<decltype (elem)>;
+									if (!HasAutogen_ || !IsPKey<Elem>::value)
+										query->bindValue (pos++, ToVariantF (elem));
+								});
+
+					if (!query->exec ())
+					{
+						DBLock::DumpError (*query);
+						throw QueryException ("batch insert query execution failed", query);
+					}
+
+					// Rowids are assigned sequentially within a single insert statement.
+					if constexpr (HasAutogen_)
+					{
+						const auto lastId = query->lastInsertId ().toLongLong ();
+						for (auto id = lastId - rows + 1; id <= lastId; ++id)
+							ids << FromVariant<PKeyValue_t> {} (id);
+					}
+
+					remaining -= rows;
 				}
-				return data;
 			}
 		};
 
@@ -658,7 +786,11 @@ namespace oral
 				if constexpr (IsExprTree<L> {})
 					return Left_.GetFieldName () + " = " + Right_.ToSql (state);
 				else
-					return Left_.ToSql (state) + ", " + Right_.ToSql (state);
+				{
+					// The bound names depend on the traversal order, so fix it.
+					const auto& left = Left_.ToSql (state);
+					return left + ", " + Right_.ToSql (state);
+				}
 			}
 
 			template<typename OL, typename OR>
@@ -686,7 +818,16 @@ namespace oral
 				static_assert (RelationalTypesChecker<Type, T, L, R>::value,
 						"Incompatible types passed to a relational operator.");
 
-				return Left_.ToSql (state) + " " + TypeToSql (Type) + " " + Right_.ToSql (state);
+				// BindValues() relies on the left subtree being numbered first.
+				const auto& left = Left_.ToSql (state);
+				return left + " " + TypeToSql (Type) + " " + Right_.ToSql (state);
+			}
+
+			template<typename T>
+			void BindValues (ToSqlState<T>& state, QSqlQuery& query) const noexcept
+			{
+				Left_.BindValues (state, query);
+				Right_.BindValues (state, query);
 			}
 
 			template<typename T>
@@ -718,6 +859,11 @@ namespace oral
 				return MemberPtrStruct_t<Ptr>::ClassName () + "." + GetFieldName ();
 			}
 
+			template<typename T>
+			void BindValues (ToSqlState<T>&, QSqlQuery&) const noexcept
+			{
+			}
+
 			QString GetFieldName () const noexcept
 			{
 				return detail::GetFieldNamePtr<Ptr> ();
@@ -764,6 +910,12 @@ namespace oral
 				return name;
 			}
 
+			template<typename ObjT>
+			void BindValues (ToSqlState<ObjT>& state, QSqlQuery& query) const noexcept
+			{
+				query.bindValue (":bound_" + QString::number (++state.LastID_), ToVariantF (Data_));
+			}
+
 			template<typename>
 			QSet<QString> AdditionalTables () const noexcept
 			{
@@ -919,6 +1071,23 @@ namespace oral
 			};
 		}
 
+		/** Binds the values from the tree to a query previously
+		 * prepared with the SQL generated by HandleExprTree(), without
+		 * regenerating the SQL itself.
+		 */
+		template<typename>
+		void BindExprTree (const ExprTree<ExprType::ConstTrue>&, QSqlQuery&, int = 0) noexcept
+		{
+		}
+
+		template<typename Seq, typename Tree,
+				typename = decltype (std::declval<Tree> ().BindValues (std::declval<ToSqlState<Seq>&> (), std::declval<QSqlQuery&> ()))>
+		void BindExprTree (const Tree& tree, QSqlQuery& query, int lastId = 0) noexcept
+		{
+			ToSqlState<Seq> state { lastId, {} };
+			tree.BindValues (state, query);
+		}
+
 		enum class AggregateFunction
 		{
 			Count,
@@ -1166,14 +1335,33 @@ namespace oral
 			const QSqlDatabase DB_;
 			const QString LimitNone_;
 
+			/* The SQL of a select is fully determined by the types of
+			 * its parameters (the values are bound), so the prepared
+			 * queries are keyed by those types.
+			 */
+			using QueriesCache_t = std::unordered_map<std::type_index, QSqlQuery_ptr>;
+			const std::shared_ptr<QueriesCache_t> Queries_ = std::make_shared<QueriesCache_t> ();
+
 			SelectWrapperCommon (const QSqlDatabase& db, const QString& limitNone)
 			: DB_ { db }
 			, LimitNone_ { limitNone }
 			{
 			}
 
-			auto RunQuery (const QString& fields, const QString& from,
-					QString where, std::function<void (QSqlQuery&)>&& binder,
+			template<typename Key, typename SqlBuilder>
+			QSqlQuery_ptr GetQuery (SqlBuilder&& sqlBuilder) const
+			{
+				auto& query = (*Queries_) [typeid (Key)];
+				if (!query)
+				{
+					query = std::make_shared<QSqlQuery> (DB_);
+					query->prepare (sqlBuilder ());
+				}
+				return query;
+			}
+
+			QString BuildQueryString (const QString& fields, const QString& from,
+					QString where,
 					const QString& orderStr,
 					const QString& groupStr,
 					const QString& limitOffsetStr) const
@@ -1181,25 +1369,21 @@ namespace oral
 				if (!where.isEmpty ())
 					where.prepend (" WHERE ");
 
-				const auto& queryStr = "SELECT " + fields +
+				return "SELECT " + fields +
 						" FROM " + from +
 						where +
 						orderStr +
 						groupStr +
 						limitOffsetStr;
+			}
 
-				QSqlQuery query { DB_ };
-				query.prepare (queryStr);
-				if (binder)
-					binder (query);
-
-				if (!query.exec ())
+			void RunQuery (const QSqlQuery_ptr& query) const
+			{
+				if (!query->exec ())
 				{
-					DBLock::DumpError (query);
-					throw QueryException ("fetch query execution failed", std::make_shared<QSqlQuery> (query));
+					DBLock::DumpError (*query);
+					throw QueryException ("fetch query execution failed", query);
 				}
-
-				return query;
 			}
 
 			QString HandleLimitOffset (LimitNone, OffsetNone) const noexcept
@@ -1207,26 +1391,43 @@ namespace oral
 				return {};
 			}
 
-			QString HandleLimitOffset (Limit limit, OffsetNone) const noexcept
+			QString HandleLimitOffset (Limit, OffsetNone) const noexcept
 			{
-				return " LIMIT " + QString::number (limit.Count);
+				return " LIMIT :limit";
 			}
 
 			template<typename L>
-			QString HandleLimitOffset (L limit, Offset offset) const noexcept
+			QString HandleLimitOffset (L, Offset) const noexcept
 			{
 				QString limitStr;
 				if constexpr (std::is_same_v<std::decay_t<L>, LimitNone>)
+					limitStr = LimitNone_;
+				else
+					limitStr = ":limit";
+				return " LIMIT " + limitStr + " OFFSET :offset";
+			}
+
+			void BindLimitOffset (QSqlQuery&, LimitNone, OffsetNone) const noexcept
+			{
+			}
+
+			void BindLimitOffset (QSqlQuery& query, Limit limit, OffsetNone) const noexcept
+			{
+				query.bindValue (":limit", static_cast<qulonglong> (limit.Count));
+			}
+
+			template<typename L>
+			void BindLimitOffset (QSqlQuery& query, L limit, Offset offset) const noexcept
+			{
+				if constexpr (std::is_integral_v<L>)
+					query.bindValue (":limit", static_cast<qulonglong> (limit));
+				else if constexpr (!std::is_same_v<std::decay_t<L>, LimitNone>)
+					query.bindValue (":limit", static_cast<qulonglong> (limit.Count));
+				else
 				{
 					Q_UNUSED (limit)
-					limitStr = LimitNone_;
 				}
-				else if constexpr (std::is_integral_v<L>)
-					limitStr = QString::number (limit);
-				else
-					limitStr = QString::number (limit.Count);
-				return " LIMIT " + limitStr +
-						" OFFSET " + QString::number (offset.Count);
+				query.bindValue (":offset", static_cast<qulonglong> (offset.Count));
 			}
 		};
 
@@ -1345,44 +1546,48 @@ namespace oral
 					Limit limit = LimitNone {},
 					Offset offset = OffsetNone {}) const
 			{
-				const auto& [where, binder, _] = HandleExprTree<T> (tree);
-				Q_UNUSED (_);
-				const auto& [fields, initializer, resultBehaviour] = HandleSelector (std::forward<Selector> (selector));
-				return HandleResultBehaviour (resultBehaviour,
-						Select (fields, BuildFromClause (tree),
-								where, binder,
-								initializer,
-								HandleOrder (std::forward<Order> (order)),
-								HandleGroup (std::forward<Group> (group)),
-								HandleLimitOffset (std::forward<Limit> (limit), std::forward<Offset> (offset))));
+				const auto& selectorResult = HandleSelector (std::forward<Selector> (selector));
+
+				using QueryKey_t = std::tuple<Selector, ExprTree<Type, L, R>, Order, Group, Limit, Offset>;
+				const auto& query = GetQuery<QueryKey_t> ([&]
+						{
+							const auto& where = HandleExprTree<T> (tree).Sql_;
+							return BuildQueryString (selectorResult.Fields_, BuildFromClause (tree),
+									where,
+									HandleOrder (std::forward<Order> (order)),
+									HandleGroup (std::forward<Group> (group)),
+									HandleLimitOffset (limit, offset));
+						});
+
+				BindExprTree<T> (tree, *query);
+				BindLimitOffset (*query, limit, offset);
+
+				return HandleResultBehaviour (selectorResult.Behaviour_,
+						Select (query, selectorResult.Initializer_));
 			}
 		private:
-			template<typename Binder, typename Initializer>
-			auto Select (const QString& fields, const QString& from,
-					const QString& where, Binder&& binder,
-					Initializer&& initializer,
-					const QString& orderStr,
-					const QString& groupStr,
-					const QString& limitOffsetStr) const
+			template<typename Initializer>
+			auto Select (const QSqlQuery_ptr& query, const Initializer& initializer) const
 			{
-				std::function<void (QSqlQuery&)> binderFunc;
-				if constexpr (!std::is_same_v<Void, std::decay_t<Binder>>)
-					binderFunc = binder;
-				auto query = RunQuery (fields, from, where, std::move (binderFunc), orderStr, groupStr, limitOffsetStr);
+				RunQuery (query);
 
 				if constexpr (SelectBehaviour == SelectBehaviour::Some)
 				{
 					QList<std::result_of_t<Initializer (QSqlQuery)>> result;
-					while (query.next ())
-						result << initializer (query);
+					while (query->next ())
+						result << initializer (*query);
+					query->finish ();
 					return result;
 				}
 				else
 				{
 					using RetType_t = std::optional<std::result_of_t<Initializer (QSqlQuery)>>;
-					return query.next () ?
-						RetType_t { initializer (query) } :
+					auto result = query->next () ?
+						RetType_t { initializer (*query) } :
 						RetType_t {};
+					// The query is kept around, so release the cursor explicitly.
+					query->finish ();
+					return result;
 				}
 			}
 
@@ -1689,6 +1894,7 @@ namespace oral
 	struct ObjectInfo
 	{
 		detail::AdaptInsert<T> Insert;
+		detail::AdaptInsertBatch<T> InsertBatch;
 		detail::AdaptUpdate<T> Update;
 		detail::AdaptDelete<T> Delete;
 
@@ -1714,6 +1920,7 @@ namespace oral
 
 		return
 		{
+			{ db, cachedData, factory },
 			{ db, cachedData, factory },
 			{ db, cachedData },
 			{ db, cachedData },
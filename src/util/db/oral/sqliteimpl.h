@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <util/sll/visitor.h>
 #include "oraltypes.h"
 #include "oraldetailfwd.h"
@@ -43,13 +44,22 @@ namespace LeechCraft::Util::oral::detail::SQLite
 		const QSqlDatabase DB_;
 
 		std::array<QSqlQuery_ptr, InsertAction::StaticCount () + 1> Queries_;
+		std::array<QSqlQuery_ptr, InsertAction::StaticCount () + 1> BatchQueries_;
+
+		const QString InsertInto_;
 		const QString InsertSuffix_;
+		const QString BatchRow_;
+
+		// SQLITE_MAX_VARIABLE_NUMBER defaults to 999 before SQLite 3.32.
+		constexpr static int MaxVariables_ = 999;
+		const int MaxBatchRows_;
 	public:
 		InsertQueryBuilder (const QSqlDatabase& db, const CachedFieldsData& data)
 		: DB_ { db }
-		, InsertSuffix_ { " INTO " + data.Table_ +
-			" (" + data.Fields_.join (", ") + ") VALUES (" +
-			data.BoundFields_.join (", ") + ");" }
+		, InsertInto_ { " INTO " + data.Table_ + " (" + data.Fields_.join (", ") + ") VALUES " }
+		, InsertSuffix_ { InsertInto_ + "(" + data.BoundFields_.join (", ") + ");" }
+		, BatchRow_ { "(" + JoinRepeated ("?", data.Fields_.size ()) + ")" }
+		, MaxBatchRows_ { std::max (1, MaxVariables_ / std::max (1, data.Fields_.size ())) }
 		{
 		}
 
@@ -63,7 +73,37 @@ namespace LeechCraft::Util::oral::detail::SQLite
 			}
 			return query;
 		}
+
+		int GetMaxBatchRows () const override
+		{
+			return MaxBatchRows_;
+		}
+
+		QSqlQuery_ptr GetBatchQuery (InsertAction action, int rows) override
+		{
+			if (rows != MaxBatchRows_)
+				return MakeBatchQuery (action, rows);
+
+			auto& query = BatchQueries_ [action.Selector_.which ()];
+			if (!query)
+				query = MakeBatchQuery (action, rows);
+			return query;
+		}
 	private:
+		QSqlQuery_ptr MakeBatchQuery (InsertAction action, int rows)
+		{
+			auto query = std::make_shared<QSqlQuery> (DB_);
+			query->prepare (GetInsertPrefix (action) + InsertInto_ + JoinRepeated (BatchRow_, rows) + ";");
+			return query;
+		}
+
+		static QString JoinRepeated (const QString& str, int count)
+		{
+			auto result = (str + ", ").repeated (count);
+			result.chop (2);
+			return result;
+		}
+
 		QString GetInsertPrefix (InsertAction action)
 		{
 			return Visit (action.Selector_,
@@ -191,6 +191,27 @@ namespace Util
 		QCOMPARE (records, (QList<AutogenPKeyRecord> { { 1, "0" }, { 2, "1" }, { 3, "2" } }));
 	}
 
+	void OralTest::testAutoPKeyRecordInsertBatchReturnsPKeys ()
+	{
+		auto adapted = Util::oral::AdaptPtr<AutogenPKeyRecord, OralFactory> (MakeDatabase ());
+
+		const int count = 1000;
+
+		QList<AutogenPKeyRecord> records;
+		QList<int> expectedIds;
+		for (int i = 0; i < count; ++i)
+		{
+			records.push_back ({ 0, QString::number (i) });
+			expectedIds << i + 1;
+		}
+
+		QCOMPARE (adapted->InsertBatch (records), expectedIds);
+
+		const auto& list = adapted->Select ();
+		QCOMPARE (list.size (), count);
+		QCOMPARE (list.last (), (AutogenPKeyRecord { count, QString::number (count - 1) }));
+	}
+
 	void OralTest::testNoPKeyRecordInsertSelect ()
 	{
 		auto adapted = PrepareRecords<NoPKeyRecord> (MakeDatabase ());
@@ -43,6 +43,7 @@ namespace Util
 		void testAutoPKeyRecordInsertRvalueReturnsPKey ();
 		void testAutoPKeyRecordInsertConstLvalueReturnsPKey ();
 		void testAutoPKeyRecordInsertSetsPKey ();
+		void testAutoPKeyRecordInsertBatchReturnsPKeys ();
 
 		void testNoPKeyRecordInsertSelect ();
 
@@ -70,6 +70,29 @@ namespace Util
 		QCOMPARE (list, (QList<SimpleRecord> { { 0, "0" } }));
 	}
 
+	void OralTest_SimpleRecord::testSimpleRecordInsertBatchSelect ()
+	{
+		auto adapted = Util::oral::AdaptPtr<SimpleRecord, OralFactory> (MakeDatabase ());
+
+		QList<SimpleRecord> records;
+		for (int i = 0; i < 1000; ++i)
+			records.push_back ({ i, QString::number (i) });
+		adapted->InsertBatch (records);
+
+		const auto& list = adapted->Select ();
+		QCOMPARE (list, records);
+	}
+
+	void OralTest_SimpleRecord::testSimpleRecordInsertBatchReplaceSelect ()
+	{
+		auto adapted = PrepareRecords<SimpleRecord> (MakeDatabase ());
+		adapted->InsertBatch (QList<SimpleRecord> { { 1, "10" }, { 3, "3" } },
+				lco::InsertAction::Replace::PKey<SimpleRecord>);
+
+		const auto& list = adapted->Select ();
+		QCOMPARE (list, (QList<SimpleRecord> { { 0, "0" }, { 1, "10" }, { 2, "2" }, { 3, "3" } }));
+	}
+
 	void OralTest_SimpleRecord::testSimpleRecordInsertSelectByPos ()
 	{
 		auto adapted = PrepareRecords<SimpleRecord> (MakeDatabase ());
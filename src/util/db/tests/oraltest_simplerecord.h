@@ -42,6 +42,8 @@ namespace Util
 		void testSimpleRecordInsertSelect ();
 		void testSimpleRecordInsertReplaceSelect ();
 		void testSimpleRecordInsertIgnoreSelect ();
+		void testSimpleRecordInsertBatchSelect ();
+		void testSimpleRecordInsertBatchReplaceSelect ();
 
 		void testSimpleRecordInsertSelectByPos ();
 		void testSimpleRecordInsertSelectByPos2 ();
@@ -28,6 +28,7 @@
  **********************************************************************/
 
 #include "oraltest_simplerecord_bench.h"
+#include <QElapsedTimer>
 #include "common.h"
 #include "simplerecord.h"
 
@@ -71,6 +72,93 @@ namespace Util
 		QBENCHMARK { adapted.Insert ({ 0, "0" }, lco::InsertAction::Ignore); }
 	}
 
+	namespace
+	{
+		void PopulateBatchSizes ()
+		{
+			QTest::addColumn<int> ("rows");
+
+			for (int rows : { 1, 10, 100, 1000, 10000 })
+				QTest::newRow (QByteArray::number (rows) + " rows") << rows;
+		}
+
+		QList<SimpleRecord> MakeBatch (int rows)
+		{
+			QList<SimpleRecord> records;
+			records.reserve (rows);
+			for (int i = 0; i < rows; ++i)
+				records.push_back ({ i, QString::number (i) });
+			return records;
+		}
+
+		/* QBENCHMARK reports the time per iteration, which doesn't
+		 * compare well across batch sizes, so the throughput is
+		 * reported as well.
+		 */
+		template<typename F>
+		void BenchmarkRows (int rows, F&& insert)
+		{
+			qint64 totalRows = 0;
+			qint64 totalNsecs = 0;
+
+			QBENCHMARK
+			{
+				QElapsedTimer timer;
+				timer.start ();
+				insert ();
+				totalNsecs += timer.nsecsElapsed ();
+				totalRows += rows;
+			}
+
+			if (totalNsecs)
+				qDebug () << QTest::currentDataTag ()
+						<< "inserted at"
+						<< static_cast<qint64> (totalRows * 1e9 / totalNsecs)
+						<< "rows/sec";
+		}
+	}
+
+	void OralTest_SimpleRecord_Bench::benchSimpleRecordInsertRows_data ()
+	{
+		PopulateBatchSizes ();
+	}
+
+	void OralTest_SimpleRecord_Bench::benchSimpleRecordInsertRows ()
+	{
+		QFETCH (int, rows);
+
+		auto db = MakeDatabase ();
+		const auto& adapted = Util::oral::Adapt<SimpleRecord, OralFactory> (db);
+		const auto& records = MakeBatch (rows);
+
+		BenchmarkRows (rows,
+				[&]
+				{
+					Util::DBLock lock { db };
+					lock.Init ();
+					for (const auto& record : records)
+						adapted.Insert (record, lco::InsertAction::Replace::PKey<SimpleRecord>);
+					lock.Good ();
+				});
+	}
+
+	void OralTest_SimpleRecord_Bench::benchSimpleRecordInsertBatch_data ()
+	{
+		PopulateBatchSizes ();
+	}
+
+	void OralTest_SimpleRecord_Bench::benchSimpleRecordInsertBatch ()
+	{
+		QFETCH (int, rows);
+
+		auto db = MakeDatabase ();
+		const auto& adapted = Util::oral::Adapt<SimpleRecord, OralFactory> (db);
+		const auto& records = MakeBatch (rows);
+
+		BenchmarkRows (rows,
+				[&] { adapted.InsertBatch (records, lco::InsertAction::Replace::PKey<SimpleRecord>); });
+	}
+
 	void OralTest_SimpleRecord_Bench::benchBaselineUpdate ()
 	{
 		auto db = MakeDatabase ();
@@ -96,5 +184,61 @@ namespace Util
 
 		QBENCHMARK { adapted.Update ({ 0, "1" }); }
 	}
+
+	void OralTest_SimpleRecord_Bench::benchBaselineSelect ()
+	{
+		auto db = MakeDatabase ();
+		PrepareRecords<SimpleRecord> (db, 10);
+
+		QSqlQuery query { db };
+		query.prepare ("SELECT SimpleRecord.ID, SimpleRecord.Value FROM SimpleRecord WHERE SimpleRecord.ID < :id;");
+
+		QBENCHMARK
+		{
+			query.bindValue (":id", 5);
+			query.exec ();
+
+			QList<SimpleRecord> result;
+			while (query.next ())
+				result.append ({ query.value (0).toInt (), query.value (1).toString () });
+			query.finish ();
+		}
+	}
+
+	void OralTest_SimpleRecord_Bench::benchSimpleRecordSelect ()
+	{
+		auto db = MakeDatabase ();
+		const auto& adapted = PrepareRecords<SimpleRecord> (db, 10);
+
+		QBENCHMARK { adapted->Select (sph::f<&SimpleRecord::ID_> < 5); }
+	}
+
+	void OralTest_SimpleRecord_Bench::benchBaselineSelectOne ()
+	{
+		auto db = MakeDatabase ();
+		PrepareRecords<SimpleRecord> (db, 10);
+
+		QSqlQuery query { db };
+		query.prepare ("SELECT SimpleRecord.ID, SimpleRecord.Value FROM SimpleRecord WHERE SimpleRecord.ID = :id;");
+
+		QBENCHMARK
+		{
+			query.bindValue (":id", 5);
+			query.exec ();
+
+			std::optional<SimpleRecord> result;
+			if (query.next ())
+				result = SimpleRecord { query.value (0).toInt (), query.value (1).toString () };
+			query.finish ();
+		}
+	}
+
+	void OralTest_SimpleRecord_Bench::benchSimpleRecordSelectOne ()
+	{
+		auto db = MakeDatabase ();
+		const auto& adapted = PrepareRecords<SimpleRecord> (db, 10);
+
+		QBENCHMARK { adapted->SelectOne (sph::f<&SimpleRecord::ID_> == 5); }
+	}
 }
 }
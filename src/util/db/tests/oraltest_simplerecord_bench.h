@@ -44,8 +44,19 @@ namespace Util
 		void benchBaselineInsert ();
 		void benchSimpleRecordInsert ();
 
+		void benchSimpleRecordInsertRows_data ();
+		void benchSimpleRecordInsertRows ();
+		void benchSimpleRecordInsertBatch_data ();
+		void benchSimpleRecordInsertBatch ();
+
 		void benchBaselineUpdate ();
 		void benchSimpleRecordUpdate ();
+
+		void benchBaselineSelect ();
+		void benchSimpleRecordSelect ();
+
+		void benchBaselineSelectOne ();
+		void benchSimpleRecordSelectOne ();
 	};
 }
 }
@@ -28,13 +28,21 @@
  **********************************************************************/
 
 #include "networkdiskcache.h"
+#include <algorithm>
+#include <memory>
 #include <QtDebug>
+#include <QBuffer>
+#include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
 #include <QFuture>
+#include <QMultiMap>
 #include <QMutexLocker>
+#include <QtConcurrentRun>
 #include <util/sys/paths.h>
 #include <util/threads/futures.h>
-#include "networkdiskcachegc.h"
+#include "networkdiskcacheindex.h"
+#include "networkdiskcachefront.h"
 
 namespace LeechCraft
 {
@@ -46,27 +54,107 @@ namespace Util
 		{
 			return GetUserDir (UserDir::Cache, "network/" + subpath).absolutePath ();
 		}
+
+		class RecoveryReader : public QNetworkDiskCache
+		{
+		public:
+			using QNetworkDiskCache::fileMetaData;
+		};
+
+		/** Returns the entries of the cache in the \em cacheDirectory
+		 * along with the sizes of their bodies, the least recently
+		 * modified first.
+		 *
+		 * This function is to be run in a separate thread.
+		 */
+		QList<QPair<QUrl, qint64>> RecoverEntries (const QString& cacheDirectory)
+		{
+			RecoveryReader reader;
+			reader.setCacheDirectory (cacheDirectory);
+
+			QMultiMap<QDateTime, QPair<QUrl, qint64>> entries;
+
+			QDirIterator it { cacheDirectory, { "*.d" }, QDir::Files, QDirIterator::Subdirectories };
+			while (it.hasNext ())
+			{
+				const auto& url = reader.fileMetaData (it.next ()).url ();
+				if (!url.isValid ())
+					continue;
+
+				// The same size NetworkDiskCache::data() touches the entry with.
+				const std::unique_ptr<QIODevice> dev { reader.data (url) };
+				if (dev)
+					entries.insert (it.fileInfo ().lastModified (), { url, dev->size () });
+			}
+
+			return entries.values ();
+		}
+
+		QIODevice* MakeBuffer (const QByteArray& body)
+		{
+			const auto buffer = new QBuffer;
+			buffer->setData (body);
+			buffer->open (QIODevice::ReadOnly);
+			return buffer;
+		}
 	}
 
 	NetworkDiskCache::NetworkDiskCache (const QString& subpath, QObject *parent)
 	: QNetworkDiskCache (parent)
-	, CurrentSize_ (-1)
 	, InsertRemoveMutex_ (QMutex::Recursive)
-	, GcGuard_ (NetworkDiskCacheGC::Instance ().RegisterDirectory (GetCacheDir (subpath),
-			[this] { return maximumCacheSize (); }))
+	, Index_ (NetworkDiskCacheIndex::ForDirectory (GetCacheDir (subpath)))
+	, Front_ (NetworkDiskCacheFront::ForDirectory (GetCacheDir (subpath)))
 	{
 		setCacheDirectory (GetCacheDir (subpath));
+
+		if (Index_->StartRecovery ())
+			StartRecovery ();
+	}
+
+	NetworkDiskCache::~NetworkDiskCache ()
+	{
+		if (IsRecovering_)
+			Index_->AbortRecovery ();
+	}
+
+	std::shared_ptr<NetworkDiskCacheFront> NetworkDiskCache::GetFrontCache () const
+	{
+		return Front_;
 	}
 
 	qint64 NetworkDiskCache::cacheSize () const
 	{
-		return CurrentSize_;
+		return Index_->GetTotalSize ();
 	}
 
 	QIODevice* NetworkDiskCache::data (const QUrl& url)
 	{
+		if (const auto body = Front_->GetBody (url))
+		{
+			Index_->Touch (url, body->size ());
+			return MakeBuffer (*body);
+		}
+
+		const auto generation = Front_->GetGeneration (url);
+
 		QMutexLocker lock (&InsertRemoveMutex_);
-		return QNetworkDiskCache::data (url);
+		const auto dev = QNetworkDiskCache::data (url);
+		if (!dev)
+		{
+			Index_->Remove (url);
+			Front_->Invalidate (url);
+			return nullptr;
+		}
+
+		const auto size = dev->size ();
+		Index_->Touch (url, size);
+		if (size > Front_->GetMaxBodySize ())
+			return dev;
+
+		const auto& body = dev->readAll ();
+		delete dev;
+		Front_->SetBody (url, body, generation);
+		return MakeBuffer (body);
 	}
 
 	void NetworkDiskCache::insert (QIODevice *device)
@@ -79,24 +167,39 @@ namespace Util
 			return;
 		}
 
-		PendingUrl2Devs_ [PendingDev2Url_.take (device)].removeAll (device);
+		const auto& url = PendingDev2Url_.take (device);
+		PendingUrl2Devs_ [url].removeAll (device);
 
-		CurrentSize_ += device->size ();
+		const auto size = device->size () - PendingDev2HeaderSize_.take (device);
 		QNetworkDiskCache::insert (device);
-	}
 
+		Front_->Invalidate (url);
+		Index_->Touch (url, size);
+		EvictLeastRecent ();
+	}
 	QNetworkCacheMetaData NetworkDiskCache::metaData (const QUrl& url)
 	{
+		if (const auto metaData = Front_->GetMetaData (url))
+			return *metaData;
+
+		const auto generation = Front_->GetGeneration (url);
+
 		QMutexLocker lock (&InsertRemoveMutex_);
-		return QNetworkDiskCache::metaData (url);
+		const auto& metaData = QNetworkDiskCache::metaData (url);
+		Front_->SetMetaData (url, metaData, generation);
+		return metaData;
 	}
 
 	QIODevice* NetworkDiskCache::prepare (const QNetworkCacheMetaData& metadata)
 	{
 		QMutexLocker lock (&InsertRemoveMutex_);
 		const auto dev = QNetworkDiskCache::prepare (metadata);
+		if (!dev)
+			return nullptr;
+
 		PendingDev2Url_ [dev] = metadata.url ();
 		PendingUrl2Devs_ [metadata.url ()] << dev;
+		PendingDev2HeaderSize_ [dev] = dev->size ();
 		return dev;
 	}
 
@@ -104,28 +207,79 @@ namespace Util
 	{
 		QMutexLocker lock (&InsertRemoveMutex_);
 		for (const auto dev : PendingUrl2Devs_.take (url))
+		{
 			PendingDev2Url_.remove (dev);
-		return QNetworkDiskCache::remove (url);
+			PendingDev2HeaderSize_.remove (dev);
+		}
+		Index_->Remove (url);
+		const auto result = QNetworkDiskCache::remove (url);
+		Front_->Invalidate (url);
+		return result;
 	}
 
 	void NetworkDiskCache::updateMetaData (const QNetworkCacheMetaData& metaData)
 	{
 		QMutexLocker lock (&InsertRemoveMutex_);
 		QNetworkDiskCache::updateMetaData (metaData);
+		Front_->Invalidate (metaData.url ());
+	}
+
+	void NetworkDiskCache::clear ()
+	{
+		QMutexLocker lock (&InsertRemoveMutex_);
+		RemoveEvicted (Index_->TakeLeastRecent (0));
+		Front_->Clear ();
 	}
 
 	qint64 NetworkDiskCache::expire ()
 	{
-		if (CurrentSize_ < 0)
-		{
-			const auto& dir = cacheDirectory ();
-			Util::Sequence (this, NetworkDiskCacheGC::Instance ().GetCurrentSize (dir)) >>
-					[this] (qint64 res) { CurrentSize_ = res; };
+		QMutexLocker lock (&InsertRemoveMutex_);
+		EvictLeastRecent ();
+		return Index_->GetTotalSize ();
+	}
 
-			return maximumCacheSize () * 8 / 10;
+	void NetworkDiskCache::EvictLeastRecent ()
+	{
+		const auto maxSize = maximumCacheSize ();
+		if (Index_->GetTotalSize () <= maxSize)
+			return;
+
+		RemoveEvicted (Index_->TakeLeastRecent (maxSize * 9 / 10));
+	}
+
+	void NetworkDiskCache::RemoveEvicted (const QList<QUrl>& urls)
+	{
+		for (const auto& url : urls)
+		{
+			QNetworkDiskCache::remove (url);
+			Front_->Invalidate (url);
 		}
+	}
+
+	void NetworkDiskCache::StartRecovery ()
+	{
+		qDebug () << Q_FUNC_INFO
+				<< "recovering the index of"
+				<< cacheDirectory ();
+
+		IsRecovering_ = true;
+
+		const auto& dir = cacheDirectory ();
+		Util::Sequence (this, QtConcurrent::run ([dir] { return RecoverEntries (dir); })) >>
+				[this] (const QList<QPair<QUrl, qint64>>& entries)
+				{
+					qDebug () << Q_FUNC_INFO
+							<< "recovered"
+							<< entries.size ()
+							<< "entries of"
+							<< cacheDirectory ();
+
+					QMutexLocker lock (&InsertRemoveMutex_);
+					Index_->FinishRecovery (entries);
+					IsRecovering_ = false;
 
-		return CurrentSize_;
+					EvictLeastRecent ();
+				};
 	}
 }
 }
@@ -29,26 +29,38 @@
 
 #pragma once
 
+#include <memory>
 #include <QNetworkDiskCache>
 #include <QMutex>
 #include <QHash>
-#include <util/sll/util.h>
 #include "networkconfig.h"
 
 namespace LeechCraft
 {
 namespace Util
 {
+	class NetworkDiskCacheIndex;
+	class NetworkDiskCacheFront;
+
 	/** @brief A thread-safe garbage-collected network disk cache.
 	 *
 	 * This class is thread-safe unlike the original QNetworkDiskCache,
 	 * thus it can be used from multiple threads simultaneously.
 	 *
-	 * Also, old cache data is automatically removed from the cache in a
-	 * background thread without blocking. The garbage collection can be
-	 * also triggered manually via the collectGarbage() slot.
+	 * Cache entries are tracked by a journaled LRU index shared by all
+	 * caches using the same directory (see NetworkDiskCacheIndex). Once
+	 * an insertion makes the cache exceed its maximum size, the least
+	 * recently used entries are removed until the cache takes 90% of its
+	 * maximum size.
+	 *
+	 * The entries are accounted by the sizes of their bodies. The cache
+	 * directory is only walked to recover the index if its journal is
+	 * missing or broken. This is done in background without blocking.
 	 *
-	 * The garbage is collected until cache takes 90% of its maximum size.
+	 * Recently looked up metadata and small bodies are served from an
+	 * in-memory front cache, also shared by all caches using the same
+	 * directory (see NetworkDiskCacheFront). Such lookups neither touch
+	 * the disk nor take the lock serializing the disk cache operations.
 	 *
 	 * @ingroup NetworkUtil
 	 */
@@ -56,14 +68,19 @@ namespace Util
 	{
 		Q_OBJECT
 
-		qint64 CurrentSize_;
-
 		mutable QMutex InsertRemoveMutex_;
 
 		QHash<QIODevice*, QUrl> PendingDev2Url_;
 		QHash<QUrl, QList<QIODevice*>> PendingUrl2Devs_;
 
-		const Util::DefaultScopeGuard GcGuard_;
+		// The size of the metadata written to a prepared device before
+		// the body.
+		QHash<QIODevice*, qint64> PendingDev2HeaderSize_;
+
+		const std::shared_ptr<NetworkDiskCacheIndex> Index_;
+		const std::shared_ptr<NetworkDiskCacheFront> Front_;
+
+		bool IsRecovering_ = false;
 	public:
 		/** @brief Constructs the new disk cache.
 		 *
@@ -77,6 +94,17 @@ namespace Util
 		 */
 		NetworkDiskCache (const QString& subpath, QObject *parent = 0);
 
+		~NetworkDiskCache ();
+
+		/** @brief Returns the front cache used by this cache.
+		 *
+		 * The front cache may be used to query the lookup counters.
+		 *
+		 * @return The front cache shared by the caches in the same
+		 * directory.
+		 */
+		std::shared_ptr<NetworkDiskCacheFront> GetFrontCache () const;
+
 		/** @brief Reimplemented from QNetworkDiskCache.
 		 */
 		qint64 cacheSize () const override;
@@ -104,10 +132,19 @@ namespace Util
 		/** @brief Reimplemented from QNetworkDiskCache.
 		 */
 		void updateMetaData (const QNetworkCacheMetaData& metaData) override;
+	public slots:
+		/** @brief Reimplemented from QNetworkDiskCache.
+		 */
+		void clear () override;
 	protected:
 		/** @brief Reimplemented from QNetworkDiskCache.
 		 */
 		qint64 expire () override;
+	private:
+		void EvictLeastRecent ();
+		void RemoveEvicted (const QList<QUrl>&);
+
+		void StartRecovery ();
 	};
 }
 }
@@ -0,0 +1,260 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "networkdiskcachefront.h"
+#include <QDir>
+#include <QMutexLocker>
+
+namespace LeechCraft
+{
+namespace Util
+{
+	namespace
+	{
+		const qint64 DefaultBudget = 8 * 1024 * 1024;
+		const qint64 DefaultMaxBodySize = 64 * 1024;
+
+		/** The approximate amount of memory taken by an entry besides its
+		 * URL, headers and body.
+		 */
+		const qint64 ItemOverhead = 128;
+
+		qint64 GetMetaDataCost (const QNetworkCacheMetaData& metaData)
+		{
+			qint64 cost = 0;
+			for (const auto& header : metaData.rawHeaders ())
+				cost += header.first.size () + header.second.size ();
+			return cost;
+		}
+	}
+
+	NetworkDiskCacheFront::NetworkDiskCacheFront (qint64 budget, qint64 maxBodySize)
+	: ShardBudget_ { budget / ShardsCount }
+	, MaxBodySize_ { maxBodySize }
+	{
+	}
+
+	std::shared_ptr<NetworkDiskCacheFront> NetworkDiskCacheFront::ForDirectory (const QString& cacheDir)
+	{
+		static QMutex mutex;
+		static QHash<QString, std::weak_ptr<NetworkDiskCacheFront>> fronts;
+
+		const auto& path = QDir::cleanPath (cacheDir);
+
+		QMutexLocker locker { &mutex };
+		if (const auto front = fronts.value (path).lock ())
+			return front;
+
+		const auto& front = std::make_shared<NetworkDiskCacheFront> (DefaultBudget, DefaultMaxBodySize);
+		fronts [path] = front;
+		return front;
+	}
+
+	qint64 NetworkDiskCacheFront::GetMaxBodySize () const
+	{
+		return MaxBodySize_;
+	}
+
+	boost::optional<QNetworkCacheMetaData> NetworkDiskCacheFront::GetMetaData (const QUrl& url)
+	{
+		auto& shard = GetShard (url);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		const auto pos = shard.Url2Item_.find (url);
+		if (pos == shard.Url2Item_.end () || !(*pos)->MetaData_)
+		{
+			++MetaDataMisses_;
+			return {};
+		}
+
+		++MetaDataHits_;
+		shard.Items_.splice (shard.Items_.begin (), shard.Items_, *pos);
+		return (*pos)->MetaData_;
+	}
+
+	boost::optional<QByteArray> NetworkDiskCacheFront::GetBody (const QUrl& url)
+	{
+		auto& shard = GetShard (url);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		const auto pos = shard.Url2Item_.find (url);
+		if (pos == shard.Url2Item_.end () || !(*pos)->Body_)
+		{
+			++DataMisses_;
+			return {};
+		}
+
+		++DataHits_;
+		shard.Items_.splice (shard.Items_.begin (), shard.Items_, *pos);
+		return (*pos)->Body_;
+	}
+
+	auto NetworkDiskCacheFront::GetGeneration (const QUrl& url) const -> Generation_t
+	{
+		auto& shard = GetShard (url);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		return GetGenerationSlot (shard, url);
+	}
+
+	void NetworkDiskCacheFront::SetMetaData (const QUrl& url,
+			const QNetworkCacheMetaData& metaData, Generation_t generation)
+	{
+		auto& shard = GetShard (url);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		if (GetGenerationSlot (shard, url) != generation)
+			return;
+
+		auto& item = GetItem (shard, url);
+		item.MetaData_ = metaData;
+		if (!metaData.isValid ())
+			item.Body_.reset ();
+		Recost (shard, item);
+		Trim (shard);
+	}
+
+	void NetworkDiskCacheFront::SetBody (const QUrl& url, const QByteArray& body, Generation_t generation)
+	{
+		if (body.size () > MaxBodySize_)
+			return;
+
+		auto& shard = GetShard (url);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		if (GetGenerationSlot (shard, url) != generation)
+			return;
+
+		auto& item = GetItem (shard, url);
+		item.Body_ = body;
+		Recost (shard, item);
+		Trim (shard);
+	}
+
+	void NetworkDiskCacheFront::Invalidate (const QUrl& url)
+	{
+		auto& shard = GetShard (url);
+
+		QMutexLocker locker { &shard.Mutex_ };
+		++GetGenerationSlot (shard, url);
+
+		const auto pos = shard.Url2Item_.find (url);
+		if (pos == shard.Url2Item_.end ())
+			return;
+
+		shard.Cost_ -= (*pos)->Cost_;
+		shard.Items_.erase (*pos);
+		shard.Url2Item_.erase (pos);
+	}
+
+	void NetworkDiskCacheFront::Clear ()
+	{
+		for (auto& shard : Shards_)
+		{
+			QMutexLocker locker { &shard.Mutex_ };
+			shard.Items_.clear ();
+			shard.Url2Item_.clear ();
+			shard.Cost_ = 0;
+			for (auto& generation : shard.Generations_)
+				++generation;
+		}
+	}
+
+	NetworkDiskCacheFront::Stats NetworkDiskCacheFront::GetStats () const
+	{
+		Stats stats;
+		stats.MetaDataHits_ = MetaDataHits_;
+		stats.MetaDataMisses_ = MetaDataMisses_;
+		stats.DataHits_ = DataHits_;
+		stats.DataMisses_ = DataMisses_;
+		return stats;
+	}
+
+	qint64 NetworkDiskCacheFront::GetCost () const
+	{
+		qint64 cost = 0;
+		for (auto& shard : Shards_)
+		{
+			QMutexLocker locker { &shard.Mutex_ };
+			cost += shard.Cost_;
+		}
+		return cost;
+	}
+
+	NetworkDiskCacheFront::Shard& NetworkDiskCacheFront::GetShard (const QUrl& url) const
+	{
+		return Shards_ [qHash (url) % ShardsCount];
+	}
+
+	auto NetworkDiskCacheFront::GetGenerationSlot (Shard& shard, const QUrl& url) -> Generation_t&
+	{
+		// The lower bits of the hash have already been used to pick the shard.
+		return shard.Generations_ [(qHash (url) / ShardsCount) % GenerationSlotsCount];
+	}
+
+	NetworkDiskCacheFront::Item& NetworkDiskCacheFront::GetItem (Shard& shard, const QUrl& url)
+	{
+		const auto pos = shard.Url2Item_.find (url);
+		if (pos != shard.Url2Item_.end ())
+		{
+			shard.Items_.splice (shard.Items_.begin (), shard.Items_, *pos);
+			return **pos;
+		}
+
+		Item item;
+		item.Url_ = url;
+		shard.Items_.push_front (item);
+		shard.Url2Item_ [url] = shard.Items_.begin ();
+		return shard.Items_.front ();
+	}
+
+	void NetworkDiskCacheFront::Recost (Shard& shard, Item& item)
+	{
+		qint64 cost = ItemOverhead + item.Url_.toEncoded ().size ();
+		if (item.MetaData_)
+			cost += GetMetaDataCost (*item.MetaData_);
+		if (item.Body_)
+			cost += item.Body_->size ();
+
+		shard.Cost_ += cost - item.Cost_;
+		item.Cost_ = cost;
+	}
+
+	void NetworkDiskCacheFront::Trim (Shard& shard)
+	{
+		while (shard.Cost_ > ShardBudget_ && shard.Items_.size () > 1)
+		{
+			const auto& item = shard.Items_.back ();
+			shard.Cost_ -= item.Cost_;
+			shard.Url2Item_.remove (item.Url_);
+			shard.Items_.pop_back ();
+		}
+	}
+}
+}
@@ -0,0 +1,256 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <boost/optional.hpp>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QNetworkCacheMetaData>
+#include <QUrl>
+#include "networkconfig.h"
+
+namespace LeechCraft
+{
+namespace Util
+{
+	/** @brief Bounded in-memory cache of network disk cache entries.
+	 *
+	 * The front cache keeps the metadata of recently looked up URLs
+	 * (including the lookups that didn't find anything) along with the
+	 * bodies of small entries, so that repeated lookups don't have to
+	 * open and parse the cache files on disk.
+	 *
+	 * The entries are spread over a fixed number of shards by the hash
+	 * of their URLs. Each shard has its own lock and its own LRU list
+	 * bounded by its part of the total memory budget, so lookups of
+	 * different URLs mostly don't contend with each other.
+	 *
+	 * The front cache is shared by all caches using the same directory
+	 * (see ForDirectory()), and it is up to them to keep it coherent by
+	 * invalidating the URLs they change on disk after changing them.
+	 *
+	 * A cache filling the front cache after a miss may race with
+	 * another cache changing the same entry on disk. To avoid keeping
+	 * the stale data, the filler takes the generation of the URL via
+	 * GetGeneration() before reading the disk, and passes it to
+	 * SetMetaData() or SetBody(), which drop the data if the URL has
+	 * been invalidated in between.
+	 *
+	 * This class is thread-safe.
+	 *
+	 * @sa NetworkDiskCache
+	 *
+	 * @ingroup NetworkUtil
+	 */
+	class UTIL_NETWORK_API NetworkDiskCacheFront
+	{
+	public:
+		/** @brief Lookup counters of the front cache.
+		 */
+		struct Stats
+		{
+			/** @brief The number of metadata lookups served from memory.
+			 */
+			quint64 MetaDataHits_ = 0;
+
+			/** @brief The number of metadata lookups that missed.
+			 */
+			quint64 MetaDataMisses_ = 0;
+
+			/** @brief The number of body lookups served from memory.
+			 */
+			quint64 DataHits_ = 0;
+
+			/** @brief The number of body lookups that missed.
+			 */
+			quint64 DataMisses_ = 0;
+		};
+
+		/** @brief The generation of a URL, changed by each invalidation.
+		 */
+		using Generation_t = quint64;
+	private:
+		struct Item
+		{
+			QUrl Url_;
+			boost::optional<QNetworkCacheMetaData> MetaData_;
+			boost::optional<QByteArray> Body_;
+			qint64 Cost_ = 0;
+		};
+		using Items_t = std::list<Item>;
+
+		/** The generations are kept for the URLs that aren't in the
+		 * cache too, so they are striped over a fixed number of slots
+		 * instead of being kept per each URL ever seen. A collision
+		 * only makes a fill be dropped needlessly.
+		 */
+		static const int GenerationSlotsCount = 64;
+
+		struct Shard
+		{
+			QMutex Mutex_;
+
+			Items_t Items_;
+			QHash<QUrl, Items_t::iterator> Url2Item_;
+			qint64 Cost_ = 0;
+
+			std::array<Generation_t, GenerationSlotsCount> Generations_ {};
+		};
+
+		static const int ShardsCount = 16;
+		mutable std::array<Shard, ShardsCount> Shards_;
+
+		const qint64 ShardBudget_;
+		const qint64 MaxBodySize_;
+
+		std::atomic<quint64> MetaDataHits_ { 0 };
+		std::atomic<quint64> MetaDataMisses_ { 0 };
+		std::atomic<quint64> DataHits_ { 0 };
+		std::atomic<quint64> DataMisses_ { 0 };
+	public:
+		/** @brief Creates the front cache with the given limits.
+		 *
+		 * @param[in] budget The total memory budget of the cache in
+		 * bytes, including the approximate size of the metadata.
+		 * @param[in] maxBodySize The maximum size of a body to be kept
+		 * in memory.
+		 */
+		NetworkDiskCacheFront (qint64 budget, qint64 maxBodySize);
+
+		NetworkDiskCacheFront (const NetworkDiskCacheFront&) = delete;
+		NetworkDiskCacheFront& operator= (const NetworkDiskCacheFront&) = delete;
+
+		/** @brief Returns the front cache shared by all caches in the
+		 * directory.
+		 *
+		 * @param[in] cacheDir The cache directory.
+		 * @return The front cache for the \em cacheDir, created with the
+		 * default limits if needed.
+		 */
+		static std::shared_ptr<NetworkDiskCacheFront> ForDirectory (const QString& cacheDir);
+
+		/** @brief Returns the maximum size of a body kept in memory.
+		 *
+		 * @return The maximum body size in bytes.
+		 */
+		qint64 GetMaxBodySize () const;
+
+		/** @brief Looks up the metadata of the \em url.
+		 *
+		 * An invalid QNetworkCacheMetaData is returned if the \em url is
+		 * known to be absent from the disk cache.
+		 *
+		 * @param[in] url The URL to look up.
+		 * @return The metadata or an empty optional on a miss.
+		 */
+		boost::optional<QNetworkCacheMetaData> GetMetaData (const QUrl& url);
+
+		/** @brief Looks up the body of the \em url.
+		 *
+		 * @param[in] url The URL to look up.
+		 * @return The body or an empty optional on a miss.
+		 */
+		boost::optional<QByteArray> GetBody (const QUrl& url);
+
+		/** @brief Returns the current generation of the \em url.
+		 *
+		 * The generation is to be taken before reading the entry from
+		 * disk and passed to SetMetaData() or SetBody() afterwards.
+		 *
+		 * @param[in] url The URL of the cache entry.
+		 * @return The current generation of the \em url.
+		 */
+		Generation_t GetGeneration (const QUrl& url) const;
+
+		/** @brief Remembers the metadata of the \em url as read from disk.
+		 *
+		 * The metadata is dropped if the \em url has been invalidated
+		 * since the \em generation has been obtained.
+		 *
+		 * @param[in] url The URL of the cache entry.
+		 * @param[in] metaData The metadata of the entry, or an invalid
+		 * one if there is no such entry.
+		 * @param[in] generation The generation of the \em url taken
+		 * before reading the \em metaData.
+		 */
+		void SetMetaData (const QUrl& url, const QNetworkCacheMetaData& metaData, Generation_t generation);
+
+		/** @brief Remembers the body of the \em url as read from disk.
+		 *
+		 * Bodies larger than GetMaxBodySize() are ignored. The body is
+		 * also dropped if the \em url has been invalidated since the
+		 * \em generation has been obtained.
+		 *
+		 * @param[in] url The URL of the cache entry.
+		 * @param[in] body The body of the entry.
+		 * @param[in] generation The generation of the \em url taken
+		 * before reading the \em body.
+		 */
+		void SetBody (const QUrl& url, const QByteArray& body, Generation_t generation);
+
+		/** @brief Forgets everything known about the \em url.
+		 *
+		 * This also changes the generation of the \em url, so the
+		 * fills started before this call are dropped.
+		 *
+		 * @param[in] url The URL of the cache entry.
+		 */
+		void Invalidate (const QUrl& url);
+
+		/** @brief Forgets everything known about all URLs.
+		 */
+		void Clear ();
+
+		/** @brief Returns the lookup counters.
+		 *
+		 * @return The counters accumulated since the cache creation.
+		 */
+		Stats GetStats () const;
+
+		/** @brief Returns the current approximate memory usage.
+		 *
+		 * @return The total cost of the kept entries in bytes.
+		 */
+		qint64 GetCost () const;
+	private:
+		Shard& GetShard (const QUrl&) const;
+		static Generation_t& GetGenerationSlot (Shard&, const QUrl&);
+
+		Item& GetItem (Shard&, const QUrl&);
+		void Recost (Shard&, Item&);
+		void Trim (Shard&);
+	};
+}
+}
@@ -0,0 +1,429 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "networkdiskcacheindex.h"
+#include <QDir>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <QtConcurrentRun>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Util
+{
+	namespace
+	{
+		const QByteArray JournalHeader = "LCNDC-LRU 1";
+
+		/** The journal is compacted once it has this many records more
+		 * than twice the number of entries in the index.
+		 */
+		const int CompactionSlack = 1024;
+
+		/** Buffered records are written at least this often, in ms.
+		 */
+		const int JournalFlushInterval = 1000;
+
+		const QIODevice::OpenMode JournalOpenMode = QIODevice::WriteOnly | QIODevice::Append;
+
+		QByteArray MakeTouchRecord (const QUrl& url, qint64 size)
+		{
+			return "T " + QByteArray::number (size) + ' ' + url.toEncoded () + '\n';
+		}
+
+		QByteArray MakeRemoveRecord (const QUrl& url)
+		{
+			return "R " + url.toEncoded () + '\n';
+		}
+	}
+
+	NetworkDiskCacheIndex::NetworkDiskCacheIndex (const QString& journalPath)
+	: JournalPath_ { journalPath }
+	, Journal_ { journalPath }
+	{
+		LastFlush_.start ();
+
+		Replay (journalPath);
+
+		// The journal is rewritten once the recovery is finished, and
+		// until then it's left as is, so that an interrupted recovery is
+		// restarted next time.
+		if (NeedsRecovery_)
+			return;
+
+		if (!Journal_.open (JournalOpenMode))
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open the journal"
+					<< journalPath
+					<< Journal_.errorString ();
+	}
+
+	NetworkDiskCacheIndex::~NetworkDiskCacheIndex ()
+	{
+		// A finishing compaction may start another one.
+		while (true)
+		{
+			QFuture<void> compaction;
+			{
+				QMutexLocker locker { &Mutex_ };
+				if (!IsCompacting_)
+					break;
+				compaction = Compaction_;
+			}
+			compaction.waitForFinished ();
+		}
+
+		Journal_.close ();
+	}
+
+	std::shared_ptr<NetworkDiskCacheIndex> NetworkDiskCacheIndex::ForDirectory (const QString& cacheDir)
+	{
+		static QMutex mutex;
+		static QHash<QString, std::weak_ptr<NetworkDiskCacheIndex>> indexes;
+
+		const auto& path = QDir::cleanPath (cacheDir);
+
+		QMutexLocker locker { &mutex };
+		if (const auto index = indexes.value (path).lock ())
+			return index;
+
+		QDir {}.mkpath (path);
+
+		const auto& index = std::make_shared<NetworkDiskCacheIndex> (path + "/lru.journal");
+		indexes [path] = index;
+		return index;
+	}
+
+	qint64 NetworkDiskCacheIndex::GetTotalSize () const
+	{
+		QMutexLocker locker { &Mutex_ };
+		return TotalSize_;
+	}
+
+	int NetworkDiskCacheIndex::GetCount () const
+	{
+		QMutexLocker locker { &Mutex_ };
+		return Url2Entry_.size ();
+	}
+
+	void NetworkDiskCacheIndex::Touch (const QUrl& url, qint64 size)
+	{
+		QMutexLocker locker { &Mutex_ };
+		switch (TouchImpl (url, size))
+		{
+		case TouchResult::Unchanged:
+			break;
+		case TouchResult::Reordered:
+			AppendRecord (MakeTouchRecord (url, size), false);
+			break;
+		case TouchResult::Changed:
+			AppendRecord (MakeTouchRecord (url, size), true);
+			break;
+		}
+	}
+
+	void NetworkDiskCacheIndex::Remove (const QUrl& url)
+	{
+		QMutexLocker locker { &Mutex_ };
+		if (RemoveImpl (url))
+			AppendRecord (MakeRemoveRecord (url), true);
+	}
+
+	QList<QUrl> NetworkDiskCacheIndex::TakeLeastRecent (qint64 goal)
+	{
+		QMutexLocker locker { &Mutex_ };
+
+		QList<QUrl> result;
+		while (TotalSize_ > goal && !Entries_.empty ())
+		{
+			const auto url = Entries_.back ().Url_;
+			RemoveImpl (url);
+			AppendRecord (MakeRemoveRecord (url), false);
+			result << url;
+		}
+		if (!result.isEmpty ())
+			FlushJournal ();
+		return result;
+	}
+
+	void NetworkDiskCacheIndex::Clear ()
+	{
+		QMutexLocker locker { &Mutex_ };
+		Entries_.clear ();
+		Url2Entry_.clear ();
+		TotalSize_ = 0;
+
+		if (!NeedsRecovery_)
+			Compact ();
+	}
+
+	bool NetworkDiskCacheIndex::NeedsRecovery () const
+	{
+		QMutexLocker locker { &Mutex_ };
+		return NeedsRecovery_;
+	}
+
+	bool NetworkDiskCacheIndex::StartRecovery ()
+	{
+		QMutexLocker locker { &Mutex_ };
+		if (!NeedsRecovery_ || IsRecovering_)
+			return false;
+
+		IsRecovering_ = true;
+		return true;
+	}
+
+	void NetworkDiskCacheIndex::FinishRecovery (const QList<QPair<QUrl, qint64>>& entries)
+	{
+		QMutexLocker locker { &Mutex_ };
+
+		// Going from the most recently used ones, so that the oldest
+		// entry ends up at the very back.
+		for (auto i = entries.size () - 1; i >= 0; --i)
+		{
+			const auto& pair = entries.at (i);
+			if (Url2Entry_.contains (pair.first))
+				continue;
+
+			Entries_.push_back ({ pair.first, pair.second });
+			Url2Entry_ [pair.first] = std::prev (Entries_.end ());
+			TotalSize_ += pair.second;
+		}
+
+		NeedsRecovery_ = false;
+		IsRecovering_ = false;
+
+		Compact ();
+	}
+
+	void NetworkDiskCacheIndex::AbortRecovery ()
+	{
+		QMutexLocker locker { &Mutex_ };
+		IsRecovering_ = false;
+	}
+
+	void NetworkDiskCacheIndex::Replay (const QString& journalPath)
+	{
+		QFile file { journalPath };
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			NeedsRecovery_ = true;
+			return;
+		}
+
+		if (file.readLine ().trimmed () != JournalHeader)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown journal format in"
+					<< journalPath;
+			NeedsRecovery_ = true;
+			return;
+		}
+
+		while (!file.atEnd ())
+		{
+			const auto& line = file.readLine ();
+
+			// A record torn by a crash can only be the last one.
+			if (!line.endsWith ('\n'))
+				break;
+
+			if (!ApplyRecord (line.left (line.size () - 1)))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "broken record"
+						<< line
+						<< "in"
+						<< journalPath;
+
+				Entries_.clear ();
+				Url2Entry_.clear ();
+				TotalSize_ = 0;
+				NeedsRecovery_ = true;
+				return;
+			}
+
+			++JournalRecords_;
+		}
+	}
+
+	bool NetworkDiskCacheIndex::ApplyRecord (const QByteArray& record)
+	{
+		const auto& parts = record.split (' ');
+		if (parts.value (0) == "T" && parts.size () == 3)
+		{
+			bool ok = false;
+			const auto size = parts.at (1).toLongLong (&ok);
+			const auto& url = QUrl::fromEncoded (parts.at (2));
+			if (!ok || !url.isValid ())
+				return false;
+
+			TouchImpl (url, size);
+			return true;
+		}
+		else if (parts.value (0) == "R" && parts.size () == 2)
+		{
+			RemoveImpl (QUrl::fromEncoded (parts.at (1)));
+			return true;
+		}
+
+		return false;
+	}
+
+	auto NetworkDiskCacheIndex::TouchImpl (const QUrl& url, qint64 size) -> TouchResult
+	{
+		const auto pos = Url2Entry_.find (url);
+		if (pos == Url2Entry_.end ())
+		{
+			Entries_.push_front ({ url, size });
+			Url2Entry_ [url] = Entries_.begin ();
+			TotalSize_ += size;
+			return TouchResult::Changed;
+		}
+
+		const auto entry = *pos;
+		const bool isResized = entry->Size_ != size;
+		if (!isResized && entry == Entries_.begin ())
+			return TouchResult::Unchanged;
+
+		TotalSize_ += size - entry->Size_;
+		entry->Size_ = size;
+		Entries_.splice (Entries_.begin (), Entries_, entry);
+		return isResized ? TouchResult::Changed : TouchResult::Reordered;
+	}
+
+	bool NetworkDiskCacheIndex::RemoveImpl (const QUrl& url)
+	{
+		const auto pos = Url2Entry_.find (url);
+		if (pos == Url2Entry_.end ())
+			return false;
+
+		TotalSize_ -= (*pos)->Size_;
+		Entries_.erase (*pos);
+		Url2Entry_.erase (pos);
+		return true;
+	}
+
+	void NetworkDiskCacheIndex::AppendRecord (const QByteArray& record, bool durable)
+	{
+		// The records made during the compaction go to the compacted
+		// journal too, even if there is no journal to append to now.
+		if (IsCompacting_)
+		{
+			CompactionTail_ += record;
+			++CompactionTailRecords_;
+		}
+
+		if (!Journal_.isOpen ())
+			return;
+
+		Journal_.write (record);
+
+		if (durable || LastFlush_.elapsed () >= JournalFlushInterval)
+			FlushJournal ();
+
+		if (++JournalRecords_ > 2 * Url2Entry_.size () + CompactionSlack)
+			Compact ();
+	}
+
+	void NetworkDiskCacheIndex::FlushJournal ()
+	{
+		if (Journal_.isOpen ())
+			Journal_.flush ();
+		LastFlush_.restart ();
+	}
+
+	void NetworkDiskCacheIndex::Compact ()
+	{
+		if (IsCompacting_)
+		{
+			RecompactPending_ = true;
+			return;
+		}
+
+		QByteArray snapshot = JournalHeader + '\n';
+		for (auto i = Entries_.rbegin (); i != Entries_.rend (); ++i)
+			snapshot += MakeTouchRecord (i->Url_, i->Size_);
+
+		IsCompacting_ = true;
+		Compaction_ = QtConcurrent::run ([this, snapshot, records = Url2Entry_.size ()]
+				{ WriteCompacted (snapshot, records); });
+	}
+
+	void NetworkDiskCacheIndex::WriteCompacted (const QByteArray& snapshot, int records)
+	{
+		QSaveFile file { JournalPath_ };
+		const bool isOpen = file.open (QIODevice::WriteOnly);
+		if (isOpen)
+			file.write (snapshot);
+		else
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+
+		QMutexLocker locker { &Mutex_ };
+
+		if (isOpen)
+		{
+			file.write (CompactionTail_);
+
+			// Some platforms can't replace a file that is still open.
+			const bool wasOpen = Journal_.isOpen ();
+			Journal_.close ();
+
+			const bool isCommitted = file.commit ();
+			if (isCommitted)
+				JournalRecords_ = records + CompactionTailRecords_;
+			else
+				qWarning () << Q_FUNC_INFO
+						<< "unable to write"
+						<< file.fileName ()
+						<< file.errorString ();
+
+			if ((isCommitted || wasOpen) && !Journal_.open (JournalOpenMode))
+				qWarning () << Q_FUNC_INFO
+						<< "unable to reopen the journal"
+						<< Journal_.fileName ()
+						<< Journal_.errorString ();
+		}
+
+		CompactionTail_.clear ();
+		CompactionTailRecords_ = 0;
+		IsCompacting_ = false;
+
+		if (RecompactPending_)
+		{
+			RecompactPending_ = false;
+			Compact ();
+		}
+	}
+}
+}
@@ -0,0 +1,213 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QUrl>
+#include "networkconfig.h"
+
+namespace LeechCraft
+{
+namespace Util
+{
+	/** @brief Journaled LRU index of a network disk cache directory.
+	 *
+	 * The index keeps the cached URLs along with their sizes ordered by
+	 * the time they were last accessed. Thus the total size of the
+	 * cache is known without walking the cache directory, and the least
+	 * recently used entries can be evicted first.
+	 *
+	 * Each change is appended to a journal file in the cache directory,
+	 * which is replayed when the index is created and compacted once it
+	 * grows too large compared to the index itself. If the journal is
+	 * missing or broken, the index is marked as needing recovery, which
+	 * is then up to the cache to perform (see StartRecovery()).
+	 *
+	 * Records that only change the order of the entries are buffered
+	 * and written at most once a second, while the ones adding, resizing
+	 * or removing entries are written right away. The compaction is done
+	 * in a background thread.
+	 *
+	 * This class is thread-safe.
+	 *
+	 * @sa NetworkDiskCache
+	 *
+	 * @ingroup NetworkUtil
+	 */
+	class UTIL_NETWORK_API NetworkDiskCacheIndex
+	{
+		struct Entry
+		{
+			QUrl Url_;
+			qint64 Size_;
+		};
+		using Entries_t = std::list<Entry>;
+
+		mutable QMutex Mutex_;
+
+		Entries_t Entries_;
+		QHash<QUrl, Entries_t::iterator> Url2Entry_;
+		qint64 TotalSize_ = 0;
+
+		const QString JournalPath_;
+		QFile Journal_;
+		int JournalRecords_ = 0;
+		QElapsedTimer LastFlush_;
+
+		QFuture<void> Compaction_;
+		bool IsCompacting_ = false;
+		bool RecompactPending_ = false;
+		QByteArray CompactionTail_;
+		int CompactionTailRecords_ = 0;
+
+		bool NeedsRecovery_ = false;
+		bool IsRecovering_ = false;
+	public:
+		/** @brief Creates the index replaying the given journal.
+		 *
+		 * @param[in] journalPath The path to the journal file.
+		 */
+		explicit NetworkDiskCacheIndex (const QString& journalPath);
+
+		/** @brief Waits for the compaction and flushes the journal.
+		 */
+		~NetworkDiskCacheIndex ();
+
+		NetworkDiskCacheIndex (const NetworkDiskCacheIndex&) = delete;
+		NetworkDiskCacheIndex& operator= (const NetworkDiskCacheIndex&) = delete;
+
+		/** @brief Returns the index shared by all caches in the directory.
+		 *
+		 * @param[in] cacheDir The cache directory.
+		 * @return The index for the \em cacheDir, created if needed.
+		 */
+		static std::shared_ptr<NetworkDiskCacheIndex> ForDirectory (const QString& cacheDir);
+
+		/** @brief Returns the total size of the indexed entries.
+		 *
+		 * This function runs in O(1).
+		 *
+		 * @return The total size of the indexed entries in bytes.
+		 */
+		qint64 GetTotalSize () const;
+
+		/** @brief Returns the number of the indexed entries.
+		 *
+		 * @return The number of the indexed entries.
+		 */
+		int GetCount () const;
+
+		/** @brief Marks the \em url as the most recently used one.
+		 *
+		 * The \em url is added to the index if it isn't there yet.
+		 *
+		 * @param[in] url The URL of the cache entry.
+		 * @param[in] size The size of the body of the cache entry.
+		 */
+		void Touch (const QUrl& url, qint64 size);
+
+		/** @brief Removes the \em url from the index.
+		 *
+		 * @param[in] url The URL of the cache entry.
+		 */
+		void Remove (const QUrl& url);
+
+		/** @brief Removes the least recently used entries from the index.
+		 *
+		 * Entries are removed until the total size is not greater than
+		 * the \em goal. The caller is expected to remove the returned
+		 * entries from the cache itself.
+		 *
+		 * @param[in] goal The desired total size of the index.
+		 * @return The removed URLs, the least recently used first.
+		 */
+		QList<QUrl> TakeLeastRecent (qint64 goal);
+
+		/** @brief Removes all entries from the index.
+		 */
+		void Clear ();
+
+		/** @brief Returns whether the index needs to be recovered.
+		 *
+		 * @return Whether the journal was missing or broken and the
+		 * recovery hasn't been finished yet.
+		 */
+		bool NeedsRecovery () const;
+
+		/** @brief Claims the recovery of the index if it is needed.
+		 *
+		 * If this function returns <code>true</code>, the caller is
+		 * expected to collect the entries present in the cache directory
+		 * and pass them to FinishRecovery(), or to call AbortRecovery().
+		 *
+		 * @return Whether the caller should perform the recovery.
+		 */
+		bool StartRecovery ();
+
+		/** @brief Adds the recovered entries to the index.
+		 *
+		 * The entries are added as less recently used than any entry
+		 * already present in the index. Entries already present in the
+		 * index are ignored.
+		 *
+		 * @param[in] entries The recovered URLs and sizes, the least
+		 * recently used first.
+		 */
+		void FinishRecovery (const QList<QPair<QUrl, qint64>>& entries);
+
+		/** @brief Gives up the recovery claimed by StartRecovery().
+		 */
+		void AbortRecovery ();
+	private:
+		void Replay (const QString&);
+		bool ApplyRecord (const QByteArray&);
+
+		enum class TouchResult
+		{
+			Unchanged,
+			Reordered,
+			Changed
+		};
+		TouchResult TouchImpl (const QUrl&, qint64);
+		bool RemoveImpl (const QUrl&);
+
+		void AppendRecord (const QByteArray&, bool durable);
+		void FlushJournal ();
+		void Compact ();
+		void WriteCompacted (const QByteArray&, int);
+	};
+}
+}
@@ -0,0 +1,197 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "networkdiskcache_bench.h"
+#include <memory>
+#include <QtTest>
+#include <QFile>
+#include <QStandardPaths>
+#include "networkdiskcache.h"
+#include "networkdiskcachefront.h"
+
+QTEST_MAIN (LeechCraft::Util::NetworkDiskCache_Bench)
+
+namespace LeechCraft
+{
+namespace Util
+{
+	namespace
+	{
+		const QString CacheSubpath = "bench";
+
+		/** Reads a recorded trace, one "size url" request per line.
+		 */
+		QList<QPair<QUrl, qint64>> ReadTrace (const QString& path)
+		{
+			QFile file { path };
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< path
+						<< file.errorString ();
+				return {};
+			}
+
+			QList<QPair<QUrl, qint64>> trace;
+			while (!file.atEnd ())
+			{
+				const auto& line = file.readLine ().trimmed ();
+				const auto space = line.indexOf (' ');
+				if (space <= 0)
+					continue;
+
+				trace.append ({ QUrl::fromEncoded (line.mid (space + 1)), line.left (space).toLongLong () });
+			}
+			return trace;
+		}
+
+		/** Models loading a few pages of several sites: each page load
+		 * requests the page itself, the resources of its site and the
+		 * resources shared by all sites (fonts, scripts from a CDN), most
+		 * of them small.
+		 */
+		QList<QPair<QUrl, qint64>> MakeTrace ()
+		{
+			const int sitesCount = 5;
+			const int siteResources = 150;
+			const int sharedResources = 40;
+
+			auto getSize = [] (int num) -> qint64
+			{
+				return num % 20 ? 512 + (num * 7919) % (24 * 1024) : 256 * 1024;
+			};
+
+			QList<QPair<QUrl, qint64>> trace;
+			for (int visit : { 0, 1, 0, 2, 0, 3, 1, 4, 0, 2 })
+			{
+				const auto& site = QString { "http://site%1.example.com/" }.arg (visit % sitesCount);
+				trace.append ({ QUrl { site + "index.html" }, 48 * 1024 });
+
+				for (int i = 0; i < siteResources; ++i)
+					trace.append ({ QUrl { site + QString { "static/%1.png" }.arg (i) }, getSize (i) });
+				for (int i = 0; i < sharedResources; ++i)
+					trace.append ({ QUrl { QString { "http://cdn.example.com/lib/%1.js" }.arg (i) }, getSize (i + 1) });
+			}
+			return trace;
+		}
+
+		void Populate (QAbstractNetworkCache& cache, const QList<QPair<QUrl, qint64>>& trace)
+		{
+			QSet<QUrl> seen;
+			for (const auto& request : trace)
+			{
+				if (seen.contains (request.first))
+					continue;
+				seen << request.first;
+
+				QNetworkCacheMetaData metaData;
+				metaData.setUrl (request.first);
+				metaData.setSaveToDisk (true);
+				metaData.setExpirationDate (QDateTime::currentDateTime ().addDays (1));
+				metaData.setRawHeaders ({
+							{ "Content-Type", "application/octet-stream" },
+							{ "Content-Length", QByteArray::number (request.second) }
+						});
+
+				const auto dev = cache.prepare (metaData);
+				if (!dev)
+					continue;
+
+				dev->write (QByteArray (request.second, 'x'));
+				cache.insert (dev);
+			}
+		}
+
+		void Replay (QAbstractNetworkCache& cache, const QList<QPair<QUrl, qint64>>& trace)
+		{
+			for (const auto& request : trace)
+			{
+				if (!cache.metaData (request.first).isValid ())
+					continue;
+
+				const std::unique_ptr<QIODevice> dev { cache.data (request.first) };
+				if (dev)
+					dev->readAll ();
+			}
+		}
+	}
+
+	void NetworkDiskCache_Bench::initTestCase ()
+	{
+		QStandardPaths::setTestModeEnabled (true);
+
+		const auto& tracePath = qgetenv ("LC_NETWORKDISKCACHE_TRACE");
+		Trace_ = tracePath.isEmpty () ?
+				MakeTrace () :
+				ReadTrace (QString::fromLocal8Bit (tracePath));
+		QVERIFY (!Trace_.isEmpty ());
+
+		NetworkDiskCache cache { CacheSubpath };
+		cache.setMaximumCacheSize (1024 * 1024 * 1024);
+
+		QNetworkDiskCache leftovers;
+		leftovers.setCacheDirectory (cache.cacheDirectory ());
+		leftovers.clear ();
+
+		Populate (cache, Trace_);
+	}
+
+	void NetworkDiskCache_Bench::benchReplayTrace_data ()
+	{
+		QTest::addColumn<bool> ("useFront");
+
+		QTest::newRow ("disk") << false;
+		QTest::newRow ("front") << true;
+	}
+
+	void NetworkDiskCache_Bench::benchReplayTrace ()
+	{
+		QFETCH (bool, useFront);
+
+		NetworkDiskCache cache { CacheSubpath };
+		cache.setMaximumCacheSize (1024 * 1024 * 1024);
+
+		if (!useFront)
+		{
+			QNetworkDiskCache plain;
+			plain.setCacheDirectory (cache.cacheDirectory ());
+			plain.setMaximumCacheSize (1024 * 1024 * 1024);
+			QBENCHMARK { Replay (plain, Trace_); }
+			return;
+		}
+
+		QBENCHMARK { Replay (cache, Trace_); }
+
+		const auto& stats = cache.GetFrontCache ()->GetStats ();
+		qDebug () << "metadata hits:" << stats.MetaDataHits_ << "misses:" << stats.MetaDataMisses_;
+		qDebug () << "data hits:" << stats.DataHits_ << "misses:" << stats.DataMisses_;
+	}
+}
+}
@@ -0,0 +1,158 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "networkdiskcachefronttest.h"
+#include <QtTest>
+#include "networkdiskcachefront.h"
+
+QTEST_MAIN (LeechCraft::Util::NetworkDiskCacheFrontTest)
+
+namespace LeechCraft
+{
+namespace Util
+{
+	namespace
+	{
+		QUrl MakeUrl (int num)
+		{
+			return QUrl { "http://example.com/" + QString::number (num) };
+		}
+
+		QNetworkCacheMetaData MakeMetaData (int num)
+		{
+			QNetworkCacheMetaData metaData;
+			metaData.setUrl (MakeUrl (num));
+			metaData.setRawHeaders ({ { "ETag", QByteArray::number (num) } });
+			return metaData;
+		}
+	}
+
+	void NetworkDiskCacheFrontTest::testMetaDataLookup ()
+	{
+		NetworkDiskCacheFront front { 1024 * 1024, 1024 };
+
+		QVERIFY (!front.GetMetaData (MakeUrl (0)));
+
+		front.SetMetaData (MakeUrl (0), MakeMetaData (0), front.GetGeneration (MakeUrl (0)));
+		const auto& metaData = front.GetMetaData (MakeUrl (0));
+		QVERIFY (metaData);
+		QCOMPARE (*metaData, MakeMetaData (0));
+
+		const auto& stats = front.GetStats ();
+		QCOMPARE (stats.MetaDataHits_, quint64 { 1 });
+		QCOMPARE (stats.MetaDataMisses_, quint64 { 1 });
+	}
+
+	void NetworkDiskCacheFrontTest::testNegativeLookup ()
+	{
+		NetworkDiskCacheFront front { 1024 * 1024, 1024 };
+
+		front.SetBody (MakeUrl (0), "body", front.GetGeneration (MakeUrl (0)));
+		front.SetMetaData (MakeUrl (0), {}, front.GetGeneration (MakeUrl (0)));
+
+		const auto& metaData = front.GetMetaData (MakeUrl (0));
+		QVERIFY (metaData);
+		QVERIFY (!metaData->isValid ());
+		QVERIFY (!front.GetBody (MakeUrl (0)));
+	}
+
+	void NetworkDiskCacheFrontTest::testBodyLookup ()
+	{
+		NetworkDiskCacheFront front { 1024 * 1024, 1024 };
+
+		front.SetMetaData (MakeUrl (0), MakeMetaData (0), front.GetGeneration (MakeUrl (0)));
+		front.SetBody (MakeUrl (0), "body", front.GetGeneration (MakeUrl (0)));
+		front.SetBody (MakeUrl (1), QByteArray (2048, 'x'), front.GetGeneration (MakeUrl (1)));
+
+		QCOMPARE (front.GetBody (MakeUrl (0)), boost::optional<QByteArray> { "body" });
+		QVERIFY (!front.GetBody (MakeUrl (1)));
+
+		const auto& stats = front.GetStats ();
+		QCOMPARE (stats.DataHits_, quint64 { 1 });
+		QCOMPARE (stats.DataMisses_, quint64 { 1 });
+	}
+
+	void NetworkDiskCacheFrontTest::testInvalidate ()
+	{
+		NetworkDiskCacheFront front { 1024 * 1024, 1024 };
+
+		for (int i = 0; i < 4; ++i)
+		{
+			front.SetMetaData (MakeUrl (i), MakeMetaData (i), front.GetGeneration (MakeUrl (i)));
+			front.SetBody (MakeUrl (i), "body", front.GetGeneration (MakeUrl (i)));
+		}
+
+		front.Invalidate (MakeUrl (0));
+		QVERIFY (!front.GetMetaData (MakeUrl (0)));
+		QVERIFY (!front.GetBody (MakeUrl (0)));
+		QVERIFY (front.GetMetaData (MakeUrl (1)));
+
+		front.Clear ();
+		QCOMPARE (front.GetCost (), qint64 { 0 });
+		for (int i = 0; i < 4; ++i)
+			QVERIFY (!front.GetMetaData (MakeUrl (i)));
+	}
+
+	void NetworkDiskCacheFrontTest::testStaleFill ()
+	{
+		NetworkDiskCacheFront front { 1024 * 1024, 1024 };
+
+		const auto generation = front.GetGeneration (MakeUrl (0));
+		front.Invalidate (MakeUrl (0));
+		front.SetMetaData (MakeUrl (0), MakeMetaData (0), generation);
+		front.SetBody (MakeUrl (0), "stale", generation);
+		QVERIFY (!front.GetMetaData (MakeUrl (0)));
+		QVERIFY (!front.GetBody (MakeUrl (0)));
+
+		const auto beforeClear = front.GetGeneration (MakeUrl (1));
+		front.Clear ();
+		front.SetBody (MakeUrl (1), "stale", beforeClear);
+		QVERIFY (!front.GetBody (MakeUrl (1)));
+
+		front.SetBody (MakeUrl (0), "fresh", front.GetGeneration (MakeUrl (0)));
+		QCOMPARE (front.GetBody (MakeUrl (0)), boost::optional<QByteArray> { "fresh" });
+	}
+
+	void NetworkDiskCacheFrontTest::testBudget ()
+	{
+		const qint64 budget = 64 * 1024;
+		NetworkDiskCacheFront front { budget, 1024 };
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			front.SetMetaData (MakeUrl (i), MakeMetaData (i), front.GetGeneration (MakeUrl (i)));
+			front.SetBody (MakeUrl (i), QByteArray (1024, 'x'), front.GetGeneration (MakeUrl (i)));
+		}
+
+		QVERIFY (front.GetCost () <= budget);
+		QVERIFY (front.GetBody (MakeUrl (999)));
+		QVERIFY (!front.GetBody (MakeUrl (0)));
+	}
+}
+}
@@ -0,0 +1,181 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "networkdiskcacheindextest.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include "networkdiskcacheindex.h"
+
+QTEST_MAIN (LeechCraft::Util::NetworkDiskCacheIndexTest)
+
+namespace LeechCraft
+{
+namespace Util
+{
+	namespace
+	{
+		QUrl MakeUrl (int num)
+		{
+			return QUrl { "http://example.com/" + QString::number (num) };
+		}
+
+		QString GetJournalPath (const QTemporaryDir& dir)
+		{
+			return dir.path () + "/lru.journal";
+		}
+
+		void Recover (NetworkDiskCacheIndex& index)
+		{
+			QVERIFY (index.StartRecovery ());
+			index.FinishRecovery ({});
+		}
+	}
+
+	void NetworkDiskCacheIndexTest::testLRUOrder ()
+	{
+		QTemporaryDir dir;
+		NetworkDiskCacheIndex index { GetJournalPath (dir) };
+		Recover (index);
+
+		for (int i = 0; i < 4; ++i)
+			index.Touch (MakeUrl (i), 10);
+		index.Touch (MakeUrl (0), 10);
+
+		QCOMPARE (index.TakeLeastRecent (20), (QList<QUrl> { MakeUrl (1), MakeUrl (2) }));
+		QCOMPARE (index.TakeLeastRecent (0), (QList<QUrl> { MakeUrl (3), MakeUrl (0) }));
+	}
+
+	void NetworkDiskCacheIndexTest::testSizeAccounting ()
+	{
+		QTemporaryDir dir;
+		NetworkDiskCacheIndex index { GetJournalPath (dir) };
+		Recover (index);
+
+		index.Touch (MakeUrl (0), 10);
+		index.Touch (MakeUrl (1), 20);
+		index.Touch (MakeUrl (0), 5);
+		QCOMPARE (index.GetTotalSize (), Q_INT64_C (25));
+
+		index.Remove (MakeUrl (1));
+		index.Remove (MakeUrl (2));
+		QCOMPARE (index.GetTotalSize (), Q_INT64_C (5));
+		QCOMPARE (index.GetCount (), 1);
+	}
+
+	void NetworkDiskCacheIndexTest::testReplay ()
+	{
+		QTemporaryDir dir;
+
+		{
+			NetworkDiskCacheIndex index { GetJournalPath (dir) };
+			Recover (index);
+
+			for (int i = 0; i < 5; ++i)
+				index.Touch (MakeUrl (i), i + 1);
+			index.Remove (MakeUrl (2));
+			index.Touch (MakeUrl (0), 1);
+		}
+
+		NetworkDiskCacheIndex index { GetJournalPath (dir) };
+		QVERIFY (!index.NeedsRecovery ());
+		QCOMPARE (index.GetTotalSize (), Q_INT64_C (12));
+		QCOMPARE (index.TakeLeastRecent (0),
+				(QList<QUrl> { MakeUrl (1), MakeUrl (3), MakeUrl (4), MakeUrl (0) }));
+	}
+
+	void NetworkDiskCacheIndexTest::testCompaction ()
+	{
+		QTemporaryDir dir;
+
+		{
+			NetworkDiskCacheIndex index { GetJournalPath (dir) };
+			Recover (index);
+
+			for (int i = 0; i < 10000; ++i)
+				index.Touch (MakeUrl (i % 10), 1);
+		}
+
+		QFile journal { GetJournalPath (dir) };
+		QVERIFY (journal.open (QIODevice::ReadOnly));
+		QVERIFY (journal.readAll ().count ('\n') < 2000);
+		journal.close ();
+
+		NetworkDiskCacheIndex index { GetJournalPath (dir) };
+		QCOMPARE (index.GetCount (), 10);
+		QCOMPARE (index.TakeLeastRecent (9), QList<QUrl> { MakeUrl (0) });
+	}
+
+	void NetworkDiskCacheIndexTest::testRecovery ()
+	{
+		QTemporaryDir dir;
+
+		{
+			NetworkDiskCacheIndex index { GetJournalPath (dir) };
+			QVERIFY (index.NeedsRecovery ());
+			QVERIFY (index.StartRecovery ());
+			QVERIFY (!index.StartRecovery ());
+
+			index.Touch (MakeUrl (0), 1);
+			index.AbortRecovery ();
+		}
+
+		NetworkDiskCacheIndex index { GetJournalPath (dir) };
+		QVERIFY (index.NeedsRecovery ());
+		QVERIFY (index.StartRecovery ());
+
+		index.Touch (MakeUrl (0), 1);
+		index.FinishRecovery ({ { MakeUrl (1), 10 }, { MakeUrl (0), 10 }, { MakeUrl (2), 10 } });
+		QVERIFY (!index.NeedsRecovery ());
+		QCOMPARE (index.GetTotalSize (), Q_INT64_C (21));
+		QCOMPARE (index.TakeLeastRecent (0),
+				(QList<QUrl> { MakeUrl (1), MakeUrl (2), MakeUrl (0) }));
+	}
+
+	void NetworkDiskCacheIndexTest::testBrokenJournal ()
+	{
+		QTemporaryDir dir;
+
+		{
+			NetworkDiskCacheIndex index { GetJournalPath (dir) };
+			Recover (index);
+			index.Touch (MakeUrl (0), 1);
+		}
+
+		{
+			QFile journal { GetJournalPath (dir) };
+			QVERIFY (journal.open (QIODevice::WriteOnly | QIODevice::Append));
+			journal.write ("X garbage\nT 1 " + MakeUrl (1).toEncoded () + '\n');
+		}
+
+		NetworkDiskCacheIndex index { GetJournalPath (dir) };
+		QVERIFY (index.NeedsRecovery ());
+		QCOMPARE (index.GetCount (), 0);
+	}
+}
+}